@@ -37,6 +37,15 @@
 	G_FILE_ATTRIBUTE_STANDARD_CONTENT_TYPE "," \
         G_FILE_ATTRIBUTE_TIME_MODIFIED
 
+/* Number of files enumerated at once */
+#define ENUMERATE_BATCH_SIZE 64
+
+/* Maximum number of pictures decoded at the same time */
+#define MAX_RUNNING_JOBS 4
+
+/* Size of GNOME_DESKTOP_THUMBNAIL_SIZE_LARGE thumbnails */
+#define LARGE_THUMBNAIL_SIZE 256
+
 struct _BgPicturesSource
 {
   BgSource parent_instance;
@@ -51,8 +60,38 @@ struct _BgPicturesSource
   GFileMonitor *cache_dir_monitor;
 
   GHashTable *known_items;
+
+  cairo_surface_t *loading_icon;
+
+  GSequence *pending_jobs;
+  guint n_running_jobs;
+  guint max_running_jobs;
+
+  /* Modification times of the newest and oldest pictures that would be
+   * shown in the view */
+  guint64 visible_newest;
+  guint64 visible_oldest;
 };
 
+typedef struct
+{
+  CcBackgroundItem *item;
+  GFile *file;
+  gchar *uri;
+  gchar *content_type;
+  guint64 mtime;
+  gint width;
+  gint height;
+  gboolean prioritized;
+  gboolean is_screenshot;
+
+  /* Set when the thumbnail cache can be used */
+  GnomeDesktopThumbnailFactory *thumb_factory;
+
+  /* Set when the thumbnail at this size is kept in our own cache */
+  gchar *cache_path;
+} ThumbnailJob;
+
 G_DEFINE_TYPE (BgPicturesSource, bg_pictures_source, BG_TYPE_SOURCE)
 
 const char * const content_types[] = {
@@ -71,8 +110,8 @@ const char * const screenshot_types[] = {
 };
 
 static char *bg_pictures_source_get_unique_filename (const char *uri);
+static void thumbnail_job_free (ThumbnailJob *job);
 
-static void picture_opened_for_read (GObject *source_object, GAsyncResult *res, gpointer user_data);
 
 static void
 bg_pictures_source_dispose (GObject *object)
@@ -99,6 +138,12 @@ bg_pictures_source_finalize (GObject *object)
   g_clear_object (&bg_source->thumb_factory);
 
   g_clear_pointer (&bg_source->known_items, g_hash_table_destroy);
+  g_clear_pointer (&bg_source->loading_icon, (GDestroyNotify) cairo_surface_destroy);
+  if (bg_source->pending_jobs)
+    {
+      g_sequence_foreach (bg_source->pending_jobs, (GFunc) thumbnail_job_free, NULL);
+      g_clear_pointer (&bg_source->pending_jobs, g_sequence_free);
+    }
 
   g_clear_object (&bg_source->picture_dir_monitor);
   g_clear_object (&bg_source->cache_dir_monitor);
@@ -163,169 +208,426 @@ swap_rotated_pixbuf (GdkPixbuf *pixbuf)
   return tmp_pixbuf;
 }
 
+static gboolean
+in_content_types (const char *content_type)
+{
+	guint i;
+	for (i = 0; content_types[i]; i++)
+		if (g_str_equal (content_types[i], content_type))
+			return TRUE;
+	return FALSE;
+}
+
+static gboolean
+in_screenshot_types (const char *content_type)
+{
+	guint i;
+	for (i = 0; screenshot_types[i]; i++)
+		if (g_str_equal (screenshot_types[i], content_type))
+			return TRUE;
+	return FALSE;
+}
+
 static void
-picture_scaled (GObject *source_object,
-                GAsyncResult *res,
-                gpointer user_data)
+thumbnail_job_free (ThumbnailJob *job)
 {
-  BgPicturesSource *bg_source;
-  CcBackgroundItem *item;
-  GError *error = NULL;
+  g_clear_object (&job->item);
+  g_clear_object (&job->file);
+  g_clear_object (&job->thumb_factory);
+  g_free (job->uri);
+  g_free (job->content_type);
+  g_free (job->cache_path);
+  g_free (job);
+}
+
+static gboolean
+thumbnail_job_is_visible (BgPicturesSource   *bg_source,
+                          const ThumbnailJob *job)
+{
+  return job->mtime <= bg_source->visible_newest &&
+         job->mtime >= bg_source->visible_oldest;
+}
+
+/* Pictures added by the user come first, then the ones in view, then the
+ * most recent ones, which is the order they are shown in.
+ */
+static gint
+thumbnail_job_compare (gconstpointer a,
+                       gconstpointer b,
+                       gpointer      user_data)
+{
+  BgPicturesSource *bg_source = user_data;
+  const ThumbnailJob *job_a = a;
+  const ThumbnailJob *job_b = b;
+  gboolean visible_a;
+  gboolean visible_b;
+
+  if (job_a->prioritized != job_b->prioritized)
+    return job_a->prioritized ? -1 : 1;
+
+  visible_a = thumbnail_job_is_visible (bg_source, job_a);
+  visible_b = thumbnail_job_is_visible (bg_source, job_b);
+  if (visible_a != visible_b)
+    return visible_a ? -1 : 1;
+
+  if (job_a->mtime != job_b->mtime)
+    return job_a->mtime > job_b->mtime ? -1 : 1;
+
+  return 0;
+}
+
+static GdkPixbuf *
+scale_to_fit (GdkPixbuf *pixbuf,
+              gint       width,
+              gint       height)
+{
+  gint pixbuf_width, pixbuf_height;
+  gdouble ratio;
+
+  pixbuf_width = gdk_pixbuf_get_width (pixbuf);
+  pixbuf_height = gdk_pixbuf_get_height (pixbuf);
+
+  ratio = MIN ((gdouble) width / pixbuf_width, (gdouble) height / pixbuf_height);
+  if (ratio >= 1.0)
+    return g_object_ref (pixbuf);
+
+  return gdk_pixbuf_scale_simple (pixbuf,
+                                  MAX (1, (gint) (pixbuf_width * ratio)),
+                                  MAX (1, (gint) (pixbuf_height * ratio)),
+                                  GDK_INTERP_BILINEAR);
+}
+
+/* Loads the freedesktop.org thumbnail of the picture, creating it if
+ * needed. Thumbnails are keyed by URI and modification time, so they are
+ * shared with the file manager and only regenerated when the picture
+ * changes. Their orientation is already applied.
+ */
+static GdkPixbuf *
+load_from_thumbnail_cache (ThumbnailJob *job)
+{
+  g_autofree gchar *thumbnail_path = NULL;
+  g_autoptr(GdkPixbuf) thumbnail = NULL;
+
+  thumbnail_path = gnome_desktop_thumbnail_factory_lookup (job->thumb_factory, job->uri, job->mtime);
+  if (thumbnail_path != NULL)
+    return gdk_pixbuf_new_from_file_at_scale (thumbnail_path, job->width, job->height, TRUE, NULL);
+
+  if (gnome_desktop_thumbnail_factory_has_valid_failed_thumbnail (job->thumb_factory, job->uri, job->mtime) ||
+      !gnome_desktop_thumbnail_factory_can_thumbnail (job->thumb_factory, job->uri, job->content_type, job->mtime))
+    return NULL;
+
+  thumbnail = gnome_desktop_thumbnail_factory_generate_thumbnail (job->thumb_factory, job->uri, job->content_type);
+  if (thumbnail == NULL)
+    {
+      gnome_desktop_thumbnail_factory_create_failed_thumbnail (job->thumb_factory, job->uri, job->mtime);
+      return NULL;
+    }
+
+  gnome_desktop_thumbnail_factory_save_thumbnail (job->thumb_factory, thumbnail, job->uri, job->mtime);
+
+  return scale_to_fit (thumbnail, job->width, job->height);
+}
+
+/* Thumbnails at the size of the view are kept under the user cache
+ * directory, as the freedesktop.org ones are too small for HiDPI. Like
+ * those, they record the URI and modification time of the picture.
+ */
+static GdkPixbuf *
+load_from_scaled_cache (ThumbnailJob *job)
+{
+  g_autoptr(GdkPixbuf) pixbuf = NULL;
+  g_autofree gchar *mtime = NULL;
+
+  pixbuf = gdk_pixbuf_new_from_file (job->cache_path, NULL);
+  if (pixbuf == NULL)
+    return NULL;
+
+  mtime = g_strdup_printf ("%" G_GUINT64_FORMAT, job->mtime);
+  if (g_strcmp0 (gdk_pixbuf_get_option (pixbuf, "tEXt::Thumb::URI"), job->uri) != 0 ||
+      g_strcmp0 (gdk_pixbuf_get_option (pixbuf, "tEXt::Thumb::MTime"), mtime) != 0)
+    return NULL;
+
+  return g_steal_pointer (&pixbuf);
+}
+
+static void
+save_to_scaled_cache (ThumbnailJob *job,
+                      GdkPixbuf    *pixbuf)
+{
+  g_autoptr(GError) error = NULL;
+  g_autofree gchar *dir = NULL;
+  g_autofree gchar *mtime = NULL;
+  g_autofree gchar *buffer = NULL;
+  gsize size;
+
+  dir = g_path_get_dirname (job->cache_path);
+  if (g_mkdir_with_parents (dir, 0700) != 0)
+    return;
+
+  /* Written to a temporary file which is then renamed, so that a partial
+   * thumbnail is never read */
+  mtime = g_strdup_printf ("%" G_GUINT64_FORMAT, job->mtime);
+  if (!gdk_pixbuf_save_to_buffer (pixbuf, &buffer, &size, "png", &error,
+                                  "tEXt::Thumb::URI", job->uri,
+                                  "tEXt::Thumb::MTime", mtime,
+                                  NULL) ||
+      !g_file_set_contents (job->cache_path, buffer, size, &error))
+    g_debug ("Failed to cache the thumbnail of '%s': %s", job->uri, error->message);
+}
+
+static GdkPixbuf *
+load_from_file (ThumbnailJob  *job,
+                gint           width,
+                gint           height,
+                GCancellable  *cancellable,
+                GError       **error)
+{
+  g_autoptr(GFileInputStream) stream = NULL;
+
+  stream = g_file_read (job->file, cancellable, error);
+  if (stream == NULL)
+    return NULL;
+
+  return gdk_pixbuf_new_from_stream_at_scale (G_INPUT_STREAM (stream),
+                                              width, height,
+                                              TRUE,
+                                              cancellable,
+                                              error);
+}
+
+static void
+load_thumbnail_thread (GTask        *task,
+                       gpointer      source_object,
+                       gpointer      task_data,
+                       GCancellable *cancellable)
+{
+  ThumbnailJob *job = task_data;
   GdkPixbuf *pixbuf = NULL;
+  GError *error = NULL;
   const char *software;
-  const char *uri;
-  GtkTreeIter iter;
-  GtkTreePath *path;
-  GtkTreeRowReference *row_ref;
-  GtkListStore *store;
-  cairo_surface_t *surface = NULL;
-  int scale_factor;
-  gboolean rotation_applied;
 
-  item = g_object_get_data (source_object, "item");
-  pixbuf = gdk_pixbuf_new_from_stream_finish (res, &error);
-  if (pixbuf == NULL)
-    {
-      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
-        {
-          g_warning ("Failed to load image: %s", error->message);
-          remove_placeholder (BG_PICTURES_SOURCE (user_data), item);
-        }
+  if (job->cache_path != NULL)
+    pixbuf = load_from_scaled_cache (job);
 
-      g_error_free (error);
-      goto out;
+  if (pixbuf == NULL && job->thumb_factory != NULL)
+    pixbuf = load_from_thumbnail_cache (job);
+
+  if (pixbuf != NULL)
+    {
+      g_task_return_pointer (task, pixbuf, g_object_unref);
+      return;
     }
 
-  /* since we were not cancelled, we can now cast user_data
-   * back to BgPicturesSource.
-   */
-  bg_source = BG_PICTURES_SOURCE (user_data);
-  store = bg_source_get_liststore (BG_SOURCE (bg_source));
-  uri = cc_background_item_get_uri (item);
-  if (uri == NULL)
-    uri = cc_background_item_get_source_url (item);
+  pixbuf = load_from_file (job, job->width, job->height, cancellable, &error);
+  if (pixbuf == NULL)
+    {
+      g_task_return_error (task, error);
+      return;
+    }
 
   /* Ignore screenshots */
   software = gdk_pixbuf_get_option (pixbuf, "tEXt::Software");
   if (software != NULL &&
       g_str_equal (software, "gnome-screenshot"))
     {
-      g_debug ("Ignored URL '%s' as it's a screenshot from gnome-screenshot", uri);
-      remove_placeholder (BG_PICTURES_SOURCE (user_data), item);
-      goto out;
+      job->is_screenshot = TRUE;
+      g_object_unref (pixbuf);
+      g_task_return_pointer (task, NULL, NULL);
+      return;
     }
 
   /* Process embedded orientation */
-  rotation_applied = GPOINTER_TO_INT (g_object_get_data (G_OBJECT (item), "rotation-applied"));
-
-  if (!rotation_applied && picture_needs_rotation (pixbuf))
+  if (picture_needs_rotation (pixbuf))
     {
+      GdkPixbuf *rotated;
+
       /* the width and height of pixbuf we requested are wrong for EXIF
        * orientations 5, 6, 7 and 8. the file has to be reloaded. */
-      GFile *file;
-
-      file = g_file_new_for_uri (uri);
-      g_object_set_data (G_OBJECT (item), "needs-rotation", GINT_TO_POINTER (TRUE));
-      g_object_set_data_full (G_OBJECT (file), "item", g_object_ref (item), g_object_unref);
-      g_file_read_async (G_FILE (file), G_PRIORITY_DEFAULT,
-                         bg_source->cancellable,
-                         picture_opened_for_read, bg_source);
-      g_object_unref (file);
-      goto out;
+      rotated = load_from_file (job, job->height, job->width, cancellable, NULL);
+      if (rotated != NULL)
+        {
+          g_object_unref (pixbuf);
+          pixbuf = rotated;
+        }
     }
 
   pixbuf = swap_rotated_pixbuf (pixbuf);
 
-  scale_factor = bg_source_get_scale_factor (BG_SOURCE (bg_source));
-  surface = gdk_cairo_surface_create_from_pixbuf (pixbuf, scale_factor, NULL);
-  cc_background_item_load (item, NULL);
+  if (job->cache_path != NULL)
+    save_to_scaled_cache (job, pixbuf);
 
-  row_ref = g_object_get_data (G_OBJECT (item), "row-ref");
-  if (row_ref == NULL)
+  g_task_return_pointer (task, pixbuf, g_object_unref);
+}
+
+static void thumbnail_loaded (GObject *source_object, GAsyncResult *res, gpointer user_data);
+
+static void
+process_pending_jobs (BgPicturesSource *bg_source)
+{
+  while (bg_source->n_running_jobs < bg_source->max_running_jobs)
     {
-      /* insert the item into the liststore if it did not exist */
-      gtk_list_store_insert_with_values (store, NULL, -1,
-                                         0, surface,
-                                         1, item,
-                                         -1);
+      GSequenceIter *iter;
+      ThumbnailJob *job;
+      GTask *task;
+
+      iter = g_sequence_get_begin_iter (bg_source->pending_jobs);
+      if (g_sequence_iter_is_end (iter))
+        break;
+
+      /* the task takes over the job */
+      job = g_sequence_get (iter);
+      g_sequence_remove (iter);
+
+      /* the task must not keep the source alive, so that disposing it
+       * cancels the jobs that are running */
+      task = g_task_new (NULL, bg_source->cancellable, thumbnail_loaded, bg_source);
+      g_task_set_task_data (task, job, (GDestroyNotify) thumbnail_job_free);
+      g_task_run_in_thread (task, load_thumbnail_thread);
+      g_object_unref (task);
+
+      bg_source->n_running_jobs++;
     }
-  else
+}
+
+/* Decoding is done in threads, with at most max_running_jobs at a time so
+ * that a big Pictures folder does not decode all of its pictures at once.
+ */
+static void
+queue_thumbnail_job (BgPicturesSource *bg_source,
+                     CcBackgroundItem *item,
+                     GFile            *file,
+                     const gchar      *content_type,
+                     gboolean          use_thumbnail_cache,
+                     gboolean          prioritized)
+{
+  ThumbnailJob *job;
+
+  job = g_new0 (ThumbnailJob, 1);
+  job->item = g_object_ref (item);
+  job->file = g_object_ref (file);
+  job->uri = g_file_get_uri (file);
+  job->content_type = g_strdup (content_type);
+  job->mtime = cc_background_item_get_modified (item);
+  job->width = bg_source_get_thumbnail_width (BG_SOURCE (bg_source));
+  job->height = bg_source_get_thumbnail_height (BG_SOURCE (bg_source));
+  job->prioritized = prioritized;
+
+  /* Large thumbnails are too small for HiDPI, and screenshots have to be
+   * told apart by their metadata, which thumbnails do not keep.
+   */
+  if (use_thumbnail_cache &&
+      content_type != NULL &&
+      !in_screenshot_types (content_type) &&
+      job->width <= LARGE_THUMBNAIL_SIZE &&
+      job->height <= LARGE_THUMBNAIL_SIZE)
+    job->thumb_factory = g_object_ref (bg_source->thumb_factory);
+
+  /* Otherwise the thumbnail gets cached at the size it is shown at. Only
+   * pictures which are not screenshots end up there.
+   */
+  if (use_thumbnail_cache && job->thumb_factory == NULL)
     {
-      path = gtk_tree_row_reference_get_path (row_ref);
-      if (gtk_tree_model_get_iter (GTK_TREE_MODEL (store), &iter, path))
-        {
-          /* otherwise update the thumbnail */
-          gtk_list_store_set (store, &iter,
-                              0, surface,
-                              -1);
-        }
+      g_autofree gchar *size = NULL;
+      g_autofree gchar *filename = NULL;
+      g_autofree gchar *name = NULL;
+
+      size = g_strdup_printf ("%dx%d@%d", job->width, job->height,
+                              bg_source_get_scale_factor (BG_SOURCE (bg_source)));
+      filename = bg_pictures_source_get_unique_filename (job->uri);
+      name = g_strconcat (filename, ".png", NULL);
+      job->cache_path = g_build_filename (g_get_user_cache_dir (),
+                                          "gnome-control-center",
+                                          "background-thumbnails",
+                                          size,
+                                          name,
+                                          NULL);
     }
 
-  g_hash_table_insert (bg_source->known_items,
-                       bg_pictures_source_get_unique_filename (uri),
-                       GINT_TO_POINTER (TRUE));
+  g_sequence_insert_sorted (bg_source->pending_jobs, job, thumbnail_job_compare, bg_source);
 
-
- out:
-  g_clear_pointer (&surface, (GDestroyNotify) cairo_surface_destroy);
-  g_clear_object (&pixbuf);
+  process_pending_jobs (bg_source);
 }
 
 static void
-picture_opened_for_read (GObject *source_object,
-                         GAsyncResult *res,
-                         gpointer user_data)
+thumbnail_loaded (GObject      *source_object,
+                  GAsyncResult *res,
+                  gpointer      user_data)
 {
   BgPicturesSource *bg_source;
-  CcBackgroundItem *item;
-  GFileInputStream *stream;
+  ThumbnailJob *job;
   GError *error = NULL;
-  gint thumbnail_height;
-  gint thumbnail_width;
-  gboolean needs_rotation;
+  GdkPixbuf *pixbuf;
+  const char *uri;
+  GtkTreeIter iter;
+  GtkTreePath *path;
+  GtkTreeRowReference *row_ref;
+  GtkListStore *store;
+  cairo_surface_t *surface;
+  int scale_factor;
 
-  item = g_object_get_data (source_object, "item");
-  stream = g_file_read_finish (G_FILE (source_object), res, &error);
-  if (stream == NULL)
+  pixbuf = g_task_propagate_pointer (G_TASK (res), &error);
+  if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
     {
-      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
-        {
-          char *filename = g_file_get_path (G_FILE (source_object));
-          g_warning ("Failed to load picture '%s': %s", filename, error->message);
-          remove_placeholder (BG_PICTURES_SOURCE (user_data), item);
-          g_free (filename);
-        }
-
       g_error_free (error);
       return;
     }
 
-  /* since we were not cancelled, we can now cast user_data
-   * back to BgPicturesSource.
-   */
+  /* since we were not cancelled, the source was not disposed */
   bg_source = BG_PICTURES_SOURCE (user_data);
+  job = g_task_get_task_data (G_TASK (res));
+
+  bg_source->n_running_jobs--;
+  process_pending_jobs (bg_source);
+
+  if (pixbuf == NULL)
+    {
+      if (job->is_screenshot)
+        g_debug ("Ignored URL '%s' as it's a screenshot from gnome-screenshot", job->uri);
+      else
+        g_warning ("Failed to load picture '%s': %s", job->uri, error->message);
 
-  needs_rotation = GPOINTER_TO_INT (g_object_get_data (G_OBJECT (item), "needs-rotation"));
-  if (needs_rotation)
+      remove_placeholder (bg_source, job->item);
+      g_clear_error (&error);
+      return;
+    }
+
+  store = bg_source_get_liststore (BG_SOURCE (bg_source));
+  uri = cc_background_item_get_uri (job->item);
+  if (uri == NULL)
+    uri = cc_background_item_get_source_url (job->item);
+
+  scale_factor = bg_source_get_scale_factor (BG_SOURCE (bg_source));
+  surface = gdk_cairo_surface_create_from_pixbuf (pixbuf, scale_factor, NULL);
+  cc_background_item_load (job->item, NULL);
+
+  row_ref = g_object_get_data (G_OBJECT (job->item), "row-ref");
+  if (row_ref == NULL)
     {
-      /* swap width and height for EXIF orientations that need it */
-      thumbnail_width = bg_source_get_thumbnail_height (BG_SOURCE (bg_source));
-      thumbnail_height = bg_source_get_thumbnail_width (BG_SOURCE (bg_source));
-      g_object_set_data (G_OBJECT (item), "rotation-applied", GINT_TO_POINTER (TRUE));
+      /* insert the item into the liststore if it did not exist */
+      gtk_list_store_insert_with_values (store, NULL, -1,
+                                         0, surface,
+                                         1, job->item,
+                                         -1);
     }
   else
     {
-      thumbnail_width = bg_source_get_thumbnail_width (BG_SOURCE (bg_source));
-      thumbnail_height = bg_source_get_thumbnail_height (BG_SOURCE (bg_source));
+      path = gtk_tree_row_reference_get_path (row_ref);
+      if (gtk_tree_model_get_iter (GTK_TREE_MODEL (store), &iter, path))
+        {
+          /* otherwise update the thumbnail */
+          gtk_list_store_set (store, &iter,
+                              0, surface,
+                              -1);
+        }
+      gtk_tree_path_free (path);
     }
 
-  g_object_set_data_full (G_OBJECT (stream), "item", g_object_ref (item), g_object_unref);
-  gdk_pixbuf_new_from_stream_at_scale_async (G_INPUT_STREAM (stream),
-                                             thumbnail_width, thumbnail_height,
-                                             TRUE,
-                                             bg_source->cancellable,
-                                             picture_scaled, bg_source);
-  g_object_unref (stream);
+  g_hash_table_insert (bg_source->known_items,
+                       bg_pictures_source_get_unique_filename (uri),
+                       GINT_TO_POINTER (TRUE));
+
+  cairo_surface_destroy (surface);
+  g_object_unref (pixbuf);
 }
 
 static void
@@ -356,39 +658,15 @@ picture_copied_for_read (GObject *source_object,
 
   bg_source = BG_PICTURES_SOURCE (user_data);
 
+  /* the downloaded file already is a thumbnail */
   native_file = g_object_get_data (G_OBJECT (thumbnail_file), "native-file");
   item = g_object_get_data (G_OBJECT (thumbnail_file), "item");
-  g_object_set_data_full (G_OBJECT (native_file), "item", g_object_ref (item), g_object_unref);
-  g_file_read_async (native_file,
-                     G_PRIORITY_DEFAULT,
-                     bg_source->cancellable,
-                     picture_opened_for_read,
-                     bg_source);
+  queue_thumbnail_job (bg_source, item, native_file, NULL, FALSE, FALSE);
 
  out:
   g_clear_error (&error);
 }
 
-static gboolean
-in_content_types (const char *content_type)
-{
-	guint i;
-	for (i = 0; content_types[i]; i++)
-		if (g_str_equal (content_types[i], content_type))
-			return TRUE;
-	return FALSE;
-}
-
-static gboolean
-in_screenshot_types (const char *content_type)
-{
-	guint i;
-	for (i = 0; screenshot_types[i]; i++)
-		if (g_str_equal (screenshot_types[i], content_type))
-			return TRUE;
-	return FALSE;
-}
-
 static cairo_surface_t *
 get_content_loading_icon (BgSource *source)
 {
@@ -470,7 +748,6 @@ add_single_file (BgPicturesSource     *bg_source,
   GtkTreeIter iter;
   GtkTreePath *path = NULL;
   GtkTreeRowReference *row_ref = NULL;
-  cairo_surface_t *surface = NULL;
   char *source_uri = NULL;
   char *uri = NULL;
   gboolean needs_download;
@@ -519,12 +796,13 @@ add_single_file (BgPicturesSource     *bg_source,
   if (!ret_row_ref && in_screenshot_types (content_type))
     goto read_file;
 
-  surface = get_content_loading_icon (BG_SOURCE (bg_source));
+  if (bg_source->loading_icon == NULL)
+    bg_source->loading_icon = get_content_loading_icon (BG_SOURCE (bg_source));
   store = bg_source_get_liststore (BG_SOURCE (bg_source));
 
   /* insert the item into the liststore */
   gtk_list_store_insert_with_values (store, &iter, -1,
-                                     0, surface,
+                                     0, bg_source->loading_icon,
                                      1, item,
                                      -1);
 
@@ -538,10 +816,7 @@ add_single_file (BgPicturesSource     *bg_source,
   media = g_object_get_data (G_OBJECT (file), "grl-media");
   if (media == NULL)
     {
-      g_object_set_data_full (G_OBJECT (file), "item", g_object_ref (item), g_object_unref);
-      g_file_read_async (file, G_PRIORITY_DEFAULT,
-                         bg_source->cancellable,
-                         picture_opened_for_read, bg_source);
+      queue_thumbnail_job (bg_source, item, file, content_type, TRUE, ret_row_ref != NULL);
     }
   else
     {
@@ -596,7 +871,6 @@ add_single_file (BgPicturesSource     *bg_source,
         *ret_row_ref = NULL;
     }
   gtk_tree_path_free (path);
-  g_clear_pointer (&surface, (GDestroyNotify) cairo_surface_destroy);
   g_clear_object (&item);
   g_object_unref (file);
   g_free (source_uri);
@@ -699,21 +973,6 @@ bg_pictures_source_remove (BgPicturesSource *bg_source,
   return retval;
 }
 
-static int
-file_sort_func (gconstpointer a,
-                gconstpointer b)
-{
-  GFileInfo *file_a = G_FILE_INFO (a);
-  GFileInfo *file_b = G_FILE_INFO (b);
-  guint64 modified_a, modified_b;
-
-  modified_a = g_file_info_get_attribute_uint64 (file_a, G_FILE_ATTRIBUTE_TIME_MODIFIED);
-
-  modified_b = g_file_info_get_attribute_uint64 (file_b, G_FILE_ATTRIBUTE_TIME_MODIFIED);
-
-  return modified_b - modified_a;
-}
-
 static void
 file_info_async_ready (GObject      *source,
                        GAsyncResult *res,
@@ -738,13 +997,16 @@ file_info_async_ready (GObject      *source,
       return;
     }
 
+  /* the enumeration is done */
+  if (files == NULL)
+    return;
+
   bg_source = BG_PICTURES_SOURCE (user_data);
 
   parent = g_file_enumerator_get_container (G_FILE_ENUMERATOR (source));
 
-  files = g_list_sort (files, file_sort_func);
-
-  /* iterate over the available files */
+  /* iterate over the available files, the thumbnails are loaded
+   * most recent first whatever the order they are enumerated in */
   for (l = files; l; l = g_list_next (l))
     {
       GFileInfo *info = l->data;
@@ -757,6 +1019,14 @@ file_info_async_ready (GObject      *source,
 
   g_list_foreach (files, (GFunc) g_object_unref, NULL);
   g_list_free (files);
+
+  /* get the next files */
+  g_file_enumerator_next_files_async (G_FILE_ENUMERATOR (source),
+                                      ENUMERATE_BATCH_SIZE,
+                                      G_PRIORITY_LOW,
+                                      bg_source->cancellable,
+                                      file_info_async_ready,
+                                      bg_source);
 }
 
 static void
@@ -780,7 +1050,7 @@ dir_enum_async_ready (GObject      *s,
 
   /* get the files */
   g_file_enumerator_next_files_async (enumerator,
-                                      G_MAXINT,
+                                      ENUMERATE_BATCH_SIZE,
                                       G_PRIORITY_LOW,
                                       source->cancellable,
                                       file_info_async_ready,
@@ -877,6 +1147,61 @@ sort_func (GtkTreeModel *model,
   return retval;
 }
 
+static guint64
+get_row_modified (GtkTreeModel *model,
+                  GtkTreePath  *path)
+{
+  g_autoptr(CcBackgroundItem) item = NULL;
+  GtkTreeIter iter;
+
+  if (!gtk_tree_model_get_iter (model, &iter, path))
+    return 0;
+
+  gtk_tree_model_get (model, &iter, 1, &item, -1);
+
+  return item != NULL ? cc_background_item_get_modified (item) : 0;
+}
+
+/**
+ * bg_pictures_source_set_visible_range:
+ * @start_path: the first row shown in the view
+ * @end_path: the last row shown in the view
+ *
+ * Makes the pictures which will show up between these rows load first.
+ * As the rows are sorted by modification time, those are the pictures
+ * modified between them, or before the last row if it is the last one.
+ */
+void
+bg_pictures_source_set_visible_range (BgPicturesSource *bg_source,
+                                      GtkTreePath      *start_path,
+                                      GtkTreePath      *end_path)
+{
+  GtkTreeModel *model;
+  GtkTreeIter iter;
+  guint64 newest = G_MAXUINT64;
+  guint64 oldest = 0;
+
+  g_return_if_fail (BG_IS_PICTURES_SOURCE (bg_source));
+
+  model = GTK_TREE_MODEL (bg_source_get_liststore (BG_SOURCE (bg_source)));
+
+  if (gtk_tree_path_get_indices (start_path)[0] > 0)
+    newest = get_row_modified (model, start_path);
+
+  if (gtk_tree_model_get_iter (model, &iter, end_path) &&
+      gtk_tree_model_iter_next (model, &iter))
+    oldest = get_row_modified (model, end_path);
+
+  if (newest == bg_source->visible_newest &&
+      oldest == bg_source->visible_oldest)
+    return;
+
+  bg_source->visible_newest = newest;
+  bg_source->visible_oldest = oldest;
+
+  g_sequence_sort (bg_source->pending_jobs, thumbnail_job_compare, bg_source);
+}
+
 static void
 file_info_ready (GObject      *object,
                  GAsyncResult *res,
@@ -1003,6 +1328,10 @@ bg_pictures_source_init (BgPicturesSource *self)
   GtkListStore *store;
 
   self->cancellable = g_cancellable_new ();
+  self->pending_jobs = g_sequence_new (NULL);
+  self->max_running_jobs = CLAMP (g_get_num_processors (), 1, MAX_RUNNING_JOBS);
+  self->visible_newest = G_MAXUINT64;
+  self->visible_oldest = 0;
   self->known_items = g_hash_table_new_full (g_str_hash,
 					     g_str_equal,
 					     (GDestroyNotify) g_free,
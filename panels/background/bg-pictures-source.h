@@ -42,6 +42,9 @@ gboolean          bg_pictures_source_remove         (BgPicturesSource *bg_source
 						     const char       *uri);
 gboolean          bg_pictures_source_is_known       (BgPicturesSource *bg_source,
 						     const char       *uri);
+void              bg_pictures_source_set_visible_range (BgPicturesSource *bg_source,
+                                                        GtkTreePath      *start_path,
+                                                        GtkTreePath      *end_path);
 
 const char * const * bg_pictures_get_support_content_types (void);
 
@@ -51,6 +51,7 @@ struct _CcBackgroundChooserDialog
   GtkListStore *sources;
   GtkWidget *stack;
   GtkWidget *pictures_stack;
+  GtkWidget *pictures_view;
 
   BgWallpapersSource *wallpapers_source;
   BgPicturesSource *pictures_source;
@@ -411,10 +412,29 @@ create_view (CcBackgroundChooserDialog *chooser, GtkTreeModel *model)
   return sw;
 }
 
+static void
+on_pictures_view_scrolled (CcBackgroundChooserDialog *chooser)
+{
+  GtkTreePath *start_path;
+  GtkTreePath *end_path;
+
+  if (chooser->pictures_source == NULL)
+    return;
+
+  if (!gtk_icon_view_get_visible_range (GTK_ICON_VIEW (chooser->pictures_view), &start_path, &end_path))
+    return;
+
+  bg_pictures_source_set_visible_range (chooser->pictures_source, start_path, end_path);
+
+  gtk_tree_path_free (start_path);
+  gtk_tree_path_free (end_path);
+}
+
 static void
 cc_background_chooser_dialog_constructed (GObject *object)
 {
   CcBackgroundChooserDialog *chooser = CC_BACKGROUND_CHOOSER_DIALOG (object);
+  GtkAdjustment *adjustment;
   GtkListStore *model;
   GtkWidget *sw;
   GtkWidget *vbox;
@@ -430,6 +450,14 @@ cc_background_chooser_dialog_constructed (GObject *object)
   sw = create_view (chooser, GTK_TREE_MODEL (model));
   gtk_stack_add_named (GTK_STACK (chooser->pictures_stack), sw, "view");
 
+  /* The thumbnails of the pictures in view are loaded first */
+  chooser->pictures_view = gtk_bin_get_child (GTK_BIN (sw));
+  adjustment = gtk_scrolled_window_get_vadjustment (GTK_SCROLLED_WINDOW (sw));
+  g_signal_connect_object (adjustment, "value-changed",
+                           G_CALLBACK (on_pictures_view_scrolled), chooser, G_CONNECT_SWAPPED);
+  g_signal_connect_object (adjustment, "changed",
+                           G_CALLBACK (on_pictures_view_scrolled), chooser, G_CONNECT_SWAPPED);
+
   model = bg_source_get_liststore (BG_SOURCE (chooser->colors_source));
   sw = create_view (chooser, GTK_TREE_MODEL (model));
   gtk_stack_add_titled (GTK_STACK (chooser->stack), sw, "colors", _("Colors"));
@@ -28,10 +28,18 @@
 #include "gdesktop-enums-types.h"
 #include "cc-background-item.h"
 #include "cc-background-xml.h"
+#include "cc-cache-file.h"
 
 /* The number of items we signal as "added" before
  * returning to the main loop */
-#define NUM_ITEMS_PER_BATCH 1
+#define NUM_ITEMS_PER_BATCH 64
+
+/* The parsed wallpaper lists are cached, and the cache is invalidated
+ * whenever one of the gnome-background-properties directories or files
+ * changes. Bump the version when the serialized items change. */
+#define WALLPAPERS_CACHE_NAME    "wallpapers.cache"
+#define WALLPAPERS_CACHE_VERSION "1"
+#define WALLPAPERS_CACHE_ENTRY   "(sa{sv})"
 
 struct _CcBackgroundXml
 {
@@ -151,10 +159,111 @@ emit_added_in_idle (CcBackgroundXml *xml,
 #define UNSET_FLAG(flag) G_STMT_START{ (flags&=~(flag)); }G_STMT_END
 #define SET_FLAG(flag) G_STMT_START{ (flags|=flag); }G_STMT_END
 
+static GVariant *
+item_to_variant (const gchar      *id,
+		 CcBackgroundItem *item)
+{
+  GVariantBuilder props;
+  CcBackgroundItemFlags flags;
+  GDesktopBackgroundStyle placement;
+  GDesktopBackgroundShading shading;
+  gboolean is_deleted, needs_download;
+  const char *string_props[] = {
+    "name", "uri", "source-xml", "source-url", "primary-color", "secondary-color"
+  };
+  guint i;
+
+  g_variant_builder_init (&props, G_VARIANT_TYPE_VARDICT);
+
+  for (i = 0; i < G_N_ELEMENTS (string_props); i++) {
+    char *value;
+
+    g_object_get (G_OBJECT (item), string_props[i], &value, NULL);
+    if (value != NULL)
+      g_variant_builder_add (&props, "{sv}", string_props[i], g_variant_new_take_string (value));
+  }
+
+  g_object_get (G_OBJECT (item),
+		"flags", &flags,
+		"placement", &placement,
+		"shading", &shading,
+		"is-deleted", &is_deleted,
+		"needs-download", &needs_download,
+		NULL);
+
+  g_variant_builder_add (&props, "{sv}", "flags", g_variant_new_uint32 (flags));
+  g_variant_builder_add (&props, "{sv}", "placement", g_variant_new_int32 (placement));
+  g_variant_builder_add (&props, "{sv}", "shading", g_variant_new_int32 (shading));
+  g_variant_builder_add (&props, "{sv}", "is-deleted", g_variant_new_boolean (is_deleted));
+  g_variant_builder_add (&props, "{sv}", "needs-download", g_variant_new_boolean (needs_download));
+
+  return g_variant_new ("(sa{sv})", id, &props);
+}
+
+static CcBackgroundItem *
+item_from_variant (GVariant  *props)
+{
+  CcBackgroundItem *item;
+  GVariantIter iter;
+  const gchar *key;
+  GVariant *value;
+
+  item = cc_background_item_new (NULL);
+
+  g_variant_iter_init (&iter, props);
+  while (g_variant_iter_next (&iter, "{&sv}", &key, &value)) {
+    if (g_variant_is_of_type (value, G_VARIANT_TYPE_STRING))
+      g_object_set (G_OBJECT (item), key, g_variant_get_string (value, NULL), NULL);
+    else if (g_variant_is_of_type (value, G_VARIANT_TYPE_UINT32))
+      g_object_set (G_OBJECT (item), key, g_variant_get_uint32 (value), NULL);
+    else if (g_variant_is_of_type (value, G_VARIANT_TYPE_INT32))
+      g_object_set (G_OBJECT (item), key, g_variant_get_int32 (value), NULL);
+    else if (g_variant_is_of_type (value, G_VARIANT_TYPE_BOOLEAN))
+      g_object_set (G_OBJECT (item), key, g_variant_get_boolean (value), NULL);
+    g_variant_unref (value);
+  }
+
+  return item;
+}
+
+static gboolean
+target_exists (CcBackgroundItem *item)
+{
+  GFile *file;
+  const char *uri;
+  gboolean retval;
+
+  uri = cc_background_item_get_uri (item);
+  if (uri == NULL)
+    return TRUE;
+
+  file = g_file_new_for_uri (uri);
+  retval = g_file_query_exists (file, NULL);
+  g_object_unref (file);
+
+  return retval;
+}
+
+static void
+add_item (CcBackgroundXml  *xml,
+	  const gchar      *id,
+	  CcBackgroundItem *item,
+	  gboolean          in_thread)
+{
+  g_hash_table_insert (xml->wp_hash,
+		       g_strdup (id),
+		       g_object_ref (item));
+  if (in_thread)
+    emit_added_in_idle (xml, g_object_ref (item));
+  else
+    g_signal_emit (G_OBJECT (xml), signals[ADDED], 0, item);
+}
+
 static gboolean
 cc_background_xml_load_xml_internal (CcBackgroundXml *xml,
 				     const gchar     *filename,
-				     gboolean         in_thread)
+				     gboolean         in_thread,
+				     GVariantBuilder *cache_builder)
 {
   xmlDoc * wplist;
   xmlNode * root, * list, * wpa;
@@ -278,23 +387,10 @@ cc_background_xml_load_xml_internal (CcBackgroundXml *xml,
       }
 
       /* Check whether the target file exists */
-      {
-        GFile *file;
-        const char *uri;
-
-	uri = cc_background_item_get_uri (item);
-	if (uri != NULL)
-	  {
-            file = g_file_new_for_uri (uri);
-	    if (g_file_query_exists (file, NULL) == FALSE)
-	      {
-	        g_free (cname);
-	        g_object_unref (file);
-	        g_object_unref (item);
-	        continue;
-	      }
-	    g_object_unref (file);
-	  }
+      if (!target_exists (item)) {
+	g_free (cname);
+	g_object_unref (item);
+	continue;
       }
 
       /* FIXME, this is a broken way of doing,
@@ -304,6 +400,13 @@ cc_background_xml_load_xml_internal (CcBackgroundXml *xml,
       g_free (cname);
       g_free (uri);
 
+      g_object_set (G_OBJECT (item), "flags", flags, NULL);
+
+      /* Cache the item even if it was already loaded, e.g. as the
+       * default background */
+      if (cache_builder != NULL)
+        g_variant_builder_add_value (cache_builder, item_to_variant (id, item));
+
       /* Make sure we don't already have this one and that filename exists */
       if (g_hash_table_lookup (xml->wp_hash, id) != NULL) {
 	g_object_unref (item);
@@ -311,14 +414,7 @@ cc_background_xml_load_xml_internal (CcBackgroundXml *xml,
 	continue;
       }
 
-      g_object_set (G_OBJECT (item), "flags", flags, NULL);
-      g_hash_table_insert (xml->wp_hash,
-                           g_strdup (id),
-                           g_object_ref (item));
-      if (in_thread)
-        emit_added_in_idle (xml, g_object_ref (item));
-      else
-        g_signal_emit (G_OBJECT (xml), signals[ADDED], 0, item);
+      add_item (xml, id, item, in_thread);
 
       g_object_unref (item);
       g_free (id);
@@ -343,7 +439,7 @@ gnome_wp_file_changed (GFileMonitor *monitor,
   case G_FILE_MONITOR_EVENT_CHANGED:
   case G_FILE_MONITOR_EVENT_CREATED:
     filename = g_file_get_path (file);
-    cc_background_xml_load_xml_internal (data, filename, FALSE);
+    cc_background_xml_load_xml_internal (data, filename, FALSE, NULL);
     g_free (filename);
     break;
   default:
@@ -383,7 +479,9 @@ cc_background_xml_add_monitor (GFile      *directory,
 static void
 cc_background_xml_load_from_dir (const gchar      *path,
 				 CcBackgroundXml  *data,
-				 gboolean          in_thread)
+				 gboolean          in_thread,
+				 GVariantBuilder  *cache_builder,
+				 GPtrArray        *watched_paths)
 {
   GFile *directory;
   GFileEnumerator *enumerator;
@@ -415,8 +513,8 @@ cc_background_xml_load_from_dir (const gchar      *path,
     fullpath = g_build_filename (path, filename, NULL);
     g_object_unref (info);
 
-    cc_background_xml_load_xml_internal (data, fullpath, in_thread);
-    g_free (fullpath);
+    cc_background_xml_load_xml_internal (data, fullpath, in_thread, cache_builder);
+    g_ptr_array_add (watched_paths, fullpath);
   }
   g_file_enumerator_close (enumerator, NULL, NULL);
 
@@ -426,28 +524,126 @@ cc_background_xml_load_from_dir (const gchar      *path,
   g_object_unref (enumerator);
 }
 
-static void
-cc_background_xml_load_list (CcBackgroundXml *data,
-			     gboolean         in_thread)
+static GPtrArray *
+get_xml_dirs (void)
 {
   const char * const *system_data_dirs;
-  gchar * datadir;
+  GPtrArray *dirs;
   gint i;
 
-  datadir = g_build_filename (g_get_user_data_dir (),
-                              "gnome-background-properties",
-                              NULL);
-  cc_background_xml_load_from_dir (datadir, data, in_thread);
-  g_free (datadir);
+  dirs = g_ptr_array_new_with_free_func (g_free);
+
+  g_ptr_array_add (dirs, g_build_filename (g_get_user_data_dir (),
+                                           "gnome-background-properties",
+                                           NULL));
 
   system_data_dirs = g_get_system_data_dirs ();
   for (i = 0; system_data_dirs[i]; i++) {
-    datadir = g_build_filename (system_data_dirs[i],
-                                "gnome-background-properties",
-				NULL);
-    cc_background_xml_load_from_dir (datadir, data, in_thread);
-    g_free (datadir);
+    g_ptr_array_add (dirs, g_build_filename (system_data_dirs[i],
+                                             "gnome-background-properties",
+                                             NULL));
+  }
+
+  return dirs;
+}
+
+/* The names are translated, and the directories searched depend on the
+ * environment */
+static gchar *
+get_cache_stamp (GPtrArray *dirs)
+{
+  g_autofree gchar *languages = NULL;
+  GString *stamp;
+  guint i;
+
+  languages = g_strjoinv (":", (gchar **) g_get_language_names ());
+
+  stamp = g_string_new (WALLPAPERS_CACHE_VERSION);
+  g_string_append_printf (stamp, ";%s", languages);
+  for (i = 0; i < dirs->len; i++)
+    g_string_append_printf (stamp, ";%s", (gchar *) g_ptr_array_index (dirs, i));
+
+  return g_string_free (stamp, FALSE);
+}
+
+static gboolean
+cc_background_xml_load_list_from_cache (CcBackgroundXml *data,
+					GPtrArray       *dirs,
+					const gchar     *stamp,
+					gboolean         in_thread)
+{
+  g_autoptr(GVariant) cache = NULL;
+  GVariantIter iter;
+  const gchar *id;
+  GVariant *props;
+  guint i;
+
+  cache = cc_cache_file_load (WALLPAPERS_CACHE_NAME, stamp, G_VARIANT_TYPE ("a" WALLPAPERS_CACHE_ENTRY));
+  if (cache == NULL)
+    return FALSE;
+
+  g_variant_iter_init (&iter, cache);
+  while (g_variant_iter_next (&iter, "(&s@a{sv})", &id, &props)) {
+    CcBackgroundItem *item;
+
+    item = item_from_variant (props);
+    g_variant_unref (props);
+
+    /* Same checks as when parsing the files */
+    if (target_exists (item) && g_hash_table_lookup (data->wp_hash, id) == NULL)
+      add_item (data, id, item, in_thread);
+
+    g_object_unref (item);
+  }
+
+  for (i = 0; i < dirs->len; i++) {
+    const gchar *path = g_ptr_array_index (dirs, i);
+    GFile *directory;
+
+    if (!g_file_test (path, G_FILE_TEST_IS_DIR))
+      continue;
+
+    directory = g_file_new_for_path (path);
+    cc_background_xml_add_monitor (directory, data);
+    g_object_unref (directory);
   }
+
+  return TRUE;
+}
+
+static void
+cc_background_xml_load_list (CcBackgroundXml *data,
+			     gboolean         in_thread)
+{
+  g_autoptr(GPtrArray) dirs = NULL;
+  g_autoptr(GPtrArray) watched_paths = NULL;
+  g_autofree gchar *stamp = NULL;
+  GVariantBuilder builder;
+  guint i;
+
+  dirs = get_xml_dirs ();
+  stamp = get_cache_stamp (dirs);
+
+  if (cc_background_xml_load_list_from_cache (data, dirs, stamp, in_thread))
+    return;
+
+  /* The directories are watched for added and removed files, and the
+   * files themselves for changes */
+  watched_paths = g_ptr_array_new_with_free_func (g_free);
+  for (i = 0; i < dirs->len; i++)
+    g_ptr_array_add (watched_paths, g_strdup (g_ptr_array_index (dirs, i)));
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a" WALLPAPERS_CACHE_ENTRY));
+
+  for (i = 0; i < dirs->len; i++)
+    cc_background_xml_load_from_dir (g_ptr_array_index (dirs, i), data, in_thread, &builder, watched_paths);
+
+  g_ptr_array_add (watched_paths, NULL);
+
+  cc_cache_file_save (WALLPAPERS_CACHE_NAME,
+                      stamp,
+                      (const gchar * const *) watched_paths->pdata,
+                      g_variant_builder_end (&builder));
 }
 
 const GHashTable *
@@ -498,7 +694,7 @@ cc_background_xml_load_xml (CcBackgroundXml *xml,
 	if (g_file_test (filename, G_FILE_TEST_IS_REGULAR) == FALSE)
 		return FALSE;
 
-	return cc_background_xml_load_xml_internal (xml, filename, FALSE);
+	return cc_background_xml_load_xml_internal (xml, filename, FALSE, NULL);
 }
 
 static void
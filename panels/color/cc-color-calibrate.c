@@ -32,6 +32,7 @@
 #include <libgnome-desktop/gnome-rr.h>
 
 #include "cc-color-calibrate.h"
+#include "cc-color-gamma-ramp.h"
 
 #define CC_COLOR_CALIBRATE_GET_PRIVATE(o) (G_TYPE_INSTANCE_GET_PRIVATE ((o), CC_TYPE_COLOR_CALIBRATE, CcColorCalibratePrivate))
 
@@ -53,6 +54,7 @@ struct _CcColorCalibratePrivate
   GtkWindow       *window;
   GtkWidget       *sample_widget;
   guint            gamma_size;
+  CcColorGammaRamp *gamma_ramp;
   CdProfileQuality quality;
   guint            target_whitepoint;   /* in Kelvin */
   gdouble          target_gamma;
@@ -200,7 +202,12 @@ cc_color_calibrate_calib_setup_screen (CcColorCalibrate *calibrate,
                            CD_SESSION_ERROR,
                            CD_SESSION_ERROR_INTERNAL,
                            "gamma size is zero");
+      goto out;
     }
+
+  /* reused for every update of the gamma table */
+  cc_color_gamma_ramp_free (priv->gamma_ramp);
+  priv->gamma_ramp = cc_color_gamma_ramp_new (priv->gamma_size);
 out:
   return ret;
 }
@@ -219,23 +226,18 @@ out:
  **/
 static gboolean
 cc_color_calibrate_calib_set_output_gamma (CcColorCalibrate *calibrate,
-                                           GPtrArray *array,
+                                           GVariantIter *iter,
                                            GError **error)
 {
   CcColorCalibratePrivate *priv = calibrate->priv;
-  CdColorRGB *p1;
-  CdColorRGB *p2;
-  CdColorRGB result;
+  CcColorGammaRamp *ramp = priv->gamma_ramp;
+  CdColorRGB color;
   gboolean ret = TRUE;
-  gdouble mix;
   GnomeRRCrtc *crtc;
-  guint16 *blue = NULL;
-  guint16 *green = NULL;
-  guint16 *red = NULL;
-  guint i;
+  guint i = 0;
 
   /* no length? */
-  if (array->len == 0)
+  if (g_variant_iter_n_children (iter) == 0)
     {
       ret = FALSE;
       g_set_error_literal (error,
@@ -245,28 +247,6 @@ cc_color_calibrate_calib_set_output_gamma (CcColorCalibrate *calibrate,
       goto out;
     }
 
-  /* convert to a type X understands of the right size */
-  red = g_new (guint16, priv->gamma_size);
-  green = g_new (guint16, priv->gamma_size);
-  blue = g_new (guint16, priv->gamma_size);
-  cd_color_rgb_set (&result, 1.0, 1.0, 1.0);
-  for (i = 0; i < priv->gamma_size; i++)
-    {
-      mix = (gdouble) (array->len - 1) /
-            (gdouble) (priv->gamma_size - 1) *
-            (gdouble) i;
-      p1 = g_ptr_array_index (array, (guint) floor (mix));
-      p2 = g_ptr_array_index (array, (guint) ceil (mix));
-      cd_color_rgb_interpolate (p1,
-                                p2,
-                                mix - (gint) mix,
-                                &result);
-      red[i] = result.R * 0xffff;
-      green[i] = result.G * 0xffff;
-      blue[i] = result.B * 0xffff;
-    }
-
-  /* send to LUT */
   crtc = gnome_rr_output_get_crtc (priv->output);
   if (crtc == NULL)
     {
@@ -278,12 +258,25 @@ cc_color_calibrate_calib_set_output_gamma (CcColorCalibrate *calibrate,
                    gnome_rr_output_get_name (priv->output));
       goto out;
     }
+
+  /* convert to a type X understands of the right size */
+  cc_color_gamma_ramp_set_n_points (ramp, g_variant_iter_n_children (iter));
+  while (g_variant_iter_next (iter, "(ddd)",
+                              &color.R,
+                              &color.G,
+                              &color.B))
+    {
+      cc_color_gamma_ramp_set_point (ramp, i++, &color);
+    }
+
+  /* send to LUT, unless it's already there */
+  if (!cc_color_gamma_ramp_update (ramp))
+    goto out;
   gnome_rr_crtc_set_gamma (crtc, priv->gamma_size,
-                           red, green, blue);
+                           (guint16 *) cc_color_gamma_ramp_get_red (ramp),
+                           (guint16 *) cc_color_gamma_ramp_get_green (ramp),
+                           (guint16 *) cc_color_gamma_ramp_get_blue (ramp));
 out:
-  g_free (red);
-  g_free (green);
-  g_free (blue);
   return ret;
 }
 
@@ -496,7 +489,6 @@ cc_color_calibrate_signal_cb (GDBusProxy *proxy,
 {
   CcColorCalibratePrivate *priv = calibrate->priv;
   CdColorRGB color;
-  CdColorRGB *color_tmp;
   CdSessionInteraction code;
   const gchar *image = NULL;
   const gchar *message;
@@ -504,7 +496,6 @@ cc_color_calibrate_signal_cb (GDBusProxy *proxy,
   const gchar *str = NULL;
   gboolean ret;
   GError *error = NULL;
-  GPtrArray *array = NULL;
   GtkImage *img;
   GtkLabel *label;
   GVariantIter *iter;
@@ -572,20 +563,10 @@ cc_color_calibrate_signal_cb (GDBusProxy *proxy,
       g_variant_get (parameters,
                      "(a(ddd))",
                      &iter);
-      array = g_ptr_array_new_with_free_func (g_free);
-      while (g_variant_iter_loop (iter, "(ddd)",
-                                  &color.R,
-                                  &color.G,
-                                  &color.B))
-        {
-          color_tmp = cd_color_rgb_new ();
-          cd_color_rgb_copy (&color, color_tmp);
-          g_ptr_array_add (array, color_tmp);
-        }
-      g_variant_iter_free (iter);
       ret = cc_color_calibrate_calib_set_output_gamma (calibrate,
-                                                       array,
+                                                       iter,
                                                        &error);
+      g_variant_iter_free (iter);
       if (!ret)
         {
           g_warning ("failed to update gamma: %s",
@@ -1044,6 +1025,7 @@ cc_color_calibrate_finalize (GObject *object)
   g_clear_object (&priv->proxy_inhibit);
   g_clear_object (&priv->sensor);
   g_clear_object (&priv->x11_screen);
+  g_clear_pointer (&priv->gamma_ramp, cc_color_gamma_ramp_free);
   g_free (priv->title);
   g_main_loop_unref (priv->loop);
 
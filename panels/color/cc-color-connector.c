@@ -0,0 +1,312 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*-
+ *
+ * Copyright (C) 2017 The GNOME Foundation
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include "cc-color-connector.h"
+
+/* Connects colord devices and profiles, which fetches all their
+ * properties, without blocking and with at most max_in_flight of them
+ * being connected at once. The others wait in a queue.
+ *
+ * Connected profiles are kept by object path until colord removes
+ * them: their properties are kept up to date by colord, so connecting
+ * the same profile again, e.g. from a new cd_client_get_profiles()
+ * call, doesn't cost a round trip.
+ */
+
+struct _CcColorConnector
+{
+  GObject      parent_instance;
+
+  CdClient    *client;
+  GHashTable  *profiles;
+  GQueue       queue;
+  guint        max_in_flight;
+  guint        n_in_flight;
+};
+
+G_DEFINE_TYPE (CcColorConnector, cc_color_connector, G_TYPE_OBJECT)
+
+static void cc_color_connector_start_next (CcColorConnector *connector);
+
+static void
+cc_color_connector_profile_removed_cb (CdClient *client,
+                                       CdProfile *profile,
+                                       CcColorConnector *connector)
+{
+  g_hash_table_remove (connector->profiles,
+                       cd_profile_get_object_path (profile));
+}
+
+static void
+cc_color_connector_cache_profile (CcColorConnector *connector,
+                                  CdProfile *profile)
+{
+  g_hash_table_insert (connector->profiles,
+                       g_strdup (cd_profile_get_object_path (profile)),
+                       g_object_ref (profile));
+}
+
+static void
+cc_color_connector_profile_connect_cb (GObject *object,
+                                       GAsyncResult *res,
+                                       gpointer user_data)
+{
+  GTask *task = G_TASK (user_data);
+  CcColorConnector *connector = g_task_get_source_object (task);
+  CdProfile *profile = CD_PROFILE (object);
+  GError *error = NULL;
+
+  connector->n_in_flight--;
+  cc_color_connector_start_next (connector);
+
+  if (!cd_profile_connect_finish (profile, res, &error))
+    {
+      g_task_return_error (task, error);
+    }
+  else
+    {
+      cc_color_connector_cache_profile (connector, profile);
+      g_task_return_pointer (task, g_object_ref (profile), g_object_unref);
+    }
+
+  g_object_unref (task);
+}
+
+static void
+cc_color_connector_device_connect_cb (GObject *object,
+                                      GAsyncResult *res,
+                                      gpointer user_data)
+{
+  GTask *task = G_TASK (user_data);
+  CcColorConnector *connector = g_task_get_source_object (task);
+  GError *error = NULL;
+
+  connector->n_in_flight--;
+  cc_color_connector_start_next (connector);
+
+  if (!cd_device_connect_finish (CD_DEVICE (object), res, &error))
+    g_task_return_error (task, error);
+  else
+    g_task_return_boolean (task, TRUE);
+
+  g_object_unref (task);
+}
+
+static void
+cc_color_connector_start_next (CcColorConnector *connector)
+{
+  while (connector->n_in_flight < connector->max_in_flight &&
+         !g_queue_is_empty (&connector->queue))
+    {
+      GTask *task = g_queue_pop_head (&connector->queue);
+      gpointer object = g_task_get_task_data (task);
+
+      /* don't use a slot for something nobody wants anymore */
+      if (g_task_return_error_if_cancelled (task))
+        {
+          g_object_unref (task);
+          continue;
+        }
+
+      connector->n_in_flight++;
+      if (CD_IS_PROFILE (object))
+        {
+          cd_profile_connect (CD_PROFILE (object),
+                              g_task_get_cancellable (task),
+                              cc_color_connector_profile_connect_cb,
+                              task);
+        }
+      else
+        {
+          cd_device_connect (CD_DEVICE (object),
+                             g_task_get_cancellable (task),
+                             cc_color_connector_device_connect_cb,
+                             task);
+        }
+    }
+}
+
+static void
+cc_color_connector_queue (CcColorConnector *connector,
+                          GTask *task,
+                          gpointer object)
+{
+  g_task_set_task_data (task, g_object_ref (object), g_object_unref);
+  g_queue_push_tail (&connector->queue, task);
+  cc_color_connector_start_next (connector);
+}
+
+/**
+ * cc_color_connector_connect_device:
+ *
+ * Connects @device, once less than the maximum number of devices and
+ * profiles are being connected.
+ **/
+void
+cc_color_connector_connect_device (CcColorConnector *connector,
+                                   CdDevice *device,
+                                   GCancellable *cancellable,
+                                   GAsyncReadyCallback callback,
+                                   gpointer user_data)
+{
+  GTask *task;
+
+  g_return_if_fail (CC_IS_COLOR_CONNECTOR (connector));
+  g_return_if_fail (CD_IS_DEVICE (device));
+
+  task = g_task_new (connector, cancellable, callback, user_data);
+  g_task_set_source_tag (task, cc_color_connector_connect_device);
+
+  if (cd_device_get_connected (device))
+    {
+      g_task_return_boolean (task, TRUE);
+      g_object_unref (task);
+      return;
+    }
+
+  cc_color_connector_queue (connector, task, device);
+}
+
+gboolean
+cc_color_connector_connect_device_finish (CcColorConnector *connector,
+                                          GAsyncResult *res,
+                                          GError **error)
+{
+  g_return_val_if_fail (g_task_is_valid (res, connector), FALSE);
+
+  return g_task_propagate_boolean (G_TASK (res), error);
+}
+
+/**
+ * cc_color_connector_connect_profile:
+ *
+ * Connects @profile, or finds the connected profile with the same
+ * object path.
+ **/
+void
+cc_color_connector_connect_profile (CcColorConnector *connector,
+                                    CdProfile *profile,
+                                    GCancellable *cancellable,
+                                    GAsyncReadyCallback callback,
+                                    gpointer user_data)
+{
+  CdProfile *cached;
+  GTask *task;
+
+  g_return_if_fail (CC_IS_COLOR_CONNECTOR (connector));
+  g_return_if_fail (CD_IS_PROFILE (profile));
+
+  task = g_task_new (connector, cancellable, callback, user_data);
+  g_task_set_source_tag (task, cc_color_connector_connect_profile);
+
+  cached = g_hash_table_lookup (connector->profiles,
+                                cd_profile_get_object_path (profile));
+  if (cached == NULL && cd_profile_get_connected (profile))
+    {
+      cc_color_connector_cache_profile (connector, profile);
+      cached = profile;
+    }
+
+  if (cached != NULL)
+    {
+      g_task_return_pointer (task, g_object_ref (cached), g_object_unref);
+      g_object_unref (task);
+      return;
+    }
+
+  cc_color_connector_queue (connector, task, profile);
+}
+
+/**
+ * cc_color_connector_connect_profile_finish:
+ *
+ * Return value: (transfer full): the connected profile, which may be
+ * another object than the one that was passed, or %NULL on error
+ **/
+CdProfile *
+cc_color_connector_connect_profile_finish (CcColorConnector *connector,
+                                           GAsyncResult *res,
+                                           GError **error)
+{
+  g_return_val_if_fail (g_task_is_valid (res, connector), NULL);
+
+  return g_task_propagate_pointer (G_TASK (res), error);
+}
+
+static void
+cc_color_connector_dispose (GObject *object)
+{
+  CcColorConnector *connector = CC_COLOR_CONNECTOR (object);
+
+  if (connector->client != NULL)
+    {
+      g_signal_handlers_disconnect_by_func (connector->client,
+                                            G_CALLBACK (cc_color_connector_profile_removed_cb),
+                                            connector);
+      g_clear_object (&connector->client);
+    }
+  g_clear_pointer (&connector->profiles, g_hash_table_unref);
+
+  G_OBJECT_CLASS (cc_color_connector_parent_class)->dispose (object);
+}
+
+static void
+cc_color_connector_class_init (CcColorConnectorClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->dispose = cc_color_connector_dispose;
+}
+
+static void
+cc_color_connector_init (CcColorConnector *connector)
+{
+  connector->profiles = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                               g_free, g_object_unref);
+  g_queue_init (&connector->queue);
+}
+
+/**
+ * cc_color_connector_new:
+ * @client: the #CdClient the devices and profiles come from
+ * @max_in_flight: how many devices and profiles can be connected at once
+ **/
+CcColorConnector *
+cc_color_connector_new (CdClient *client,
+                        guint max_in_flight)
+{
+  CcColorConnector *connector;
+
+  g_return_val_if_fail (CD_IS_CLIENT (client), NULL);
+  g_return_val_if_fail (max_in_flight > 0, NULL);
+
+  connector = g_object_new (CC_TYPE_COLOR_CONNECTOR, NULL);
+  connector->client = g_object_ref (client);
+  connector->max_in_flight = max_in_flight;
+
+  g_signal_connect (client, "profile-removed",
+                    G_CALLBACK (cc_color_connector_profile_removed_cb),
+                    connector);
+
+  return connector;
+}
@@ -0,0 +1,56 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*-
+ *
+ * Copyright (C) 2017 The GNOME Foundation
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef CC_COLOR_CONNECTOR_H
+#define CC_COLOR_CONNECTOR_H
+
+#include <gio/gio.h>
+#include <colord.h>
+
+G_BEGIN_DECLS
+
+#define CC_TYPE_COLOR_CONNECTOR (cc_color_connector_get_type ())
+G_DECLARE_FINAL_TYPE (CcColorConnector, cc_color_connector, CC, COLOR_CONNECTOR, GObject)
+
+CcColorConnector *cc_color_connector_new                    (CdClient            *client,
+                                                             guint                max_in_flight);
+
+void              cc_color_connector_connect_device         (CcColorConnector    *connector,
+                                                             CdDevice            *device,
+                                                             GCancellable        *cancellable,
+                                                             GAsyncReadyCallback  callback,
+                                                             gpointer             user_data);
+gboolean          cc_color_connector_connect_device_finish  (CcColorConnector    *connector,
+                                                             GAsyncResult        *res,
+                                                             GError             **error);
+
+void              cc_color_connector_connect_profile        (CcColorConnector    *connector,
+                                                             CdProfile           *profile,
+                                                             GCancellable        *cancellable,
+                                                             GAsyncReadyCallback  callback,
+                                                             gpointer             user_data);
+CdProfile        *cc_color_connector_connect_profile_finish (CcColorConnector    *connector,
+                                                             GAsyncResult        *res,
+                                                             GError             **error);
+
+G_END_DECLS
+
+#endif /* CC_COLOR_CONNECTOR_H */
@@ -0,0 +1,281 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*-
+ *
+ * Copyright (C) 2017 The GNOME Foundation
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <math.h>
+#include <string.h>
+
+#include "cc-color-gamma-ramp.h"
+
+/* Builds the red, green and blue ramps of a video card gamma table
+ * from a CLUT, interpolating linearly between its points. The same
+ * builder is reused for every update during a calibration, so nothing
+ * is allocated once the sizes are known, and an update tells whether
+ * the ramps actually changed, to only send them to X when they did.
+ *
+ * The CLUT is kept as one array per channel, and where each entry of
+ * the ramps falls between two points of the CLUT only depends on the
+ * sizes, so it is worked out once. Interpolating is then a plain loop
+ * over arrays, without calls or branches, which the compiler can
+ * vectorize.
+ */
+
+enum {
+  CHANNEL_RED,
+  CHANNEL_GREEN,
+  CHANNEL_BLUE,
+  N_CHANNELS
+};
+
+struct _CcColorGammaRamp
+{
+  guint     size;
+
+  /* the CLUT, with the last point repeated so that the point after
+   * any entry can be read without checking the bounds */
+  guint     n_points;
+  guint     n_points_allocated;
+  gdouble  *points[N_CHANNELS];
+
+  /* the CLUT point before each entry of the ramps, and how far the
+   * entry is from it, for layout_n_points points */
+  guint     layout_n_points;
+  guint    *lower;
+  gdouble  *mix;
+
+  /* the last built ramps, and the ones being built */
+  gboolean  valid;
+  guint16  *ramps[N_CHANNELS];
+  guint16  *scratch[N_CHANNELS];
+};
+
+/**
+ * cc_color_gamma_ramp_new:
+ * @size: the number of entries of the gamma table
+ **/
+CcColorGammaRamp *
+cc_color_gamma_ramp_new (guint size)
+{
+  CcColorGammaRamp *ramp;
+  guint c;
+
+  g_return_val_if_fail (size > 0, NULL);
+
+  ramp = g_new0 (CcColorGammaRamp, 1);
+  ramp->size = size;
+  ramp->lower = g_new (guint, size);
+  ramp->mix = g_new (gdouble, size);
+  for (c = 0; c < N_CHANNELS; c++)
+    {
+      ramp->ramps[c] = g_new0 (guint16, size);
+      ramp->scratch[c] = g_new0 (guint16, size);
+    }
+
+  return ramp;
+}
+
+void
+cc_color_gamma_ramp_free (CcColorGammaRamp *ramp)
+{
+  guint c;
+
+  if (ramp == NULL)
+    return;
+
+  for (c = 0; c < N_CHANNELS; c++)
+    {
+      g_free (ramp->points[c]);
+      g_free (ramp->ramps[c]);
+      g_free (ramp->scratch[c]);
+    }
+  g_free (ramp->lower);
+  g_free (ramp->mix);
+  g_free (ramp);
+}
+
+guint
+cc_color_gamma_ramp_get_size (CcColorGammaRamp *ramp)
+{
+  return ramp->size;
+}
+
+/**
+ * cc_color_gamma_ramp_set_n_points:
+ *
+ * Sets the number of points of the CLUT, which are then set with
+ * cc_color_gamma_ramp_set_point().
+ **/
+void
+cc_color_gamma_ramp_set_n_points (CcColorGammaRamp *ramp,
+                                  guint n_points)
+{
+  guint c;
+
+  if (n_points + 1 > ramp->n_points_allocated)
+    {
+      ramp->n_points_allocated = n_points + 1;
+      for (c = 0; c < N_CHANNELS; c++)
+        ramp->points[c] = g_renew (gdouble, ramp->points[c], ramp->n_points_allocated);
+    }
+
+  ramp->n_points = n_points;
+}
+
+guint
+cc_color_gamma_ramp_get_n_points (CcColorGammaRamp *ramp)
+{
+  return ramp->n_points;
+}
+
+void
+cc_color_gamma_ramp_set_point (CcColorGammaRamp *ramp,
+                               guint i,
+                               const CdColorRGB *color)
+{
+  g_return_if_fail (i < ramp->n_points);
+
+  ramp->points[CHANNEL_RED][i] = color->R;
+  ramp->points[CHANNEL_GREEN][i] = color->G;
+  ramp->points[CHANNEL_BLUE][i] = color->B;
+}
+
+static void
+cc_color_gamma_ramp_ensure_layout (CcColorGammaRamp *ramp)
+{
+  gdouble mix;
+  guint i;
+
+  if (ramp->layout_n_points == ramp->n_points)
+    return;
+
+  for (i = 0; i < ramp->size; i++)
+    {
+      if (ramp->size > 1)
+        {
+          mix = (gdouble) (ramp->n_points - 1) /
+                (gdouble) (ramp->size - 1) *
+                (gdouble) i;
+        }
+      else
+        {
+          mix = 0;
+        }
+      ramp->lower[i] = MIN ((guint) floor (mix), ramp->n_points - 1);
+      ramp->mix[i] = mix - (gint) mix;
+    }
+
+  ramp->layout_n_points = ramp->n_points;
+}
+
+static void
+cc_color_gamma_ramp_interpolate (const gdouble *points,
+                                 const guint *lower,
+                                 const gdouble *mix,
+                                 guint16 *ramp,
+                                 guint size)
+{
+  guint i;
+
+  for (i = 0; i < size; i++)
+    {
+      gdouble value;
+
+      value = (1.0 - mix[i]) * points[lower[i]] + mix[i] * points[lower[i] + 1];
+      ramp[i] = CLAMP (value, 0.0, 1.0) * 0xffff;
+    }
+}
+
+/**
+ * cc_color_gamma_ramp_update:
+ *
+ * Builds the ramps from the points of the CLUT.
+ *
+ * Return value: %TRUE if the ramps changed since the last update
+ **/
+gboolean
+cc_color_gamma_ramp_update (CcColorGammaRamp *ramp)
+{
+  gboolean changed;
+  guint16 *tmp;
+  guint c;
+
+  g_return_val_if_fail (ramp->n_points > 0, FALSE);
+
+  cc_color_gamma_ramp_ensure_layout (ramp);
+
+  for (c = 0; c < N_CHANNELS; c++)
+    {
+      ramp->points[c][ramp->n_points] = ramp->points[c][ramp->n_points - 1];
+      cc_color_gamma_ramp_interpolate (ramp->points[c],
+                                       ramp->lower,
+                                       ramp->mix,
+                                       ramp->scratch[c],
+                                       ramp->size);
+    }
+
+  changed = !ramp->valid;
+  for (c = 0; c < N_CHANNELS && !changed; c++)
+    changed = memcmp (ramp->scratch[c], ramp->ramps[c], ramp->size * sizeof (guint16)) != 0;
+
+  if (changed)
+    {
+      for (c = 0; c < N_CHANNELS; c++)
+        {
+          tmp = ramp->ramps[c];
+          ramp->ramps[c] = ramp->scratch[c];
+          ramp->scratch[c] = tmp;
+        }
+    }
+  ramp->valid = TRUE;
+
+  return changed;
+}
+
+/**
+ * cc_color_gamma_ramp_invalidate:
+ *
+ * Makes the next update report a change, e.g. when the ramps could not
+ * be sent.
+ **/
+void
+cc_color_gamma_ramp_invalidate (CcColorGammaRamp *ramp)
+{
+  ramp->valid = FALSE;
+}
+
+const guint16 *
+cc_color_gamma_ramp_get_red (CcColorGammaRamp *ramp)
+{
+  return ramp->ramps[CHANNEL_RED];
+}
+
+const guint16 *
+cc_color_gamma_ramp_get_green (CcColorGammaRamp *ramp)
+{
+  return ramp->ramps[CHANNEL_GREEN];
+}
+
+const guint16 *
+cc_color_gamma_ramp_get_blue (CcColorGammaRamp *ramp)
+{
+  return ramp->ramps[CHANNEL_BLUE];
+}
@@ -0,0 +1,52 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*-
+ *
+ * Copyright (C) 2017 The GNOME Foundation
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef CC_COLOR_GAMMA_RAMP_H
+#define CC_COLOR_GAMMA_RAMP_H
+
+#include <glib.h>
+#include <colord.h>
+
+G_BEGIN_DECLS
+
+typedef struct _CcColorGammaRamp CcColorGammaRamp;
+
+CcColorGammaRamp *cc_color_gamma_ramp_new          (guint              size);
+void              cc_color_gamma_ramp_free         (CcColorGammaRamp  *ramp);
+
+guint             cc_color_gamma_ramp_get_size     (CcColorGammaRamp  *ramp);
+void              cc_color_gamma_ramp_set_n_points (CcColorGammaRamp  *ramp,
+                                                    guint              n_points);
+guint             cc_color_gamma_ramp_get_n_points (CcColorGammaRamp  *ramp);
+void              cc_color_gamma_ramp_set_point    (CcColorGammaRamp  *ramp,
+                                                    guint              i,
+                                                    const CdColorRGB  *color);
+
+gboolean          cc_color_gamma_ramp_update       (CcColorGammaRamp  *ramp);
+void              cc_color_gamma_ramp_invalidate   (CcColorGammaRamp  *ramp);
+
+const guint16    *cc_color_gamma_ramp_get_red      (CcColorGammaRamp  *ramp);
+const guint16    *cc_color_gamma_ramp_get_green    (CcColorGammaRamp  *ramp);
+const guint16    *cc_color_gamma_ramp_get_blue     (CcColorGammaRamp  *ramp);
+
+G_END_DECLS
+
+#endif /* CC_COLOR_GAMMA_RAMP_H */
@@ -32,6 +32,7 @@
 #include "cc-color-panel.h"
 #include "cc-color-resources.h"
 #include "cc-color-common.h"
+#include "cc-color-connector.h"
 #include "cc-color-device.h"
 #include "cc-color-profile.h"
 
@@ -45,8 +46,12 @@ CC_PANEL_REGISTER (CcColorPanel, cc_color_panel)
 struct _CcColorPanelPrivate
 {
   CdClient      *client;
+  CcColorConnector *connector;
   CdDevice      *current_device;
   GPtrArray     *devices;
+  guint          devices_connecting;
+  GPtrArray     *assign_profiles;
+  GCancellable  *assign_cancellable;
   GPtrArray     *sensors;
   GCancellable  *cancellable;
   GDBusProxy    *proxy;
@@ -106,6 +111,15 @@ enum {
 /* max number of devices and profiles to cause auto-expand at startup */
 #define GCM_PREFS_MAX_DEVICES_PROFILES_EXPANDED         5
 
+/* max number of devices and profiles being connected at once */
+#define GCM_PREFS_MAX_CONNECTIONS_IN_FLIGHT             8
+
+typedef struct {
+  CcColorPanel  *prefs;
+  CdDevice      *device;
+  gboolean       is_default;
+} GcmPrefsDeviceData;
+
 static void gcm_prefs_refresh_toolbar_buttons (CcColorPanel *panel);
 
 static void
@@ -754,17 +768,94 @@ gcm_prefs_profile_exists_in_array (GPtrArray *array, CdProfile *profile)
 }
 
 static void
-gcm_prefs_add_profiles_suitable_for_devices (CcColorPanel *prefs,
-                                             GPtrArray *profiles)
+gcm_prefs_assign_profile_connect_cb (GObject *object,
+                                     GAsyncResult *res,
+                                     gpointer user_data)
 {
+  CcColorPanel *prefs;
+  CcColorPanelPrivate *priv;
+  CdProfile *profile;
+  GError *error = NULL;
+
+  profile = cc_color_connector_connect_profile_finish (CC_COLOR_CONNECTOR (object),
+                                                       res,
+                                                       &error);
+  if (profile == NULL)
+    {
+      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        g_warning ("failed to get profile: %s", error->message);
+      g_error_free (error);
+      return;
+    }
+
+  /* the panel is still there if this wasn't cancelled */
+  prefs = CC_COLOR_PANEL (user_data);
+  priv = prefs->priv;
+
+  /* don't add any of the already added profiles */
+  if (priv->assign_profiles != NULL &&
+      gcm_prefs_profile_exists_in_array (priv->assign_profiles, profile))
+    goto out;
+
+  /* only add correct types */
+  if (!gcm_prefs_is_profile_suitable_for_device (profile,
+                                                 priv->current_device))
+    goto out;
+
+#if CD_CHECK_VERSION(0,1,13)
+  /* ignore profiles from other user accounts */
+  if (!cd_profile_has_access (profile))
+    goto out;
+#endif
+
+  /* add */
+  gcm_prefs_combobox_add_profile (prefs, profile, NULL);
+out:
+  g_object_unref (profile);
+}
+
+static void
+gcm_prefs_assign_get_profiles_cb (GObject *object,
+                                  GAsyncResult *res,
+                                  gpointer user_data)
+{
+  CcColorPanelPrivate *priv;
   CdProfile *profile_tmp;
-  gboolean ret;
   GError *error = NULL;
-  GPtrArray *profile_array = NULL;
-  GtkTreeIter iter;
+  GPtrArray *profile_array;
+  guint i;
+
+  profile_array = cd_client_get_profiles_finish (CD_CLIENT (object),
+                                                 res,
+                                                 &error);
+  if (profile_array == NULL)
+    {
+      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        g_warning ("failed to get profiles: %s", error->message);
+      g_error_free (error);
+      return;
+    }
+
+  /* add the profiles of the right kind as they get connected */
+  priv = CC_COLOR_PANEL (user_data)->priv;
+  for (i = 0; i < profile_array->len; i++)
+    {
+      profile_tmp = g_ptr_array_index (profile_array, i);
+      cc_color_connector_connect_profile (priv->connector,
+                                          profile_tmp,
+                                          priv->assign_cancellable,
+                                          gcm_prefs_assign_profile_connect_cb,
+                                          user_data);
+    }
+  g_ptr_array_unref (profile_array);
+}
+
+static void
+gcm_prefs_add_profiles_suitable_for_devices (CcColorPanel *prefs,
+                                             GPtrArray *profiles)
+{
   GtkListStore *list_store;
   GtkWidget *widget;
-  guint i;
   CcColorPanelPrivate *priv = prefs->priv;
 
   list_store = GTK_LIST_STORE(gtk_builder_get_object (prefs->priv->builder,
@@ -782,61 +873,21 @@ gcm_prefs_add_profiles_suitable_for_devices (CcColorPanel *prefs,
                                                "label_assign_warning"));
   gtk_widget_hide (widget);
 
-  /* get profiles */
-  profile_array = cd_client_get_profiles_sync (priv->client,
-                                               priv->cancellable,
-                                               &error);
-  if (profile_array == NULL)
-    {
-      g_warning ("failed to get profiles: %s",
-           error->message);
-      g_error_free (error);
-      goto out;
-    }
-
-  /* add profiles of the right kind */
-  for (i = 0; i < profile_array->len; i++)
-    {
-      profile_tmp = g_ptr_array_index (profile_array, i);
+  /* stop adding the profiles found the previous time */
+  if (priv->assign_cancellable != NULL)
+    g_cancellable_cancel (priv->assign_cancellable);
+  g_clear_object (&priv->assign_cancellable);
+  priv->assign_cancellable = g_cancellable_new ();
 
-      /* get properties */
-      ret = cd_profile_connect_sync (profile_tmp,
-                                     priv->cancellable,
-                                     &error);
-      if (!ret)
-        {
-          g_warning ("failed to get profile: %s", error->message);
-          g_error_free (error);
-          goto out;
-        }
-
-      /* don't add any of the already added profiles */
-      if (profiles != NULL)
-        {
-          if (gcm_prefs_profile_exists_in_array (profiles, profile_tmp))
-            continue;
-        }
-
-      /* only add correct types */
-      ret = gcm_prefs_is_profile_suitable_for_device (profile_tmp,
-                                                      priv->current_device);
-      if (!ret)
-        continue;
-
-#if CD_CHECK_VERSION(0,1,13)
-      /* ignore profiles from other user accounts */
-      if (!cd_profile_has_access (profile_tmp))
-        continue;
-#endif
+  g_clear_pointer (&priv->assign_profiles, g_ptr_array_unref);
+  if (profiles != NULL)
+    priv->assign_profiles = g_ptr_array_ref (profiles);
 
-      /* add */
-      gcm_prefs_combobox_add_profile (prefs,
-                                      profile_tmp,
-                                      &iter);
-    }
-out:
-  if (profile_array != NULL)
-    g_ptr_array_unref (profile_array);
+  /* get profiles */
+  cd_client_get_profiles (priv->client,
+                          priv->assign_cancellable,
+                          gcm_prefs_assign_get_profiles_cb,
+                          prefs);
 }
 
 static void
@@ -1573,27 +1624,79 @@ gcm_prefs_client_sensor_changed_cb (CdClient *client,
 }
 
 static void
-gcm_prefs_add_device_profile (CcColorPanel *prefs,
-                              CdDevice *device,
-                              CdProfile *profile,
-                              gboolean is_default)
+gcm_prefs_device_data_free (GcmPrefsDeviceData *data)
 {
-  CcColorPanelPrivate *priv = prefs->priv;
+  g_object_unref (data->device);
+  g_free (data);
+}
+
+static GcmPrefsDeviceData *
+gcm_prefs_device_data_new (CcColorPanel *prefs,
+                           CdDevice *device,
+                           gboolean is_default)
+{
+  GcmPrefsDeviceData *data;
+
+  data = g_new0 (GcmPrefsDeviceData, 1);
+  data->prefs = prefs;
+  data->device = g_object_ref (device);
+  data->is_default = is_default;
+
+  return data;
+}
+
+static gboolean gcm_prefs_find_widget_by_object_path (GList *list,
+                                                      const gchar *object_path_device,
+                                                      const gchar *object_path_profile);
+
+static void
+gcm_prefs_add_device_profile_cb (GObject *object,
+                                 GAsyncResult *res,
+                                 gpointer user_data)
+{
+  GcmPrefsDeviceData *data = user_data;
+  CcColorPanelPrivate *priv;
+  CdProfile *profile;
   gboolean ret;
   GError *error = NULL;
+  GList *list;
   GtkWidget *widget;
+  guint i;
 
   /* get properties */
-  ret = cd_profile_connect_sync (profile,
-                                 priv->cancellable,
-                                 &error);
-  if (!ret)
+  profile = cc_color_connector_connect_profile_finish (CC_COLOR_CONNECTOR (object),
+                                                       res,
+                                                       &error);
+  if (profile == NULL)
     {
-      g_warning ("failed to get profile: %s", error->message);
+      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        g_warning ("failed to get profile: %s", error->message);
       g_error_free (error);
       goto out;
     }
 
+  /* the panel is still there if this wasn't cancelled */
+  priv = data->prefs->priv;
+
+  /* the device was removed in the meantime */
+  ret = FALSE;
+  for (i = 0; i < priv->devices->len; i++)
+    {
+      if (g_ptr_array_index (priv->devices, i) == data->device)
+        ret = TRUE;
+    }
+  if (!ret)
+    goto out;
+
+  /* or the profile was already added after a change of the device */
+  list = gtk_container_get_children (GTK_CONTAINER (priv->list_box));
+  ret = gcm_prefs_find_widget_by_object_path (list,
+                                              cd_device_get_object_path (data->device),
+                                              cd_profile_get_object_path (profile));
+  g_list_free (list);
+  if (ret)
+    goto out;
+
   /* ignore profiles from other user accounts */
   if (!cd_profile_has_access (profile))
     {
@@ -1612,12 +1715,30 @@ gcm_prefs_add_device_profile (CcColorPanel *prefs,
     }
 
   /* add to listbox */
-  widget = cc_color_profile_new (device, profile, is_default);
+  widget = cc_color_profile_new (data->device, profile, data->is_default);
   gtk_widget_show (widget);
   gtk_container_add (GTK_CONTAINER (priv->list_box), widget);
   gtk_size_group_add_widget (priv->list_box_size, widget);
 out:
-  return;
+  if (profile != NULL)
+    g_object_unref (profile);
+  gcm_prefs_device_data_free (data);
+}
+
+static void
+gcm_prefs_add_device_profile (CcColorPanel *prefs,
+                              CdDevice *device,
+                              CdProfile *profile,
+                              gboolean is_default)
+{
+  CcColorPanelPrivate *priv = prefs->priv;
+
+  /* the row is added once the properties are there */
+  cc_color_connector_connect_profile (priv->connector,
+                                      profile,
+                                      priv->cancellable,
+                                      gcm_prefs_add_device_profile_cb,
+                                      gcm_prefs_device_data_new (prefs, device, is_default));
 }
 
 static void
@@ -1783,41 +1904,81 @@ gcm_prefs_device_expanded_changed_cb (CcColorDevice *widget,
   gtk_list_box_invalidate_filter (priv->list_box);
 }
 
+static void gcm_prefs_update_device_list_extra_entry (CcColorPanel *prefs);
+
 static void
-gcm_prefs_add_device (CcColorPanel *prefs, CdDevice *device)
+gcm_prefs_add_device_cb (GObject *object,
+                         GAsyncResult *res,
+                         gpointer user_data)
 {
-  CcColorPanelPrivate *priv = prefs->priv;
+  GcmPrefsDeviceData *data = user_data;
+  CcColorPanel *prefs;
+  CcColorPanelPrivate *priv;
   gboolean ret;
   GError *error = NULL;
   GtkWidget *widget;
 
   /* get device properties */
-  ret = cd_device_connect_sync (device, priv->cancellable, &error);
+  ret = cc_color_connector_connect_device_finish (CC_COLOR_CONNECTOR (object),
+                                                  res,
+                                                  &error);
   if (!ret)
     {
+      if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        {
+          g_error_free (error);
+          gcm_prefs_device_data_free (data);
+          return;
+        }
+
       g_warning ("failed to connect to the device: %s", error->message);
       g_error_free (error);
-      goto out;
     }
 
+  /* the panel is still there if this wasn't cancelled */
+  prefs = data->prefs;
+  priv = prefs->priv;
+  if (!ret)
+    goto out;
+
   /* add device */
-  widget = cc_color_device_new (device);
+  widget = cc_color_device_new (data->device);
   g_signal_connect (widget, "expanded-changed",
                     G_CALLBACK (gcm_prefs_device_expanded_changed_cb), prefs);
   gtk_widget_show (widget);
   gtk_container_add (GTK_CONTAINER (priv->list_box), widget);
   gtk_size_group_add_widget (priv->list_box_size, widget);
 
-  /* add profiles */
-  gcm_prefs_add_device_profiles (prefs, device);
-
   /* watch for changes */
-  g_ptr_array_add (priv->devices, g_object_ref (device));
-  g_signal_connect (device, "changed",
+  g_ptr_array_add (priv->devices, g_object_ref (data->device));
+  g_signal_connect (data->device, "changed",
                     G_CALLBACK (gcm_prefs_device_changed_cb), prefs);
+
+  /* add profiles */
+  gcm_prefs_add_device_profiles (prefs, data->device);
+
   gtk_list_box_invalidate_sort (priv->list_box);
 out:
-  return;
+  /* ensure we show the right 'No devices detected' entry once all the
+   * devices are there */
+  if (--priv->devices_connecting == 0)
+    gcm_prefs_update_device_list_extra_entry (prefs);
+
+  gcm_prefs_device_data_free (data);
+}
+
+static void
+gcm_prefs_add_device (CcColorPanel *prefs, CdDevice *device)
+{
+  CcColorPanelPrivate *priv = prefs->priv;
+
+  /* the row is added once the properties are there */
+  priv->devices_connecting++;
+  cc_color_connector_connect_device (priv->connector,
+                                     device,
+                                     priv->cancellable,
+                                     gcm_prefs_add_device_cb,
+                                     gcm_prefs_device_data_new (prefs, device, FALSE));
 }
 
 static void
@@ -1877,11 +2038,8 @@ gcm_prefs_device_added_cb (CdClient *client,
                            CdDevice *device,
                            CcColorPanel *prefs)
 {
-  /* add the device */
+  /* add the device, this also updates the 'No devices detected' entry */
   gcm_prefs_add_device (prefs, device);
-
-  /* ensure we're not showing the 'No devices detected' entry */
-  gcm_prefs_update_device_list_extra_entry (prefs);
 }
 
 static void
@@ -1924,7 +2082,8 @@ gcm_prefs_get_devices_cb (GObject *object,
     }
 
   /* ensure we show the 'No devices detected' entry if empty */
-  gcm_prefs_update_device_list_extra_entry (prefs);
+  if (prefs->priv->devices_connecting == 0)
+    gcm_prefs_update_device_list_extra_entry (prefs);
 out:
   if (devices != NULL)
     g_ptr_array_unref (devices);
@@ -2158,10 +2317,15 @@ cc_color_panel_dispose (GObject *object)
 
   if (priv->cancellable != NULL)
     g_cancellable_cancel (priv->cancellable);
+  if (priv->assign_cancellable != NULL)
+    g_cancellable_cancel (priv->assign_cancellable);
   g_clear_object (&priv->settings);
   g_clear_object (&priv->settings_colord);
   g_clear_object (&priv->cancellable);
+  g_clear_object (&priv->assign_cancellable);
+  g_clear_pointer (&priv->assign_profiles, g_ptr_array_unref);
   g_clear_object (&priv->builder);
+  g_clear_object (&priv->connector);
   g_clear_object (&priv->client);
   g_clear_object (&priv->current_device);
   g_clear_object (&priv->calibrate);
@@ -2489,6 +2653,8 @@ cc_color_panel_init (CcColorPanel *prefs)
 
   /* use a device client array */
   priv->client = cd_client_new ();
+  priv->connector = cc_color_connector_new (priv->client,
+                                            GCM_PREFS_MAX_CONNECTIONS_IN_FLIGHT);
   g_signal_connect_object (priv->client, "device-added",
                            G_CALLBACK (gcm_prefs_device_added_cb), prefs, 0);
   g_signal_connect_object (priv->client, "device-removed",
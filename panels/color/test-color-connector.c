@@ -0,0 +1,549 @@
+#include "config.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <gio/gio.h>
+#include <colord.h>
+
+#include "cc-color-connector.h"
+
+/* A mock colord on a private bus: it has N_PROFILES profiles, and
+ * replies to the requests for their properties in batches, from an
+ * idle, so that the number of profiles being connected at once can be
+ * checked.
+ */
+
+#define COLORD_SERVICE          "org.freedesktop.ColorManager"
+#define COLORD_PATH             "/org/freedesktop/ColorManager"
+#define COLORD_INTERFACE        "org.freedesktop.ColorManager"
+
+#define N_PROFILES              40
+#define MAX_IN_FLIGHT           4
+
+static const gchar colord_xml[] =
+  "<node>"
+  "  <interface name='org.freedesktop.ColorManager'>"
+  "    <method name='GetProfiles'>"
+  "      <arg type='ao' name='object_paths' direction='out'/>"
+  "    </method>"
+  "    <method name='GetDevices'>"
+  "      <arg type='ao' name='object_paths' direction='out'/>"
+  "    </method>"
+  "    <signal name='ProfileRemoved'>"
+  "      <arg type='o' name='object_path'/>"
+  "    </signal>"
+  "    <property type='s' name='DaemonVersion' access='read'/>"
+  "  </interface>"
+  "</node>";
+
+static const gchar profile_xml[] =
+  "<node>"
+  "  <interface name='org.freedesktop.ColorManager.Profile'>"
+  "    <property type='s' name='ProfileId' access='read'/>"
+  "    <property type='s' name='Title' access='read'/>"
+  "    <property type='s' name='Kind' access='read'/>"
+  "    <property type='s' name='Colorspace' access='read'/>"
+  "    <property type='s' name='Filename' access='read'/>"
+  "  </interface>"
+  "</node>";
+
+typedef struct {
+  GDBusConnection *connection;
+  GDBusNodeInfo   *colord_info;
+  GDBusNodeInfo   *profile_info;
+  GQueue           pending;
+  guint            reply_id;
+  guint            n_get_all;
+  guint            max_pending;
+} MockColord;
+
+static MockColord *mock;
+
+static gchar *
+get_profile_path (guint i)
+{
+  return g_strdup_printf (COLORD_PATH "/profiles/mock_%u", i);
+}
+
+static void
+mock_colord_method_call (GDBusConnection       *connection,
+                         const gchar           *sender,
+                         const gchar           *object_path,
+                         const gchar           *interface_name,
+                         const gchar           *method_name,
+                         GVariant              *parameters,
+                         GDBusMethodInvocation *invocation,
+                         gpointer               user_data)
+{
+  GVariantBuilder builder;
+  guint i;
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("ao"));
+
+  if (g_strcmp0 (method_name, "GetProfiles") == 0)
+    {
+      for (i = 0; i < N_PROFILES; i++)
+        {
+          gchar *path = get_profile_path (i);
+          g_variant_builder_add (&builder, "o", path);
+          g_free (path);
+        }
+    }
+
+  g_dbus_method_invocation_return_value (invocation,
+                                         g_variant_new ("(ao)", &builder));
+}
+
+static GVariant *
+mock_colord_get_property (GDBusConnection  *connection,
+                          const gchar      *sender,
+                          const gchar      *object_path,
+                          const gchar      *interface_name,
+                          const gchar      *property_name,
+                          GError          **error,
+                          gpointer          user_data)
+{
+  return g_variant_new_string ("1.3.0");
+}
+
+static const GDBusInterfaceVTable colord_vtable = {
+  mock_colord_method_call,
+  mock_colord_get_property,
+  NULL
+};
+
+static GVariant *
+mock_profile_get_properties (guint i)
+{
+  GVariantBuilder builder;
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{sv}"));
+  g_variant_builder_add (&builder, "{sv}", "ProfileId",
+                         g_variant_new_take_string (g_strdup_printf ("mock-%u", i)));
+  g_variant_builder_add (&builder, "{sv}", "Title",
+                         g_variant_new_take_string (g_strdup_printf ("Profile %u", i)));
+  g_variant_builder_add (&builder, "{sv}", "Kind",
+                         g_variant_new_string ("display-device"));
+  g_variant_builder_add (&builder, "{sv}", "Colorspace",
+                         g_variant_new_string ("rgb"));
+
+  return g_variant_builder_end (&builder);
+}
+
+static gboolean
+mock_profile_reply_cb (gpointer user_data)
+{
+  GDBusMethodInvocation *invocation;
+
+  while ((invocation = g_queue_pop_head (&mock->pending)) != NULL)
+    {
+      guint i = GPOINTER_TO_UINT (g_object_get_data (G_OBJECT (invocation), "profile"));
+
+      g_dbus_method_invocation_return_value (invocation,
+                                             g_variant_new ("(@a{sv})",
+                                                            mock_profile_get_properties (i)));
+    }
+
+  mock->reply_id = 0;
+  return G_SOURCE_REMOVE;
+}
+
+/* Without a get_property() function, the property requests come here */
+static void
+mock_profile_method_call (GDBusConnection       *connection,
+                          const gchar           *sender,
+                          const gchar           *object_path,
+                          const gchar           *interface_name,
+                          const gchar           *method_name,
+                          GVariant              *parameters,
+                          GDBusMethodInvocation *invocation,
+                          gpointer               user_data)
+{
+  if (g_strcmp0 (method_name, "GetAll") != 0)
+    {
+      g_dbus_method_invocation_return_dbus_error (invocation,
+                                                  "org.freedesktop.DBus.Error.NotSupported",
+                                                  "Only GetAll is supported");
+      return;
+    }
+
+  mock->n_get_all++;
+
+  g_object_set_data (G_OBJECT (invocation), "profile", user_data);
+  g_queue_push_tail (&mock->pending, invocation);
+  mock->max_pending = MAX (mock->max_pending, mock->pending.length);
+
+  if (mock->reply_id == 0)
+    mock->reply_id = g_timeout_add (10, mock_profile_reply_cb, NULL);
+}
+
+static const GDBusInterfaceVTable profile_vtable = {
+  mock_profile_method_call,
+  NULL,
+  NULL
+};
+
+static void
+name_acquired_cb (GDBusConnection *connection,
+                  const gchar     *name,
+                  gpointer         user_data)
+{
+  gboolean *acquired = user_data;
+
+  *acquired = TRUE;
+}
+
+static void
+mock_colord_start (const gchar *address)
+{
+  GError *error = NULL;
+  gboolean acquired = FALSE;
+  guint i;
+
+  mock = g_new0 (MockColord, 1);
+  g_queue_init (&mock->pending);
+
+  mock->connection = g_dbus_connection_new_for_address_sync (address,
+                                                             G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT |
+                                                             G_DBUS_CONNECTION_FLAGS_MESSAGE_BUS_CONNECTION,
+                                                             NULL, NULL, &error);
+  g_assert_no_error (error);
+
+  mock->colord_info = g_dbus_node_info_new_for_xml (colord_xml, &error);
+  g_assert_no_error (error);
+  mock->profile_info = g_dbus_node_info_new_for_xml (profile_xml, &error);
+  g_assert_no_error (error);
+
+  g_dbus_connection_register_object (mock->connection,
+                                     COLORD_PATH,
+                                     mock->colord_info->interfaces[0],
+                                     &colord_vtable,
+                                     NULL, NULL, &error);
+  g_assert_no_error (error);
+
+  for (i = 0; i < N_PROFILES; i++)
+    {
+      gchar *path = get_profile_path (i);
+
+      g_dbus_connection_register_object (mock->connection,
+                                         path,
+                                         mock->profile_info->interfaces[0],
+                                         &profile_vtable,
+                                         GUINT_TO_POINTER (i), NULL, &error);
+      g_assert_no_error (error);
+      g_free (path);
+    }
+
+  g_bus_own_name_on_connection (mock->connection,
+                                COLORD_SERVICE,
+                                G_BUS_NAME_OWNER_FLAGS_NONE,
+                                name_acquired_cb,
+                                NULL,
+                                &acquired,
+                                NULL);
+  while (!acquired)
+    g_main_context_iteration (NULL, TRUE);
+}
+
+static void
+mock_colord_stop (void)
+{
+  g_dbus_connection_close_sync (mock->connection, NULL, NULL);
+  g_object_unref (mock->connection);
+  g_dbus_node_info_unref (mock->colord_info);
+  g_dbus_node_info_unref (mock->profile_info);
+  g_clear_pointer (&mock, g_free);
+}
+
+typedef struct {
+  GPtrArray *profiles;
+  guint      n_pending;
+  guint      n_errors;
+} ConnectData;
+
+static void
+connect_cb (GObject      *object,
+            GAsyncResult *res,
+            gpointer      user_data)
+{
+  ConnectData *data = user_data;
+  CdProfile *profile;
+  GError *error = NULL;
+
+  profile = cc_color_connector_connect_profile_finish (CC_COLOR_CONNECTOR (object), res, &error);
+  if (profile != NULL)
+    g_ptr_array_add (data->profiles, profile);
+  else
+    {
+      g_assert_error (error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+      g_error_free (error);
+      data->n_errors++;
+    }
+
+  data->n_pending--;
+}
+
+static void
+get_profiles_cb (GObject      *object,
+                 GAsyncResult *res,
+                 gpointer      user_data)
+{
+  GPtrArray **profiles = user_data;
+  GError *error = NULL;
+
+  *profiles = cd_client_get_profiles_finish (CD_CLIENT (object), res, &error);
+  g_assert_no_error (error);
+}
+
+static void
+client_connect_cb (GObject      *object,
+                   GAsyncResult *res,
+                   gpointer      user_data)
+{
+  gboolean *connected = user_data;
+  GError *error = NULL;
+
+  *connected = cd_client_connect_finish (CD_CLIENT (object), res, &error);
+  g_assert_no_error (error);
+}
+
+/* The mock replies from this main context, so nothing can be synchronous */
+static CdClient *
+connect_client (void)
+{
+  CdClient *client;
+  gboolean connected = FALSE;
+
+  client = cd_client_new ();
+  cd_client_connect (client, NULL, client_connect_cb, &connected);
+  while (!connected)
+    g_main_context_iteration (NULL, TRUE);
+
+  return client;
+}
+
+static GPtrArray *
+get_profiles (CdClient *client)
+{
+  GPtrArray *profiles = NULL;
+
+  cd_client_get_profiles (client, NULL, get_profiles_cb, &profiles);
+  while (profiles == NULL)
+    g_main_context_iteration (NULL, TRUE);
+
+  g_assert_cmpuint (profiles->len, ==, N_PROFILES);
+
+  return profiles;
+}
+
+static ConnectData *
+connect_profiles (CcColorConnector *connector,
+                  GPtrArray        *profiles,
+                  GCancellable     *cancellable)
+{
+  ConnectData *data;
+  guint i;
+
+  data = g_new0 (ConnectData, 1);
+  data->profiles = g_ptr_array_new_with_free_func (g_object_unref);
+  data->n_pending = profiles->len;
+
+  for (i = 0; i < profiles->len; i++)
+    cc_color_connector_connect_profile (connector,
+                                        g_ptr_array_index (profiles, i),
+                                        cancellable,
+                                        connect_cb,
+                                        data);
+
+  return data;
+}
+
+static void
+connect_data_free (ConnectData *data)
+{
+  g_ptr_array_unref (data->profiles);
+  g_free (data);
+}
+
+static void
+test_connect_profiles (void)
+{
+  CcColorConnector *connector;
+  CdClient *client;
+  ConnectData *data;
+  GPtrArray *profiles;
+  gboolean seen[N_PROFILES] = { FALSE, };
+  guint i;
+
+  client = connect_client ();
+  connector = cc_color_connector_new (client, MAX_IN_FLIGHT);
+  profiles = get_profiles (client);
+
+  mock->n_get_all = 0;
+  mock->max_pending = 0;
+
+  data = connect_profiles (connector, profiles, NULL);
+  while (data->n_pending > 0)
+    g_main_context_iteration (NULL, TRUE);
+
+  /* connected in parallel, but never more than allowed at once */
+  g_assert_cmpuint (mock->n_get_all, ==, N_PROFILES);
+  g_assert_cmpuint (mock->max_pending, >, 1);
+  g_assert_cmpuint (mock->max_pending, <=, MAX_IN_FLIGHT);
+
+  g_assert_cmpuint (data->n_errors, ==, 0);
+  g_assert_cmpuint (data->profiles->len, ==, N_PROFILES);
+  for (i = 0; i < data->profiles->len; i++)
+    {
+      CdProfile *profile = g_ptr_array_index (data->profiles, i);
+      guint n;
+
+      g_assert_true (cd_profile_get_connected (profile));
+      g_assert_true (g_str_has_prefix (cd_profile_get_title (profile), "Profile "));
+      n = atoi (cd_profile_get_title (profile) + strlen ("Profile "));
+      g_assert_cmpuint (n, <, N_PROFILES);
+      g_assert_false (seen[n]);
+      seen[n] = TRUE;
+
+      g_assert_cmpint (cd_profile_get_kind (profile), ==, CD_PROFILE_KIND_DISPLAY_DEVICE);
+      g_assert_cmpint (cd_profile_get_colorspace (profile), ==, CD_COLORSPACE_RGB);
+    }
+
+  connect_data_free (data);
+  g_ptr_array_unref (profiles);
+  g_object_unref (connector);
+  g_object_unref (client);
+}
+
+static void
+profile_removed_cb (CdClient  *client,
+                    CdProfile *profile,
+                    gpointer   user_data)
+{
+  gboolean *removed = user_data;
+
+  *removed = TRUE;
+}
+
+static void
+test_cached_profiles (void)
+{
+  CcColorConnector *connector;
+  CdClient *client;
+  ConnectData *data;
+  GPtrArray *profiles;
+  gboolean removed = FALSE;
+  gchar *path;
+
+  client = connect_client ();
+  connector = cc_color_connector_new (client, MAX_IN_FLIGHT);
+
+  profiles = get_profiles (client);
+  data = connect_profiles (connector, profiles, NULL);
+  while (data->n_pending > 0)
+    g_main_context_iteration (NULL, TRUE);
+  connect_data_free (data);
+  g_ptr_array_unref (profiles);
+
+  /* new objects for the same profiles don't need to be connected again */
+  mock->n_get_all = 0;
+
+  profiles = get_profiles (client);
+  data = connect_profiles (connector, profiles, NULL);
+  while (data->n_pending > 0)
+    g_main_context_iteration (NULL, TRUE);
+
+  g_assert_cmpuint (mock->n_get_all, ==, 0);
+  g_assert_cmpuint (data->profiles->len, ==, N_PROFILES);
+  connect_data_free (data);
+
+  /* unless colord removed them in the meantime */
+  g_signal_connect (client, "profile-removed",
+                    G_CALLBACK (profile_removed_cb), &removed);
+
+  path = get_profile_path (0);
+  g_dbus_connection_emit_signal (mock->connection, NULL,
+                                 COLORD_PATH, COLORD_INTERFACE,
+                                 "ProfileRemoved",
+                                 g_variant_new ("(o)", path),
+                                 NULL);
+  g_free (path);
+
+  while (!removed)
+    g_main_context_iteration (NULL, TRUE);
+
+  data = connect_profiles (connector, profiles, NULL);
+  while (data->n_pending > 0)
+    g_main_context_iteration (NULL, TRUE);
+
+  g_assert_cmpuint (mock->n_get_all, ==, 1);
+  connect_data_free (data);
+
+  g_ptr_array_unref (profiles);
+  g_object_unref (connector);
+  g_object_unref (client);
+}
+
+static void
+test_cancel (void)
+{
+  CcColorConnector *connector;
+  CdClient *client;
+  ConnectData *data;
+  GCancellable *cancellable;
+  GPtrArray *profiles;
+
+  client = connect_client ();
+  connector = cc_color_connector_new (client, MAX_IN_FLIGHT);
+  profiles = get_profiles (client);
+  cancellable = g_cancellable_new ();
+
+  mock->n_get_all = 0;
+
+  /* the queued profiles are not connected once cancelled */
+  data = connect_profiles (connector, profiles, cancellable);
+  g_cancellable_cancel (cancellable);
+  while (data->n_pending > 0)
+    g_main_context_iteration (NULL, TRUE);
+
+  g_assert_cmpuint (data->n_errors, ==, N_PROFILES);
+  g_assert_cmpuint (mock->n_get_all, <=, MAX_IN_FLIGHT);
+
+  /* let the mock reply to the requests that were already sent */
+  while (mock->reply_id != 0)
+    g_main_context_iteration (NULL, TRUE);
+
+  connect_data_free (data);
+  g_object_unref (cancellable);
+  g_ptr_array_unref (profiles);
+  g_object_unref (connector);
+  g_object_unref (client);
+}
+
+int
+main (int argc, char **argv)
+{
+  GTestDBus *bus;
+  int ret;
+
+  g_test_init (&argc, &argv, NULL);
+
+  /* colord is on the system bus */
+  bus = g_test_dbus_new (G_TEST_DBUS_NONE);
+  g_test_dbus_up (bus);
+  g_setenv ("DBUS_SYSTEM_BUS_ADDRESS", g_test_dbus_get_bus_address (bus), TRUE);
+
+  mock_colord_start (g_test_dbus_get_bus_address (bus));
+
+  g_test_add_func ("/color/connector/connect-profiles", test_connect_profiles);
+  g_test_add_func ("/color/connector/cached-profiles", test_cached_profiles);
+  g_test_add_func ("/color/connector/cancel", test_cancel);
+
+  ret = g_test_run ();
+
+  mock_colord_stop ();
+  g_test_dbus_down (bus);
+  g_object_unref (bus);
+
+  return ret;
+}
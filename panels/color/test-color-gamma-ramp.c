@@ -0,0 +1,245 @@
+#include "config.h"
+
+#include <math.h>
+#include <colord.h>
+
+#include "cc-color-gamma-ramp.h"
+
+/* Run with "-m perf" to compare the timings with the previous way of
+ * building the ramps */
+#define N_BENCHMARK_UPDATES 2000
+
+/* How the ramps were built for each update before CcColorGammaRamp */
+static void
+build_reference_ramps (GPtrArray *array,
+                       guint      gamma_size,
+                       guint16  **red_out,
+                       guint16  **green_out,
+                       guint16  **blue_out)
+{
+  CdColorRGB *p1;
+  CdColorRGB *p2;
+  CdColorRGB result;
+  gdouble mix;
+  guint16 *blue;
+  guint16 *green;
+  guint16 *red;
+  guint i;
+
+  red = g_new (guint16, gamma_size);
+  green = g_new (guint16, gamma_size);
+  blue = g_new (guint16, gamma_size);
+  cd_color_rgb_set (&result, 1.0, 1.0, 1.0);
+  for (i = 0; i < gamma_size; i++)
+    {
+      mix = (gdouble) (array->len - 1) /
+            (gdouble) (gamma_size - 1) *
+            (gdouble) i;
+      p1 = g_ptr_array_index (array, (guint) floor (mix));
+      p2 = g_ptr_array_index (array, (guint) ceil (mix));
+      cd_color_rgb_interpolate (p1,
+                                p2,
+                                mix - (gint) mix,
+                                &result);
+      red[i] = result.R * 0xffff;
+      green[i] = result.G * 0xffff;
+      blue[i] = result.B * 0xffff;
+    }
+
+  *red_out = red;
+  *green_out = green;
+  *blue_out = blue;
+}
+
+/* A gamma curve with some noise, like the CLUTs sent during a
+ * calibration */
+static GPtrArray *
+create_clut (guint   n_points,
+             GRand  *rand)
+{
+  GPtrArray *array;
+  guint i;
+
+  array = g_ptr_array_new_with_free_func ((GDestroyNotify) cd_color_rgb_free);
+  for (i = 0; i < n_points; i++)
+    {
+      CdColorRGB *color = cd_color_rgb_new ();
+      gdouble x = n_points > 1 ? (gdouble) i / (n_points - 1) : 1.0;
+
+      cd_color_rgb_set (color,
+                        CLAMP (pow (x, 1 / 2.2) + g_rand_double_range (rand, -0.01, 0.01), 0, 1),
+                        CLAMP (pow (x, 1 / 2.2) + g_rand_double_range (rand, -0.01, 0.01), 0, 1),
+                        CLAMP (pow (x, 1 / 2.2) + g_rand_double_range (rand, -0.01, 0.01), 0, 1));
+      g_ptr_array_add (array, color);
+    }
+
+  return array;
+}
+
+static void
+set_clut (CcColorGammaRamp *ramp,
+          GPtrArray        *array)
+{
+  guint i;
+
+  cc_color_gamma_ramp_set_n_points (ramp, array->len);
+  for (i = 0; i < array->len; i++)
+    cc_color_gamma_ramp_set_point (ramp, i, g_ptr_array_index (array, i));
+}
+
+static void
+check_ramps (guint gamma_size,
+             guint n_points,
+             GRand *rand)
+{
+  CcColorGammaRamp *ramp;
+  GPtrArray *array;
+  guint16 *blue;
+  guint16 *green;
+  guint16 *red;
+
+  array = create_clut (n_points, rand);
+  build_reference_ramps (array, gamma_size, &red, &green, &blue);
+
+  ramp = cc_color_gamma_ramp_new (gamma_size);
+  set_clut (ramp, array);
+  g_assert_true (cc_color_gamma_ramp_update (ramp));
+
+  g_assert_cmpmem (cc_color_gamma_ramp_get_red (ramp), gamma_size * sizeof (guint16),
+                   red, gamma_size * sizeof (guint16));
+  g_assert_cmpmem (cc_color_gamma_ramp_get_green (ramp), gamma_size * sizeof (guint16),
+                   green, gamma_size * sizeof (guint16));
+  g_assert_cmpmem (cc_color_gamma_ramp_get_blue (ramp), gamma_size * sizeof (guint16),
+                   blue, gamma_size * sizeof (guint16));
+
+  cc_color_gamma_ramp_free (ramp);
+  g_ptr_array_unref (array);
+  g_free (red);
+  g_free (green);
+  g_free (blue);
+}
+
+static void
+test_interpolation (void)
+{
+  const guint gamma_sizes[] = { 2, 256, 1024, 4096 };
+  const guint n_points[] = { 1, 2, 3, 17, 256, 1000 };
+  GRand *rand;
+  guint i;
+  guint j;
+
+  rand = g_rand_new_with_seed (42);
+
+  for (i = 0; i < G_N_ELEMENTS (gamma_sizes); i++)
+    for (j = 0; j < G_N_ELEMENTS (n_points); j++)
+      check_ramps (gamma_sizes[i], n_points[j], rand);
+
+  g_rand_free (rand);
+}
+
+static void
+test_changes (void)
+{
+  CcColorGammaRamp *ramp;
+  CdColorRGB color;
+  GPtrArray *array;
+  GRand *rand;
+
+  rand = g_rand_new_with_seed (42);
+  array = create_clut (64, rand);
+  ramp = cc_color_gamma_ramp_new (1024);
+
+  /* the first ramps are always new */
+  set_clut (ramp, array);
+  g_assert_true (cc_color_gamma_ramp_update (ramp));
+
+  /* the same CLUT gives the same ramps */
+  set_clut (ramp, array);
+  g_assert_false (cc_color_gamma_ramp_update (ramp));
+
+  /* unless asked to */
+  cc_color_gamma_ramp_invalidate (ramp);
+  g_assert_true (cc_color_gamma_ramp_update (ramp));
+
+  /* a point changes */
+  cd_color_rgb_set (&color, 0.5, 0.25, 0.125);
+  cc_color_gamma_ramp_set_point (ramp, 32, &color);
+  g_assert_true (cc_color_gamma_ramp_update (ramp));
+  g_assert_false (cc_color_gamma_ramp_update (ramp));
+
+  /* the number of points changes */
+  g_ptr_array_unref (array);
+  array = create_clut (65, rand);
+  set_clut (ramp, array);
+  g_assert_true (cc_color_gamma_ramp_update (ramp));
+  g_assert_cmpuint (cc_color_gamma_ramp_get_n_points (ramp), ==, 65);
+
+  cc_color_gamma_ramp_free (ramp);
+  g_ptr_array_unref (array);
+  g_rand_free (rand);
+}
+
+static void
+test_benchmark (void)
+{
+  CcColorGammaRamp *ramp;
+  GPtrArray *arrays[2];
+  GRand *rand;
+  GTimer *timer;
+  gdouble reference_time;
+  gdouble ramp_time;
+  guint i;
+
+  if (!g_test_perf ())
+    return;
+
+  rand = g_rand_new_with_seed (42);
+  arrays[0] = create_clut (256, rand);
+  arrays[1] = create_clut (256, rand);
+
+  timer = g_timer_new ();
+  for (i = 0; i < N_BENCHMARK_UPDATES; i++)
+    {
+      guint16 *red, *green, *blue;
+
+      build_reference_ramps (arrays[i % 2], 4096, &red, &green, &blue);
+      g_free (red);
+      g_free (green);
+      g_free (blue);
+    }
+  reference_time = g_timer_elapsed (timer, NULL);
+
+  ramp = cc_color_gamma_ramp_new (4096);
+  g_timer_start (timer);
+  for (i = 0; i < N_BENCHMARK_UPDATES; i++)
+    {
+      set_clut (ramp, arrays[i % 2]);
+      g_assert_true (cc_color_gamma_ramp_update (ramp));
+    }
+  ramp_time = g_timer_elapsed (timer, NULL);
+
+  g_test_minimized_result (reference_time * 1000 / N_BENCHMARK_UPDATES,
+                           "previous path: %.3f ms per 4096 entry update",
+                           reference_time * 1000 / N_BENCHMARK_UPDATES);
+  g_test_minimized_result (ramp_time * 1000 / N_BENCHMARK_UPDATES,
+                           "CcColorGammaRamp: %.3f ms per 4096 entry update",
+                           ramp_time * 1000 / N_BENCHMARK_UPDATES);
+
+  cc_color_gamma_ramp_free (ramp);
+  g_ptr_array_unref (arrays[0]);
+  g_ptr_array_unref (arrays[1]);
+  g_timer_destroy (timer);
+  g_rand_free (rand);
+}
+
+int
+main (int argc, char **argv)
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/color/gamma-ramp/interpolation", test_interpolation);
+  g_test_add_func ("/color/gamma-ramp/changes", test_changes);
+  g_test_add_func ("/color/gamma-ramp/benchmark", test_benchmark);
+
+  return g_test_run ();
+}
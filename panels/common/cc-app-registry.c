@@ -0,0 +1,539 @@
+/*
+ * Copyright (c) 2017 The GNOME Foundation
+ *
+ * The Control Center is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * The Control Center is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with the Control Center; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#include "config.h"
+
+#include <glib/gstdio.h>
+
+#include "cc-app-registry.h"
+
+/* The installed applications, shared by all the panels of the process.
+ *
+ * The desktop files are only parsed when a panel first needs them, in a
+ * thread with cc_app_registry_load_async(), or synchronously by the
+ * lookup functions. The applications are then indexed by desktop id and
+ * by the content types of their MimeType key. Indexes of applications
+ * with a given boolean key are built the first time they are asked for.
+ *
+ * The registry listens to the GAppInfoMonitor of the process. When it
+ * says applications changed, they are scanned again in a thread and
+ * compared with the known ones by desktop file, modification time and
+ * size, and "app-added", "app-removed" and "app-changed" are emitted for
+ * the differences only.
+ */
+
+typedef struct
+{
+  GDesktopAppInfo *info;
+  gint64           mtime;
+  gint64           size;
+} AppEntry;
+
+struct _CcAppRegistry
+{
+  GObject          parent_instance;
+
+  GAppInfoMonitor *monitor;
+
+  /* desktop id → AppEntry */
+  GHashTable      *apps;
+  /* content type → GPtrArray of GDesktopAppInfo */
+  GHashTable      *by_type;
+  /* boolean key → GPtrArray of GDesktopAppInfo */
+  GHashTable      *by_key;
+
+  gboolean         loaded;
+  gboolean         scanning;
+  gboolean         rescan_pending;
+  GList           *load_tasks;
+};
+
+G_DEFINE_TYPE (CcAppRegistry, cc_app_registry, G_TYPE_OBJECT)
+
+enum {
+  APP_ADDED,
+  APP_REMOVED,
+  APP_CHANGED,
+  LAST_SIGNAL
+};
+
+static guint signals[LAST_SIGNAL] = { 0 };
+
+static void
+app_entry_free (AppEntry *entry)
+{
+  g_object_unref (entry->info);
+  g_slice_free (AppEntry, entry);
+}
+
+static gboolean
+app_entry_equal (AppEntry *a,
+                 AppEntry *b)
+{
+  return a->mtime == b->mtime &&
+         a->size == b->size &&
+         g_strcmp0 (g_desktop_app_info_get_filename (a->info),
+                    g_desktop_app_info_get_filename (b->info)) == 0;
+}
+
+/* Can be called from any thread */
+static GHashTable *
+scan_apps (void)
+{
+  GHashTable *apps;
+  GList *infos, *l;
+
+  apps = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                NULL, (GDestroyNotify) app_entry_free);
+
+  infos = g_app_info_get_all ();
+  for (l = infos; l != NULL; l = l->next)
+    {
+      GDesktopAppInfo *info = l->data;
+      const gchar *desktop_id;
+      const gchar *filename;
+      AppEntry *entry;
+      GStatBuf buf;
+
+      desktop_id = g_app_info_get_id (G_APP_INFO (info));
+      if (desktop_id == NULL || g_hash_table_contains (apps, desktop_id))
+        continue;
+
+      entry = g_slice_new (AppEntry);
+      entry->info = g_object_ref (info);
+      entry->mtime = -1;
+      entry->size = -1;
+
+      filename = g_desktop_app_info_get_filename (info);
+      if (filename != NULL && g_stat (filename, &buf) == 0)
+        {
+          entry->mtime = buf.st_mtime;
+          entry->size = buf.st_size;
+        }
+
+      /* The id is owned by the info, which the entry keeps alive */
+      g_hash_table_insert (apps, (gpointer) desktop_id, entry);
+    }
+  g_list_free_full (infos, g_object_unref);
+
+  return apps;
+}
+
+static void
+rebuild_indexes (CcAppRegistry *self)
+{
+  GHashTableIter iter;
+  AppEntry *entry;
+
+  g_hash_table_remove_all (self->by_type);
+  g_hash_table_remove_all (self->by_key);
+
+  g_hash_table_iter_init (&iter, self->apps);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &entry))
+    {
+      const gchar * const *types;
+      guint i;
+
+      types = g_app_info_get_supported_types (G_APP_INFO (entry->info));
+      for (i = 0; types != NULL && types[i] != NULL; i++)
+        {
+          GPtrArray *infos;
+
+          infos = g_hash_table_lookup (self->by_type, types[i]);
+          if (infos == NULL)
+            {
+              infos = g_ptr_array_new_with_free_func (g_object_unref);
+              g_hash_table_insert (self->by_type, g_strdup (types[i]), infos);
+            }
+          g_ptr_array_add (infos, g_object_ref (entry->info));
+        }
+    }
+}
+
+static void
+emit_for_each (CcAppRegistry *self,
+               guint          signal_id,
+               GPtrArray     *infos)
+{
+  guint i;
+
+  for (i = 0; i < infos->len; i++)
+    g_signal_emit (self, signal_id, 0, g_ptr_array_index (infos, i));
+}
+
+static void
+apply_scan (CcAppRegistry *self,
+            GHashTable    *apps)
+{
+  g_autoptr(GPtrArray) added = NULL;
+  g_autoptr(GPtrArray) removed = NULL;
+  g_autoptr(GPtrArray) changed = NULL;
+  GHashTable *old_apps;
+  GHashTableIter iter;
+  const gchar *desktop_id;
+  AppEntry *entry;
+
+  if (!self->loaded)
+    {
+      g_clear_pointer (&self->apps, g_hash_table_unref);
+      self->apps = apps;
+      self->loaded = TRUE;
+      rebuild_indexes (self);
+      return;
+    }
+
+  added = g_ptr_array_new_with_free_func (g_object_unref);
+  removed = g_ptr_array_new_with_free_func (g_object_unref);
+  changed = g_ptr_array_new_with_free_func (g_object_unref);
+
+  g_hash_table_iter_init (&iter, apps);
+  while (g_hash_table_iter_next (&iter, (gpointer *) &desktop_id, (gpointer *) &entry))
+    {
+      AppEntry *old_entry;
+
+      old_entry = g_hash_table_lookup (self->apps, desktop_id);
+      if (old_entry == NULL)
+        g_ptr_array_add (added, g_object_ref (entry->info));
+      else if (!app_entry_equal (old_entry, entry))
+        g_ptr_array_add (changed, g_object_ref (entry->info));
+    }
+
+  g_hash_table_iter_init (&iter, self->apps);
+  while (g_hash_table_iter_next (&iter, (gpointer *) &desktop_id, (gpointer *) &entry))
+    {
+      if (!g_hash_table_contains (apps, desktop_id))
+        g_ptr_array_add (removed, g_object_ref (entry->info));
+    }
+
+  if (added->len == 0 && removed->len == 0 && changed->len == 0)
+    {
+      g_hash_table_unref (apps);
+      return;
+    }
+
+  g_debug ("Applications changed: %u added, %u removed, %u changed",
+           added->len, removed->len, changed->len);
+
+  old_apps = self->apps;
+  self->apps = apps;
+  rebuild_indexes (self);
+
+  emit_for_each (self, signals[APP_REMOVED], removed);
+  emit_for_each (self, signals[APP_ADDED], added);
+  emit_for_each (self, signals[APP_CHANGED], changed);
+
+  g_hash_table_unref (old_apps);
+}
+
+static void start_scan (CcAppRegistry *self);
+
+static void
+scan_thread (GTask        *task,
+             gpointer      source_object,
+             gpointer      task_data,
+             GCancellable *cancellable)
+{
+  g_task_return_pointer (task, scan_apps (), (GDestroyNotify) g_hash_table_unref);
+}
+
+static void
+scan_cb (GObject      *source_object,
+         GAsyncResult *res,
+         gpointer      user_data)
+{
+  CcAppRegistry *self = CC_APP_REGISTRY (source_object);
+  GList *load_tasks, *l;
+
+  self->scanning = FALSE;
+  apply_scan (self, g_task_propagate_pointer (G_TASK (res), NULL));
+
+  load_tasks = self->load_tasks;
+  self->load_tasks = NULL;
+  for (l = load_tasks; l != NULL; l = l->next)
+    {
+      g_task_return_boolean (l->data, TRUE);
+      g_object_unref (l->data);
+    }
+  g_list_free (load_tasks);
+
+  if (self->rescan_pending)
+    {
+      self->rescan_pending = FALSE;
+      start_scan (self);
+    }
+}
+
+static void
+start_scan (CcAppRegistry *self)
+{
+  GTask *task;
+
+  if (self->scanning)
+    {
+      self->rescan_pending = TRUE;
+      return;
+    }
+
+  self->scanning = TRUE;
+  task = g_task_new (self, NULL, scan_cb, NULL);
+  g_task_set_source_tag (task, start_scan);
+  g_task_run_in_thread (task, scan_thread);
+  g_object_unref (task);
+}
+
+static void
+app_info_monitor_changed_cb (GAppInfoMonitor *monitor,
+                             CcAppRegistry   *self)
+{
+  /* Nothing to update until something asks for the applications */
+  if (!self->loaded && !self->scanning)
+    return;
+
+  start_scan (self);
+}
+
+static void
+ensure_loaded (CcAppRegistry *self)
+{
+  if (self->loaded)
+    return;
+
+  /* A scan in progress will be applied as changes on top of this one */
+  apply_scan (self, scan_apps ());
+}
+
+static void
+cc_app_registry_finalize (GObject *object)
+{
+  CcAppRegistry *self = CC_APP_REGISTRY (object);
+
+  g_signal_handlers_disconnect_by_func (self->monitor, app_info_monitor_changed_cb, self);
+  g_clear_object (&self->monitor);
+  g_clear_pointer (&self->apps, g_hash_table_unref);
+  g_clear_pointer (&self->by_type, g_hash_table_unref);
+  g_clear_pointer (&self->by_key, g_hash_table_unref);
+
+  G_OBJECT_CLASS (cc_app_registry_parent_class)->finalize (object);
+}
+
+static void
+cc_app_registry_class_init (CcAppRegistryClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->finalize = cc_app_registry_finalize;
+
+  signals[APP_ADDED] = g_signal_new ("app-added",
+                                     G_TYPE_FROM_CLASS (klass),
+                                     G_SIGNAL_RUN_LAST,
+                                     0, NULL, NULL,
+                                     g_cclosure_marshal_VOID__OBJECT,
+                                     G_TYPE_NONE, 1, G_TYPE_DESKTOP_APP_INFO);
+
+  signals[APP_REMOVED] = g_signal_new ("app-removed",
+                                       G_TYPE_FROM_CLASS (klass),
+                                       G_SIGNAL_RUN_LAST,
+                                       0, NULL, NULL,
+                                       g_cclosure_marshal_VOID__OBJECT,
+                                       G_TYPE_NONE, 1, G_TYPE_DESKTOP_APP_INFO);
+
+  signals[APP_CHANGED] = g_signal_new ("app-changed",
+                                       G_TYPE_FROM_CLASS (klass),
+                                       G_SIGNAL_RUN_LAST,
+                                       0, NULL, NULL,
+                                       g_cclosure_marshal_VOID__OBJECT,
+                                       G_TYPE_NONE, 1, G_TYPE_DESKTOP_APP_INFO);
+}
+
+static void
+cc_app_registry_init (CcAppRegistry *self)
+{
+  self->by_type = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                         g_free, (GDestroyNotify) g_ptr_array_unref);
+  self->by_key = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                        g_free, (GDestroyNotify) g_ptr_array_unref);
+
+  self->monitor = g_app_info_monitor_get ();
+  g_signal_connect (self->monitor, "changed",
+                    G_CALLBACK (app_info_monitor_changed_cb), self);
+}
+
+/**
+ * cc_app_registry_get_default:
+ *
+ * Returns the registry of the process. It must only be used from the
+ * main thread.
+ *
+ * Returns: (transfer none): the #CcAppRegistry
+ */
+CcAppRegistry *
+cc_app_registry_get_default (void)
+{
+  static CcAppRegistry *registry = NULL;
+
+  if (registry == NULL)
+    registry = g_object_new (CC_TYPE_APP_REGISTRY, NULL);
+
+  return registry;
+}
+
+/**
+ * cc_app_registry_load_async:
+ *
+ * Parses the desktop files in a thread, unless it was already done.
+ */
+void
+cc_app_registry_load_async (CcAppRegistry       *registry,
+                            GCancellable        *cancellable,
+                            GAsyncReadyCallback  callback,
+                            gpointer             user_data)
+{
+  GTask *task;
+
+  g_return_if_fail (CC_IS_APP_REGISTRY (registry));
+
+  task = g_task_new (registry, cancellable, callback, user_data);
+  g_task_set_source_tag (task, cc_app_registry_load_async);
+
+  if (registry->loaded)
+    {
+      g_task_return_boolean (task, TRUE);
+      g_object_unref (task);
+      return;
+    }
+
+  registry->load_tasks = g_list_prepend (registry->load_tasks, task);
+  start_scan (registry);
+}
+
+gboolean
+cc_app_registry_load_finish (CcAppRegistry  *registry,
+                             GAsyncResult   *res,
+                             GError        **error)
+{
+  g_return_val_if_fail (g_task_is_valid (res, registry), FALSE);
+
+  return g_task_propagate_boolean (G_TASK (res), error);
+}
+
+gboolean
+cc_app_registry_is_loaded (CcAppRegistry *registry)
+{
+  g_return_val_if_fail (CC_IS_APP_REGISTRY (registry), FALSE);
+
+  return registry->loaded;
+}
+
+/**
+ * cc_app_registry_lookup:
+ * @desktop_id: a desktop file id, e.g. "org.gnome.Nautilus.desktop"
+ *
+ * Parses the desktop files if they were not yet.
+ *
+ * Returns: (transfer none) (nullable): the application, or %NULL
+ */
+GDesktopAppInfo *
+cc_app_registry_lookup (CcAppRegistry *registry,
+                        const gchar   *desktop_id)
+{
+  AppEntry *entry;
+
+  g_return_val_if_fail (CC_IS_APP_REGISTRY (registry), NULL);
+  g_return_val_if_fail (desktop_id != NULL, NULL);
+
+  ensure_loaded (registry);
+
+  entry = g_hash_table_lookup (registry->apps, desktop_id);
+
+  return entry != NULL ? entry->info : NULL;
+}
+
+static GPtrArray *
+copy_infos (GPtrArray *infos)
+{
+  GPtrArray *copy;
+  guint i;
+
+  copy = g_ptr_array_new_full (infos != NULL ? infos->len : 0, g_object_unref);
+  for (i = 0; infos != NULL && i < infos->len; i++)
+    g_ptr_array_add (copy, g_object_ref (g_ptr_array_index (infos, i)));
+
+  return copy;
+}
+
+/**
+ * cc_app_registry_list_for_type:
+ * @content_type: a content type
+ *
+ * Lists the applications that declare @content_type in their MimeType
+ * key. Unlike g_app_info_get_all_for_type(), parent types and the
+ * associations of mimeapps.list are not taken into account.
+ *
+ * Returns: (transfer full) (element-type GDesktopAppInfo): the applications
+ */
+GPtrArray *
+cc_app_registry_list_for_type (CcAppRegistry *registry,
+                               const gchar   *content_type)
+{
+  g_return_val_if_fail (CC_IS_APP_REGISTRY (registry), NULL);
+  g_return_val_if_fail (content_type != NULL, NULL);
+
+  ensure_loaded (registry);
+
+  return copy_infos (g_hash_table_lookup (registry->by_type, content_type));
+}
+
+/**
+ * cc_app_registry_list_with_key:
+ * @key: a boolean key of desktop files, e.g. "X-GNOME-UsesNotifications"
+ *
+ * Lists the applications whose desktop file sets @key to true.
+ *
+ * Returns: (transfer full) (element-type GDesktopAppInfo): the applications
+ */
+GPtrArray *
+cc_app_registry_list_with_key (CcAppRegistry *registry,
+                               const gchar   *key)
+{
+  GPtrArray *infos;
+
+  g_return_val_if_fail (CC_IS_APP_REGISTRY (registry), NULL);
+  g_return_val_if_fail (key != NULL, NULL);
+
+  ensure_loaded (registry);
+
+  infos = g_hash_table_lookup (registry->by_key, key);
+  if (infos == NULL)
+    {
+      GHashTableIter iter;
+      AppEntry *entry;
+
+      infos = g_ptr_array_new_with_free_func (g_object_unref);
+      g_hash_table_iter_init (&iter, registry->apps);
+      while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &entry))
+        {
+          if (g_desktop_app_info_get_boolean (entry->info, key))
+            g_ptr_array_add (infos, g_object_ref (entry->info));
+        }
+
+      g_hash_table_insert (registry->by_key, g_strdup (key), infos);
+    }
+
+  return copy_infos (infos);
+}
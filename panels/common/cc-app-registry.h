@@ -0,0 +1,52 @@
+/*
+ * Copyright (c) 2017 The GNOME Foundation
+ *
+ * The Control Center is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * The Control Center is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with the Control Center; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+
+#ifndef _CC_APP_REGISTRY_H
+#define _CC_APP_REGISTRY_H
+
+#include <gio/gio.h>
+#include <gio/gdesktopappinfo.h>
+
+G_BEGIN_DECLS
+
+#define CC_TYPE_APP_REGISTRY (cc_app_registry_get_type ())
+G_DECLARE_FINAL_TYPE (CcAppRegistry, cc_app_registry, CC, APP_REGISTRY, GObject)
+
+CcAppRegistry   *cc_app_registry_get_default      (void);
+
+void             cc_app_registry_load_async       (CcAppRegistry        *registry,
+                                                   GCancellable         *cancellable,
+                                                   GAsyncReadyCallback   callback,
+                                                   gpointer              user_data);
+gboolean         cc_app_registry_load_finish      (CcAppRegistry        *registry,
+                                                   GAsyncResult         *res,
+                                                   GError              **error);
+gboolean         cc_app_registry_is_loaded        (CcAppRegistry        *registry);
+
+GDesktopAppInfo *cc_app_registry_lookup           (CcAppRegistry        *registry,
+                                                   const gchar          *desktop_id);
+GPtrArray       *cc_app_registry_list_for_type    (CcAppRegistry        *registry,
+                                                   const gchar          *content_type);
+GPtrArray       *cc_app_registry_list_with_key    (CcAppRegistry        *registry,
+                                                   const gchar          *key);
+
+G_END_DECLS
+
+#endif
@@ -0,0 +1,211 @@
+/*
+ * Copyright (c) 2017 The GNOME Foundation
+ *
+ * The Control Center is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * The Control Center is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with the Control Center; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#include "config.h"
+
+#include <glib/gstdio.h>
+
+#include "cc-cache-file.h"
+
+/* Cache files are a serialized GVariant of type CACHE_FILE_TYPE:
+ *
+ *  - the version of this container format
+ *  - a caller-provided stamp, which has to match exactly
+ *  - the paths the data was computed from, with their modification
+ *    time in microseconds and their size (-1 if they did not exist);
+ *    the cache is stale as soon as one of them changes. Seconds are not
+ *    precise enough, a file could be changed in the second the cache
+ *    was saved
+ *  - the data itself
+ *
+ * Files are mapped rather than read, so loading a cache costs a few
+ * stat() calls and whatever pages of the data are actually used.
+ */
+#define CACHE_FILE_VERSION 2
+#define CACHE_FILE_TYPE    "(usa(sxx)v)"
+
+gchar *
+cc_cache_file_get_path (const gchar *name)
+{
+  return g_build_filename (g_get_user_cache_dir (),
+                           "gnome-control-center",
+                           name,
+                           NULL);
+}
+
+static void
+get_file_stamp (const gchar *path,
+                gint64      *mtime,
+                gint64      *size)
+{
+  GStatBuf buf;
+
+  if (g_stat (path, &buf) < 0)
+    {
+      *mtime = -1;
+      *size = -1;
+      return;
+    }
+
+  *mtime = (gint64) buf.st_mtime * G_USEC_PER_SEC;
+#ifdef HAVE_STRUCT_STAT_ST_MTIM_TV_NSEC
+  *mtime += buf.st_mtim.tv_nsec / 1000;
+#endif
+  *size = buf.st_size;
+}
+
+/**
+ * cc_cache_file_load:
+ * @name: the name of the cache file
+ * @stamp: the stamp the cache was saved with
+ * @type: the expected type of the cached data
+ *
+ * Loads the data saved with cc_cache_file_save(), if the cache exists, was
+ * saved with the same @stamp, its data has the expected @type and none of
+ * its watched paths changed since.
+ *
+ * Returns: (transfer full) (nullable): the cached data, or %NULL
+ */
+GVariant *
+cc_cache_file_load (const gchar        *name,
+                    const gchar        *stamp,
+                    const GVariantType *type)
+{
+  g_autoptr(GMappedFile) mapped_file = NULL;
+  g_autoptr(GBytes) bytes = NULL;
+  g_autoptr(GVariant) cache = NULL;
+  g_autoptr(GVariant) paths = NULL;
+  g_autoptr(GVariant) data = NULL;
+  g_autofree gchar *path = NULL;
+  const gchar *cached_stamp;
+  const gchar *watched_path;
+  GVariantIter iter;
+  gint64 mtime, size;
+  guint32 version;
+
+  path = cc_cache_file_get_path (name);
+
+  mapped_file = g_mapped_file_new (path, FALSE, NULL);
+  if (!mapped_file)
+    return NULL;
+
+  bytes = g_mapped_file_get_bytes (mapped_file);
+  cache = g_variant_new_from_bytes (G_VARIANT_TYPE (CACHE_FILE_TYPE), bytes, FALSE);
+
+  g_variant_get (cache, "(u&s@a(sxx)v)", &version, &cached_stamp, &paths, &data);
+
+  if (version != CACHE_FILE_VERSION || g_strcmp0 (cached_stamp, stamp) != 0)
+    {
+      g_debug ("Ignoring cache %s, it was saved for another version or environment", name);
+      return NULL;
+    }
+
+  if (!g_variant_is_of_type (data, type))
+    {
+      g_debug ("Ignoring cache %s, it has an unexpected type", name);
+      return NULL;
+    }
+
+  g_variant_iter_init (&iter, paths);
+  while (g_variant_iter_next (&iter, "(&sxx)", &watched_path, &mtime, &size))
+    {
+      gint64 current_mtime, current_size;
+
+      get_file_stamp (watched_path, &current_mtime, &current_size);
+      if (current_mtime != mtime || current_size != size)
+        {
+          g_debug ("Ignoring cache %s, %s changed", name, watched_path);
+          return NULL;
+        }
+    }
+
+  return g_steal_pointer (&data);
+}
+
+/**
+ * cc_cache_file_save:
+ * @name: the name of the cache file
+ * @stamp: a string identifying the version and environment of the data
+ * @watched_paths: (nullable): the files and directories the data was
+ *     computed from
+ * @data: the data to cache, consumed if floating
+ *
+ * Saves @data to the user cache directory. The modification times and
+ * sizes of @watched_paths are recorded so that cc_cache_file_load() can tell when
+ * the data is stale.
+ *
+ * Returns: %TRUE if the cache was saved
+ */
+gboolean
+cc_cache_file_save (const gchar         *name,
+                    const gchar         *stamp,
+                    const gchar * const *watched_paths,
+                    GVariant            *data)
+{
+  g_autoptr(GError) error = NULL;
+  g_autoptr(GVariant) cache = NULL;
+  g_autofree gchar *path = NULL;
+  g_autofree gchar *dir = NULL;
+  GVariantBuilder builder;
+  guint i;
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(sxx)"));
+  for (i = 0; watched_paths && watched_paths[i]; i++)
+    {
+      gint64 mtime, size;
+
+      get_file_stamp (watched_paths[i], &mtime, &size);
+      g_variant_builder_add (&builder, "(sxx)", watched_paths[i], mtime, size);
+    }
+
+  cache = g_variant_ref_sink (g_variant_new (CACHE_FILE_TYPE,
+                                             CACHE_FILE_VERSION,
+                                             stamp,
+                                             &builder,
+                                             data));
+
+  path = cc_cache_file_get_path (name);
+  dir = g_path_get_dirname (path);
+
+  if (g_mkdir_with_parents (dir, USER_DIR_MODE) < 0)
+    {
+      g_warning ("Could not create directory '%s': %m", dir);
+      return FALSE;
+    }
+
+  if (!g_file_set_contents (path,
+                            g_variant_get_data (cache),
+                            g_variant_get_size (cache),
+                            &error))
+    {
+      g_warning ("Could not save cache '%s': %s", path, error->message);
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+void
+cc_cache_file_remove (const gchar *name)
+{
+  g_autofree gchar *path = NULL;
+
+  path = cc_cache_file_get_path (name);
+  g_unlink (path);
+}
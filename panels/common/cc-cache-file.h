@@ -0,0 +1,43 @@
+/*
+ * Copyright (c) 2017 The GNOME Foundation
+ *
+ * The Control Center is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * The Control Center is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with the Control Center; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+
+#ifndef _CC_CACHE_FILE_H
+#define _CC_CACHE_FILE_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+GVariant * cc_cache_file_load     (const gchar         *name,
+                                   const gchar         *stamp,
+                                   const GVariantType  *type);
+
+gboolean   cc_cache_file_save     (const gchar         *name,
+                                   const gchar         *stamp,
+                                   const gchar * const *watched_paths,
+                                   GVariant            *data);
+
+void       cc_cache_file_remove   (const gchar         *name);
+
+gchar *    cc_cache_file_get_path (const gchar         *name);
+
+G_END_DECLS
+
+#endif
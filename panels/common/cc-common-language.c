@@ -87,59 +87,76 @@ cc_common_language_get_iter_for_language (GtkTreeModel *model,
   return iter_for_language (model, lang, iter, FALSE);
 }
 
+/* The languages covered by the installed fonts, for the fontconfig
+ * configuration they were computed from. Fontconfig replaces its current
+ * configuration whenever fonts are installed or removed.
+ */
+static FcConfig  *coverage_config = NULL;
+static FcLangSet *coverage = NULL;
+
+static FcLangSet *
+get_font_coverage (void)
+{
+        FcConfig    *config;
+        FcPattern   *pattern;
+        FcObjectSet *object_set;
+        FcFontSet   *font_set;
+        FcLangSet   *lang_set;
+        FcLangSet   *union_set;
+        int          i;
+
+        /* Only checks the font directories once per rescan interval */
+        FcInitBringUptoDate ();
+
+        config = FcConfigGetCurrent ();
+        if (coverage != NULL && config == coverage_config)
+                return coverage;
+
+        g_clear_pointer (&coverage, FcLangSetDestroy);
+        coverage = FcLangSetCreate ();
+        coverage_config = config;
+
+        pattern = FcPatternCreate ();
+        object_set = FcObjectSetBuild (FC_LANG, NULL);
+        font_set = FcFontList (config, pattern, object_set);
+
+        for (i = 0; font_set != NULL && i < font_set->nfont; i++) {
+                if (FcPatternGetLangSet (font_set->fonts[i], FC_LANG, 0, &lang_set) != FcResultMatch)
+                        continue;
+
+                union_set = FcLangSetUnion (coverage, lang_set);
+                FcLangSetDestroy (coverage);
+                coverage = union_set;
+        }
+
+        if (font_set != NULL)
+                FcFontSetDestroy (font_set);
+        FcObjectSetDestroy (object_set);
+        FcPatternDestroy (pattern);
+
+        return coverage;
+}
+
 gboolean
 cc_common_language_has_font (const gchar *locale)
 {
-        const FcCharSet *charset;
-        FcPattern       *pattern;
-        FcObjectSet     *object_set;
-        FcFontSet       *font_set;
         gchar           *language_code;
         gboolean         is_displayable;
 
-        is_displayable = FALSE;
-        pattern = NULL;
-        object_set = NULL;
-        font_set = NULL;
-
         if (!gnome_parse_locale (locale, &language_code, NULL, NULL, NULL))
                 return FALSE;
 
-        charset = FcLangGetCharSet ((FcChar8 *) language_code);
-        if (!charset) {
+        if (!FcLangGetCharSet ((FcChar8 *) language_code)) {
                 /* fontconfig does not know about this language */
                 is_displayable = TRUE;
         }
         else {
-                /* see if any fonts support rendering it */
-                pattern = FcPatternBuild (NULL, FC_LANG, FcTypeString, language_code, NULL);
-
-                if (pattern == NULL)
-                        goto done;
-
-                object_set = FcObjectSetCreate ();
-
-                if (object_set == NULL)
-                        goto done;
-
-                font_set = FcFontList (NULL, pattern, object_set);
-
-                if (font_set == NULL)
-                        goto done;
-
-                is_displayable = (font_set->nfont > 0);
+                /* see if any fonts support rendering it, the same way
+                 * FcFontList() matches a language against a font */
+                is_displayable = FcLangSetHasLang (get_font_coverage (),
+                                                   (FcChar8 *) language_code) != FcLangDifferentLang;
         }
 
- done:
-        if (font_set != NULL)
-                FcFontSetDestroy (font_set);
-
-        if (object_set != NULL)
-                FcObjectSetDestroy (object_set);
-
-        if (pattern != NULL)
-                FcPatternDestroy (pattern);
-
         g_free (language_code);
 
         return is_displayable;
@@ -31,6 +31,26 @@
 
 #define DATETIME_RESOURCE_PATH "/org/gnome/control-center/datetime"
 
+/* The locations are bucketed in a GRID_SIZE x GRID_SIZE grid laid over
+ * the map, so that finding the one closest to a click only looks at the
+ * cells around it */
+#define GRID_SIZE 32
+
+/* Number of rendered maps kept around, e.g. while the window is resized
+ * back and forth or when going back to a previously selected zone */
+#define MAX_CACHED_TILES 4
+
+/* The background and highlight of the map, rendered for a size */
+typedef struct
+{
+  gint width;
+  gint height;
+  gint scale;
+  gdouble offset;
+  gboolean sensitive;
+  cairo_surface_t *surface;
+} MapTile;
+
 typedef struct
 {
   gdouble offset;
@@ -46,20 +66,35 @@ struct _CcTimezoneMap
 
   GdkPixbuf *orig_background;
   GdkPixbuf *orig_background_dim;
-  GdkPixbuf *orig_color_map;
-
-  GdkPixbuf *background;
-  GdkPixbuf *color_map;
   GdkPixbuf *pin;
 
-  guchar *visible_map_pixels;
-  gint visible_map_rowstride;
+  /* The sources of the rendered tiles, at their original size */
+  cairo_surface_t *background_surface;
+  cairo_surface_t *background_dim_surface;
+  cairo_surface_t *highlight_surface;
+  gchar *highlight_file;
+
+  GList *tiles; /* MapTile, most recently used first */
+
+  /* The index in color_codes of the offset of every pixel of the
+   * color map, plus one, or 0 outside of any time zone */
+  guint8 *offset_index;
+  gint offset_index_width;
+  gint offset_index_height;
 
   gdouble selected_offset;
 
   TzDB *tzdb;
   TzLocation *location;
 
+  /* position of every location, relative to the map size */
+  gdouble *location_x;
+  gdouble *location_y;
+  /* grid_locations[grid_cells[cell]..grid_cells[cell + 1]] are the
+   * locations in a cell */
+  guint *grid_cells;
+  guint *grid_locations;
+
   gchar *bubble_text;
 };
 
@@ -118,6 +153,13 @@ static CcTimezoneMapOffset color_codes[] =
 };
 
 
+static void
+map_tile_free (MapTile *tile)
+{
+  cairo_surface_destroy (tile->surface);
+  g_free (tile);
+}
+
 static void
 cc_timezone_map_dispose (GObject *object)
 {
@@ -125,18 +167,16 @@ cc_timezone_map_dispose (GObject *object)
 
   g_clear_object (&self->orig_background);
   g_clear_object (&self->orig_background_dim);
-  g_clear_object (&self->orig_color_map);
-  g_clear_object (&self->background);
   g_clear_object (&self->pin);
   g_clear_pointer (&self->bubble_text, g_free);
 
-  if (self->color_map)
-    {
-      g_clear_object (&self->color_map);
+  g_clear_pointer (&self->background_surface, cairo_surface_destroy);
+  g_clear_pointer (&self->background_dim_surface, cairo_surface_destroy);
+  g_clear_pointer (&self->highlight_surface, cairo_surface_destroy);
+  g_clear_pointer (&self->highlight_file, g_free);
 
-      self->visible_map_pixels = NULL;
-      self->visible_map_rowstride = 0;
-    }
+  g_list_free_full (self->tiles, (GDestroyNotify) map_tile_free);
+  self->tiles = NULL;
 
   G_OBJECT_CLASS (cc_timezone_map_parent_class)->dispose (object);
 }
@@ -152,6 +192,12 @@ cc_timezone_map_finalize (GObject *object)
       self->tzdb = NULL;
     }
 
+  g_clear_pointer (&self->location_x, g_free);
+  g_clear_pointer (&self->location_y, g_free);
+  g_clear_pointer (&self->grid_cells, g_free);
+  g_clear_pointer (&self->grid_locations, g_free);
+  g_clear_pointer (&self->offset_index, g_free);
+
 
   G_OBJECT_CLASS (cc_timezone_map_parent_class)->finalize (object);
 }
@@ -189,41 +235,6 @@ cc_timezone_map_get_preferred_height (GtkWidget *widget,
     *natural = size;
 }
 
-static void
-cc_timezone_map_size_allocate (GtkWidget     *widget,
-                               GtkAllocation *allocation)
-{
-  CcTimezoneMap *map = CC_TIMEZONE_MAP (widget);
-  GdkPixbuf *pixbuf;
-
-  if (map->background)
-    g_object_unref (map->background);
-
-  if (!gtk_widget_is_sensitive (widget))
-    pixbuf = map->orig_background_dim;
-  else
-    pixbuf = map->orig_background;
-
-  map->background = gdk_pixbuf_scale_simple (pixbuf,
-                                             allocation->width,
-                                             allocation->height,
-                                             GDK_INTERP_BILINEAR);
-
-  if (map->color_map)
-    g_object_unref (map->color_map);
-
-  map->color_map = gdk_pixbuf_scale_simple (map->orig_color_map,
-                                            allocation->width,
-                                            allocation->height,
-                                            GDK_INTERP_BILINEAR);
-
-  map->visible_map_pixels = gdk_pixbuf_get_pixels (map->color_map);
-  map->visible_map_rowstride = gdk_pixbuf_get_rowstride (map->color_map);
-
-  GTK_WIDGET_CLASS (cc_timezone_map_parent_class)->size_allocate (widget,
-                                                                  allocation);
-}
-
 static void
 cc_timezone_map_realize (GtkWidget *widget)
 {
@@ -360,60 +371,163 @@ draw_text_bubble (cairo_t *cr,
   cairo_restore (cr);
 }
 
-static gboolean
-cc_timezone_map_draw (GtkWidget *widget,
-                      cairo_t   *cr)
+static cairo_surface_t *
+get_highlight_surface (CcTimezoneMap *map,
+                       gboolean       sensitive)
 {
-  CcTimezoneMap *map = CC_TIMEZONE_MAP (widget);
-  GdkPixbuf *hilight, *orig_hilight;
-  GtkAllocation alloc;
-  gchar *file;
-  GError *err = NULL;
-  gdouble pointx, pointy;
+  g_autoptr(GdkPixbuf) pixbuf = NULL;
+  g_autoptr(GError) error = NULL;
+  g_autofree gchar *file = NULL;
   char buf[16];
 
-  gtk_widget_get_allocation (widget, &alloc);
+  file = g_strdup_printf (DATETIME_RESOURCE_PATH "/timezone_%s%s.png",
+                          g_ascii_formatd (buf, sizeof (buf),
+                                           "%g", map->selected_offset),
+                          sensitive ? "" : "_dim");
 
-  /* paint background */
-  gdk_cairo_set_source_pixbuf (cr, map->background, 0, 0);
-  cairo_paint (cr);
+  /* Only the last one is kept, the tiles keep the rendered ones */
+  if (g_strcmp0 (file, map->highlight_file) == 0)
+    return map->highlight_surface;
 
-  /* paint hilight */
-  if (gtk_widget_is_sensitive (widget))
+  g_clear_pointer (&map->highlight_surface, cairo_surface_destroy);
+  g_free (map->highlight_file);
+  map->highlight_file = g_steal_pointer (&file);
+
+  pixbuf = gdk_pixbuf_new_from_resource (map->highlight_file, &error);
+  if (!pixbuf)
     {
-      file = g_strdup_printf (DATETIME_RESOURCE_PATH "/timezone_%s.png",
-                              g_ascii_formatd (buf, sizeof (buf),
-                                               "%g", map->selected_offset));
+      g_warning ("Could not load hilight: %s",
+                 (error) ? error->message : "Unknown Error");
+      return NULL;
     }
-  else
+
+  map->highlight_surface = gdk_cairo_surface_create_from_pixbuf (pixbuf, 1, NULL);
+
+  return map->highlight_surface;
+}
+
+static void
+paint_scaled (cairo_t         *cr,
+              cairo_surface_t *surface,
+              gint             width,
+              gint             height)
+{
+  gint surface_width, surface_height;
+
+  surface_width = cairo_image_surface_get_width (surface);
+  surface_height = cairo_image_surface_get_height (surface);
+
+  cairo_save (cr);
+  cairo_scale (cr, (gdouble) width / surface_width, (gdouble) height / surface_height);
+  cairo_set_source_surface (cr, surface, 0, 0);
+  cairo_pattern_set_filter (cairo_get_source (cr), CAIRO_FILTER_GOOD);
+  cairo_paint (cr);
+  cairo_restore (cr);
+}
+
+/* Returns the background with the selected zone highlighted, rendered for
+ * the size and scale of the widget. Tiles are cached, so redrawing the
+ * map, e.g. for the bubble, or going back to a previous size or zone does
+ * not scale the images again. */
+static cairo_surface_t *
+get_map_tile (CcTimezoneMap *map,
+              gint           width,
+              gint           height)
+{
+  GtkWidget *widget = GTK_WIDGET (map);
+  cairo_surface_t *background, *highlight;
+  MapTile *tile;
+  gboolean sensitive;
+  cairo_t *cr;
+  GList *l;
+  gint scale;
+
+  if (width <= 0 || height <= 0)
+    return NULL;
+
+  scale = gtk_widget_get_scale_factor (widget);
+  sensitive = gtk_widget_is_sensitive (widget);
+
+  for (l = map->tiles; l != NULL; l = l->next)
     {
-      file = g_strdup_printf (DATETIME_RESOURCE_PATH "/timezone_%s_dim.png",
-                              g_ascii_formatd (buf, sizeof (buf),
-                                               "%g", map->selected_offset));
+      tile = l->data;
 
+      if (tile->width == width &&
+          tile->height == height &&
+          tile->scale == scale &&
+          tile->offset == map->selected_offset &&
+          tile->sensitive == sensitive)
+        {
+          map->tiles = g_list_remove_link (map->tiles, l);
+          map->tiles = g_list_concat (l, map->tiles);
+          return tile->surface;
+        }
     }
 
-  orig_hilight = gdk_pixbuf_new_from_resource (file, &err);
-  g_free (file);
-  file = NULL;
+  background = sensitive ? map->background_surface : map->background_dim_surface;
+  if (background == NULL)
+    return NULL;
 
-  if (!orig_hilight)
+  tile = g_new0 (MapTile, 1);
+  tile->width = width;
+  tile->height = height;
+  tile->scale = scale;
+  tile->offset = map->selected_offset;
+  tile->sensitive = sensitive;
+
+  if (gtk_widget_get_realized (widget))
     {
-      g_warning ("Could not load hilight: %s",
-                 (err) ? err->message : "Unknown Error");
-      if (err)
-        g_clear_error (&err);
+      tile->surface = gdk_window_create_similar_image_surface (gtk_widget_get_window (widget),
+                                                               CAIRO_FORMAT_ARGB32,
+                                                               width * scale,
+                                                               height * scale,
+                                                               scale);
     }
   else
     {
+      tile->surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, width * scale, height * scale);
+      cairo_surface_set_device_scale (tile->surface, scale, scale);
+    }
+
+  cr = cairo_create (tile->surface);
+  paint_scaled (cr, background, width, height);
+
+  highlight = get_highlight_surface (map, sensitive);
+  if (highlight)
+    paint_scaled (cr, highlight, width, height);
+
+  cairo_destroy (cr);
+
+  map->tiles = g_list_prepend (map->tiles, tile);
 
-      hilight = gdk_pixbuf_scale_simple (orig_hilight, alloc.width,
-                                         alloc.height, GDK_INTERP_BILINEAR);
-      gdk_cairo_set_source_pixbuf (cr, hilight, 0, 0);
+  l = g_list_nth (map->tiles, MAX_CACHED_TILES);
+  if (l)
+    {
+      l->prev->next = NULL;
+      l->prev = NULL;
+      g_list_free_full (l, (GDestroyNotify) map_tile_free);
+    }
+
+  return tile->surface;
+}
 
+static gboolean
+cc_timezone_map_draw (GtkWidget *widget,
+                      cairo_t   *cr)
+{
+  CcTimezoneMap *map = CC_TIMEZONE_MAP (widget);
+  cairo_surface_t *surface;
+  GtkAllocation alloc;
+  gdouble pointx, pointy;
+
+  gtk_widget_get_allocation (widget, &alloc);
+
+  /* paint background and hilight */
+  surface = get_map_tile (map, alloc.width, alloc.height);
+  if (surface)
+    {
+      cairo_set_source_surface (cr, surface, 0, 0);
       cairo_paint (cr);
-      g_object_unref (hilight);
-      g_object_unref (orig_hilight);
     }
 
   if (map->location)
@@ -483,7 +597,6 @@ cc_timezone_map_class_init (CcTimezoneMapClass *klass)
 
   widget_class->get_preferred_width = cc_timezone_map_get_preferred_width;
   widget_class->get_preferred_height = cc_timezone_map_get_preferred_height;
-  widget_class->size_allocate = cc_timezone_map_size_allocate;
   widget_class->realize = cc_timezone_map_realize;
   widget_class->draw = cc_timezone_map_draw;
   widget_class->state_flags_changed = cc_timezone_map_state_flags_changed;
@@ -501,16 +614,147 @@ cc_timezone_map_class_init (CcTimezoneMapClass *klass)
 
 
 static gint
-sort_locations (TzLocation *a,
-                TzLocation *b)
+grid_coordinate (gdouble position)
+{
+  return CLAMP ((gint) floor (position * GRID_SIZE), 0, GRID_SIZE - 1);
+}
+
+static void
+build_location_grid (CcTimezoneMap *map)
 {
-  if (a->dist > b->dist)
-    return 1;
+  GPtrArray *locations;
+  guint *cell_of;
+  guint *fill;
+  guint i;
+
+  locations = tz_get_locations (map->tzdb);
 
-  if (a->dist < b->dist)
-    return -1;
+  map->location_x = g_new (gdouble, locations->len);
+  map->location_y = g_new (gdouble, locations->len);
+  map->grid_cells = g_new0 (guint, GRID_SIZE * GRID_SIZE + 1);
+  map->grid_locations = g_new (guint, locations->len);
+  cell_of = g_new (guint, locations->len);
+  fill = g_new0 (guint, GRID_SIZE * GRID_SIZE);
 
-  return 0;
+  /* the projection is linear in the map size */
+  for (i = 0; i < locations->len; i++)
+    {
+      TzLocation *loc = locations->pdata[i];
+
+      map->location_x[i] = convert_longitude_to_x (loc->longitude, 1);
+      map->location_y[i] = convert_latitude_to_y (loc->latitude, 1);
+
+      cell_of[i] = grid_coordinate (map->location_y[i]) * GRID_SIZE
+                   + grid_coordinate (map->location_x[i]);
+      map->grid_cells[cell_of[i] + 1]++;
+    }
+
+  for (i = 0; i < GRID_SIZE * GRID_SIZE; i++)
+    map->grid_cells[i + 1] += map->grid_cells[i];
+
+  for (i = 0; i < locations->len; i++)
+    map->grid_locations[map->grid_cells[cell_of[i]] + fill[cell_of[i]]++] = i;
+
+  g_free (cell_of);
+  g_free (fill);
+}
+
+/**
+ * cc_timezone_map_get_location_at:
+ * @map: a #CcTimezoneMap
+ * @x: the X coordinate, in a map of size @width x @height
+ * @y: the Y coordinate
+ * @width: the width of the map
+ * @height: the height of the map
+ *
+ * Returns: (transfer none) (nullable): the location closest to @x, @y
+ */
+TzLocation *
+cc_timezone_map_get_location_at (CcTimezoneMap *map,
+                                 gdouble        x,
+                                 gdouble        y,
+                                 gint           width,
+                                 gint           height)
+{
+  GPtrArray *locations;
+  gdouble rel_x, rel_y;
+  gdouble best_dist = G_MAXDOUBLE;
+  gint best = -1;
+  gint cx, cy, ring;
+
+  if (map->tzdb == NULL || width <= 0 || height <= 0)
+    return NULL;
+
+  locations = tz_get_locations (map->tzdb);
+
+  rel_x = x / width;
+  rel_y = y / height;
+  cx = grid_coordinate (rel_x);
+  cy = grid_coordinate (rel_y);
+
+  /* Look at the rings of cells around the clicked one, until the
+   * closest location found is closer than anything in the next ring.
+   * Distances are in pixels, the cells are not square. */
+  for (ring = 0; ring < GRID_SIZE; ring++)
+    {
+      gdouble bound = G_MAXDOUBLE;
+      gint gx, gy;
+
+      for (gy = MAX (cy - ring, 0); gy <= MIN (cy + ring, GRID_SIZE - 1); gy++)
+        {
+          gint step;
+
+          /* only the border of the ring, the inside was done */
+          step = (gy == cy - ring || gy == cy + ring) ? 1 : 2 * ring;
+
+          for (gx = cx - ring; gx <= cx + ring; gx += MAX (step, 1))
+            {
+              guint cell, j;
+
+              if (gx < 0 || gx >= GRID_SIZE)
+                continue;
+
+              cell = gy * GRID_SIZE + gx;
+              for (j = map->grid_cells[cell]; j < map->grid_cells[cell + 1]; j++)
+                {
+                  guint i = map->grid_locations[j];
+                  gdouble dx, dy, dist;
+
+                  dx = (map->location_x[i] - rel_x) * width;
+                  dy = (map->location_y[i] - rel_y) * height;
+                  dist = dx * dx + dy * dy;
+
+                  if (dist < best_dist)
+                    {
+                      best_dist = dist;
+                      best = i;
+                    }
+                }
+            }
+        }
+
+      /* The edge cells also hold the locations outside of the map, so
+       * there is nothing left beyond them. */
+      if (cx + ring < GRID_SIZE - 1)
+        bound = MIN (bound, ((gdouble) (cx + ring + 1) / GRID_SIZE - rel_x) * width);
+      if (cx - ring > 0)
+        bound = MIN (bound, (rel_x - (gdouble) (cx - ring) / GRID_SIZE) * width);
+      if (cy + ring < GRID_SIZE - 1)
+        bound = MIN (bound, ((gdouble) (cy + ring + 1) / GRID_SIZE - rel_y) * height);
+      if (cy - ring > 0)
+        bound = MIN (bound, (rel_y - (gdouble) (cy - ring) / GRID_SIZE) * height);
+
+      if (bound == G_MAXDOUBLE)
+        break;
+
+      if (best >= 0 && best_dist <= bound * bound)
+        break;
+    }
+
+  if (best < 0)
+    return NULL;
+
+  return locations->pdata[best];
 }
 
 static void
@@ -537,76 +781,85 @@ button_press_event (GtkWidget      *widget,
 {
   CcTimezoneMap *map = CC_TIMEZONE_MAP (widget);
   gint x, y;
-  guchar r, g, b, a;
-  guchar *pixels;
-  gint rowstride;
-  gint i;
-
-  const GPtrArray *array;
-  gint width, height;
-  GList *distances = NULL;
+
+  TzLocation *location;
   GtkAllocation alloc;
 
   x = event->x;
   y = event->y;
 
 
-  rowstride = map->visible_map_rowstride;
-  pixels = map->visible_map_pixels;
+  gtk_widget_get_allocation (widget, &alloc);
 
-  r = pixels[(rowstride * y + x * 4)];
-  g = pixels[(rowstride * y + x * 4) + 1];
-  b = pixels[(rowstride * y + x * 4) + 2];
-  a = pixels[(rowstride * y + x * 4) + 3];
+  /* look the offset up in the color map, at its own size */
+  if (map->offset_index && alloc.width > 0 && alloc.height > 0)
+    {
+      gint index_x, index_y;
+      guint8 index;
 
+      index_x = CLAMP (x * map->offset_index_width / alloc.width, 0, map->offset_index_width - 1);
+      index_y = CLAMP (y * map->offset_index_height / alloc.height, 0, map->offset_index_height - 1);
 
-  for (i = 0; color_codes[i].offset != -100; i++)
-    {
-       if (color_codes[i].red == r && color_codes[i].green == g
-           && color_codes[i].blue == b && color_codes[i].alpha == a)
-         {
-           map->selected_offset = color_codes[i].offset;
-         }
+      index = map->offset_index[index_y * map->offset_index_width + index_x];
+      if (index > 0)
+        map->selected_offset = color_codes[index - 1].offset;
     }
 
   gtk_widget_queue_draw (widget);
 
   /* work out the co-ordinates */
 
-  array = tz_get_locations (map->tzdb);
+  location = cc_timezone_map_get_location_at (map, x, y, alloc.width, alloc.height);
+  if (location)
+    set_location (map, location);
 
-  gtk_widget_get_allocation (widget, &alloc);
-  width = alloc.width;
-  height = alloc.height;
+  return TRUE;
+}
 
-  for (i = 0; i < array->len; i++)
-    {
-      gdouble pointx, pointy, dx, dy;
-      TzLocation *loc = array->pdata[i];
+static void
+build_offset_index (CcTimezoneMap *map,
+                    GdkPixbuf     *color_map)
+{
+  const guchar *pixels;
+  gint width, height, rowstride, n_channels;
+  gint x, y, i;
 
-      pointx = convert_longitude_to_x (loc->longitude, width);
-      pointy = convert_latitude_to_y (loc->latitude, height);
+  /* the colors of cc.png have an alpha channel */
+  g_return_if_fail (gdk_pixbuf_get_n_channels (color_map) == 4);
 
-      dx = pointx - x;
-      dy = pointy - y;
+  width = gdk_pixbuf_get_width (color_map);
+  height = gdk_pixbuf_get_height (color_map);
+  rowstride = gdk_pixbuf_get_rowstride (color_map);
+  n_channels = gdk_pixbuf_get_n_channels (color_map);
+  pixels = gdk_pixbuf_read_pixels (color_map);
 
-      loc->dist = dx * dx + dy * dy;
-      distances = g_list_prepend (distances, loc);
+  map->offset_index = g_new0 (guint8, width * height);
+  map->offset_index_width = width;
+  map->offset_index_height = height;
 
+  for (y = 0; y < height; y++)
+    {
+      for (x = 0; x < width; x++)
+        {
+          const guchar *p = pixels + y * rowstride + x * n_channels;
+
+          for (i = 0; color_codes[i].offset != -100; i++)
+            {
+              if (color_codes[i].red == p[0] && color_codes[i].green == p[1]
+                  && color_codes[i].blue == p[2] && color_codes[i].alpha == p[3])
+                {
+                  map->offset_index[y * width + x] = i + 1;
+                  break;
+                }
+            }
+        }
     }
-  distances = g_list_sort (distances, (GCompareFunc) sort_locations);
-
-
-  set_location (CC_TIMEZONE_MAP (widget), (TzLocation*) distances->data);
-
-  g_list_free (distances);
-
-  return TRUE;
 }
 
 static void
 cc_timezone_map_init (CcTimezoneMap *map)
 {
+  GdkPixbuf *color_map;
   GError *err = NULL;
 
   map->orig_background = gdk_pixbuf_new_from_resource (DATETIME_RESOURCE_PATH "/bg.png",
@@ -629,14 +882,24 @@ cc_timezone_map_init (CcTimezoneMap *map)
       g_clear_error (&err);
     }
 
-  map->orig_color_map = gdk_pixbuf_new_from_resource (DATETIME_RESOURCE_PATH "/cc.png",
-                                                      &err);
-  if (!map->orig_color_map)
+  color_map = gdk_pixbuf_new_from_resource (DATETIME_RESOURCE_PATH "/cc.png",
+                                            &err);
+  if (!color_map)
     {
       g_warning ("Could not load background image: %s",
                  (err) ? err->message : "Unknown error");
       g_clear_error (&err);
     }
+  else
+    {
+      build_offset_index (map, color_map);
+      g_object_unref (color_map);
+    }
+
+  if (map->orig_background)
+    map->background_surface = gdk_cairo_surface_create_from_pixbuf (map->orig_background, 1, NULL);
+  if (map->orig_background_dim)
+    map->background_dim_surface = gdk_cairo_surface_create_from_pixbuf (map->orig_background_dim, 1, NULL);
 
   map->pin = gdk_pixbuf_new_from_resource (DATETIME_RESOURCE_PATH "/pin.png",
                                            &err);
@@ -648,6 +911,8 @@ cc_timezone_map_init (CcTimezoneMap *map)
     }
 
   map->tzdb = tz_load_db ();
+  if (map->tzdb)
+    build_location_grid (map);
 
   g_signal_connect (map, "button-press-event", G_CALLBACK (button_press_event),
                     NULL);
@@ -37,6 +37,11 @@ gboolean cc_timezone_map_set_timezone (CcTimezoneMap *map,
 void cc_timezone_map_set_bubble_text (CcTimezoneMap *map,
                                       const gchar   *text);
 TzLocation * cc_timezone_map_get_location (CcTimezoneMap *map);
+TzLocation * cc_timezone_map_get_location_at (CcTimezoneMap *map,
+                                              gdouble        x,
+                                              gdouble        y,
+                                              gint           width,
+                                              gint           height);
 
 G_END_DECLS
 
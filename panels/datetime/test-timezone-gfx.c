@@ -1,6 +1,9 @@
 #include <config.h>
 #include <locale.h>
+#include <gtk/gtk.h>
+#include <glib/gstdio.h>
 
+#include "cc-timezone-map.h"
 #include "tz.h"
 
 static void
@@ -40,9 +43,126 @@ test_timezone_gfx (gconstpointer data)
 	tz_db_free (db);
 }
 
+static gdouble
+draw_map (GtkWidget       *map,
+	  cairo_surface_t *surface,
+	  int              width,
+	  int              height)
+{
+	GtkAllocation alloc = { 0, 0, width, height };
+	GTimer *timer;
+	cairo_t *cr;
+	gdouble elapsed;
+
+	timer = g_timer_new ();
+	cr = cairo_create (surface);
+
+	gtk_widget_size_allocate (map, &alloc);
+	gtk_widget_draw (map, cr);
+	cairo_surface_flush (surface);
+
+	cairo_destroy (cr);
+	elapsed = g_timer_elapsed (timer, NULL);
+	g_timer_destroy (timer);
+
+	return elapsed;
+}
+
+static void
+test_timezone_map_draw (void)
+{
+	GtkWidget *window, *map;
+	cairo_surface_t *surface;
+	TzDB *db;
+	GPtrArray *locs;
+	gdouble first, elapsed;
+	const guint n_redraws = 100;
+	guint i;
+	int width;
+
+	if (!g_test_perf ())
+		return;
+
+	window = gtk_offscreen_window_new ();
+	map = GTK_WIDGET (cc_timezone_map_new ());
+	gtk_container_add (GTK_CONTAINER (window), map);
+	gtk_widget_show_all (window);
+
+	surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, 1600, 818);
+
+	/* Resizing the window, every size is rendered once */
+	first = elapsed = 0.0;
+	for (width = 400; width <= 1600; width += 4) {
+		gdouble time = draw_map (map, surface, width, width * 409 / 800);
+
+		if (width == 400)
+			first = time;
+		elapsed += time;
+	}
+	g_test_minimized_result (first * 1000, "First draw: %.3f ms", first * 1000);
+	elapsed /= (1600 - 400) / 4 + 1;
+	g_test_minimized_result (elapsed * 1000, "Draw while resizing: %.3f ms", elapsed * 1000);
+
+	/* Redrawing at the same size, e.g. for the bubble */
+	elapsed = 0.0;
+	for (i = 0; i < n_redraws; i++)
+		elapsed += draw_map (map, surface, 800, 409);
+	elapsed /= n_redraws;
+	g_test_minimized_result (elapsed * 1000, "Redraw: %.3f ms", elapsed * 1000);
+
+	/* Going through the zones, two of them alternately */
+	db = tz_load_db ();
+	locs = tz_get_locations (db);
+	elapsed = 0.0;
+	for (i = 0; i < n_redraws; i++) {
+		TzLocation *loc = locs->pdata[(i % 2) * (locs->len / 2)];
+
+		cc_timezone_map_set_timezone (CC_TIMEZONE_MAP (map), loc->zone);
+		elapsed += draw_map (map, surface, 800, 409);
+	}
+	elapsed /= n_redraws;
+	g_test_minimized_result (elapsed * 1000, "Draw after changing zone: %.3f ms", elapsed * 1000);
+
+	tz_db_free (db);
+	cairo_surface_destroy (surface);
+	gtk_widget_destroy (window);
+}
+
+static void
+remove_dir (const char *path)
+{
+	GDir *dir;
+	const char *name;
+
+	dir = g_dir_open (path, 0, NULL);
+	if (dir == NULL)
+		return;
+
+	while ((name = g_dir_read_name (dir)) != NULL) {
+		char *child;
+
+		child = g_build_filename (path, name, NULL);
+		if (g_file_test (child, G_FILE_TEST_IS_DIR))
+			remove_dir (child);
+		else
+			g_unlink (child);
+		g_free (child);
+	}
+
+	g_dir_close (dir);
+	g_rmdir (path);
+}
+
 int main (int argc, char **argv)
 {
 	char *pixmap_dir;
+	char *cache_dir;
+	int ret;
+
+	/* Keep the timezones cache away from the user's */
+	cache_dir = g_dir_make_tmp ("test-timezone-gfx-XXXXXX", NULL);
+	g_assert_nonnull (cache_dir);
+	g_setenv ("XDG_CACHE_HOME", cache_dir, TRUE);
 
         setlocale (LC_ALL, "");
 	g_test_init (&argc, &argv, NULL);
@@ -55,10 +175,19 @@ int main (int argc, char **argv)
 		pixmap_dir = g_strdup (SRCDIR "/data/");
 	} else {
 		g_message ("Usage: %s [PIXMAP DIRECTORY]", argv[0]);
+		remove_dir (cache_dir);
 		return 1;
 	}
 
 	g_test_add_data_func ("/datetime/timezone-gfx", pixmap_dir, test_timezone_gfx);
+	if (gtk_init_check (NULL, NULL))
+		g_test_add_func ("/datetime/timezone-map-draw", test_timezone_map_draw);
+
+	ret = g_test_run ();
+
+	remove_dir (cache_dir);
+	g_free (cache_dir);
+	g_free (pixmap_dir);
 
-	return g_test_run ();
+	return ret;
 }
@@ -1,5 +1,8 @@
 #include <locale.h>
+#include <math.h>
 #include <gtk/gtk.h>
+#include <glib/gstdio.h>
+#include "cc-cache-file.h"
 #include "cc-timezone-map.h"
 
 #define TZ_DIR "/usr/share/zoneinfo/"
@@ -98,8 +101,185 @@ test_timezone (void)
 	g_hash_table_destroy (ht);
 }
 
+#define MAP_WIDTH  800
+#define MAP_HEIGHT 400
+
+/* The projection of the map, as in cc-timezone-map.c */
+static gdouble
+longitude_to_x (gdouble longitude, gint map_width)
+{
+	return (map_width * (180.0 + longitude) / 360.0)
+		+ (map_width * -6 / 180.0);
+}
+
+static gdouble
+latitude_to_y (gdouble latitude, gdouble map_height)
+{
+	gdouble top_offset, map_range, y;
+
+	top_offset = 4.6068250867599998 * 81 / 180.0;
+	map_range = fabs (1.25 * log (tan (G_PI_4 + 0.4 * (-59 / 180.0 * G_PI))) - top_offset);
+	y = fabs (1.25 * log (tan (G_PI_4 + 0.4 * (latitude / 180.0 * G_PI))) - top_offset);
+
+	return y / map_range * map_height;
+}
+
+static gdouble
+location_distance (TzLocation *loc,
+		   gdouble     x,
+		   gdouble     y,
+		   gint        width,
+		   gint        height)
+{
+	gdouble dx, dy;
+
+	dx = longitude_to_x (loc->longitude, width) - x;
+	dy = latitude_to_y (loc->latitude, height) - y;
+
+	return dx * dx + dy * dy;
+}
+
+/* Compares the lookup with going through all the locations, on a grid of
+ * points that also covers the outside of the map */
+static void
+check_location_at (CcTimezoneMap *map,
+		   GPtrArray     *locations,
+		   gint           width,
+		   gint           height,
+		   gdouble        step)
+{
+	gdouble x, y;
+	guint i;
+
+	for (y = -height / 10.0; y < height * 1.1; y += step) {
+		for (x = -width / 10.0; x < width * 1.1; x += step) {
+			TzLocation *loc;
+			gdouble best = G_MAXDOUBLE;
+
+			for (i = 0; i < locations->len; i++)
+				best = MIN (best, location_distance (locations->pdata[i], x, y, width, height));
+
+			/* Several locations can be as close, any of them will do */
+			loc = cc_timezone_map_get_location_at (map, x, y, width, height);
+			g_assert_nonnull (loc);
+			g_assert_nonnull (loc->zone);
+			g_assert_cmpfloat (fabs (location_distance (loc, x, y, width, height) - best), <=, 1e-6 * MAX (best, 1.0));
+		}
+	}
+}
+
+static void
+test_location_at (void)
+{
+	CcTimezoneMap *map;
+	TzLocation *loc;
+	TzDB *tz_db;
+	GPtrArray *locations;
+
+	map = g_object_ref_sink (cc_timezone_map_new ());
+	tz_db = tz_load_db ();
+	locations = tz_get_locations (tz_db);
+	g_assert_cmpuint (locations->len, >, 0);
+
+	check_location_at (map, locations, MAP_WIDTH, MAP_HEIGHT, 7.3);
+	/* The grid cells are not square on a map of another shape */
+	check_location_at (map, locations, 333, 170, 3.1);
+
+	/* The same spot on a bigger map is the same location */
+	loc = cc_timezone_map_get_location_at (map, 400, 150, MAP_WIDTH, MAP_HEIGHT);
+	g_assert (loc == cc_timezone_map_get_location_at (map, 800, 300, MAP_WIDTH * 2, MAP_HEIGHT * 2));
+
+	tz_db_free (tz_db);
+	g_object_unref (map);
+}
+
+static void
+test_performance (void)
+{
+	CcTimezoneMap *map;
+	TzDB *tz_db;
+	GTimer *timer;
+	GRand *rand;
+	gdouble elapsed;
+	guint i;
+	const guint n_loads = 100;
+	const guint n_lookups = 100000;
+
+	if (!g_test_perf ())
+		return;
+
+	timer = g_timer_new ();
+
+	/* Parses zone.tab and writes the cache */
+	cc_cache_file_remove ("timezones.cache");
+	g_timer_start (timer);
+	tz_db = tz_load_db ();
+	elapsed = g_timer_elapsed (timer, NULL);
+	g_assert_nonnull (tz_db);
+	tz_db_free (tz_db);
+	g_test_minimized_result (elapsed * 1000, "Cold load: %.3f ms", elapsed * 1000);
+
+	g_timer_start (timer);
+	for (i = 0; i < n_loads; i++) {
+		tz_db = tz_load_db ();
+		tz_db_free (tz_db);
+	}
+	elapsed = g_timer_elapsed (timer, NULL) / n_loads;
+	g_test_minimized_result (elapsed * 1000, "Cached load: %.3f ms", elapsed * 1000);
+
+	map = g_object_ref_sink (cc_timezone_map_new ());
+	rand = g_rand_new_with_seed (42);
+
+	g_timer_start (timer);
+	for (i = 0; i < n_lookups; i++) {
+		cc_timezone_map_get_location_at (map,
+						 g_rand_double_range (rand, 0, MAP_WIDTH),
+						 g_rand_double_range (rand, 0, MAP_HEIGHT),
+						 MAP_WIDTH, MAP_HEIGHT);
+	}
+	elapsed = g_timer_elapsed (timer, NULL) / n_lookups;
+	g_test_minimized_result (elapsed * G_USEC_PER_SEC, "Nearest location lookup: %.3f µs", elapsed * G_USEC_PER_SEC);
+
+	g_rand_free (rand);
+	g_object_unref (map);
+	g_timer_destroy (timer);
+}
+
+static void
+remove_dir (const char *path)
+{
+	GDir *dir;
+	const char *name;
+
+	dir = g_dir_open (path, 0, NULL);
+	if (dir == NULL)
+		return;
+
+	while ((name = g_dir_read_name (dir)) != NULL) {
+		char *child;
+
+		child = g_build_filename (path, name, NULL);
+		if (g_file_test (child, G_FILE_TEST_IS_DIR))
+			remove_dir (child);
+		else
+			g_unlink (child);
+		g_free (child);
+	}
+
+	g_dir_close (dir);
+	g_rmdir (path);
+}
+
 int main (int argc, char **argv)
 {
+	char *cache_dir;
+	int ret;
+
+	/* Keep the timezones cache away from the user's */
+	cache_dir = g_dir_make_tmp ("test-timezone-XXXXXX", NULL);
+	g_assert_nonnull (cache_dir);
+	g_setenv ("XDG_CACHE_HOME", cache_dir, TRUE);
+
 	setlocale (LC_ALL, "");
 	gtk_init (NULL, NULL);
 	g_test_init (&argc, &argv, NULL);
@@ -107,6 +287,13 @@ int main (int argc, char **argv)
 	g_setenv ("G_DEBUG", "fatal_warnings", FALSE);
 
 	g_test_add_func ("/datetime/timezone", test_timezone);
+	g_test_add_func ("/datetime/location-at", test_location_at);
+	g_test_add_func ("/datetime/performance", test_performance);
+
+	ret = g_test_run ();
+
+	remove_dir (cache_dir);
+	g_free (cache_dir);
 
-	return g_test_run ();
+	return ret;
 }
@@ -22,6 +22,8 @@
  */
 
 
+#include <config.h>
+
 #include <glib.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -31,48 +33,49 @@
 #include <string.h>
 #include <ctype.h>
 #include "tz.h"
+#include "cc-cache-file.h"
 #include "cc-datetime-resources.h"
 
+/* The parsed zone.tab and backward files are cached, see tz_load_db() */
+#define TZ_CACHE_NAME    "timezones.cache"
+#define TZ_CACHE_VERSION "1"
+#define TZ_CACHE_TYPE    "(a(ssddms)a(ss))"
+
 
 /* Forward declarations for private functions */
 
 static float convert_pos (gchar *pos, int digits);
 static int compare_country_names (const void *a, const void *b);
-static void sort_locations_by_country (GPtrArray *locations);
+static void sort_locations_by_country (GArray *locations);
 static gchar * tz_data_file_get (void);
 static void load_backward_tz (TzDB *tz_db);
+static gboolean load_cache (TzDB *tz_db, const gchar *stamp);
+static void save_cache (TzDB *tz_db, const gchar *stamp, const gchar *tz_data_file);
 
 /* ---------------- *
  * Public interface *
  * ---------------- */
-TzDB *
-tz_load_db (void)
+static gboolean
+load_data_file (TzDB        *tz_db,
+		const gchar *tz_data_file)
 {
-	gchar *tz_data_file;
-	TzDB *tz_db;
+	GArray *locations;
 	FILE *tzfile;
 	char buf[4096];
 
-	tz_data_file = tz_data_file_get ();
-	if (!tz_data_file) {
-		g_warning ("Could not get the TimeZone data file name");
-		return NULL;
-	}
 	tzfile = fopen (tz_data_file, "r");
 	if (!tzfile) {
 		g_warning ("Could not open *%s*\n", tz_data_file);
-		g_free (tz_data_file);
-		return NULL;
+		return FALSE;
 	}
 
-	tz_db = g_new0 (TzDB, 1);
-	tz_db->locations = g_ptr_array_new ();
+	locations = g_array_new (FALSE, TRUE, sizeof (TzLocation));
 
 	while (fgets (buf, sizeof(buf), tzfile))
 	{
 		gchar **tmpstrarr;
 		gchar *latstr, *lngstr, *p;
-		TzLocation *loc;
+		TzLocation loc = { 0 };
 
 		if (*buf == '#') continue;
 
@@ -85,34 +88,32 @@ tz_load_db (void)
 		lngstr = g_strdup (p);
 		*p = '\0';
 		
-		loc = g_new0 (TzLocation, 1);
-		loc->country = g_strdup (tmpstrarr[0]);
-		loc->zone = g_strdup (tmpstrarr[2]);
-		loc->latitude  = convert_pos (latstr, 2);
-		loc->longitude = convert_pos (lngstr, 3);
+		loc.country = g_string_chunk_insert_const (tz_db->strings, tmpstrarr[0]);
+		loc.zone = g_string_chunk_insert_const (tz_db->strings, tmpstrarr[2]);
+		loc.latitude  = convert_pos (latstr, 2);
+		loc.longitude = convert_pos (lngstr, 3);
 		
 #ifdef __sun
 		if (tmpstrarr[3] && *tmpstrarr[3] == '-' && tmpstrarr[4])
-			loc->comment = g_strdup (tmpstrarr[4]);
+			loc.comment = g_string_chunk_insert_const (tz_db->strings, tmpstrarr[4]);
 
-		if (tmpstrarr[3] && *tmpstrarr[3] != '-' && !islower(loc->zone)) {
-			TzLocation *locgrp;
+		if (tmpstrarr[3] && *tmpstrarr[3] != '-' && !islower(loc.zone)) {
+			TzLocation locgrp = { 0 };
 
 			/* duplicate entry */
-			locgrp = g_new0 (TzLocation, 1);
-			locgrp->country = g_strdup (tmpstrarr[0]);
-			locgrp->zone = g_strdup (tmpstrarr[3]);
-			locgrp->latitude  = convert_pos (latstr, 2);
-			locgrp->longitude = convert_pos (lngstr, 3);
-			locgrp->comment = (tmpstrarr[4]) ? g_strdup (tmpstrarr[4]) : NULL;
-
-			g_ptr_array_add (tz_db->locations, (gpointer) locgrp);
+			locgrp.country = g_string_chunk_insert_const (tz_db->strings, tmpstrarr[0]);
+			locgrp.zone = g_string_chunk_insert_const (tz_db->strings, tmpstrarr[3]);
+			locgrp.latitude  = convert_pos (latstr, 2);
+			locgrp.longitude = convert_pos (lngstr, 3);
+			locgrp.comment = (tmpstrarr[4]) ? g_string_chunk_insert_const (tz_db->strings, tmpstrarr[4]) : NULL;
+
+			g_array_append_val (locations, locgrp);
 		}
 #else
-		loc->comment = (tmpstrarr[3]) ? g_strdup(tmpstrarr[3]) : NULL;
+		loc.comment = (tmpstrarr[3]) ? g_string_chunk_insert_const (tz_db->strings, tmpstrarr[3]) : NULL;
 #endif
 
-		g_ptr_array_add (tz_db->locations, (gpointer) loc);
+		g_array_append_val (locations, loc);
 
 		g_free (latstr);
 		g_free (lngstr);
@@ -122,32 +123,77 @@ tz_load_db (void)
 	fclose (tzfile);
 	
 	/* now sort by country */
-	sort_locations_by_country (tz_db->locations);
-	
-	g_free (tz_data_file);
+	sort_locations_by_country (locations);
 
-	/* Load up the hashtable of backward links */
-	load_backward_tz (tz_db);
+	tz_db->n_locations = locations->len;
+	tz_db->location_data = (TzLocation *) g_array_free (locations, FALSE);
 
-	return tz_db;
+	return TRUE;
 }
 
-static void
-tz_location_free (TzLocation *loc)
+/* ---------------- *
+ * Public interface *
+ * ---------------- */
+
+/* Parsing zone.tab and the backward file is only done when the cache in
+ * the user cache directory is missing or stale. Otherwise the cache is
+ * mapped, and the locations only point to its strings.
+ */
+TzDB *
+tz_load_db (void)
 {
-	g_free (loc->country);
-	g_free (loc->zone);
-	g_free (loc->comment);
+	gchar *tz_data_file;
+	gchar *stamp;
+	TzDB *tz_db;
+	guint i;
+
+	tz_data_file = tz_data_file_get ();
+	if (!tz_data_file) {
+		g_warning ("Could not get the TimeZone data file name");
+		return NULL;
+	}
+
+	tz_db = g_new0 (TzDB, 1);
+	tz_db->backward = g_hash_table_new (g_str_hash, g_str_equal);
+
+	/* the backward file is built in, so it changes with the version */
+	stamp = g_strjoin (";", TZ_CACHE_VERSION, PACKAGE_VERSION, tz_data_file, NULL);
 
-	g_free (loc);
+	if (!load_cache (tz_db, stamp)) {
+		tz_db->strings = g_string_chunk_new (4096);
+
+		if (!load_data_file (tz_db, tz_data_file)) {
+			tz_db_free (tz_db);
+			g_free (stamp);
+			g_free (tz_data_file);
+			return NULL;
+		}
+
+		/* Load up the hashtable of backward links */
+		load_backward_tz (tz_db);
+
+		save_cache (tz_db, stamp, tz_data_file);
+	}
+
+	tz_db->locations = g_ptr_array_sized_new (tz_db->n_locations);
+	for (i = 0; i < tz_db->n_locations; i++)
+		g_ptr_array_add (tz_db->locations, &tz_db->location_data[i]);
+
+	g_free (stamp);
+	g_free (tz_data_file);
+
+	return tz_db;
 }
 
 void
 tz_db_free (TzDB *db)
 {
-	g_ptr_array_foreach (db->locations, (GFunc) tz_location_free, NULL);
-	g_ptr_array_free (db->locations, TRUE);
-	g_hash_table_destroy (db->backward);
+	g_clear_pointer (&db->locations, g_ptr_array_unref);
+	g_clear_pointer (&db->backward, g_hash_table_destroy);
+	g_clear_pointer (&db->location_data, g_free);
+	g_clear_pointer (&db->cache, g_variant_unref);
+	if (db->strings)
+		g_string_chunk_free (db->strings);
 	g_free (db);
 }
 
@@ -411,18 +457,17 @@ free_tzdata (TzLocation *tz)
 static int
 compare_country_names (const void *a, const void *b)
 {
-	const TzLocation *tza = * (TzLocation **) a;
-	const TzLocation *tzb = * (TzLocation **) b;
+	const TzLocation *tza = a;
+	const TzLocation *tzb = b;
 	
 	return strcmp (tza->zone, tzb->zone);
 }
 
 
 static void
-sort_locations_by_country (GPtrArray *locations)
+sort_locations_by_country (GArray *locations)
 {
-	qsort (locations->pdata, locations->len, sizeof (gpointer),
-	       compare_country_names);
+	g_array_sort (locations, compare_country_names);
 }
 
 static void
@@ -433,8 +478,6 @@ load_backward_tz (TzDB *tz_db)
   const char *contents;
   guint i;
 
-  tz_db->backward = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
-
   bytes = g_resources_lookup_data ("/org/gnome/control-center/datetime/backward",
                                    G_RESOURCE_LOOKUP_FLAGS_NONE, NULL);
   contents = (const char *) g_bytes_get_data (bytes, NULL);
@@ -469,16 +512,103 @@ load_backward_tz (TzDB *tz_db)
         }
 
       if (real == NULL || alias == NULL)
-        g_warning ("Could not parse line: %s", lines[i]);
+        {
+          g_warning ("Could not parse line: %s", lines[i]);
+          g_strfreev (items);
+          continue;
+        }
 
       /* We don't need more than one name for it */
       if (g_str_equal (real, "Etc/UTC") ||
           g_str_equal (real, "Etc/UCT"))
         real = "Etc/GMT";
 
-      g_hash_table_insert (tz_db->backward, g_strdup (alias), g_strdup (real));
+      g_hash_table_insert (tz_db->backward,
+                           g_string_chunk_insert_const (tz_db->strings, alias),
+                           g_string_chunk_insert_const (tz_db->strings, real));
       g_strfreev (items);
     }
   g_strfreev (lines);
 }
 
+static gboolean
+load_cache (TzDB        *tz_db,
+            const gchar *stamp)
+{
+  GVariant *cache;
+  GVariant *locations;
+  GVariant *backward;
+  GVariantIter iter;
+  const gchar *alias, *real;
+  guint i;
+
+  cache = cc_cache_file_load (TZ_CACHE_NAME, stamp, G_VARIANT_TYPE (TZ_CACHE_TYPE));
+  if (cache == NULL)
+    return FALSE;
+
+  locations = g_variant_get_child_value (cache, 0);
+  backward = g_variant_get_child_value (cache, 1);
+
+  tz_db->cache = cache;
+  tz_db->n_locations = g_variant_n_children (locations);
+  tz_db->location_data = g_new0 (TzLocation, tz_db->n_locations);
+
+  for (i = 0; i < tz_db->n_locations; i++)
+    {
+      TzLocation *loc = &tz_db->location_data[i];
+
+      g_variant_get_child (locations, i, "(&s&sddm&s)",
+                           &loc->country,
+                           &loc->zone,
+                           &loc->latitude,
+                           &loc->longitude,
+                           &loc->comment);
+    }
+
+  g_variant_iter_init (&iter, backward);
+  while (g_variant_iter_next (&iter, "(&s&s)", &alias, &real))
+    g_hash_table_insert (tz_db->backward, (gpointer) alias, (gpointer) real);
+
+  /* the strings stay valid as long as the cache is referenced */
+  g_variant_unref (locations);
+  g_variant_unref (backward);
+
+  return TRUE;
+}
+
+static void
+save_cache (TzDB        *tz_db,
+            const gchar *stamp,
+            const gchar *tz_data_file)
+{
+  const gchar *watched_paths[] = { tz_data_file, NULL };
+  GVariantBuilder builder;
+  GHashTableIter iter;
+  gpointer alias, real;
+  guint i;
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE (TZ_CACHE_TYPE));
+
+  g_variant_builder_open (&builder, G_VARIANT_TYPE ("a(ssddms)"));
+  for (i = 0; i < tz_db->n_locations; i++)
+    {
+      TzLocation *loc = &tz_db->location_data[i];
+
+      g_variant_builder_add (&builder, "(ssddms)",
+                             loc->country,
+                             loc->zone,
+                             loc->latitude,
+                             loc->longitude,
+                             loc->comment);
+    }
+  g_variant_builder_close (&builder);
+
+  g_variant_builder_open (&builder, G_VARIANT_TYPE ("a(ss)"));
+  g_hash_table_iter_init (&iter, tz_db->backward);
+  while (g_hash_table_iter_next (&iter, &alias, &real))
+    g_variant_builder_add (&builder, "(ss)", alias, real);
+  g_variant_builder_close (&builder);
+
+  cc_cache_file_save (TZ_CACHE_NAME, stamp, watched_paths, g_variant_builder_end (&builder));
+}
+
@@ -42,6 +42,13 @@ struct _TzDB
 {
 	GPtrArray  *locations;
 	GHashTable *backward;
+
+	/* The locations are stored contiguously, their strings
+	 * point either into the cache or into the string chunk */
+	TzLocation   *location_data;
+	guint         n_locations;
+	GVariant     *cache;
+	GStringChunk *strings;
 };
 
 struct _TzLocation
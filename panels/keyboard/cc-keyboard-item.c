@@ -238,6 +238,7 @@ cc_keyboard_item_set_property (GObject      *object,
     _set_description (self, g_value_get_string (value));
     break;
   case PROP_BINDING:
+    cc_keyboard_item_ensure_loaded (self);
     _set_binding (self, g_value_get_string (value), TRUE);
     break;
   case PROP_COMMAND:
@@ -524,12 +525,36 @@ cc_keyboard_item_load_from_gsettings (CcKeyboardItem *item,
 				      const char *schema,
 				      const char *key)
 {
-  char *signal_name;
-
   item->schema = g_strdup (schema);
   item->key = g_strdup (key);
   item->description = g_strdup (description);
 
+  /* The settings are only read once the item is shown, see
+   * cc_keyboard_item_ensure_loaded() */
+
+  return TRUE;
+}
+
+/**
+ * cc_keyboard_item_ensure_loaded:
+ * @item: a #CcKeyboardItem
+ *
+ * Reads the binding of a shortcut loaded with
+ * cc_keyboard_item_load_from_gsettings(), and starts following its
+ * changes. Until then, only its description is known, and its
+ * #CcKeyboardItem:binding is %NULL.
+ */
+void
+cc_keyboard_item_ensure_loaded (CcKeyboardItem *item)
+{
+  CcKeyboardItem *reverse;
+  char *signal_name;
+
+  g_return_if_fail (CC_IS_KEYBOARD_ITEM (item));
+
+  if (item->settings != NULL)
+    return;
+
   item->settings = g_settings_new (item->schema);
   g_free (item->priv->binding);
   item->priv->binding = settings_get_binding (item->settings, item->key);
@@ -547,7 +572,12 @@ cc_keyboard_item_load_from_gsettings (CcKeyboardItem *item,
 		    G_CALLBACK (binding_changed), item);
   g_free (signal_name);
 
-  return TRUE;
+  g_object_notify (G_OBJECT (item), "binding");
+
+  /* Setting a binding also sets the one of the reverse item */
+  reverse = item->priv->reverse_item;
+  if (reverse)
+    cc_keyboard_item_ensure_loaded (reverse);
 }
 
 gboolean
@@ -631,6 +661,8 @@ cc_keyboard_item_is_value_default (CcKeyboardItem *self)
   if (self->type == CC_KEYBOARD_ITEM_TYPE_GSETTINGS_PATH)
     return TRUE;
 
+  cc_keyboard_item_ensure_loaded (self);
+
   user_value = g_settings_get_user_value (self->settings, self->key);
 
   is_value_default = TRUE;
@@ -668,6 +700,8 @@ cc_keyboard_item_reset (CcKeyboardItem *self)
 
   g_return_if_fail (CC_IS_KEYBOARD_ITEM (self));
 
+  cc_keyboard_item_ensure_loaded (self);
+
   reverse = self->priv->reverse_item;
 
   g_settings_reset (self->settings, self->key);
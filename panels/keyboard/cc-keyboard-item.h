@@ -99,6 +99,7 @@ gboolean cc_keyboard_item_load_from_gsettings (CcKeyboardItem *item,
 					       const char *description,
 					       const char *schema,
 					       const char *key);
+void     cc_keyboard_item_ensure_loaded    (CcKeyboardItem *item);
 
 const char * cc_keyboard_item_get_description (CcKeyboardItem *item);
 const char * cc_keyboard_item_get_command     (CcKeyboardItem *item);
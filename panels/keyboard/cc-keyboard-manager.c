@@ -20,8 +20,11 @@
  *
  */
 
+#include "config.h"
+
 #include <glib/gi18n.h>
 
+#include "cc-cache-file.h"
 #include "cc-keyboard-manager.h"
 #include "keyboard-shortcuts.h"
 #include "wm-common.h"
@@ -33,6 +36,19 @@
 #define BINDINGS_SCHEMA       "org.gnome.settings-daemon.plugins.media-keys"
 #define CUSTOM_SHORTCUTS_ID   "custom"
 
+/* Combos are indexed by keyval, or by keycode when they have no keyval */
+#define COMBO_KEYCODE_FLAG    (1u << 31)
+
+/* The parsed keybindings files, one entry per section: its name, group,
+ * gettext package, window manager and data directory, and its entries
+ * (key, schema, description, reverse entry, is reversed, hidden). Unset
+ * strings are empty.
+ */
+#define SECTIONS_CACHE_NAME    "keybindings.cache"
+#define SECTIONS_CACHE_VERSION "1"
+#define SECTIONS_CACHE_ENTRY   "(ssssbb)"
+#define SECTIONS_CACHE_TYPE    "a(sssssa" SECTIONS_CACHE_ENTRY ")"
+
 struct _CcKeyboardManager
 {
   GObject             parent;
@@ -44,6 +60,11 @@ struct _CcKeyboardManager
   GHashTable         *kb_apps_sections;
   GHashTable         *kb_user_sections;
 
+  /* (mask, keyval or keycode) → items bound to it, and item → its keys */
+  GHashTable         *combo_index;
+  GHashTable         *indexed_items;
+  gboolean            index_complete;
+
   GSettings          *binding_settings;
 
   gpointer            wm_changed_id;
@@ -85,83 +106,178 @@ free_key_array (GPtrArray *keys)
 }
 
 static gboolean
-find_conflict (CcUniquenessData *data,
-               CcKeyboardItem   *item)
+get_combo_index_key (const CcKeyCombo *combo,
+                     gint64           *key)
 {
-  GList *l;
-  gboolean is_conflict = FALSE;
+  guint32 code;
 
-  if (data->orig_item && cc_keyboard_item_equal (data->orig_item, item))
+  if (combo->keyval != 0)
+    code = combo->keyval;
+  else if (combo->keycode != 0)
+    code = combo->keycode | COMBO_KEYCODE_FLAG;
+  else
     return FALSE;
 
+  *key = (gint64) (((guint64) combo->mask << 32) | code);
+
+  return TRUE;
+}
+
+static void
+add_item_combos (CcKeyboardManager *self,
+                 CcKeyboardItem    *item,
+                 GArray            *keys)
+{
+  GList *l;
+
   for (l = item->key_combos; l; l = l->next)
     {
-      CcKeyCombo *combo = l->data;
+      GPtrArray *items;
+      gint64 key;
 
-      if (data->new_mask != combo->mask)
+      if (!get_combo_index_key (l->data, &key))
         continue;
 
-      if (data->new_keyval != 0)
-        is_conflict = data->new_keyval == combo->keyval;
-      else
-        is_conflict = combo->keyval == 0 && data->new_keycode == combo->keycode;
+      items = g_hash_table_lookup (self->combo_index, &key);
+      if (!items)
+        {
+          items = g_ptr_array_new ();
+          g_hash_table_insert (self->combo_index, g_memdup (&key, sizeof (key)), items);
+        }
 
-      if (is_conflict)
-        break;
+      g_ptr_array_add (items, item);
+      g_array_append_val (keys, key);
     }
+}
+
+static void
+remove_item_combos (CcKeyboardManager *self,
+                    CcKeyboardItem    *item,
+                    GArray            *keys)
+{
+  guint i;
+
+  for (i = 0; i < keys->len; i++)
+    {
+      GPtrArray *items;
+      gint64 key;
+
+      key = g_array_index (keys, gint64, i);
+      items = g_hash_table_lookup (self->combo_index, &key);
+
+      if (!items)
+        continue;
+
+      g_ptr_array_remove_fast (items, item);
 
-  if (is_conflict)
-    data->conflict_item = item;
+      if (items->len == 0)
+        g_hash_table_remove (self->combo_index, &key);
+    }
 
-  return is_conflict;
+  g_array_set_size (keys, 0);
 }
 
-static gboolean
-compare_keys_for_uniqueness (CcKeyboardItem   *current_item,
-                             CcUniquenessData *data)
+static void
+on_item_binding_changed (CcKeyboardItem    *item,
+                         GParamSpec        *pspec,
+                         CcKeyboardManager *self)
 {
-  CcKeyboardItem *reverse_item;
+  GArray *keys;
 
-  /* No conflict for: blanks or ourselves */
-  if (!current_item || data->orig_item == current_item)
-    return FALSE;
+  keys = g_hash_table_lookup (self->indexed_items, item);
 
-  reverse_item = cc_keyboard_item_get_reverse_item (current_item);
+  remove_item_combos (self, item, keys);
+  add_item_combos (self, item, keys);
+}
 
-  /* When the current item is the reversed shortcut of a main item, simply ignore it */
-  if (reverse_item && cc_keyboard_item_is_hidden (current_item))
-    return FALSE;
+static void
+index_item (CcKeyboardManager *self,
+            CcKeyboardItem    *item)
+{
+  GArray *keys;
 
-  if (find_conflict (data, current_item))
-    return TRUE;
+  if (g_hash_table_contains (self->indexed_items, item))
+    return;
 
-  /* Also check for the reverse item if any */
-  if (reverse_item && find_conflict (data, reverse_item))
-    return TRUE;
+  keys = g_array_new (FALSE, FALSE, sizeof (gint64));
+  g_hash_table_insert (self->indexed_items, item, keys);
 
-  return FALSE;
+  add_item_combos (self, item, keys);
+
+  g_signal_connect (item, "notify::binding", G_CALLBACK (on_item_binding_changed), self);
 }
 
-static gboolean
-check_for_uniqueness (gpointer          key,
-                      GPtrArray        *keys_array,
-                      CcUniquenessData *data)
+static void
+unindex_item (CcKeyboardManager *self,
+              CcKeyboardItem    *item)
 {
-  guint i;
+  GArray *keys;
 
-  for (i = 0; i < keys_array->len; i++)
-    {
-      CcKeyboardItem *item;
+  keys = g_hash_table_lookup (self->indexed_items, item);
 
-      item = keys_array->pdata[i];
+  if (!keys)
+    return;
 
-      if (compare_keys_for_uniqueness (item, data))
-        return TRUE;
-    }
+  remove_item_combos (self, item, keys);
+  g_signal_handlers_disconnect_by_func (item, on_item_binding_changed, self);
 
-  return FALSE;
+  g_hash_table_remove (self->indexed_items, item);
+}
+
+static void
+clear_index (CcKeyboardManager *self)
+{
+  GHashTableIter iter;
+  CcKeyboardItem *item;
+
+  g_hash_table_iter_init (&iter, self->indexed_items);
+  while (g_hash_table_iter_next (&iter, (gpointer*) &item, NULL))
+    g_signal_handlers_disconnect_by_func (item, on_item_binding_changed, self);
+
+  g_hash_table_remove_all (self->indexed_items);
+  g_hash_table_remove_all (self->combo_index);
+  self->index_complete = FALSE;
 }
 
+/* Shortcuts only read their bindings once they're shown, and get indexed
+ * then. Collision lookups need all of them.
+ */
+static void
+ensure_index_complete (CcKeyboardManager *self)
+{
+  GHashTableIter iter;
+  CcKeyboardItem *item;
+
+  if (self->index_complete)
+    return;
+
+  g_hash_table_iter_init (&iter, self->indexed_items);
+  while (g_hash_table_iter_next (&iter, (gpointer*) &item, NULL))
+    cc_keyboard_item_ensure_loaded (item);
+
+  self->index_complete = TRUE;
+}
+
+static gboolean
+is_collision (CcKeyboardItem *orig_item,
+              CcKeyboardItem *item)
+{
+  CcKeyboardItem *reverse_item;
+
+  if (!orig_item)
+    return TRUE;
+
+  /* No conflict for ourselves */
+  if (orig_item == item || cc_keyboard_item_equal (orig_item, item))
+    return FALSE;
+
+  /* Nor for the hidden reversed shortcut of ourselves, it changes along with us */
+  reverse_item = cc_keyboard_item_get_reverse_item (item);
+  if (reverse_item == orig_item && cc_keyboard_item_is_hidden (item))
+    return FALSE;
+
+  return TRUE;
+}
 
 static GHashTable*
 get_hash_for_group (CcKeyboardManager *self,
@@ -368,6 +484,7 @@ append_section (CcKeyboardManager  *self,
       item->group = group;
 
       g_ptr_array_add (keys_array, item);
+      index_item (self, item);
     }
 
   g_hash_table_destroy (reverse_items);
@@ -389,16 +506,39 @@ append_section (CcKeyboardManager  *self,
 }
 
 static void
-append_sections_from_file (CcKeyboardManager  *self,
-                           const gchar        *path,
-                           const char         *datadir,
-                           gchar             **wm_keybindings)
+free_keylist (KeyList *keylist)
+{
+  guint i;
+
+  for (i = 0; i < keylist->entries->len; i++)
+    {
+      KeyListEntry *entry = &g_array_index (keylist->entries, KeyListEntry, i);
+
+      g_free (entry->schema);
+      g_free (entry->description);
+      g_free (entry->name);
+      g_free (entry->reverse_entry);
+    }
+
+  g_free (keylist->name);
+  g_free (keylist->package);
+  g_free (keylist->wm_name);
+  g_free (keylist->schema);
+  g_free (keylist->group);
+  g_array_free (keylist->entries, TRUE);
+  g_free (keylist);
+}
+
+#define empty_if_null(s) ((s) ? (s) : "")
+#define null_if_empty(s) (*(s) ? (s) : NULL)
+
+static void
+add_sections_from_file (GVariantBuilder *builder,
+                        const gchar     *path,
+                        const gchar     *datadir)
 {
+  GVariantBuilder entries_builder;
   KeyList *keylist;
-  KeyListEntry *keys;
-  KeyListEntry key = { 0, 0, 0, 0, 0, 0, 0 };
-  const char *title;
-  int group;
   guint i;
 
   keylist = parse_keylist_from_file (path);
@@ -406,68 +546,229 @@ append_sections_from_file (CcKeyboardManager  *self,
   if (keylist == NULL)
     return;
 
-#define const_strv(s) ((const gchar* const*) s)
-
-  /* If there's no keys to add, or the settings apply to a window manager
-   * that's not the one we're running */
-  if (keylist->entries->len == 0 ||
-      (keylist->wm_name != NULL && !g_strv_contains (const_strv (wm_keybindings), keylist->wm_name)) ||
-      keylist->name == NULL)
+  /* If there's no keys to add */
+  if (keylist->entries->len == 0 || keylist->name == NULL)
     {
-      g_free (keylist->name);
-      g_free (keylist->package);
-      g_free (keylist->wm_name);
-      g_array_free (keylist->entries, TRUE);
-      g_free (keylist);
+      free_keylist (keylist);
       return;
     }
 
-#undef const_strv
+  g_variant_builder_init (&entries_builder, G_VARIANT_TYPE ("a" SECTIONS_CACHE_ENTRY));
+
+  for (i = 0; i < keylist->entries->len; i++)
+    {
+      KeyListEntry *entry = &g_array_index (keylist->entries, KeyListEntry, i);
+
+      g_variant_builder_add (&entries_builder,
+                             SECTIONS_CACHE_ENTRY,
+                             entry->name,
+                             entry->schema,
+                             empty_if_null (entry->description),
+                             empty_if_null (entry->reverse_entry),
+                             entry->is_reversed,
+                             entry->hidden);
+    }
+
+  g_variant_builder_add (builder,
+                         "(sssssa" SECTIONS_CACHE_ENTRY ")",
+                         keylist->name,
+                         empty_if_null (keylist->group),
+                         empty_if_null (keylist->package),
+                         empty_if_null (keylist->wm_name),
+                         datadir,
+                         &entries_builder);
+
+  free_keylist (keylist);
+}
+
+/* The descriptions are translated and may contain the name of the
+ * pictures folder, and the directories searched depend on the environment
+ */
+static gchar *
+get_sections_cache_stamp (GPtrArray *dirs)
+{
+  g_autofree gchar *languages = NULL;
+  GString *stamp;
+  guint i;
+
+  languages = g_strjoinv (":", (gchar **) g_get_language_names ());
+
+  stamp = g_string_new (SECTIONS_CACHE_VERSION);
+  g_string_append_printf (stamp, ";%s;%s;%s",
+                          PACKAGE_VERSION,
+                          languages,
+                          empty_if_null (g_get_user_special_dir (G_USER_DIRECTORY_PICTURES)));
+  for (i = 0; i < dirs->len; i++)
+    g_string_append_printf (stamp, ";%s", (gchar *) g_ptr_array_index (dirs, i));
+
+  return g_string_free (stamp, FALSE);
+}
+
+/*
+ * Parsing the keybindings files is what opening the panel used to spend
+ * most of its time on, so the result is cached until one of the
+ * keybindings directories or files changes.
+ */
+static GVariant *
+load_sections (void)
+{
+  g_autoptr(GPtrArray) dirs = NULL;
+  g_autoptr(GPtrArray) watched_paths = NULL;
+  g_autoptr(GHashTable) loaded_files = NULL;
+  g_autofree gchar *stamp = NULL;
+  const gchar * const * data_dirs;
+  GVariantBuilder builder;
+  GVariant *sections;
+  guint i;
+
+  data_dirs = g_get_system_data_dirs ();
+
+  dirs = g_ptr_array_new_with_free_func (g_free);
+  for (i = 0; data_dirs[i] != NULL; i++)
+    g_ptr_array_add (dirs, g_build_filename (data_dirs[i], "gnome-control-center", "keybindings", NULL));
+
+  stamp = get_sections_cache_stamp (dirs);
+
+  sections = cc_cache_file_load (SECTIONS_CACHE_NAME, stamp, G_VARIANT_TYPE (SECTIONS_CACHE_TYPE));
+  if (sections)
+    return sections;
+
+  /* The directories are watched for added and removed files, and the
+   * files themselves for changes */
+  watched_paths = g_ptr_array_new_with_free_func (g_free);
+  loaded_files = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
 
-  /* Empty KeyListEntry to end the array */
-  key.name = NULL;
-  g_array_append_val (keylist->entries, key);
+  g_variant_builder_init (&builder, G_VARIANT_TYPE (SECTIONS_CACHE_TYPE));
 
-  keys = (KeyListEntry *) g_array_free (keylist->entries, FALSE);
-  if (keylist->package)
+  for (i = 0; i < dirs->len; i++)
     {
-      char *localedir;
+      const gchar *dir_path;
+      const gchar *name;
+      GDir *dir;
+
+      dir_path = g_ptr_array_index (dirs, i);
+      g_ptr_array_add (watched_paths, g_strdup (dir_path));
+
+      dir = g_dir_open (dir_path, 0, NULL);
+      if (!dir)
+        continue;
+
+      for (name = g_dir_read_name (dir) ; name ; name = g_dir_read_name (dir))
+        {
+          gchar *path;
+
+          if (g_str_has_suffix (name, ".xml") == FALSE)
+            continue;
+
+          if (g_hash_table_lookup (loaded_files, name) != NULL)
+            {
+              g_debug ("Not loading %s, it was already loaded from another directory", name);
+              continue;
+            }
 
-      localedir = g_build_filename (datadir, "locale", NULL);
-      bindtextdomain (keylist->package, localedir);
-      g_free (localedir);
+          g_hash_table_insert (loaded_files, g_strdup (name), GINT_TO_POINTER (1));
+          path = g_build_filename (dir_path, name, NULL);
+          add_sections_from_file (&builder, path, data_dirs[i]);
+          g_ptr_array_add (watched_paths, path);
+        }
 
-      title = dgettext (keylist->package, keylist->name);
-    } else {
-      title = _(keylist->name);
+      g_dir_close (dir);
     }
 
-  if (keylist->group && strcmp (keylist->group, "system") == 0)
-    group = BINDING_GROUP_SYSTEM;
-  else
-    group = BINDING_GROUP_APPS;
+  g_ptr_array_add (watched_paths, NULL);
 
-  append_section (self, title, keylist->name, group, keys);
+  sections = g_variant_ref_sink (g_variant_builder_end (&builder));
 
-  g_free (keylist->name);
-  g_free (keylist->package);
-  g_free (keylist->wm_name);
-  g_free (keylist->schema);
-  g_free (keylist->group);
+  cc_cache_file_save (SECTIONS_CACHE_NAME,
+                      stamp,
+                      (const gchar * const *) watched_paths->pdata,
+                      sections);
 
-  for (i = 0; keys[i].name != NULL; i++)
+  return sections;
+}
+
+static void
+append_sections_from_cache (CcKeyboardManager  *self,
+                            GVariant           *sections,
+                            gchar             **wm_keybindings)
+{
+  GVariantIter iter;
+  const gchar *name, *group, *package, *wm_name, *datadir;
+  GVariantIter *entries;
+
+#define const_strv(s) ((const gchar* const*) s)
+
+  g_variant_iter_init (&iter, sections);
+  while (g_variant_iter_next (&iter,
+                              "(&s&s&s&s&sa" SECTIONS_CACHE_ENTRY ")",
+                              &name, &group, &package, &wm_name, &datadir, &entries))
     {
-      KeyListEntry *entry = &keys[i];
-      g_free (entry->schema);
-      g_free (entry->description);
-      g_free (entry->name);
-      g_free (entry->reverse_entry);
+      KeyListEntry *keys;
+      const gchar *title;
+      const gchar *key_name, *schema, *description, *reverse_entry;
+      gboolean is_reversed, hidden;
+      guint n_keys;
+      int group_type;
+
+      /* If the settings apply to a window manager that's not the one we're running */
+      if (*wm_name && !g_strv_contains (const_strv (wm_keybindings), wm_name))
+        {
+          g_variant_iter_free (entries);
+          continue;
+        }
+
+      /* Empty KeyListEntry to end the array. The strings are owned by the
+       * cache, append_section() doesn't keep them. */
+      keys = g_new0 (KeyListEntry, g_variant_iter_n_children (entries) + 1);
+      n_keys = 0;
+
+      while (g_variant_iter_next (entries,
+                                  "(&s&s&s&sbb)",
+                                  &key_name, &schema, &description, &reverse_entry,
+                                  &is_reversed, &hidden))
+        {
+          KeyListEntry *key = &keys[n_keys++];
+
+          key->type = CC_KEYBOARD_ITEM_TYPE_GSETTINGS;
+          key->name = (gchar *) key_name;
+          key->schema = (gchar *) schema;
+          key->description = (gchar *) null_if_empty (description);
+          key->reverse_entry = (gchar *) null_if_empty (reverse_entry);
+          key->is_reversed = is_reversed;
+          key->hidden = hidden;
+        }
+
+      if (*package)
+        {
+          char *localedir;
+
+          localedir = g_build_filename (datadir, "locale", NULL);
+          bindtextdomain (package, localedir);
+          bind_textdomain_codeset (package, "UTF-8");
+          g_free (localedir);
+
+          title = dgettext (package, name);
+        } else {
+          title = _(name);
+        }
+
+      if (strcmp (group, "system") == 0)
+        group_type = BINDING_GROUP_SYSTEM;
+      else
+        group_type = BINDING_GROUP_APPS;
+
+      append_section (self, title, name, group_type, keys);
+
+      g_variant_iter_free (entries);
+      g_free (keys);
     }
 
-  g_free (keylist);
-  g_free (keys);
+#undef const_strv
 }
 
+#undef empty_if_null
+#undef null_if_empty
+
 static void
 append_sections_from_gsettings (CcKeyboardManager *self)
 {
@@ -521,18 +822,16 @@ static void
 reload_sections (CcKeyboardManager *self)
 {
   GtkTreeModel *shortcut_model;
-  GHashTable *loaded_files;
-  GDir *dir;
+  GVariant *sections;
   gchar *default_wm_keybindings[] = { "Mutter", "GNOME Shell", NULL };
   gchar **wm_keybindings;
-  const gchar * const * data_dirs;
-  guint i;
 
   shortcut_model = GTK_TREE_MODEL (self->shortcuts_model);
 
   /* Clear previous models and hash tables */
   gtk_list_store_clear (GTK_LIST_STORE (self->sections_store));
   gtk_list_store_clear (GTK_LIST_STORE (shortcut_model));
+  clear_index (self);
 
   g_clear_pointer (&self->kb_system_sections, g_hash_table_destroy);
   self->kb_system_sections = g_hash_table_new_full (g_str_hash,
@@ -560,47 +859,10 @@ reload_sections (CcKeyboardManager *self)
 #endif
     wm_keybindings = g_strdupv (default_wm_keybindings);
 
-  loaded_files = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
-
-  data_dirs = g_get_system_data_dirs ();
-  for (i = 0; data_dirs[i] != NULL; i++)
-    {
-      char *dir_path;
-      const gchar *name;
-
-      dir_path = g_build_filename (data_dirs[i], "gnome-control-center", "keybindings", NULL);
-
-      dir = g_dir_open (dir_path, 0, NULL);
-      if (!dir)
-        {
-          g_free (dir_path);
-          continue;
-        }
-
-      for (name = g_dir_read_name (dir) ; name ; name = g_dir_read_name (dir))
-        {
-          gchar *path;
-
-          if (g_str_has_suffix (name, ".xml") == FALSE)
-            continue;
-
-          if (g_hash_table_lookup (loaded_files, name) != NULL)
-            {
-              g_debug ("Not loading %s, it was already loaded from another directory", name);
-              continue;
-            }
-
-          g_hash_table_insert (loaded_files, g_strdup (name), GINT_TO_POINTER (1));
-          path = g_build_filename (dir_path, name, NULL);
-          append_sections_from_file (self, path, data_dirs[i], wm_keybindings);
-          g_free (path);
-        }
-
-      g_free (dir_path);
-      g_dir_close (dir);
-    }
+  sections = load_sections ();
+  append_sections_from_cache (self, sections, wm_keybindings);
 
-  g_hash_table_destroy (loaded_files);
+  g_variant_unref (sections);
   g_strfreev (wm_keybindings);
 
   /* Load custom keybindings */
@@ -622,6 +884,9 @@ cc_keyboard_manager_finalize (GObject *object)
 {
   CcKeyboardManager *self = (CcKeyboardManager *)object;
 
+  clear_index (self);
+  g_clear_pointer (&self->combo_index, g_hash_table_destroy);
+  g_clear_pointer (&self->indexed_items, g_hash_table_destroy);
   g_clear_pointer (&self->kb_system_sections, g_hash_table_destroy);
   g_clear_pointer (&self->kb_apps_sections, g_hash_table_destroy);
   g_clear_pointer (&self->kb_user_sections, g_hash_table_destroy);
@@ -708,6 +973,15 @@ cc_keyboard_manager_init (CcKeyboardManager *self)
   /* Bindings */
   self->binding_settings = g_settings_new (BINDINGS_SCHEMA);
 
+  self->combo_index = g_hash_table_new_full (g_int64_hash,
+                                             g_int64_equal,
+                                             g_free,
+                                             (GDestroyNotify) g_ptr_array_unref);
+  self->indexed_items = g_hash_table_new_full (NULL,
+                                               NULL,
+                                               NULL,
+                                               (GDestroyNotify) g_array_unref);
+
   /* Setup the section models */
   self->sections_store = gtk_list_store_new (SECTION_N_COLUMNS,
                                              G_TYPE_STRING,
@@ -800,6 +1074,7 @@ cc_keyboard_manager_add_custom_shortcut (CcKeyboardManager *self,
     }
 
   g_ptr_array_add (keys_array, item);
+  index_item (self, item);
 
   gtk_list_store_append (self->shortcuts_model, &iter);
   gtk_list_store_set (self->shortcuts_model, &iter, DETAIL_KEYENTRY_COLUMN, item, -1);
@@ -887,6 +1162,7 @@ cc_keyboard_manager_remove_custom_shortcut  (CcKeyboardManager *self,
 
   keys_array = g_hash_table_lookup (get_hash_for_group (self, BINDING_GROUP_USER), CUSTOM_SHORTCUTS_ID);
   g_ptr_array_remove (keys_array, item);
+  unindex_item (self, item);
 
   gtk_list_store_remove (GTK_LIST_STORE (model), &iter);
 
@@ -908,34 +1184,29 @@ cc_keyboard_manager_get_collision (CcKeyboardManager *self,
                                    CcKeyboardItem    *item,
                                    CcKeyCombo        *combo)
 {
-  CcUniquenessData data;
-  BindingGroupType i;
+  GPtrArray *items;
+  gint64 key;
+  guint i;
 
   g_return_val_if_fail (CC_IS_KEYBOARD_MANAGER (self), NULL);
 
-  data.orig_item = item;
-  data.new_keyval = combo->keyval;
-  data.new_mask = combo->mask;
-  data.new_keycode = combo->keycode;
-  data.conflict_item = NULL;
-
-  if (combo->keyval == 0 && combo->keycode == 0)
+  /* Any number of shortcuts can be disabled */
+  if (!get_combo_index_key (combo, &key))
     return NULL;
 
-  /* Any number of shortcuts can be disabled */
-  for (i = BINDING_GROUP_SYSTEM; i <= BINDING_GROUP_USER && !data.conflict_item; i++)
-    {
-      GHashTable *table;
+  ensure_index_complete (self);
 
-      table = get_hash_for_group (self, i);
+  items = g_hash_table_lookup (self->combo_index, &key);
 
-      if (!table)
-        continue;
+  for (i = 0; items && i < items->len; i++)
+    {
+      CcKeyboardItem *current_item = g_ptr_array_index (items, i);
 
-      g_hash_table_find (table, (GHRFunc) check_for_uniqueness, &data);
+      if (is_collision (item, current_item))
+        return current_item;
     }
 
-  return data.conflict_item;
+  return NULL;
 }
 
 /**
@@ -972,6 +1243,8 @@ cc_keyboard_manager_reset_shortcut (CcKeyboardManager *self,
   g_return_if_fail (CC_IS_KEYBOARD_MANAGER (self));
   g_return_if_fail (CC_IS_KEYBOARD_ITEM (item));
 
+  cc_keyboard_item_ensure_loaded (item);
+
   /* Disables any shortcut that conflicts with the new shortcut's value */
   for (l = item->default_combos; l; l = l->next)
     {
@@ -39,6 +39,11 @@ typedef struct {
   CcKeyboardItem *item;
   gchar          *section_title;
   gchar          *section_id;
+
+  /* Bound to the item once the row is shown */
+  GtkWidget      *accelerator_label;
+  GtkWidget      *reset_button;
+  gboolean        bound;
 } RowData;
 
 struct _CcKeyboardPanel
@@ -56,6 +61,8 @@ struct _CcKeyboardPanel
   GtkWidget          *listbox;
   GtkListBoxRow      *add_shortcut_row;
   GtkSizeGroup       *accelerator_sizegroup;
+  GtkWidget          *scrolled_window;
+  guint               bind_rows_id;
 
   /* Custom shortcut dialog */
   GtkWidget          *shortcut_editor;
@@ -219,6 +226,90 @@ reset_shortcut_cb (GtkWidget      *reset_button,
   cc_keyboard_manager_reset_shortcut (self->manager, item);
 }
 
+static void
+bind_row (RowData *data)
+{
+  CcKeyboardItem *item;
+
+  if (data->bound)
+    return;
+
+  data->bound = TRUE;
+  item = data->item;
+
+  cc_keyboard_item_ensure_loaded (item);
+
+  g_object_bind_property_full (item,
+                               "binding",
+                               data->accelerator_label,
+                               "label",
+                               G_BINDING_DEFAULT | G_BINDING_SYNC_CREATE,
+                               transform_binding_to_accel,
+                               NULL, NULL, NULL);
+
+  gtk_widget_set_child_visible (data->reset_button, !cc_keyboard_item_is_value_default (item));
+
+  g_signal_connect (item,
+                    "notify::is-value-default",
+                    G_CALLBACK (shortcut_modified_changed_cb),
+                    data->reset_button);
+}
+
+/*
+ * Reading the bindings is what makes showing a shortcut expensive, so it's
+ * only done for the rows that are scrolled into view.
+ */
+static gboolean
+bind_visible_rows (gpointer user_data)
+{
+  CcKeyboardPanel *self = user_data;
+  GtkAdjustment *adjustment;
+  GtkWidget *content;
+  GList *children, *l;
+  gdouble top, bottom;
+
+  self->bind_rows_id = 0;
+
+  adjustment = gtk_scrolled_window_get_vadjustment (GTK_SCROLLED_WINDOW (self->scrolled_window));
+  top = gtk_adjustment_get_value (adjustment);
+  bottom = top + gtk_adjustment_get_page_size (adjustment);
+
+  /* The child of the viewport, in which rows have scrolling coordinates */
+  content = gtk_bin_get_child (GTK_BIN (gtk_bin_get_child (GTK_BIN (self->scrolled_window))));
+
+  children = gtk_container_get_children (GTK_CONTAINER (self->listbox));
+
+  for (l = children; l != NULL; l = l->next)
+    {
+      GtkWidget *row = l->data;
+      RowData *data;
+      gint y;
+
+      data = g_object_get_data (G_OBJECT (row), "data");
+
+      if (!data || data->bound || !gtk_widget_get_child_visible (row))
+        continue;
+
+      /* Not allocated yet */
+      if (!gtk_widget_translate_coordinates (row, content, 0, 0, NULL, &y))
+        continue;
+
+      if (y + gtk_widget_get_allocated_height (row) >= top && y <= bottom)
+        bind_row (data);
+    }
+
+  g_list_free (children);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+queue_bind_visible_rows (CcKeyboardPanel *self)
+{
+  if (self->bind_rows_id == 0)
+    self->bind_rows_id = g_idle_add (bind_visible_rows, self);
+}
+
 static void
 add_item (CcKeyboardPanel *self,
           CcKeyboardItem  *item,
@@ -226,6 +317,7 @@ add_item (CcKeyboardPanel *self,
           const gchar     *section_title)
 {
   GtkWidget *row, *box, *label, *reset_button;
+  RowData *data;
 
   /* Horizontal box */
   box = g_object_new (GTK_TYPE_BOX,
@@ -252,21 +344,13 @@ add_item (CcKeyboardPanel *self,
 
   gtk_container_add (GTK_CONTAINER (box), label);
 
-  /* Shortcut accelerator */
+  /* Shortcut accelerator, set in bind_row() */
   label = gtk_label_new ("");
   gtk_label_set_xalign (GTK_LABEL (label), 0.0);
   gtk_label_set_use_markup (GTK_LABEL (label), TRUE);
 
   gtk_size_group_add_widget (self->accelerator_sizegroup, label);
 
-  g_object_bind_property_full (item,
-                               "binding",
-                               label,
-                              "label",
-                               G_BINDING_DEFAULT | G_BINDING_SYNC_CREATE,
-                               transform_binding_to_accel,
-                               NULL, NULL, NULL);
-
   gtk_container_add (GTK_CONTAINER (box), label);
 
   gtk_style_context_add_class (gtk_widget_get_style_context (label), "dim-label");
@@ -276,7 +360,7 @@ add_item (CcKeyboardPanel *self,
   gtk_widget_set_valign (reset_button, GTK_ALIGN_CENTER);
 
   gtk_button_set_relief (GTK_BUTTON (reset_button), GTK_RELIEF_NONE);
-  gtk_widget_set_child_visible (reset_button, !cc_keyboard_item_is_value_default (item));
+  gtk_widget_set_child_visible (reset_button, FALSE);
 
   gtk_widget_set_tooltip_text (reset_button, _("Reset the shortcut to its default value"));
 
@@ -286,11 +370,6 @@ add_item (CcKeyboardPanel *self,
   gtk_style_context_add_class (gtk_widget_get_style_context (reset_button), "circular");
   gtk_style_context_add_class (gtk_widget_get_style_context (reset_button), "reset-shortcut-button");
 
-  g_signal_connect (item,
-                    "notify::is-value-default",
-                    G_CALLBACK (shortcut_modified_changed_cb),
-                    reset_button);
-
   g_signal_connect (reset_button,
                     "clicked",
                     G_CALLBACK (reset_shortcut_cb),
@@ -302,12 +381,18 @@ add_item (CcKeyboardPanel *self,
 
   gtk_widget_show_all (row);
 
+  data = row_data_new (item, section_id, section_title);
+  data->accelerator_label = label;
+  data->reset_button = reset_button;
+
   g_object_set_data_full (G_OBJECT (row),
                           "data",
-                          row_data_new (item, section_id, section_title),
+                          data,
                           (GDestroyNotify) row_data_free);
 
   gtk_container_add (GTK_CONTAINER (self->listbox), row);
+
+  queue_bind_visible_rows (self);
 }
 
 static void
@@ -401,6 +486,8 @@ search_match_shortcut (CcKeyboardItem *item,
   gboolean match;
   guint i;
 
+  cc_keyboard_item_ensure_loaded (item);
+
   if (is_empty_binding (combo))
     return FALSE;
 
@@ -632,6 +719,12 @@ cc_keyboard_panel_finalize (GObject *object)
   g_clear_pointer (&self->pictures_regex, g_regex_unref);
   g_clear_object (&self->accelerator_sizegroup);
 
+  if (self->bind_rows_id != 0)
+    {
+      g_source_remove (self->bind_rows_id);
+      self->bind_rows_id = 0;
+    }
+
   cc_keyboard_option_clear_all ();
 
   if (self->search_bar_handler_id != 0)
@@ -684,6 +777,7 @@ cc_keyboard_panel_class_init (CcKeyboardPanelClass *klass)
   gtk_widget_class_bind_template_child (widget_class, CcKeyboardPanel, add_shortcut_row);
   gtk_widget_class_bind_template_child (widget_class, CcKeyboardPanel, empty_search_placeholder);
   gtk_widget_class_bind_template_child (widget_class, CcKeyboardPanel, listbox);
+  gtk_widget_class_bind_template_child (widget_class, CcKeyboardPanel, scrolled_window);
   gtk_widget_class_bind_template_child (widget_class, CcKeyboardPanel, search_bar);
   gtk_widget_class_bind_template_child (widget_class, CcKeyboardPanel, search_button);
   gtk_widget_class_bind_template_child (widget_class, CcKeyboardPanel, search_entry);
@@ -711,6 +805,17 @@ cc_keyboard_panel_init (CcKeyboardPanel *self)
 
   g_object_unref (provider);
 
+  /* Rows are bound as they're scrolled into view, or shown by a search */
+  g_signal_connect_swapped (gtk_scrolled_window_get_vadjustment (GTK_SCROLLED_WINDOW (self->scrolled_window)),
+                            "value-changed",
+                            G_CALLBACK (queue_bind_visible_rows),
+                            self);
+
+  g_signal_connect_swapped (self->listbox,
+                            "size-allocate",
+                            G_CALLBACK (queue_bind_visible_rows),
+                            self);
+
   /* Shortcut manager */
   self->manager = cc_keyboard_manager_new ();
 
@@ -581,6 +581,8 @@ setup_keyboard_item (CcKeyboardShortcutEditor *self,
   if (!item)
     return;
 
+  cc_keyboard_item_ensure_loaded (item);
+
   combo = item->primary_combo;
   is_custom = item->type == CC_KEYBOARD_ITEM_TYPE_GSETTINGS_PATH;
   accel = gtk_accelerator_name (combo->keyval, combo->mask);
@@ -0,0 +1,348 @@
+#include "config.h"
+
+#include <string.h>
+#include <glib/gstdio.h>
+#include <gtk/gtk.h>
+
+#include "cc-keyboard-manager.h"
+
+#define BINDINGS_SCHEMA "org.gnome.settings-daemon.plugins.media-keys"
+
+/* Run with "-m perf" to get the lookup timings */
+#define N_SHORTCUTS 3000
+#define N_LOOKUPS   100000
+
+static const gchar *modifiers[] = {
+  "<Control>", "<Alt>", "<Super>", "<Meta>", "<Mod3>", "<Mod5>", "<Shift>"
+};
+
+#define N_ACCELERATORS (26 << G_N_ELEMENTS (modifiers))
+
+/* Every accelerator is distinct, and <Hyper> keeps them clear of the
+ * default shortcuts.
+ */
+static gchar *
+get_accelerator (guint i)
+{
+  GString *accel;
+  guint j;
+
+  g_assert_cmpuint (i, <, N_ACCELERATORS);
+
+  accel = g_string_new ("<Hyper>");
+
+  for (j = 0; j < G_N_ELEMENTS (modifiers); j++)
+    if ((i / 26) & (1 << j))
+      g_string_append (accel, modifiers[j]);
+
+  g_string_append_c (accel, 'a' + i % 26);
+
+  return g_string_free (accel, FALSE);
+}
+
+static void
+get_combo (guint       i,
+           CcKeyCombo *combo)
+{
+  gchar *accel;
+  guint *keycodes;
+
+  accel = get_accelerator (i);
+  gtk_accelerator_parse_with_keycode (accel, &combo->keyval, &keycodes, &combo->mask);
+  combo->keycode = keycodes ? keycodes[0] : 0;
+
+  g_free (keycodes);
+  g_free (accel);
+}
+
+static void
+flush_main_context (void)
+{
+  while (g_main_context_iteration (NULL, FALSE))
+    ;
+}
+
+static CcKeyboardItem *
+add_custom_shortcut (CcKeyboardManager *manager,
+                     guint              i)
+{
+  CcKeyboardItem *item;
+  gchar *accel;
+  gchar *name;
+
+  accel = get_accelerator (i);
+  name = g_strdup_printf ("Shortcut %u", i);
+
+  item = cc_keyboard_manager_create_custom_shortcut (manager);
+  g_object_set (item,
+                "description", name,
+                "command", "true",
+                "binding", accel,
+                NULL);
+  cc_keyboard_manager_add_custom_shortcut (manager, item);
+
+  g_free (name);
+  g_free (accel);
+
+  return item;
+}
+
+static CcKeyboardManager *
+create_manager (guint       n_shortcuts,
+                GPtrArray **items)
+{
+  CcKeyboardManager *manager;
+  GSettings *settings;
+  guint i;
+
+  /* The memory backend keeps the custom shortcuts of the previous tests */
+  settings = g_settings_new (BINDINGS_SCHEMA);
+  g_settings_reset (settings, "custom-keybindings");
+  g_object_unref (settings);
+
+  manager = cc_keyboard_manager_new ();
+  cc_keyboard_manager_load_shortcuts (manager);
+
+  *items = g_ptr_array_new ();
+  for (i = 0; i < n_shortcuts; i++)
+    g_ptr_array_add (*items, add_custom_shortcut (manager, i));
+
+  flush_main_context ();
+
+  return manager;
+}
+
+static void
+test_collisions (void)
+{
+  CcKeyboardManager *manager;
+  GPtrArray *items;
+  CcKeyCombo combo;
+  guint i;
+
+  manager = create_manager (N_SHORTCUTS, &items);
+
+  for (i = 0; i < N_SHORTCUTS; i++)
+    {
+      CcKeyboardItem *item = g_ptr_array_index (items, i);
+
+      get_combo (i, &combo);
+      g_assert_true (cc_keyboard_manager_get_collision (manager, NULL, &combo) == item);
+
+      /* A shortcut does not collide with itself */
+      g_assert_null (cc_keyboard_manager_get_collision (manager, item, &combo));
+    }
+
+  get_combo (N_SHORTCUTS, &combo);
+  g_assert_null (cc_keyboard_manager_get_collision (manager, NULL, &combo));
+
+  /* Any number of shortcuts can be disabled */
+  memset (&combo, 0, sizeof (combo));
+  g_assert_null (cc_keyboard_manager_get_collision (manager, NULL, &combo));
+
+  g_ptr_array_unref (items);
+  g_object_unref (manager);
+}
+
+static void
+test_binding_changes (void)
+{
+  CcKeyboardManager *manager;
+  CcKeyboardItem *item;
+  GPtrArray *items;
+  CcKeyCombo old_combo;
+  CcKeyCombo new_combo;
+  gchar *accel;
+
+  manager = create_manager (3, &items);
+  item = g_ptr_array_index (items, 0);
+
+  /* Rebinding moves the shortcut in the index */
+  get_combo (0, &old_combo);
+  get_combo (3, &new_combo);
+
+  accel = get_accelerator (3);
+  g_object_set (item, "binding", accel, NULL);
+  flush_main_context ();
+  g_free (accel);
+
+  g_assert_null (cc_keyboard_manager_get_collision (manager, NULL, &old_combo));
+  g_assert_true (cc_keyboard_manager_get_collision (manager, NULL, &new_combo) == item);
+
+  /* Disabled shortcuts don't collide */
+  cc_keyboard_manager_disable_shortcut (manager, item);
+  flush_main_context ();
+
+  g_assert_null (cc_keyboard_manager_get_collision (manager, NULL, &new_combo));
+
+  /* Neither do removed ones */
+  item = g_ptr_array_index (items, 1);
+  get_combo (1, &old_combo);
+  g_assert_true (cc_keyboard_manager_get_collision (manager, NULL, &old_combo) == item);
+
+  cc_keyboard_manager_remove_custom_shortcut (manager, item);
+  flush_main_context ();
+
+  g_assert_null (cc_keyboard_manager_get_collision (manager, NULL, &old_combo));
+
+  /* Reloading rebuilds the index */
+  g_ptr_array_unref (items);
+  g_object_unref (manager);
+
+  manager = cc_keyboard_manager_new ();
+  cc_keyboard_manager_load_shortcuts (manager);
+
+  get_combo (2, &old_combo);
+  g_assert_nonnull (cc_keyboard_manager_get_collision (manager, NULL, &old_combo));
+  get_combo (1, &old_combo);
+  g_assert_null (cc_keyboard_manager_get_collision (manager, NULL, &old_combo));
+
+  g_object_unref (manager);
+}
+
+static void
+test_lookup_performance (void)
+{
+  CcKeyboardManager *manager;
+  GPtrArray *items;
+  CcKeyCombo *combos;
+  GTimer *timer;
+  gdouble load_time;
+  gdouble lookup_time;
+  guint n_found;
+  guint i;
+
+  if (!g_test_perf ())
+    return;
+
+  manager = create_manager (N_SHORTCUTS, &items);
+  g_ptr_array_unref (items);
+  g_object_unref (manager);
+
+  /* Load the shortcuts added above */
+  timer = g_timer_new ();
+  manager = cc_keyboard_manager_new ();
+  cc_keyboard_manager_load_shortcuts (manager);
+  load_time = g_timer_elapsed (timer, NULL);
+
+  /* The first N_SHORTCUTS combos collide, the other ones don't */
+  combos = g_new (CcKeyCombo, N_ACCELERATORS);
+  for (i = 0; i < N_ACCELERATORS; i++)
+    get_combo (i, &combos[i]);
+
+  n_found = 0;
+  g_timer_start (timer);
+
+  for (i = 0; i < N_LOOKUPS; i++)
+    if (cc_keyboard_manager_get_collision (manager, NULL, &combos[i % N_ACCELERATORS]))
+      n_found++;
+
+  lookup_time = g_timer_elapsed (timer, NULL);
+
+  g_assert_cmpuint (n_found, >, 0);
+
+  g_test_maximized_result (N_SHORTCUTS / load_time,
+                           "%u custom shortcuts loaded in %.1f ms",
+                           N_SHORTCUTS,
+                           load_time * 1000);
+  g_test_minimized_result (lookup_time * G_USEC_PER_SEC / N_LOOKUPS,
+                           "%u collision lookups: %.3f µs per lookup",
+                           N_LOOKUPS,
+                           lookup_time * G_USEC_PER_SEC / N_LOOKUPS);
+
+  g_timer_destroy (timer);
+  g_free (combos);
+  g_object_unref (manager);
+}
+
+/* Only the custom shortcuts are loaded: the system data directories are
+ * replaced by an empty one, but their GSettings schemas stay available.
+ */
+static gchar *
+isolate_data_dirs (void)
+{
+  const gchar *data_dirs;
+  GString *schema_dirs;
+  gchar **dirs;
+  gchar *empty_dir;
+  guint i;
+
+  data_dirs = g_getenv ("XDG_DATA_DIRS");
+  if (!data_dirs || !*data_dirs)
+    data_dirs = "/usr/local/share/" G_SEARCHPATH_SEPARATOR_S "/usr/share/";
+
+  schema_dirs = g_string_new (g_getenv ("GSETTINGS_SCHEMA_DIR"));
+
+  dirs = g_strsplit (data_dirs, G_SEARCHPATH_SEPARATOR_S, 0);
+  for (i = 0; dirs[i]; i++)
+    {
+      gchar *schema_dir;
+
+      schema_dir = g_build_filename (dirs[i], "glib-2.0", "schemas", NULL);
+      if (schema_dirs->len > 0)
+        g_string_append (schema_dirs, G_SEARCHPATH_SEPARATOR_S);
+      g_string_append (schema_dirs, schema_dir);
+      g_free (schema_dir);
+    }
+  g_strfreev (dirs);
+
+  empty_dir = g_dir_make_tmp ("test-shortcut-collisions-XXXXXX", NULL);
+  g_assert_nonnull (empty_dir);
+
+  g_setenv ("GSETTINGS_SCHEMA_DIR", schema_dirs->str, TRUE);
+  g_setenv ("XDG_DATA_DIRS", empty_dir, TRUE);
+
+  g_string_free (schema_dirs, TRUE);
+
+  return empty_dir;
+}
+
+int
+main (int argc, char **argv)
+{
+  GSettingsSchemaSource *source;
+  GSettingsSchema *schema = NULL;
+  gchar *empty_dir;
+  gchar *cache_dir;
+  gchar *cache_path;
+  int ret;
+
+  g_setenv ("GSETTINGS_BACKEND", "memory", TRUE);
+  empty_dir = isolate_data_dirs ();
+
+  /* Loading the shortcuts writes the keybindings cache */
+  cache_dir = g_dir_make_tmp ("test-shortcut-collisions-cache-XXXXXX", NULL);
+  g_assert_nonnull (cache_dir);
+  g_setenv ("XDG_CACHE_HOME", cache_dir, TRUE);
+
+  g_test_init (&argc, &argv, NULL);
+
+  source = g_settings_schema_source_get_default ();
+  if (source)
+    schema = g_settings_schema_source_lookup (source, BINDINGS_SCHEMA, TRUE);
+
+  /* Parsing the bindings needs a keymap */
+  if (schema && gtk_init_check (NULL, NULL))
+    {
+      g_test_add_func ("/keyboard/shortcut-collisions/collisions", test_collisions);
+      g_test_add_func ("/keyboard/shortcut-collisions/binding-changes", test_binding_changes);
+      g_test_add_func ("/keyboard/shortcut-collisions/lookup-performance", test_lookup_performance);
+    }
+
+  ret = g_test_run ();
+
+  g_clear_pointer (&schema, g_settings_schema_unref);
+  g_rmdir (empty_dir);
+  g_free (empty_dir);
+
+  cache_path = g_build_filename (cache_dir, "gnome-control-center", "keybindings.cache", NULL);
+  g_unlink (cache_path);
+  g_free (cache_path);
+  cache_path = g_build_filename (cache_dir, "gnome-control-center", NULL);
+  g_rmdir (cache_path);
+  g_free (cache_path);
+  g_rmdir (cache_dir);
+  g_free (cache_dir);
+
+  return ret;
+}
@@ -36,6 +36,7 @@
 
 #include "connection-editor/net-connection-editor.h"
 #include "net-device-wifi.h"
+#include "net-ssid-table.h"
 
 #define NET_DEVICE_WIFI_GET_PRIVATE(o) (G_TYPE_INSTANCE_GET_PRIVATE ((o), NET_TYPE_DEVICE_WIFI, NetDeviceWifiPrivate))
 
@@ -50,6 +51,8 @@ typedef enum {
 static void nm_device_wifi_refresh_ui (NetDeviceWifi *device_wifi);
 static void show_wifi_list (NetDeviceWifi *device_wifi);
 static void populate_ap_list (NetDeviceWifi *device_wifi);
+static void queue_populate_ap_list (NetDeviceWifi *device_wifi);
+static gboolean connection_is_shared (NMConnection *c);
 static void show_hotspot_ui (NetDeviceWifi *device_wifi);
 
 struct _NetDeviceWifiPrivate
@@ -61,10 +64,16 @@ struct _NetDeviceWifiPrivate
         gchar                   *selected_ssid_title;
         gchar                   *selected_connection_id;
         gchar                   *selected_ap_id;
+        GHashTable              *ap_rows;
+        guint                    populate_ap_list_id;
 };
 
 G_DEFINE_TYPE (NetDeviceWifi, net_device_wifi, NET_TYPE_DEVICE)
 
+/* Access points come and go in bursts while scanning, update the list
+ * once per burst */
+#define POPULATE_AP_LIST_DELAY 200 /* ms */
+
 enum {
         COLUMN_CONNECTION_ID,
         COLUMN_ACCESS_POINT_ID,
@@ -147,20 +156,18 @@ get_access_point_security (NMAccessPoint *ap)
         return type;
 }
 
-static GPtrArray *
+/* Returns a table of SSID keys to access points */
+static NetSsidTable *
 panel_get_strongest_unique_aps (const GPtrArray *aps)
 {
-        GBytes *ssid, *ssid_tmp;
-        GPtrArray *aps_unique = NULL;
-        gboolean add_ap;
-        guint i;
-        guint j;
+        NetSsidTable *aps_unique;
         NMAccessPoint *ap;
-        NMAccessPoint *ap_tmp;
+        GBytes *ssid;
+        guint i;
 
         /* we will have multiple entries for typical hotspots, just
          * filter to the one with the strongest signal */
-        aps_unique = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+        aps_unique = net_ssid_table_new ();
         if (aps != NULL)
                 for (i = 0; i < aps->len; i++) {
                         ap = NM_ACCESS_POINT (g_ptr_array_index (aps, i));
@@ -170,48 +177,43 @@ panel_get_strongest_unique_aps (const GPtrArray *aps)
                         if (!ssid)
                                 continue;
 
-                        add_ap = TRUE;
-
-                        /* get already added list */
-                        for (j=0; j<aps_unique->len; j++) {
-                                ap_tmp = NM_ACCESS_POINT (g_ptr_array_index (aps_unique, j));
-                                ssid_tmp = nm_access_point_get_ssid (ap_tmp);
-                                g_assert (ssid_tmp);
-
-                                /* is this the same type and data? */
-                                if (nm_utils_same_ssid (g_bytes_get_data (ssid, NULL), g_bytes_get_size (ssid),
-                                                        g_bytes_get_data (ssid_tmp, NULL), g_bytes_get_size (ssid_tmp),
-                                                        TRUE)) {
-
-                                        g_debug ("found duplicate: %s",
-                                                 nm_utils_escape_ssid (g_bytes_get_data (ssid_tmp, NULL),
-                                                                       g_bytes_get_size (ssid_tmp)));
-
-                                        /* the new access point is stronger */
-                                        if (nm_access_point_get_strength (ap) >
-                                            nm_access_point_get_strength (ap_tmp)) {
-                                                g_debug ("removing %s",
-                                                         nm_utils_escape_ssid (g_bytes_get_data (ssid_tmp, NULL),
-                                                                               g_bytes_get_size (ssid_tmp)));
-                                                g_ptr_array_remove (aps_unique, ap_tmp);
-                                                add_ap = TRUE;
-                                        } else {
-                                                add_ap = FALSE;
-                                        }
-
-                                        break;
-                                }
-                        }
-                        if (add_ap) {
-                                g_debug ("adding %s",
-                                         nm_utils_escape_ssid (g_bytes_get_data (ssid, NULL),
-                                                               g_bytes_get_size (ssid)));
-                                g_ptr_array_add (aps_unique, g_object_ref (ap));
-                        }
+                        net_ssid_table_add (aps_unique, ssid,
+                                            nm_access_point_get_strength (ap), ap);
                 }
         return aps_unique;
 }
 
+/* Returns a table of SSID keys to the first connection for the SSID */
+static NetSsidTable *
+get_connections_by_ssid (GSList *connections)
+{
+        NetSsidTable *table;
+        GSList *l;
+
+        table = net_ssid_table_new ();
+        for (l = connections; l; l = l->next) {
+                NMConnection *connection = l->data;
+                NMSettingWireless *sw;
+                GBytes *ssid;
+
+                if (connection_is_shared (connection))
+                        continue;
+
+                sw = nm_connection_get_setting_wireless (connection);
+                if (sw == NULL)
+                        continue;
+
+                ssid = nm_setting_wireless_get_ssid (sw);
+                if (ssid == NULL)
+                        continue;
+
+                /* all the same strength, so the first one is kept */
+                net_ssid_table_add (table, ssid, 0, connection);
+        }
+
+        return table;
+}
+
 static gchar *
 get_ap_security_string (NMAccessPoint *ap)
 {
@@ -260,7 +262,7 @@ net_device_wifi_access_point_changed (NMDeviceWifi *nm_device_wifi,
 
         device_wifi = NET_DEVICE_WIFI (user_data);
 
-        populate_ap_list (device_wifi);
+        queue_populate_ap_list (device_wifi);
 }
 
 static void
@@ -1433,7 +1435,7 @@ client_connection_added_cb (NMClient           *client,
                 return;
         }
 
-        populate_ap_list (device_wifi);
+        queue_populate_ap_list (device_wifi);
         show_wifi_list (device_wifi);
 }
 
@@ -1442,30 +1444,7 @@ client_connection_removed_cb (NMClient           *client,
                               NMRemoteConnection *connection,
                               NetDeviceWifi      *device_wifi)
 {
-        GtkWidget *list;
-        GList *rows, *l;
-        const char *uuid;
-
-        uuid = nm_connection_get_uuid (NM_CONNECTION (connection));
-
-        list = GTK_WIDGET (gtk_builder_get_object (device_wifi->priv->builder, "listbox"));
-        rows = gtk_container_get_children (GTK_CONTAINER (list));
-        for (l = rows; l != NULL; l = l->next) {
-                GtkWidget *row = l->data;
-                NMConnection *connection;
-                const char *uuid_r;
-
-                connection = g_object_get_data (G_OBJECT (row), "connection");
-                if (!connection)
-                        continue;
-
-                uuid_r = nm_connection_get_uuid (connection);
-                if (g_strcmp0 (uuid_r, uuid) == 0) {
-                        gtk_widget_destroy (row);
-                        break;
-                }
-        }
-        g_list_free (rows);
+        queue_populate_ap_list (device_wifi);
 }
 
 static void
@@ -1525,6 +1504,9 @@ net_device_wifi_finalize (GObject *object)
         NetDeviceWifi *device_wifi = NET_DEVICE_WIFI (object);
         NetDeviceWifiPrivate *priv = device_wifi->priv;
 
+        if (priv->populate_ap_list_id != 0)
+                g_source_remove (priv->populate_ap_list_id);
+        g_clear_pointer (&priv->ap_rows, g_hash_table_unref);
         g_clear_pointer (&priv->details_dialog, gtk_widget_destroy);
         g_object_unref (priv->builder);
         g_free (priv->selected_ssid_title);
@@ -1591,7 +1573,7 @@ really_forgotten (GObject            *source_object,
         }
 
         /* remove the entry from the list */
-        populate_ap_list (user_data);
+        queue_populate_ap_list (user_data);
 }
 
 static void
@@ -1680,46 +1662,30 @@ update_forget (GtkWidget *forget,
 }
 
 static void
-make_row (GtkSizeGroup   *rows,
-          GtkSizeGroup   *icons,
-          GtkWidget      *forget,
-          NMDevice       *device,
-          NMConnection   *connection,
-          NMAccessPoint  *ap,
-          NMAccessPoint  *active_ap,
-          GtkWidget     **row_out,
-          GtkWidget     **check_out,
-          GtkWidget     **edit_out)
+update_row (GtkWidget     *row,
+            NMDevice      *device,
+            NMConnection  *connection,
+            NMAccessPoint *ap,
+            NMAccessPoint *active_ap)
 {
-        GtkWidget *row, *row_box;
-        GtkWidget *widget;
-        GtkWidget *box;
         GtkWidget *button_stack;
-        GtkWidget *image;
-        gchar *title;
+        GtkWidget *widget;
         gboolean active;
         gboolean in_range;
         gboolean connecting;
         guint security;
         guint strength;
-        GBytes *ssid;
         const gchar *icon_name;
         guint64 timestamp;
         NMDeviceState state;
 
-        g_assert (connection || ap);
-
         state = nm_device_get_state (device);
 
         if (connection != NULL) {
-                NMSettingWireless *sw;
                 NMSettingConnection *sc;
-                sw = nm_connection_get_setting_wireless (connection);
-                ssid = nm_setting_wireless_get_ssid (sw);
                 sc = nm_connection_get_setting_connection (connection);
                 timestamp = nm_setting_connection_get_timestamp (sc);
         } else {
-                ssid = nm_access_point_get_ssid (ap);
                 timestamp = 0;
         }
 
@@ -1742,6 +1708,89 @@ make_row (GtkSizeGroup   *rows,
                 strength = 0;
         }
 
+        widget = g_object_get_data (G_OBJECT (row), "active_image");
+        gtk_widget_set_visible (widget, active);
+
+        button_stack = g_object_get_data (G_OBJECT (row), "button_stack");
+        gtk_widget_show (g_object_get_data (G_OBJECT (row), "edit"));
+        if (connecting)
+                gtk_stack_set_visible_child_name (GTK_STACK (button_stack), "spinner");
+        else if (connection)
+                gtk_stack_set_visible_child_name (GTK_STACK (button_stack), "button");
+        else
+                gtk_stack_set_visible_child_name (GTK_STACK (button_stack), "empty");
+
+        widget = g_object_get_data (G_OBJECT (row), "security_image");
+        if (in_range &&
+            security != NM_AP_SEC_UNKNOWN &&
+            security != NM_AP_SEC_NONE)
+                gtk_image_set_from_icon_name (GTK_IMAGE (widget), "network-wireless-encrypted-symbolic", GTK_ICON_SIZE_MENU);
+        else
+                gtk_image_clear (GTK_IMAGE (widget));
+
+        widget = g_object_get_data (G_OBJECT (row), "strength_image");
+        if (in_range) {
+                if (strength < 20)
+                        icon_name = "network-wireless-signal-none-symbolic";
+                else if (strength < 40)
+                        icon_name = "network-wireless-signal-weak-symbolic";
+                else if (strength < 50)
+                        icon_name = "network-wireless-signal-ok-symbolic";
+                else if (strength < 80)
+                        icon_name = "network-wireless-signal-good-symbolic";
+                else
+                        icon_name = "network-wireless-signal-excellent-symbolic";
+                gtk_image_set_from_icon_name (GTK_IMAGE (widget), icon_name, GTK_ICON_SIZE_MENU);
+        } else {
+                gtk_image_clear (GTK_IMAGE (widget));
+        }
+
+        g_object_set_data_full (G_OBJECT (row), "ap",
+                                ap ? g_object_ref (ap) : NULL,
+                                g_object_unref);
+        g_object_set_data_full (G_OBJECT (row), "connection",
+                                connection ? g_object_ref (connection) : NULL,
+                                g_object_unref);
+        g_object_set_data (G_OBJECT (row), "timestamp", GUINT_TO_POINTER (timestamp));
+        g_object_set_data (G_OBJECT (row), "active", GUINT_TO_POINTER (active));
+
+        /* the list is sorted by strength */
+        if (GPOINTER_TO_UINT (g_object_get_data (G_OBJECT (row), "strength")) != strength) {
+                g_object_set_data (G_OBJECT (row), "strength", GUINT_TO_POINTER (strength));
+                gtk_list_box_row_changed (GTK_LIST_BOX_ROW (row));
+        }
+}
+
+static void
+make_row (GtkSizeGroup   *rows,
+          GtkSizeGroup   *icons,
+          GtkWidget      *forget,
+          NMDevice       *device,
+          NMConnection   *connection,
+          NMAccessPoint  *ap,
+          NMAccessPoint  *active_ap,
+          GtkWidget     **row_out,
+          GtkWidget     **check_out,
+          GtkWidget     **edit_out)
+{
+        GtkWidget *row, *row_box;
+        GtkWidget *widget;
+        GtkWidget *box;
+        GtkWidget *button_stack;
+        GtkWidget *image;
+        gchar *title;
+        GBytes *ssid;
+
+        g_assert (connection || ap);
+
+        if (connection != NULL) {
+                NMSettingWireless *sw;
+                sw = nm_connection_get_setting_wireless (connection);
+                ssid = nm_setting_wireless_get_ssid (sw);
+        } else {
+                ssid = nm_access_point_get_ssid (ap);
+        }
+
         row = gtk_list_box_row_new ();
         gtk_size_group_add_widget (rows, row);
 
@@ -1751,11 +1800,9 @@ make_row (GtkSizeGroup   *rows,
         gtk_container_add (GTK_CONTAINER (row), row_box);
 
         button_stack = gtk_stack_new ();
-        gtk_widget_show (button_stack);
 
         widget = gtk_label_new ("");
-        gtk_widget_show (widget);
-        gtk_container_add (GTK_CONTAINER (button_stack), widget);
+        gtk_stack_add_named (GTK_STACK (button_stack), widget, "empty");
 
         widget = NULL;
         if (forget) {
@@ -1778,22 +1825,18 @@ make_row (GtkSizeGroup   *rows,
         gtk_widget_set_margin_bottom (widget, 12);
         gtk_box_pack_start (GTK_BOX (row_box), widget, FALSE, FALSE, 0);
 
-        if (active) {
-                widget = gtk_image_new_from_icon_name ("object-select-symbolic", GTK_ICON_SIZE_MENU);
-                gtk_widget_set_halign (widget, GTK_ALIGN_CENTER);
-                gtk_widget_set_valign (widget, GTK_ALIGN_CENTER);
-                gtk_box_pack_start (GTK_BOX (row_box), widget, FALSE, FALSE, 0);
-        }
+        widget = gtk_image_new_from_icon_name ("object-select-symbolic", GTK_ICON_SIZE_MENU);
+        gtk_widget_set_halign (widget, GTK_ALIGN_CENTER);
+        gtk_widget_set_valign (widget, GTK_ALIGN_CENTER);
+        gtk_box_pack_start (GTK_BOX (row_box), widget, FALSE, FALSE, 0);
+        g_object_set_data (G_OBJECT (row), "active_image", widget);
 
         gtk_box_pack_start (GTK_BOX (row_box), gtk_label_new (""), TRUE, FALSE, 0);
 
-        widget = NULL;
         image = gtk_image_new_from_icon_name ("emblem-system-symbolic", GTK_ICON_SIZE_MENU);
-        gtk_widget_show (image);
         widget = gtk_button_new ();
         gtk_style_context_add_class (gtk_widget_get_style_context (widget), "image-button");
         gtk_style_context_add_class (gtk_widget_get_style_context (widget), "circular");
-        gtk_widget_show (widget);
         gtk_container_add (GTK_CONTAINER (widget), image);
         gtk_widget_set_halign (widget, GTK_ALIGN_CENTER);
         gtk_widget_set_valign (widget, GTK_ALIGN_CENTER);
@@ -1801,9 +1844,6 @@ make_row (GtkSizeGroup   *rows,
         gtk_stack_add_named (GTK_STACK (button_stack), widget, "button");
         g_object_set_data (G_OBJECT (row), "edit", widget);
 
-        if (connection)
-                gtk_stack_set_visible_child_name (GTK_STACK (button_stack), "button");
-
         gtk_box_pack_start (GTK_BOX (row_box), button_stack, FALSE, FALSE, 0);
         g_object_set_data (G_OBJECT (row), "button_stack", button_stack);
 
@@ -1813,50 +1853,27 @@ make_row (GtkSizeGroup   *rows,
 
         widget = gtk_spinner_new ();
         gtk_spinner_start (GTK_SPINNER (widget));
-        gtk_widget_show (widget);
 
         gtk_widget_set_halign (widget, GTK_ALIGN_CENTER);
         gtk_widget_set_valign (widget, GTK_ALIGN_CENTER);
         gtk_stack_add_named (GTK_STACK (button_stack), widget, "spinner");
-        if (connecting)
-                gtk_stack_set_visible_child_name (GTK_STACK (button_stack), "spinner");
 
         box = gtk_box_new (GTK_ORIENTATION_HORIZONTAL, 6);
         gtk_box_set_homogeneous (GTK_BOX (box), TRUE);
         gtk_size_group_add_widget (icons, box);
         gtk_box_pack_start (GTK_BOX (row_box), box, FALSE, FALSE, 0);
 
-        if (in_range) {
-                if (security != NM_AP_SEC_UNKNOWN &&
-                    security != NM_AP_SEC_NONE) {
-                        widget = gtk_image_new_from_icon_name ("network-wireless-encrypted-symbolic", GTK_ICON_SIZE_MENU);
-                } else {
-                        widget = gtk_label_new ("");
-                }
-                gtk_box_pack_start (GTK_BOX (box), widget, FALSE, FALSE, 0);
+        widget = gtk_image_new ();
+        gtk_box_pack_start (GTK_BOX (box), widget, FALSE, FALSE, 0);
+        g_object_set_data (G_OBJECT (row), "security_image", widget);
 
-                if (strength < 20)
-                        icon_name = "network-wireless-signal-none-symbolic";
-                else if (strength < 40)
-                        icon_name = "network-wireless-signal-weak-symbolic";
-                else if (strength < 50)
-                        icon_name = "network-wireless-signal-ok-symbolic";
-                else if (strength < 80)
-                        icon_name = "network-wireless-signal-good-symbolic";
-                else
-                        icon_name = "network-wireless-signal-excellent-symbolic";
-                widget = gtk_image_new_from_icon_name (icon_name, GTK_ICON_SIZE_MENU);
-                gtk_box_pack_start (GTK_BOX (box), widget, FALSE, FALSE, 0);
-        }
+        widget = gtk_image_new ();
+        gtk_box_pack_start (GTK_BOX (box), widget, FALSE, FALSE, 0);
+        g_object_set_data (G_OBJECT (row), "strength_image", widget);
 
         gtk_widget_show_all (row);
 
-        g_object_set_data (G_OBJECT (row), "ap", ap);
-        if (connection)
-                g_object_set_data (G_OBJECT (row), "connection", connection);
-        g_object_set_data (G_OBJECT (row), "timestamp", GUINT_TO_POINTER (timestamp));
-        g_object_set_data (G_OBJECT (row), "active", GUINT_TO_POINTER (active));
-        g_object_set_data (G_OBJECT (row), "strength", GUINT_TO_POINTER (strength));
+        update_row (row, device, connection, ap, active_ap);
 
         *row_out = row;
 }
@@ -1935,9 +1952,8 @@ open_history (NetDeviceWifi *device_wifi)
         GSList *connections;
         GSList *l;
         const GPtrArray *aps;
-        GPtrArray *aps_unique = NULL;
+        NetSsidTable *aps_unique = NULL;
         NMAccessPoint *active_ap;
-        guint i;
         NMDevice *nm_device;
         GtkWidget *list;
         GtkWidget *row;
@@ -2025,15 +2041,12 @@ open_history (NetDeviceWifi *device_wifi)
 
                 setting = nm_connection_get_setting_by_name (connection, NM_SETTING_WIRELESS_SETTING_NAME);
                 ssid = nm_setting_wireless_get_ssid (NM_SETTING_WIRELESS (setting));
-                for (i = 0; i < aps_unique->len; i++) {
-                        GBytes *ssid_ap;
-                        ap = NM_ACCESS_POINT (g_ptr_array_index (aps_unique, i));
-                        ssid_ap = nm_access_point_get_ssid (ap);
-                        if (nm_utils_same_ssid (g_bytes_get_data (ssid, NULL), g_bytes_get_size (ssid),
-                                                g_bytes_get_data (ssid_ap, NULL), g_bytes_get_size (ssid_ap),
-                                                TRUE))
-                                break;
-                        ap = NULL;
+                if (ssid != NULL) {
+                        GBytes *key;
+
+                        key = net_ssid_key_new (ssid);
+                        ap = net_ssid_table_lookup (aps_unique, key);
+                        g_bytes_unref (key);
                 }
 
                 make_row (rows, icons, forget, nm_device, connection, ap, active_ap, &row, NULL, &button);
@@ -2045,35 +2058,51 @@ open_history (NetDeviceWifi *device_wifi)
                 }
         }
         g_slist_free (connections);
-        g_ptr_array_free (aps_unique, TRUE);
+        net_ssid_table_free (aps_unique);
 
         gtk_window_present (GTK_WINDOW (dialog));
 }
 
+static void
+ap_row_destroyed (GtkWidget     *row,
+                  NetDeviceWifi *device_wifi)
+{
+        GBytes *key;
+
+        key = g_object_get_data (G_OBJECT (row), "ssid_key");
+        if (g_hash_table_lookup (device_wifi->priv->ap_rows, key) == row)
+                g_hash_table_remove (device_wifi->priv->ap_rows, key);
+}
+
+/* Updates the rows of networks which are still in range in place, only
+ * networks which appeared or disappeared get a row added or removed */
 static void
 populate_ap_list (NetDeviceWifi *device_wifi)
 {
+        NetDeviceWifiPrivate *priv = device_wifi->priv;
         GtkWidget *list;
         GtkSizeGroup *rows;
         GtkSizeGroup *icons;
         NMDevice *nm_device;
         GSList *connections;
-        GSList *l;
         const GPtrArray *aps;
-        GPtrArray *aps_unique = NULL;
+        NetSsidTable *aps_unique;
+        NetSsidTable *connections_by_ssid;
+        GHashTableIter iter;
         NMAccessPoint *active_ap;
-        guint i;
+        NMAccessPoint *ap;
+        NMConnection *connection;
+        GBytes *key;
         GtkWidget *row;
         GtkWidget *button;
-        GList *children, *child;
-
-        list = GTK_WIDGET (gtk_builder_get_object (device_wifi->priv->builder, "listbox"));
+        GList *gone = NULL, *l;
 
-        children = gtk_container_get_children (GTK_CONTAINER (list));
-        for (child = children; child; child = child->next) {
-                gtk_container_remove (GTK_CONTAINER (list), GTK_WIDGET (child->data));
+        if (priv->populate_ap_list_id != 0) {
+                g_source_remove (priv->populate_ap_list_id);
+                priv->populate_ap_list_id = 0;
         }
-        g_list_free (children);
+
+        list = GTK_WIDGET (gtk_builder_get_object (priv->builder, "listbox"));
 
         rows = GTK_SIZE_GROUP (g_object_get_data (G_OBJECT (list), "rows"));
         icons = GTK_SIZE_GROUP (g_object_get_data (G_OBJECT (list), "icons"));
@@ -2081,35 +2110,34 @@ populate_ap_list (NetDeviceWifi *device_wifi)
         nm_device = net_device_get_nm_device (NET_DEVICE (device_wifi));
 
         connections = net_device_get_valid_connections (NET_DEVICE (device_wifi));
+        connections_by_ssid = get_connections_by_ssid (connections);
 
         aps = nm_device_wifi_get_access_points (NM_DEVICE_WIFI (nm_device));
         aps_unique = panel_get_strongest_unique_aps (aps);
         active_ap = nm_device_wifi_get_active_access_point (NM_DEVICE_WIFI (nm_device));
 
-        for (i = 0; i < aps_unique->len; i++) {
-                GBytes *ssid_ap;
-                NMAccessPoint *ap;
-                NMConnection *connection = NULL;
-                ap = NM_ACCESS_POINT (g_ptr_array_index (aps_unique, i));
-                ssid_ap = nm_access_point_get_ssid (ap);
-                for (l = connections; l; l = l->next) {
-                        connection = l->data;
-                        NMSetting *setting;
-                        GBytes *ssid;
+        g_hash_table_iter_init (&iter, priv->ap_rows);
+        while (g_hash_table_iter_next (&iter, (gpointer *) &key, (gpointer *) &row)) {
+                ap = net_ssid_table_lookup (aps_unique, key);
+                if (ap == NULL) {
+                        gone = g_list_prepend (gone, row);
+                        continue;
+                }
 
-                        if (connection_is_shared (connection)) {
-                                connection = NULL;
-                                continue;
-                        }
+                connection = net_ssid_table_lookup (connections_by_ssid, key);
+                update_row (row, nm_device, connection, ap, active_ap);
+        }
 
-                        setting = nm_connection_get_setting_by_name (connection, NM_SETTING_WIRELESS_SETTING_NAME);
-                        ssid = nm_setting_wireless_get_ssid (NM_SETTING_WIRELESS (setting));
-                        if (nm_utils_same_ssid (g_bytes_get_data (ssid, NULL), g_bytes_get_size (ssid),
-                                                g_bytes_get_data (ssid_ap, NULL), g_bytes_get_size (ssid_ap),
-                                                TRUE))
-                                break;
-                        connection = NULL;
-                }
+        for (l = gone; l; l = l->next)
+                gtk_widget_destroy (l->data);
+        g_list_free (gone);
+
+        net_ssid_table_iter_init (&iter, aps_unique);
+        while (net_ssid_table_iter_next (&iter, &key, (gpointer *) &ap)) {
+                if (g_hash_table_contains (priv->ap_rows, key))
+                        continue;
+
+                connection = net_ssid_table_lookup (connections_by_ssid, key);
 
                 make_row (rows, icons, NULL, nm_device, connection, ap, active_ap, &row, NULL, &button);
                 gtk_container_add (GTK_CONTAINER (list), row);
@@ -2118,10 +2146,42 @@ populate_ap_list (NetDeviceWifi *device_wifi)
                                           G_CALLBACK (show_details_for_row), device_wifi);
                         g_object_set_data (G_OBJECT (button), "row", row);
                 }
+
+                g_object_set_data_full (G_OBJECT (row), "ssid_key",
+                                        g_bytes_ref (key),
+                                        (GDestroyNotify) g_bytes_unref);
+                g_signal_connect_object (row, "destroy",
+                                         G_CALLBACK (ap_row_destroyed), device_wifi, 0);
+                g_hash_table_insert (priv->ap_rows, g_bytes_ref (key), row);
         }
 
         g_slist_free (connections);
-        g_ptr_array_free (aps_unique, TRUE);
+        net_ssid_table_free (connections_by_ssid);
+        net_ssid_table_free (aps_unique);
+}
+
+static gboolean
+populate_ap_list_timeout_cb (gpointer user_data)
+{
+        NetDeviceWifi *device_wifi = user_data;
+
+        device_wifi->priv->populate_ap_list_id = 0;
+        populate_ap_list (device_wifi);
+
+        return G_SOURCE_REMOVE;
+}
+
+static void
+queue_populate_ap_list (NetDeviceWifi *device_wifi)
+{
+        NetDeviceWifiPrivate *priv = device_wifi->priv;
+
+        if (priv->populate_ap_list_id != 0)
+                return;
+
+        priv->populate_ap_list_id = g_timeout_add (POPULATE_AP_LIST_DELAY,
+                                                   populate_ap_list_timeout_cb,
+                                                   device_wifi);
 }
 
 static void
@@ -2174,6 +2234,9 @@ net_device_wifi_init (NetDeviceWifi *device_wifi)
         GtkSizeGroup *icons;
 
         device_wifi->priv = NET_DEVICE_WIFI_GET_PRIVATE (device_wifi);
+        device_wifi->priv->ap_rows = g_hash_table_new_full (g_bytes_hash, g_bytes_equal,
+                                                            (GDestroyNotify) g_bytes_unref,
+                                                            NULL);
 
         device_wifi->priv->builder = gtk_builder_new ();
         gtk_builder_add_from_resource (device_wifi->priv->builder,
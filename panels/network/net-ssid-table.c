@@ -0,0 +1,148 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2017 The GNOME Foundation
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include "net-ssid-table.h"
+
+/*
+ * Maps SSIDs to the strongest access point, or the first connection,
+ * seen for them. The values are not referenced, they have to outlive
+ * the table.
+ */
+struct _NetSsidTable {
+        GHashTable *entries;
+};
+
+typedef struct {
+        gpointer value;
+        guint8   strength;
+} Entry;
+
+static void
+entry_free (Entry *entry)
+{
+        g_slice_free (Entry, entry);
+}
+
+/* SSIDs which only differ by a trailing NUL byte are the same network,
+ * like for nm_utils_same_ssid() */
+GBytes *
+net_ssid_key_new (GBytes *ssid)
+{
+        const guint8 *data;
+        gsize len;
+
+        data = g_bytes_get_data (ssid, &len);
+        if (len > 0 && data[len - 1] == '\0')
+                return g_bytes_new_from_bytes (ssid, 0, len - 1);
+
+        return g_bytes_ref (ssid);
+}
+
+NetSsidTable *
+net_ssid_table_new (void)
+{
+        NetSsidTable *table;
+
+        table = g_new0 (NetSsidTable, 1);
+        table->entries = g_hash_table_new_full (g_bytes_hash, g_bytes_equal,
+                                                (GDestroyNotify) g_bytes_unref,
+                                                (GDestroyNotify) entry_free);
+
+        return table;
+}
+
+void
+net_ssid_table_free (NetSsidTable *table)
+{
+        g_hash_table_unref (table->entries);
+        g_free (table);
+}
+
+/* Adds @value for @ssid, unless the table already has a value at least
+ * as strong for it. Returns whether @value was added. */
+gboolean
+net_ssid_table_add (NetSsidTable *table,
+                    GBytes       *ssid,
+                    guint8        strength,
+                    gpointer      value)
+{
+        Entry *entry;
+        GBytes *key;
+
+        key = net_ssid_key_new (ssid);
+        entry = g_hash_table_lookup (table->entries, key);
+        if (entry != NULL) {
+                g_bytes_unref (key);
+                if (strength <= entry->strength)
+                        return FALSE;
+        } else {
+                entry = g_slice_new (Entry);
+                g_hash_table_insert (table->entries, key, entry);
+        }
+
+        entry->value = value;
+        entry->strength = strength;
+
+        return TRUE;
+}
+
+/* @key comes from net_ssid_key_new() */
+gpointer
+net_ssid_table_lookup (NetSsidTable *table,
+                       GBytes       *key)
+{
+        Entry *entry;
+
+        entry = g_hash_table_lookup (table->entries, key);
+
+        return entry != NULL ? entry->value : NULL;
+}
+
+guint
+net_ssid_table_size (NetSsidTable *table)
+{
+        return g_hash_table_size (table->entries);
+}
+
+void
+net_ssid_table_iter_init (GHashTableIter *iter,
+                          NetSsidTable   *table)
+{
+        g_hash_table_iter_init (iter, table->entries);
+}
+
+gboolean
+net_ssid_table_iter_next (GHashTableIter  *iter,
+                          GBytes         **key,
+                          gpointer        *value)
+{
+        Entry *entry;
+
+        if (!g_hash_table_iter_next (iter, (gpointer *) key, (gpointer *) &entry))
+                return FALSE;
+
+        if (value != NULL)
+                *value = entry->value;
+
+        return TRUE;
+}
@@ -0,0 +1,52 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2017 The GNOME Foundation
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __NET_SSID_TABLE_H
+#define __NET_SSID_TABLE_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _NetSsidTable NetSsidTable;
+
+GBytes          *net_ssid_key_new               (GBytes          *ssid);
+
+NetSsidTable    *net_ssid_table_new             (void);
+void             net_ssid_table_free            (NetSsidTable    *table);
+
+gboolean         net_ssid_table_add             (NetSsidTable    *table,
+                                                 GBytes          *ssid,
+                                                 guint8           strength,
+                                                 gpointer         value);
+gpointer         net_ssid_table_lookup          (NetSsidTable    *table,
+                                                 GBytes          *key);
+guint            net_ssid_table_size            (NetSsidTable    *table);
+
+void             net_ssid_table_iter_init       (GHashTableIter  *iter,
+                                                 NetSsidTable    *table);
+gboolean         net_ssid_table_iter_next       (GHashTableIter  *iter,
+                                                 GBytes         **key,
+                                                 gpointer        *value);
+
+G_END_DECLS
+
+#endif /* __NET_SSID_TABLE_H */
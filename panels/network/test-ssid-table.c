@@ -0,0 +1,311 @@
+#include "config.h"
+
+#include <string.h>
+#include <NetworkManager.h>
+
+#include "net-ssid-table.h"
+
+/* Run with "-m perf" to compare the timings with the previous way of
+ * finding the unique networks */
+#define N_NETWORKS 60
+#define N_BSSIDS 200
+#define N_CONNECTIONS 40
+#define N_BENCHMARK_RUNS 200
+
+typedef struct {
+        GBytes *ssid;
+        guint8  strength;
+} Bss;
+
+static gboolean
+same_ssid (GBytes *ssid1,
+           GBytes *ssid2)
+{
+        return nm_utils_same_ssid (g_bytes_get_data (ssid1, NULL), g_bytes_get_size (ssid1),
+                                   g_bytes_get_data (ssid2, NULL), g_bytes_get_size (ssid2),
+                                   TRUE);
+}
+
+/* How the strongest access point of every network was found before
+ * NetSsidTable, returns the indexes of the BSSes */
+static GArray *
+find_reference_unique (Bss   *bsses,
+                       guint  n_bsses)
+{
+        GArray *unique;
+        guint i, j;
+
+        unique = g_array_new (FALSE, FALSE, sizeof (guint));
+        for (i = 0; i < n_bsses; i++) {
+                gboolean add = TRUE;
+
+                for (j = 0; j < unique->len; j++) {
+                        Bss *tmp = &bsses[g_array_index (unique, guint, j)];
+
+                        if (same_ssid (bsses[i].ssid, tmp->ssid)) {
+                                if (bsses[i].strength > tmp->strength)
+                                        g_array_remove_index (unique, j);
+                                else
+                                        add = FALSE;
+                                break;
+                        }
+                }
+
+                if (add)
+                        g_array_append_val (unique, i);
+        }
+
+        return unique;
+}
+
+/* and the connection of each of them */
+static gint
+find_reference_connection (GBytes **connections,
+                           guint    n_connections,
+                           GBytes  *ssid)
+{
+        guint i;
+
+        for (i = 0; i < n_connections; i++) {
+                if (same_ssid (connections[i], ssid))
+                        return i;
+        }
+
+        return -1;
+}
+
+/* SSIDs of up to 32 bytes, some of them with a trailing NUL byte as
+ * sent by some access points */
+static GBytes *
+create_ssid (GRand *rand,
+             guint  network)
+{
+        gchar *name;
+        GBytes *ssid;
+        gsize len;
+
+        name = g_strdup_printf ("network-%u-%08x", network, network * 2654435761u);
+        len = strlen (name);
+        if (g_rand_boolean (rand))
+                len++;
+        ssid = g_bytes_new (name, len);
+        g_free (name);
+
+        return ssid;
+}
+
+static Bss *
+create_bsses (GRand *rand)
+{
+        Bss *bsses;
+        guint i;
+
+        bsses = g_new (Bss, N_BSSIDS);
+        for (i = 0; i < N_BSSIDS; i++) {
+                bsses[i].ssid = create_ssid (rand, g_rand_int_range (rand, 0, N_NETWORKS));
+                bsses[i].strength = g_rand_int_range (rand, 0, 101);
+        }
+
+        return bsses;
+}
+
+/* Connections for half of the networks, some of them twice */
+static GBytes **
+create_connections (GRand *rand)
+{
+        GBytes **connections;
+        guint i;
+
+        connections = g_new (GBytes *, N_CONNECTIONS);
+        for (i = 0; i < N_CONNECTIONS; i++)
+                connections[i] = create_ssid (rand, g_rand_int_range (rand, 0, N_NETWORKS / 2));
+
+        return connections;
+}
+
+static void
+free_data (Bss     *bsses,
+           GBytes **connections)
+{
+        guint i;
+
+        for (i = 0; i < N_BSSIDS; i++)
+                g_bytes_unref (bsses[i].ssid);
+        for (i = 0; i < N_CONNECTIONS; i++)
+                g_bytes_unref (connections[i]);
+        g_free (bsses);
+        g_free (connections);
+}
+
+static NetSsidTable *
+create_aps_table (Bss *bsses)
+{
+        NetSsidTable *table;
+        guint i;
+
+        table = net_ssid_table_new ();
+        for (i = 0; i < N_BSSIDS; i++)
+                net_ssid_table_add (table, bsses[i].ssid, bsses[i].strength, &bsses[i]);
+
+        return table;
+}
+
+static NetSsidTable *
+create_connections_table (GBytes **connections)
+{
+        NetSsidTable *table;
+        guint i;
+
+        table = net_ssid_table_new ();
+        for (i = 0; i < N_CONNECTIONS; i++)
+                net_ssid_table_add (table, connections[i], 0, GUINT_TO_POINTER (i + 1));
+
+        return table;
+}
+
+static void
+test_key (void)
+{
+        GBytes *ssid;
+        GBytes *key;
+        GBytes *other;
+
+        ssid = g_bytes_new_static ("home\0", 5);
+        key = net_ssid_key_new (ssid);
+        g_assert_cmpuint (g_bytes_get_size (key), ==, 4);
+
+        other = g_bytes_new_static ("home", 4);
+        g_assert_true (g_bytes_equal (key, other));
+        g_bytes_unref (key);
+
+        key = net_ssid_key_new (other);
+        g_assert_true (key == other);
+
+        g_bytes_unref (key);
+        g_bytes_unref (other);
+        g_bytes_unref (ssid);
+}
+
+static void
+test_unique (void)
+{
+        NetSsidTable *aps;
+        NetSsidTable *connections_table;
+        GBytes **connections;
+        GArray *unique;
+        GRand *rand;
+        Bss *bsses;
+        guint i;
+
+        rand = g_rand_new_with_seed (42);
+        bsses = create_bsses (rand);
+        connections = create_connections (rand);
+
+        aps = create_aps_table (bsses);
+        connections_table = create_connections_table (connections);
+
+        /* The same access points and connections as with nm_utils_same_ssid() */
+        unique = find_reference_unique (bsses, N_BSSIDS);
+        g_assert_cmpuint (net_ssid_table_size (aps), ==, unique->len);
+
+        for (i = 0; i < unique->len; i++) {
+                Bss *bss = &bsses[g_array_index (unique, guint, i)];
+                GBytes *key;
+                gint connection;
+
+                key = net_ssid_key_new (bss->ssid);
+                g_assert_true (net_ssid_table_lookup (aps, key) == bss);
+
+                connection = find_reference_connection (connections, N_CONNECTIONS, bss->ssid);
+                g_assert_cmpuint (GPOINTER_TO_UINT (net_ssid_table_lookup (connections_table, key)), ==, connection + 1);
+
+                g_bytes_unref (key);
+        }
+
+        g_array_unref (unique);
+        net_ssid_table_free (connections_table);
+        net_ssid_table_free (aps);
+        free_data (bsses, connections);
+        g_rand_free (rand);
+}
+
+static void
+test_benchmark (void)
+{
+        GBytes **connections;
+        GTimer *timer;
+        GRand *rand;
+        Bss *bsses;
+        gdouble reference_time;
+        gdouble table_time;
+        guint n_found = 0;
+        guint i, j;
+
+        if (!g_test_perf ())
+                return;
+
+        rand = g_rand_new_with_seed (42);
+        bsses = create_bsses (rand);
+        connections = create_connections (rand);
+
+        timer = g_timer_new ();
+        for (i = 0; i < N_BENCHMARK_RUNS; i++) {
+                GArray *unique;
+
+                unique = find_reference_unique (bsses, N_BSSIDS);
+                for (j = 0; j < unique->len; j++) {
+                        Bss *bss = &bsses[g_array_index (unique, guint, j)];
+
+                        if (find_reference_connection (connections, N_CONNECTIONS, bss->ssid) >= 0)
+                                n_found++;
+                }
+                g_array_unref (unique);
+        }
+        reference_time = g_timer_elapsed (timer, NULL);
+
+        g_timer_start (timer);
+        for (i = 0; i < N_BENCHMARK_RUNS; i++) {
+                NetSsidTable *aps;
+                NetSsidTable *connections_table;
+                GHashTableIter iter;
+                GBytes *key;
+
+                aps = create_aps_table (bsses);
+                connections_table = create_connections_table (connections);
+
+                net_ssid_table_iter_init (&iter, aps);
+                while (net_ssid_table_iter_next (&iter, &key, NULL)) {
+                        if (net_ssid_table_lookup (connections_table, key) != NULL)
+                                n_found--;
+                }
+
+                net_ssid_table_free (connections_table);
+                net_ssid_table_free (aps);
+        }
+        table_time = g_timer_elapsed (timer, NULL);
+
+        g_assert_cmpuint (n_found, ==, 0);
+
+        g_test_minimized_result (reference_time * 1000 / N_BENCHMARK_RUNS,
+                                 "nm_utils_same_ssid() scans: %.3f ms for %d BSSIDs and %d connections",
+                                 reference_time * 1000 / N_BENCHMARK_RUNS, N_BSSIDS, N_CONNECTIONS);
+        g_test_minimized_result (table_time * 1000 / N_BENCHMARK_RUNS,
+                                 "NetSsidTable: %.3f ms for %d BSSIDs and %d connections",
+                                 table_time * 1000 / N_BENCHMARK_RUNS, N_BSSIDS, N_CONNECTIONS);
+
+        g_timer_destroy (timer);
+        free_data (bsses, connections);
+        g_rand_free (rand);
+}
+
+int
+main (int argc, char **argv)
+{
+        g_test_init (&argc, &argv, NULL);
+
+        g_test_add_func ("/network/ssid-table/key", test_key);
+        g_test_add_func ("/network/ssid-table/unique", test_unique);
+        g_test_add_func ("/network/ssid-table/benchmark", test_benchmark);
+
+        return g_test_run ();
+}
@@ -0,0 +1,370 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+/*
+ * Copyright (C) 2012 Giovanni Campagna <scampa.giovanni@gmail.com>
+ * Copyright (C) 2017 The GNOME Foundation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <gio/gdesktopappinfo.h>
+
+#include "cc-app-registry.h"
+#include "cc-notifications-app.h"
+
+/* Applications are taken from the #CcAppRegistry, which parses the
+ * desktop files in a thread, and handed out in batches of
+ * APPS_BATCH_SIZE, one per main loop iteration, rather than with one
+ * idle per application. Their per-application GSettings are only
+ * created when something needs them, e.g. when their row is shown or
+ * their dialog opened.
+ */
+#define APPS_BATCH_SIZE 64
+
+struct _CcNotificationsApp
+{
+  GObject    parent_instance;
+
+  GAppInfo  *app_info;
+  char      *canonical_app_id;
+  char      *sort_key;
+  GSettings *settings;
+};
+
+G_DEFINE_TYPE (CcNotificationsApp, cc_notifications_app, G_TYPE_OBJECT)
+
+static void
+cc_notifications_app_finalize (GObject *object)
+{
+  CcNotificationsApp *app = CC_NOTIFICATIONS_APP (object);
+
+  g_clear_object (&app->app_info);
+  g_clear_object (&app->settings);
+  g_free (app->canonical_app_id);
+  g_free (app->sort_key);
+
+  G_OBJECT_CLASS (cc_notifications_app_parent_class)->finalize (object);
+}
+
+static void
+cc_notifications_app_class_init (CcNotificationsAppClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->finalize = cc_notifications_app_finalize;
+}
+
+static void
+cc_notifications_app_init (CcNotificationsApp *app)
+{
+}
+
+/**
+ * cc_notifications_app_new:
+ * @app_info: the application
+ * @canonical_app_id: the id of the application in the notifications settings
+ * @settings: (allow-none): the settings of the application, if already known
+ *
+ * Can be called from any thread when @settings is %NULL.
+ **/
+CcNotificationsApp *
+cc_notifications_app_new (GAppInfo   *app_info,
+                          const char *canonical_app_id,
+                          GSettings  *settings)
+{
+  CcNotificationsApp *app;
+  const char *name;
+
+  g_return_val_if_fail (G_IS_APP_INFO (app_info), NULL);
+  g_return_val_if_fail (canonical_app_id != NULL, NULL);
+
+  app = g_object_new (CC_TYPE_NOTIFICATIONS_APP, NULL);
+  app->app_info = g_object_ref (app_info);
+  app->canonical_app_id = g_strdup (canonical_app_id);
+  if (settings != NULL)
+    app->settings = g_object_ref (settings);
+
+  name = g_app_info_get_name (app_info);
+  app->sort_key = g_utf8_collate_key (name != NULL ? name : "", -1);
+
+  return app;
+}
+
+GAppInfo *
+cc_notifications_app_get_app_info (CcNotificationsApp *app)
+{
+  g_return_val_if_fail (CC_IS_NOTIFICATIONS_APP (app), NULL);
+
+  return app->app_info;
+}
+
+const char *
+cc_notifications_app_get_canonical_app_id (CcNotificationsApp *app)
+{
+  g_return_val_if_fail (CC_IS_NOTIFICATIONS_APP (app), NULL);
+
+  return app->canonical_app_id;
+}
+
+/**
+ * cc_notifications_app_get_settings:
+ *
+ * Returns the notification settings of the application, which are
+ * created on the first call.
+ *
+ * Return value: (transfer none): a #GSettings
+ **/
+GSettings *
+cc_notifications_app_get_settings (CcNotificationsApp *app)
+{
+  g_return_val_if_fail (CC_IS_NOTIFICATIONS_APP (app), NULL);
+
+  if (app->settings == NULL)
+    {
+      char *path;
+
+      path = g_strconcat (APP_PREFIX, app->canonical_app_id, "/", NULL);
+      app->settings = g_settings_new_with_path (APP_SCHEMA, path);
+      g_free (path);
+    }
+
+  return app->settings;
+}
+
+gboolean
+cc_notifications_app_has_settings (CcNotificationsApp *app)
+{
+  g_return_val_if_fail (CC_IS_NOTIFICATIONS_APP (app), FALSE);
+
+  return app->settings != NULL;
+}
+
+/* Sorts applications by name, as a #GCompareDataFunc */
+int
+cc_notifications_app_compare (gconstpointer a,
+                              gconstpointer b,
+                              gpointer      user_data)
+{
+  const CcNotificationsApp *app_a = a;
+  const CcNotificationsApp *app_b = b;
+
+  return strcmp (app_a->sort_key, app_b->sort_key);
+}
+
+static char *
+app_info_get_id (GAppInfo *app_info)
+{
+  const char *desktop_id;
+  char *ret;
+  const char *filename;
+  int l;
+
+  desktop_id = g_app_info_get_id (app_info);
+  if (desktop_id != NULL)
+    {
+      ret = g_strdup (desktop_id);
+    }
+  else
+    {
+      filename = g_desktop_app_info_get_filename (G_DESKTOP_APP_INFO (app_info));
+      ret = g_path_get_basename (filename);
+    }
+
+  if (G_UNLIKELY (g_str_has_suffix (ret, ".desktop") == FALSE))
+    {
+      g_free (ret);
+      return NULL;
+    }
+
+  l = strlen (ret);
+  *(ret + l - strlen(".desktop")) = '\0';
+  return ret;
+}
+
+/**
+ * cc_notifications_app_info_get_canonical_id:
+ *
+ * Returns the id of @app_info in the notifications settings, derived
+ * from its desktop id.
+ *
+ * Return value: (transfer full) (nullable): the id
+ **/
+char *
+cc_notifications_app_info_get_canonical_id (GAppInfo *app_info)
+{
+  char *canonical_app_id;
+  guint i;
+
+  canonical_app_id = app_info_get_id (app_info);
+  if (canonical_app_id == NULL)
+    return NULL;
+
+  g_strcanon (canonical_app_id,
+              "0123456789"
+              "abcdefghijklmnopqrstuvwxyz"
+              "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+              "-",
+              '-');
+  for (i = 0; canonical_app_id[i] != '\0'; i++)
+    canonical_app_id[i] = g_ascii_tolower (canonical_app_id[i]);
+
+  return canonical_app_id;
+}
+
+/**
+ * cc_notifications_app_new_for_app_info:
+ *
+ * Return value: (nullable): the application, or %NULL if it cannot be
+ * shown in the panel
+ **/
+CcNotificationsApp *
+cc_notifications_app_new_for_app_info (GAppInfo *app_info)
+{
+  CcNotificationsApp *app;
+  const char *app_name;
+  char *canonical_app_id;
+
+  app_name = g_app_info_get_name (app_info);
+  if (app_name == NULL || *app_name == '\0')
+    return NULL;
+
+  canonical_app_id = cc_notifications_app_info_get_canonical_id (app_info);
+  if (canonical_app_id == NULL)
+    return NULL;
+
+  app = cc_notifications_app_new (app_info, canonical_app_id, NULL);
+  g_free (canonical_app_id);
+
+  return app;
+}
+
+typedef struct {
+  CcNotificationsAppsFunc apps_func;
+  gpointer apps_data;
+  GPtrArray *app_infos;
+  guint next;
+} LoadData;
+
+static void
+load_data_free (LoadData *data)
+{
+  g_clear_pointer (&data->app_infos, g_ptr_array_unref);
+  g_free (data);
+}
+
+static gboolean
+load_batch (gpointer user_data)
+{
+  GTask *task = G_TASK (user_data);
+  LoadData *data = g_task_get_task_data (task);
+  GPtrArray *batch;
+
+  if (g_task_return_error_if_cancelled (task))
+    return G_SOURCE_REMOVE;
+
+  batch = g_ptr_array_new_with_free_func (g_object_unref);
+  while (data->next < data->app_infos->len && batch->len < APPS_BATCH_SIZE)
+    {
+      GAppInfo *app_info = g_ptr_array_index (data->app_infos, data->next++);
+      CcNotificationsApp *app;
+
+      app = cc_notifications_app_new_for_app_info (app_info);
+      if (app != NULL)
+        g_ptr_array_add (batch, app);
+    }
+
+  if (batch->len > 0)
+    data->apps_func (batch, data->apps_data);
+  g_ptr_array_unref (batch);
+
+  if (data->next < data->app_infos->len)
+    return G_SOURCE_CONTINUE;
+
+  g_task_return_boolean (task, TRUE);
+  return G_SOURCE_REMOVE;
+}
+
+static void
+registry_loaded_cb (GObject      *source_object,
+                    GAsyncResult *res,
+                    gpointer      user_data)
+{
+  CcAppRegistry *registry = CC_APP_REGISTRY (source_object);
+  GTask *task = G_TASK (user_data);
+  LoadData *data = g_task_get_task_data (task);
+  GError *error = NULL;
+  GSource *source;
+
+  if (!cc_app_registry_load_finish (registry, res, &error))
+    {
+      g_task_return_error (task, error);
+      g_object_unref (task);
+      return;
+    }
+
+  data->app_infos = cc_app_registry_list_with_key (registry, NOTIFICATIONS_KEY);
+
+  source = g_idle_source_new ();
+  g_source_set_priority (source, G_PRIORITY_DEFAULT_IDLE);
+  g_source_set_callback (source, load_batch, task, g_object_unref);
+  g_source_attach (source, g_task_get_context (task));
+  g_source_unref (source);
+}
+
+/**
+ * cc_notifications_apps_load_async:
+ * @apps_func: called with each batch of applications
+ *
+ * Finds the installed applications that use notifications, through the
+ * #CcAppRegistry. @apps_func is called on the thread-default main
+ * context with batches of them, unsorted, one batch per main loop
+ * iteration, before @callback.
+ **/
+void
+cc_notifications_apps_load_async (CcNotificationsAppsFunc apps_func,
+                                  gpointer                apps_data,
+                                  GCancellable           *cancellable,
+                                  GAsyncReadyCallback     callback,
+                                  gpointer                user_data)
+{
+  LoadData *data;
+  GTask *task;
+
+  g_return_if_fail (apps_func != NULL);
+
+  data = g_new0 (LoadData, 1);
+  data->apps_func = apps_func;
+  data->apps_data = apps_data;
+
+  task = g_task_new (NULL, cancellable, callback, user_data);
+  g_task_set_source_tag (task, cc_notifications_apps_load_async);
+  g_task_set_task_data (task, data, (GDestroyNotify) load_data_free);
+
+  cc_app_registry_load_async (cc_app_registry_get_default (),
+                              cancellable,
+                              registry_loaded_cb,
+                              task);
+}
+
+gboolean
+cc_notifications_apps_load_finish (GAsyncResult  *res,
+                                   GError       **error)
+{
+  g_return_val_if_fail (g_task_is_valid (res, NULL), FALSE);
+
+  return g_task_propagate_boolean (G_TASK (res), error);
+}
@@ -0,0 +1,64 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+/*
+ * Copyright (C) 2017 The GNOME Foundation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef _CC_NOTIFICATIONS_APP_H_
+#define _CC_NOTIFICATIONS_APP_H_
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+#define MASTER_SCHEMA "org.gnome.desktop.notifications"
+#define APP_SCHEMA MASTER_SCHEMA ".application"
+#define APP_PREFIX "/org/gnome/desktop/notifications/application/"
+
+/* The desktop file key of applications that use notifications */
+#define NOTIFICATIONS_KEY "X-GNOME-UsesNotifications"
+
+#define CC_TYPE_NOTIFICATIONS_APP (cc_notifications_app_get_type ())
+G_DECLARE_FINAL_TYPE (CcNotificationsApp, cc_notifications_app, CC, NOTIFICATIONS_APP, GObject)
+
+/* Called on the main context with a batch of loaded applications */
+typedef void (*CcNotificationsAppsFunc) (GPtrArray *apps,
+                                         gpointer   user_data);
+
+CcNotificationsApp *cc_notifications_app_new                  (GAppInfo            *app_info,
+                                                               const char          *canonical_app_id,
+                                                               GSettings           *settings);
+CcNotificationsApp *cc_notifications_app_new_for_app_info     (GAppInfo            *app_info);
+GAppInfo           *cc_notifications_app_get_app_info         (CcNotificationsApp  *app);
+const char         *cc_notifications_app_get_canonical_app_id (CcNotificationsApp  *app);
+GSettings          *cc_notifications_app_get_settings         (CcNotificationsApp  *app);
+gboolean            cc_notifications_app_has_settings         (CcNotificationsApp  *app);
+int                 cc_notifications_app_compare              (gconstpointer        a,
+                                                               gconstpointer        b,
+                                                               gpointer             user_data);
+char               *cc_notifications_app_info_get_canonical_id (GAppInfo           *app_info);
+
+void                cc_notifications_apps_load_async          (CcNotificationsAppsFunc apps_func,
+                                                               gpointer             apps_data,
+                                                               GCancellable        *cancellable,
+                                                               GAsyncReadyCallback  callback,
+                                                               gpointer             user_data);
+gboolean            cc_notifications_apps_load_finish         (GAsyncResult        *res,
+                                                               GError             **error);
+
+G_END_DECLS
+
+#endif /* _CC_NOTIFICATIONS_APP_H_ */
@@ -29,10 +29,8 @@
 #include "cc-notifications-panel.h"
 #include "cc-notifications-resources.h"
 #include "cc-edit-dialog.h"
-
-#define MASTER_SCHEMA "org.gnome.desktop.notifications"
-#define APP_SCHEMA MASTER_SCHEMA ".application"
-#define APP_PREFIX "/org/gnome/desktop/notifications/application/"
+#include "cc-notifications-app.h"
+#include "cc-app-registry.h"
 
 struct _CcNotificationsPanel {
   CcPanel parent_instance;
@@ -43,6 +41,7 @@ struct _CcNotificationsPanel {
   GCancellable *apps_load_cancellable;
 
   GHashTable *known_applications;
+  GListStore *apps;
 
   GtkAdjustment *focus_adjustment;
 
@@ -56,20 +55,9 @@ struct _CcNotificationsPanelClass {
   CcPanelClass parent;
 };
 
-typedef struct {
-  char *canonical_app_id;
-  GAppInfo *app_info;
-  GSettings *settings;
-
-  /* Temporary pointer, to pass from the loading thread
-     to the app */
-  CcNotificationsPanel *panel;
-} Application;
-
-static void application_free (Application *app);
-static void build_app_store (CcNotificationsPanel *panel);
-static void select_app      (GtkListBox *box, GtkListBoxRow *row, CcNotificationsPanel *panel);
-static int  sort_apps       (gconstpointer one, gconstpointer two, gpointer user_data);
+static void       build_app_store (CcNotificationsPanel *panel);
+static void       select_app      (GtkListBox *box, GtkListBoxRow *row, CcNotificationsPanel *panel);
+static GtkWidget *create_app_row  (gpointer item, gpointer user_data);
 
 CC_PANEL_REGISTER (CcNotificationsPanel, cc_notifications_panel);
 
@@ -81,9 +69,11 @@ cc_notifications_panel_dispose (GObject *object)
   g_clear_object (&panel->builder);
   g_clear_object (&panel->master_settings);
   g_clear_pointer (&panel->known_applications, g_hash_table_unref);
+  g_clear_object (&panel->apps);
   g_clear_pointer (&panel->sections, g_list_free);
   g_clear_pointer (&panel->sections_reverse, g_list_free);
 
+  g_signal_handlers_disconnect_by_data (cc_app_registry_get_default (), panel);
   g_cancellable_cancel (panel->apps_load_cancellable);
 
   G_OBJECT_CLASS (cc_notifications_panel_parent_class)->dispose (object);
@@ -174,6 +164,7 @@ cc_notifications_panel_init (CcNotificationsPanel *panel)
   g_resources_register (cc_notifications_get_resource ());
   panel->known_applications = g_hash_table_new_full (g_str_hash, g_str_equal,
                                                      NULL, g_free);
+  panel->apps = g_list_store_new (CC_TYPE_NOTIFICATIONS_APP);
 
   panel->builder = gtk_builder_new ();
   if (gtk_builder_add_from_resource (panel->builder,
@@ -225,7 +216,8 @@ cc_notifications_panel_init (CcNotificationsPanel *panel)
   panel->sections = g_list_append (panel->sections, w);
   panel->sections_reverse = g_list_prepend (panel->sections_reverse, w);
   g_signal_connect (w, "keynav-failed", G_CALLBACK (keynav_failed), panel);
-  gtk_list_box_set_sort_func (GTK_LIST_BOX (w), (GtkListBoxSortFunc)sort_apps, NULL, NULL);
+  gtk_list_box_bind_model (GTK_LIST_BOX (w), G_LIST_MODEL (panel->apps),
+                           create_app_row, panel, NULL);
   gtk_list_box_set_header_func (GTK_LIST_BOX (w),
                                 cc_list_box_update_header_func,
                                 NULL, NULL);
@@ -294,20 +286,46 @@ on_off_label_mapping_get (GValue   *value,
   return TRUE;
 }
 
-static void
-add_application (CcNotificationsPanel *panel,
-                 Application          *app)
+/* Rows are bound to the settings of their application the first time
+ * they are drawn, rather than when they are mapped: GtkListBox maps all
+ * its rows, including the ones scrolled out of view.
+ */
+static gboolean
+app_row_draw_cb (GtkWidget *row,
+                 cairo_t   *cr,
+                 GtkWidget *label)
 {
-  GtkWidget *box, *w, *row, *list_box;
+  CcNotificationsApp *app;
+
+  g_signal_handlers_disconnect_by_func (row, app_row_draw_cb, label);
+
+  app = g_object_get_qdata (G_OBJECT (row), application_quark ());
+  g_settings_bind_with_mapping (cc_notifications_app_get_settings (app), "enable",
+                                label, "label",
+                                G_SETTINGS_BIND_GET |
+                                G_SETTINGS_BIND_NO_SENSITIVITY,
+                                on_off_label_mapping_get,
+                                NULL,
+                                NULL,
+                                NULL);
+
+  return FALSE;
+}
+
+static GtkWidget *
+create_app_row (gpointer item,
+                gpointer user_data)
+{
+  CcNotificationsPanel *panel = user_data;
+  CcNotificationsApp *app = item;
+  GtkWidget *box, *w, *row, *label;
+  GAppInfo *app_info;
   GIcon *icon;
-  const gchar *app_name;
   int size;
 
-  app_name = g_app_info_get_name (app->app_info);
-  if (app_name == NULL || *app_name == '\0')
-    return;
+  app_info = cc_notifications_app_get_app_info (app);
 
-  icon = g_app_info_get_icon (app->app_info);
+  icon = g_app_info_get_icon (app_info);
   if (icon == NULL)
     icon = g_themed_icon_new ("application-x-executable");
   else
@@ -318,12 +336,7 @@ add_application (CcNotificationsPanel *panel,
 
   row = gtk_list_box_row_new ();
   g_object_set_qdata_full (G_OBJECT (row), application_quark (),
-                           app, (GDestroyNotify) application_free);
-
-  list_box = GTK_WIDGET (gtk_builder_get_object (panel->builder,
-                                                 "ccnotify-app-listbox"));
-
-  gtk_container_add (GTK_CONTAINER (list_box), row);
+                           g_object_ref (app), g_object_unref);
   gtk_container_add (GTK_CONTAINER (row), box);
 
   w = gtk_image_new_from_gicon (icon, GTK_ICON_SIZE_DIALOG);
@@ -333,36 +346,48 @@ add_application (CcNotificationsPanel *panel,
   gtk_container_add (GTK_CONTAINER (box), w);
   g_object_unref (icon);
 
-  w = gtk_label_new (app_name);
+  w = gtk_label_new (g_app_info_get_name (app_info));
   gtk_container_add (GTK_CONTAINER (box), w);
 
-  w = gtk_label_new ("");
-  g_settings_bind_with_mapping (app->settings, "enable",
-                                w, "label",
-                                G_SETTINGS_BIND_GET |
-                                G_SETTINGS_BIND_NO_SENSITIVITY,
-                                on_off_label_mapping_get,
-                                NULL,
-                                NULL,
-                                NULL);
-  gtk_widget_set_margin_end (w, 12);
-  gtk_widget_set_valign (w, GTK_ALIGN_CENTER);
-  gtk_box_pack_end (GTK_BOX (box), w, FALSE, FALSE, 0);
+  label = gtk_label_new ("");
+  gtk_widget_set_margin_end (label, 12);
+  gtk_widget_set_valign (label, GTK_ALIGN_CENTER);
+  gtk_box_pack_end (GTK_BOX (box), label, FALSE, FALSE, 0);
+
+  if (cc_notifications_app_has_settings (app))
+    app_row_draw_cb (row, NULL, label);
+  else
+    g_signal_connect (row, "draw", G_CALLBACK (app_row_draw_cb), label);
 
   gtk_widget_show_all (row);
 
-  g_hash_table_add (panel->known_applications, g_strdup (app->canonical_app_id));
+  return row;
+}
+
+static void
+add_application (CcNotificationsPanel *panel,
+                 CcNotificationsApp   *app)
+{
+  const char *canonical_app_id;
+
+  canonical_app_id = cc_notifications_app_get_canonical_app_id (app);
+  if (g_hash_table_contains (panel->known_applications, canonical_app_id))
+    return;
+
+  g_hash_table_add (panel->known_applications, g_strdup (canonical_app_id));
+  g_list_store_insert_sorted (panel->apps, app, cc_notifications_app_compare, NULL);
 }
 
 static void
 maybe_add_app_id (CcNotificationsPanel *panel,
                   const char *canonical_app_id)
 {
-  Application *app;
+  CcNotificationsApp *app;
   gchar *path;
   gchar *full_app_id;
   GSettings *settings;
   GAppInfo *app_info;
+  const gchar *app_name;
 
   if (*canonical_app_id == '\0')
     return;
@@ -375,161 +400,134 @@ maybe_add_app_id (CcNotificationsPanel *panel,
   settings = g_settings_new_with_path (APP_SCHEMA, path);
 
   full_app_id = g_settings_get_string (settings, "application-id");
-  app_info = G_APP_INFO (g_desktop_app_info_new (full_app_id));
+  app_info = G_APP_INFO (cc_app_registry_lookup (cc_app_registry_get_default (),
+                                                 full_app_id));
 
   if (app_info == NULL) {
     g_debug ("Not adding application '%s' (canonical app ID: %s)",
              full_app_id, canonical_app_id);
     /* The application cannot be found, probably it was uninstalled */
-    g_object_unref (settings);
   } else {
-    app = g_slice_new (Application);
-    app->canonical_app_id = g_strdup (canonical_app_id);
-    app->settings = settings;
-    app->app_info = app_info;
-
-    g_debug ("Adding application '%s' (canonical app ID: %s)",
-             full_app_id, canonical_app_id);
-
-    add_application (panel, app);
+    app_name = g_app_info_get_name (app_info);
+    if (app_name != NULL && *app_name != '\0')
+      {
+        g_debug ("Adding application '%s' (canonical app ID: %s)",
+                 full_app_id, canonical_app_id);
+
+        app = cc_notifications_app_new (app_info, canonical_app_id, settings);
+        add_application (panel, app);
+        g_object_unref (app);
+      }
   }
 
+  g_object_unref (settings);
   g_free (path);
   g_free (full_app_id);
 }
 
-static gboolean
-queued_app_info (gpointer data)
+static void
+apps_loaded_cb (GPtrArray *apps,
+                gpointer   user_data)
 {
-  Application *app;
-  CcNotificationsPanel *panel;
-
-  app = data;
-  panel = app->panel;
-  app->panel = NULL;
+  CcNotificationsPanel *panel = user_data;
+  guint i;
 
-  if (g_cancellable_is_cancelled (panel->apps_load_cancellable) ||
-      g_hash_table_contains (panel->known_applications,
-                             app->canonical_app_id))
+  for (i = 0; i < apps->len; i++)
     {
-      application_free (app);
-      g_object_unref (panel);
-      return FALSE;
+      CcNotificationsApp *app = g_ptr_array_index (apps, i);
+
+      g_debug ("Processing queued application %s",
+               cc_notifications_app_get_canonical_app_id (app));
+      add_application (panel, app);
     }
+}
 
-  g_debug ("Processing queued application %s", app->canonical_app_id);
+/* Removes the row of an application, returning whether it had one */
+static gboolean
+remove_application (CcNotificationsPanel *panel,
+                    const char           *canonical_app_id)
+{
+  guint i, n_items;
 
-  add_application (panel, app);
-  g_object_unref (panel);
+  n_items = g_list_model_get_n_items (G_LIST_MODEL (panel->apps));
+  for (i = 0; i < n_items; i++)
+    {
+      CcNotificationsApp *app;
+      gboolean found;
+
+      app = g_list_model_get_item (G_LIST_MODEL (panel->apps), i);
+      found = g_str_equal (cc_notifications_app_get_canonical_app_id (app),
+                           canonical_app_id);
+      g_object_unref (app);
+
+      if (found)
+        {
+          g_list_store_remove (panel->apps, i);
+          g_hash_table_remove (panel->known_applications, canonical_app_id);
+          return TRUE;
+        }
+    }
 
   return FALSE;
 }
 
-static char *
-app_info_get_id (GAppInfo *app_info)
+static void
+app_added_cb (CcAppRegistry        *registry,
+              GDesktopAppInfo      *app_info,
+              CcNotificationsPanel *panel)
 {
-  const char *desktop_id;
-  char *ret;
-  const char *filename;
-  int l;
+  CcNotificationsApp *app;
 
-  desktop_id = g_app_info_get_id (app_info);
-  if (desktop_id != NULL)
-    {
-      ret = g_strdup (desktop_id);
-    }
-  else
-    {
-      filename = g_desktop_app_info_get_filename (G_DESKTOP_APP_INFO (app_info));
-      ret = g_path_get_basename (filename);
-    }
+  if (!g_desktop_app_info_get_boolean (app_info, NOTIFICATIONS_KEY))
+    return;
 
-  if (G_UNLIKELY (g_str_has_suffix (ret, ".desktop") == FALSE))
+  app = cc_notifications_app_new_for_app_info (G_APP_INFO (app_info));
+  if (app != NULL)
     {
-      g_free (ret);
-      return NULL;
+      add_application (panel, app);
+      g_object_unref (app);
     }
-
-  l = strlen (desktop_id);
-  *(ret + l - strlen(".desktop")) = '\0';
-  return ret;
 }
 
 static void
-process_app_info (CcNotificationsPanel *panel,
-                  GTask                *task,
-                  GAppInfo             *app_info)
+app_removed_cb (CcAppRegistry        *registry,
+                GDesktopAppInfo      *app_info,
+                CcNotificationsPanel *panel)
 {
-  Application *app;
-  char *app_id;
   char *canonical_app_id;
-  char *path;
-  GSettings *settings;
-  GSource *source;
-  guint i;
-
-  app_id = app_info_get_id (app_info);
-  canonical_app_id = g_strcanon (app_id,
-                                 "0123456789"
-                                 "abcdefghijklmnopqrstuvwxyz"
-                                 "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
-                                 "-",
-                                 '-');
-  for (i = 0; canonical_app_id[i] != '\0'; i++)
-    canonical_app_id[i] = g_ascii_tolower (canonical_app_id[i]);
 
-  path = g_strconcat (APP_PREFIX, canonical_app_id, "/", NULL);
-  settings = g_settings_new_with_path (APP_SCHEMA, path);
-
-  app = g_slice_new (Application);
-  app->canonical_app_id = canonical_app_id;
-  app->settings = settings;
-  app->app_info = g_object_ref (app_info);
-  app->panel = g_object_ref (panel);
-
-  source = g_idle_source_new ();
-  g_source_set_callback (source, queued_app_info, app, NULL);
-  g_source_attach (source, g_task_get_context (task));
-
-  g_free (path);
+  canonical_app_id = cc_notifications_app_info_get_canonical_id (G_APP_INFO (app_info));
+  if (canonical_app_id != NULL)
+    remove_application (panel, canonical_app_id);
+  g_free (canonical_app_id);
 }
 
 static void
-load_apps_thread (GTask        *task,
-                  gpointer      panel,
-                  gpointer      task_data,
-                  GCancellable *cancellable)
+app_changed_cb (CcAppRegistry        *registry,
+                GDesktopAppInfo      *app_info,
+                CcNotificationsPanel *panel)
 {
-  GList *iter, *apps;
+  CcNotificationsApp *app;
+  char *canonical_app_id;
 
-  apps = g_app_info_get_all ();
+  canonical_app_id = cc_notifications_app_info_get_canonical_id (G_APP_INFO (app_info));
+  if (canonical_app_id == NULL)
+    return;
 
-  for (iter = apps; iter && !g_cancellable_is_cancelled (cancellable); iter = iter->next)
+  /* Rebuild the row, for the name and icon, if the application is shown
+   * or now uses notifications */
+  if (remove_application (panel, canonical_app_id) ||
+      g_desktop_app_info_get_boolean (app_info, NOTIFICATIONS_KEY))
     {
-      GDesktopAppInfo *app;
-
-      app = iter->data;
-      if (g_desktop_app_info_get_boolean (app, "X-GNOME-UsesNotifications")) {
-        process_app_info (panel, task, G_APP_INFO (app));
-        g_debug ("Processing app '%s'", g_app_info_get_id (G_APP_INFO (app)));
-      } else {
-        g_debug ("Skipped app '%s', doesn't use notifications", g_app_info_get_id (G_APP_INFO (app)));
-      }
+      app = cc_notifications_app_new_for_app_info (G_APP_INFO (app_info));
+      if (app != NULL)
+        {
+          add_application (panel, app);
+          g_object_unref (app);
+        }
     }
 
-  g_list_free_full (apps, g_object_unref);
-}
-
-static void
-load_apps_async (CcNotificationsPanel *panel)
-{
-  GTask *task;
-
-  panel->apps_load_cancellable = g_cancellable_new ();
-  task = g_task_new (panel, panel->apps_load_cancellable, NULL, NULL);
-  g_task_run_in_thread (task, load_apps_thread);
-
-  g_object_unref (task);
+  g_free (canonical_app_id);
 }
 
 static void
@@ -549,48 +547,61 @@ children_changed (GSettings            *settings,
 }
 
 static void
-build_app_store (CcNotificationsPanel *panel)
+apps_load_done_cb (GObject      *source_object,
+                   GAsyncResult *res,
+                   gpointer      user_data)
 {
-  /* Build application entries for known applications */
+  CcNotificationsPanel *panel;
+  GError *error = NULL;
+
+  if (!cc_notifications_apps_load_finish (res, &error))
+    {
+      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        g_warning ("Failed to load applications: %s", error->message);
+      g_error_free (error);
+      return;
+    }
+
+  panel = CC_NOTIFICATIONS_PANEL (user_data);
+
+  /* Build application entries for known applications, now that they
+   * can be looked up without parsing the desktop files */
   children_changed (panel->master_settings, NULL, panel);
   g_signal_connect (panel->master_settings, "changed::application-children",
                     G_CALLBACK (children_changed), panel);
 
-  /* Scan applications that statically declare to show notifications */
-  load_apps_async (panel);
+  g_signal_connect (cc_app_registry_get_default (), "app-added",
+                    G_CALLBACK (app_added_cb), panel);
+  g_signal_connect (cc_app_registry_get_default (), "app-removed",
+                    G_CALLBACK (app_removed_cb), panel);
+  g_signal_connect (cc_app_registry_get_default (), "app-changed",
+                    G_CALLBACK (app_changed_cb), panel);
 }
 
 static void
-select_app (GtkListBox           *list_box,
-            GtkListBoxRow        *row,
-            CcNotificationsPanel *panel)
+build_app_store (CcNotificationsPanel *panel)
 {
-  Application *app;
+  panel->apps_load_cancellable = g_cancellable_new ();
 
-  app = g_object_get_qdata (G_OBJECT (row), application_quark ());
-  cc_build_edit_dialog (panel, app->app_info, app->settings, panel->master_settings, panel->perm_store);
+  /* Scan applications that statically declare to show notifications.
+   * The batches are dropped once the panel is disposed, which cancels
+   * the loading */
+  cc_notifications_apps_load_async (apps_loaded_cb, panel,
+                                    panel->apps_load_cancellable,
+                                    apps_load_done_cb, panel);
 }
 
 static void
-application_free (Application *app)
-{
-  g_free (app->canonical_app_id);
-  g_object_unref (app->app_info);
-  g_object_unref (app->settings);
-
-  g_slice_free (Application, app);
-}
-
-static int
-sort_apps (gconstpointer one,
-           gconstpointer two,
-           gpointer      user_data)
+select_app (GtkListBox           *list_box,
+            GtkListBoxRow        *row,
+            CcNotificationsPanel *panel)
 {
-  Application *a1, *a2;
-
-  a1 = g_object_get_qdata (G_OBJECT (one), application_quark ());
-  a2 = g_object_get_qdata (G_OBJECT (two), application_quark ());
+  CcNotificationsApp *app;
 
-  return g_utf8_collate (g_app_info_get_name (a1->app_info),
-                         g_app_info_get_name (a2->app_info));
+  app = g_object_get_qdata (G_OBJECT (row), application_quark ());
+  cc_build_edit_dialog (panel,
+                        cc_notifications_app_get_app_info (app),
+                        cc_notifications_app_get_settings (app),
+                        panel->master_settings,
+                        panel->perm_store);
 }
@@ -0,0 +1,354 @@
+#include "config.h"
+
+#include <glib/gstdio.h>
+#include <gio/gio.h>
+
+#include "cc-app-registry.h"
+#include "cc-notifications-app.h"
+
+/* Run with "-m perf" to get the loading timings */
+#define N_DESKTOP_FILES 4000
+#define N_BENCHMARK_LOADS 5
+
+static char *data_home;
+static gdouble first_load_time;
+
+typedef struct {
+  GMainLoop *loop;
+  GHashTable *ids;
+  guint n_batches;
+  guint n_apps;
+  gboolean finished;
+  gboolean settings_created;
+} LoadData;
+
+static void
+apps_cb (GPtrArray *apps,
+         gpointer   user_data)
+{
+  LoadData *data = user_data;
+  guint i;
+
+  g_assert_false (data->finished);
+
+  data->n_batches++;
+  data->n_apps += apps->len;
+
+  for (i = 0; i < apps->len; i++)
+    {
+      CcNotificationsApp *app = g_ptr_array_index (apps, i);
+
+      if (cc_notifications_app_has_settings (app))
+        data->settings_created = TRUE;
+      if (data->ids != NULL)
+        g_hash_table_add (data->ids, g_strdup (cc_notifications_app_get_canonical_app_id (app)));
+    }
+}
+
+static void
+load_cb (GObject      *source_object,
+         GAsyncResult *res,
+         gpointer      user_data)
+{
+  LoadData *data = user_data;
+  GError *error = NULL;
+
+  g_assert_true (cc_notifications_apps_load_finish (res, &error));
+  g_assert_no_error (error);
+
+  data->finished = TRUE;
+  g_main_loop_quit (data->loop);
+}
+
+static void
+load_apps (LoadData *data)
+{
+  data->loop = g_main_loop_new (NULL, FALSE);
+  cc_notifications_apps_load_async (apps_cb, data, NULL, load_cb, data);
+  g_main_loop_run (data->loop);
+  g_main_loop_unref (data->loop);
+}
+
+static void
+test_load (void)
+{
+  LoadData data = { 0 };
+  GTimer *timer;
+
+  /* The first load also parses the desktop files into the registry */
+  data.ids = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  timer = g_timer_new ();
+  load_apps (&data);
+  first_load_time = g_timer_elapsed (timer, NULL);
+  g_timer_destroy (timer);
+
+  /* Every other desktop file uses notifications */
+  g_assert_true (data.finished);
+  g_assert_cmpuint (data.n_apps, ==, N_DESKTOP_FILES / 2);
+  g_assert_cmpuint (g_hash_table_size (data.ids), ==, N_DESKTOP_FILES / 2);
+  g_assert_true (g_hash_table_contains (data.ids, "org-example-app0"));
+  g_assert_false (g_hash_table_contains (data.ids, "org-example-app1"));
+
+  /* In a few batches rather than one by one, and without loading any
+   * settings */
+  g_assert_cmpuint (data.n_batches, >, 1);
+  g_assert_cmpuint (data.n_batches, <, data.n_apps / 10);
+  g_assert_false (data.settings_created);
+
+  g_hash_table_unref (data.ids);
+}
+
+static void
+cancelled_cb (GObject      *source_object,
+              GAsyncResult *res,
+              gpointer      user_data)
+{
+  LoadData *data = user_data;
+  GError *error = NULL;
+
+  g_assert_false (cc_notifications_apps_load_finish (res, &error));
+  g_assert_error (error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+  g_error_free (error);
+
+  data->finished = TRUE;
+  g_main_loop_quit (data->loop);
+}
+
+static void
+test_cancel (void)
+{
+  GCancellable *cancellable;
+  LoadData data = { 0 };
+
+  cancellable = g_cancellable_new ();
+  data.loop = g_main_loop_new (NULL, FALSE);
+
+  cc_notifications_apps_load_async (apps_cb, &data, cancellable, cancelled_cb, &data);
+  g_cancellable_cancel (cancellable);
+  g_main_loop_run (data.loop);
+
+  /* No batch is handed over once cancelled, even if it was ready */
+  g_assert_true (data.finished);
+  g_assert_cmpuint (data.n_batches, ==, 0);
+
+  g_main_loop_unref (data.loop);
+  g_object_unref (cancellable);
+}
+
+typedef struct {
+  GMainLoop *loop;
+  char *added;
+  char *removed;
+} ChangesData;
+
+static void
+registry_app_added_cb (CcAppRegistry   *registry,
+                       GDesktopAppInfo *app_info,
+                       ChangesData     *data)
+{
+  g_free (data->added);
+  data->added = g_strdup (g_app_info_get_id (G_APP_INFO (app_info)));
+  g_main_loop_quit (data->loop);
+}
+
+static void
+registry_app_removed_cb (CcAppRegistry   *registry,
+                         GDesktopAppInfo *app_info,
+                         ChangesData     *data)
+{
+  g_free (data->removed);
+  data->removed = g_strdup (g_app_info_get_id (G_APP_INFO (app_info)));
+  g_main_loop_quit (data->loop);
+}
+
+static gboolean
+changes_timeout_cb (gpointer user_data)
+{
+  g_assert_not_reached ();
+  return G_SOURCE_REMOVE;
+}
+
+static void
+test_registry_changes (void)
+{
+  CcAppRegistry *registry;
+  g_autoptr(GPtrArray) apps = NULL;
+  ChangesData data = { 0 };
+  char *path;
+  guint timeout_id;
+
+  registry = cc_app_registry_get_default ();
+  g_assert_true (cc_app_registry_is_loaded (registry));
+
+  apps = cc_app_registry_list_with_key (registry, NOTIFICATIONS_KEY);
+  g_assert_cmpuint (apps->len, ==, N_DESKTOP_FILES / 2);
+  g_assert_nonnull (cc_app_registry_lookup (registry, "org.example.App1.desktop"));
+  g_clear_pointer (&apps, g_ptr_array_unref);
+
+  data.loop = g_main_loop_new (NULL, FALSE);
+  g_signal_connect (registry, "app-added", G_CALLBACK (registry_app_added_cb), &data);
+  g_signal_connect (registry, "app-removed", G_CALLBACK (registry_app_removed_cb), &data);
+  timeout_id = g_timeout_add_seconds (10, changes_timeout_cb, NULL);
+
+  /* A new application is indexed */
+  path = g_build_filename (data_home, "applications", "org.example.NewApp.desktop", NULL);
+  g_assert_true (g_file_set_contents (path,
+                                      "[Desktop Entry]\n"
+                                      "Type=Application\n"
+                                      "Name=New Example Application\n"
+                                      "Exec=true\n"
+                                      "X-GNOME-UsesNotifications=true\n",
+                                      -1, NULL));
+  g_main_loop_run (data.loop);
+  g_assert_cmpstr (data.added, ==, "org.example.NewApp.desktop");
+  g_assert_null (data.removed);
+
+  apps = cc_app_registry_list_with_key (registry, NOTIFICATIONS_KEY);
+  g_assert_cmpuint (apps->len, ==, N_DESKTOP_FILES / 2 + 1);
+  g_clear_pointer (&apps, g_ptr_array_unref);
+
+  /* and dropped once uninstalled */
+  g_assert_cmpint (g_unlink (path), ==, 0);
+  g_main_loop_run (data.loop);
+  g_assert_cmpstr (data.removed, ==, "org.example.NewApp.desktop");
+  g_assert_null (cc_app_registry_lookup (registry, "org.example.NewApp.desktop"));
+
+  g_source_remove (timeout_id);
+  g_signal_handlers_disconnect_by_data (registry, &data);
+  g_main_loop_unref (data.loop);
+  g_free (data.added);
+  g_free (data.removed);
+  g_free (path);
+}
+
+static void
+test_benchmark (void)
+{
+  GTimer *timer;
+  gdouble min_time = G_MAXDOUBLE;
+  guint i;
+
+  if (!g_test_perf ())
+    return;
+
+  timer = g_timer_new ();
+  for (i = 0; i < N_BENCHMARK_LOADS; i++)
+    {
+      LoadData data = { 0 };
+
+      g_timer_start (timer);
+      load_apps (&data);
+      min_time = MIN (min_time, g_timer_elapsed (timer, NULL));
+
+      g_assert_cmpuint (data.n_apps, ==, N_DESKTOP_FILES / 2);
+    }
+
+  g_test_minimized_result (first_load_time,
+                           "Loaded %d applications out of %d desktop files in %.1f ms",
+                           N_DESKTOP_FILES / 2, N_DESKTOP_FILES, first_load_time * 1000);
+  g_test_minimized_result (min_time,
+                           "Loaded them again from the registry in %.1f ms",
+                           min_time * 1000);
+
+  g_timer_destroy (timer);
+}
+
+/* A data directory with only the generated desktop files */
+static void
+create_data_dirs (void)
+{
+  char *apps_dir;
+  char *empty_dir;
+  guint i;
+
+  data_home = g_dir_make_tmp ("test-notifications-apps-XXXXXX", NULL);
+  g_assert_nonnull (data_home);
+
+  apps_dir = g_build_filename (data_home, "applications", NULL);
+  g_assert_cmpint (g_mkdir (apps_dir, 0700), ==, 0);
+
+  for (i = 0; i < N_DESKTOP_FILES; i++)
+    {
+      char *filename;
+      char *path;
+      char *contents;
+
+      contents = g_strdup_printf ("[Desktop Entry]\n"
+                                  "Type=Application\n"
+                                  "Name=Example Application %u\n"
+                                  "Exec=true\n"
+                                  "Icon=example-app\n"
+                                  "X-GNOME-UsesNotifications=%s\n",
+                                  i, i % 2 == 0 ? "true" : "false");
+      filename = g_strdup_printf ("org.example.App%u.desktop", i);
+      path = g_build_filename (apps_dir, filename, NULL);
+      g_assert_true (g_file_set_contents (path, contents, -1, NULL));
+
+      g_free (path);
+      g_free (filename);
+      g_free (contents);
+    }
+
+  empty_dir = g_build_filename (data_home, "empty", NULL);
+  g_assert_cmpint (g_mkdir (empty_dir, 0700), ==, 0);
+
+  g_setenv ("XDG_DATA_HOME", data_home, TRUE);
+  g_setenv ("XDG_DATA_DIRS", empty_dir, TRUE);
+
+  g_free (empty_dir);
+  g_free (apps_dir);
+}
+
+static void
+remove_data_dirs (void)
+{
+  char *apps_dir;
+  char *empty_dir;
+  guint i;
+
+  apps_dir = g_build_filename (data_home, "applications", NULL);
+  for (i = 0; i < N_DESKTOP_FILES; i++)
+    {
+      char *filename;
+      char *path;
+
+      filename = g_strdup_printf ("org.example.App%u.desktop", i);
+      path = g_build_filename (apps_dir, filename, NULL);
+      g_unlink (path);
+
+      g_free (path);
+      g_free (filename);
+    }
+  g_rmdir (apps_dir);
+
+  empty_dir = g_build_filename (data_home, "empty", NULL);
+  g_rmdir (empty_dir);
+  g_rmdir (data_home);
+
+  g_free (empty_dir);
+  g_free (apps_dir);
+  g_free (data_home);
+}
+
+int
+main (int argc, char **argv)
+{
+  int ret;
+
+  /* The settings of the applications must not be needed to load them */
+  g_setenv ("GSETTINGS_BACKEND", "memory", TRUE);
+  create_data_dirs ();
+
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/notifications/apps/load", test_load);
+  g_test_add_func ("/notifications/apps/cancel", test_cancel);
+  g_test_add_func ("/notifications/apps/registry-changes", test_registry_changes);
+  g_test_add_func ("/notifications/apps/benchmark", test_benchmark);
+
+  ret = g_test_run ();
+
+  remove_data_dirs ();
+
+  return ret;
+}
@@ -38,7 +38,7 @@
 #include "pp-utils.h"
 #include "pp-cups.h"
 #include "pp-printer-entry.h"
-#include "pp-job.h"
+#include "pp-printer-events.h"
 
 #include "cc-util.h"
 
@@ -93,6 +93,7 @@ struct _CcPrintersPanelPrivate
   GtkRevealer  *notification;
   PPDList      *all_ppds_list;
   GCancellable *get_all_ppds_cancellable;
+  GCancellable *load_ppds_cache_cancellable;
   GCancellable *subscription_renew_cancellable;
   GCancellable *actualize_printers_list_cancellable;
 
@@ -105,12 +106,18 @@ struct _CcPrintersPanelPrivate
   gchar    *deleted_printer_name;
 
   GHashTable *printer_entries;
+  gboolean    printer_entries_authorized;
+
+  PpPrinterEvents *printer_events;
 
   GtkSizeGroup *size_group;
 
   gpointer dummy;
 };
 
+/* How long printer notifications are collected before the list is updated */
+#define PRINTER_EVENTS_INTERVAL 500
+
 #define PAGE_LOCK "_lock"
 #define PAGE_ADDPRINTER "_addprinter"
 
@@ -265,6 +272,13 @@ cc_printers_panel_dispose (GObject *object)
       priv->get_all_ppds_cancellable = NULL;
     }
 
+  if (priv->load_ppds_cache_cancellable)
+    {
+      g_cancellable_cancel (priv->load_ppds_cache_cancellable);
+      g_object_unref (priv->load_ppds_cache_cancellable);
+      priv->load_ppds_cache_cancellable = NULL;
+    }
+
   if (priv->deleted_printer_name != NULL)
     {
       PpPrinter *printer;
@@ -278,6 +292,7 @@ cc_printers_panel_dispose (GObject *object)
                                NULL);
     }
 
+  g_clear_pointer (&priv->printer_events, pp_printer_events_free);
   g_clear_pointer (&priv->printer_entries, g_hash_table_destroy);
 
   G_OBJECT_CLASS (cc_printers_panel_parent_class)->dispose (object);
@@ -312,58 +327,6 @@ cc_printers_panel_class_init (CcPrintersPanelClass *klass)
   panel_class->get_help_uri = cc_printers_panel_get_help_uri;
 }
 
-static void
-on_get_job_attributes_cb (GObject      *source_object,
-                          GAsyncResult *res,
-                          gpointer      user_data)
-{
-  CcPrintersPanel        *self = (CcPrintersPanel*) user_data;
-  CcPrintersPanelPrivate *priv;
-  const gchar            *job_originating_user_name;
-  const gchar            *job_printer_uri;
-  GVariant               *attributes;
-  GVariant               *username;
-  GVariant               *printer_uri;
-  GError                 *error = NULL;
-
-  priv = PRINTERS_PANEL_PRIVATE (self);
-
-  attributes = pp_job_get_attributes_finish (PP_JOB (source_object), res, &error);
-  g_object_unref (source_object);
-
-  if (attributes != NULL)
-    {
-      if ((username = g_variant_lookup_value (attributes, "job-originating-user-name", G_VARIANT_TYPE ("as"))) != NULL)
-        {
-          if ((printer_uri = g_variant_lookup_value (attributes, "job-printer-uri", G_VARIANT_TYPE ("as"))) != NULL)
-            {
-              job_originating_user_name = g_variant_get_string (g_variant_get_child_value (username, 0), NULL);
-              job_printer_uri = g_variant_get_string (g_variant_get_child_value (printer_uri, 0), NULL);
-
-              if (job_originating_user_name != NULL && job_printer_uri != NULL &&
-                  g_strcmp0 (job_originating_user_name, cupsUser ()) == 0 &&
-                  g_strrstr (job_printer_uri, "/") != 0 &&
-                  priv->dests != NULL)
-                {
-                  PpPrinterEntry *printer_entry;
-                  gchar *printer_name;
-
-                  printer_name = g_strrstr (job_printer_uri, "/") + 1;
-                  printer_entry = PP_PRINTER_ENTRY (g_hash_table_lookup (priv->printer_entries, printer_name));
-
-                  pp_printer_entry_update_jobs_count (printer_entry);
-                }
-
-              g_variant_unref (printer_uri);
-            }
-
-          g_variant_unref (username);
-        }
-
-      g_variant_unref (attributes);
-    }
-}
-
 static void
 on_cups_notification (GDBusConnection *connection,
                       const char      *sender_name,
@@ -373,75 +336,10 @@ on_cups_notification (GDBusConnection *connection,
                       GVariant        *parameters,
                       gpointer         user_data)
 {
-  CcPrintersPanel        *self = (CcPrintersPanel*) user_data;
-  gboolean                printer_is_accepting_jobs;
-  gchar                  *printer_name = NULL;
-  gchar                  *text = NULL;
-  gchar                  *printer_uri = NULL;
-  gchar                  *printer_state_reasons = NULL;
-  PpJob                  *job;
-  gchar                  *job_state_reasons = NULL;
-  gchar                  *job_name = NULL;
-  guint                   job_id;
-  gint                    printer_state;
-  gint                    job_state;
-  gint                    job_impressions_completed;
-  static gchar *requested_attrs[] = {
-    "job-printer-uri",
-    "job-originating-user-name",
-    NULL };
-
-  if (g_strcmp0 (signal_name, "PrinterAdded") != 0 &&
-      g_strcmp0 (signal_name, "PrinterDeleted") != 0 &&
-      g_strcmp0 (signal_name, "PrinterStateChanged") != 0 &&
-      g_strcmp0 (signal_name, "PrinterStopped") != 0 &&
-      g_strcmp0 (signal_name, "JobCreated") != 0 &&
-      g_strcmp0 (signal_name, "JobCompleted") != 0)
-    return;
+  CcPrintersPanel *self = (CcPrintersPanel*) user_data;
 
-  if (g_variant_n_children (parameters) == 1)
-    g_variant_get (parameters, "(&s)", &text);
- else if (g_variant_n_children (parameters) == 6)
-    {
-      g_variant_get (parameters, "(&s&s&su&sb)",
-                     &text,
-                     &printer_uri,
-                     &printer_name,
-                     &printer_state,
-                     &printer_state_reasons,
-                     &printer_is_accepting_jobs);
-    }
-  else if (g_variant_n_children (parameters) == 11)
-    {
-      g_variant_get (parameters, "(&s&s&su&sbuu&s&su)",
-                     &text,
-                     &printer_uri,
-                     &printer_name,
-                     &printer_state,
-                     &printer_state_reasons,
-                     &printer_is_accepting_jobs,
-                     &job_id,
-                     &job_state,
-                     &job_state_reasons,
-                     &job_name,
-                     &job_impressions_completed);
-    }
-
-  if (g_strcmp0 (signal_name, "PrinterAdded") == 0 ||
-      g_strcmp0 (signal_name, "PrinterDeleted") == 0 ||
-      g_strcmp0 (signal_name, "PrinterStateChanged") == 0 ||
-      g_strcmp0 (signal_name, "PrinterStopped") == 0)
-    actualize_printers_list (self);
-  else if (g_strcmp0 (signal_name, "JobCreated") == 0 ||
-           g_strcmp0 (signal_name, "JobCompleted") == 0)
-    {
-      job = g_object_new (PP_TYPE_JOB, "id", job_id, NULL);
-      pp_job_get_attributes_async (job,
-                                   requested_attrs,
-                                   NULL,
-                                   on_get_job_attributes_cb,
-                                   self);
-    }
+  /* Handled in batches by printer_events_cb () */
+  pp_printer_events_push (self->priv->printer_events, signal_name, parameters);
 }
 
 static gchar *subscription_events[] = {
@@ -738,9 +636,51 @@ on_printer_changed (PpPrinterEntry *printer_entry,
   actualize_printers_list (user_data);
 }
 
+static void
+printer_events_cb (GList    *states,
+                   gboolean  printers_changed,
+                   gpointer  user_data)
+{
+  CcPrintersPanelPrivate *priv;
+  CcPrintersPanel        *self = (CcPrintersPanel*) user_data;
+  PpPrinterEntry         *printer_entry;
+  PpPrinterState         *state;
+  GList                  *l;
+
+  priv = PRINTERS_PANEL_PRIVATE (self);
+
+  if (printers_changed)
+    {
+      actualize_printers_list (self);
+      return;
+    }
+
+  for (l = states; l != NULL; l = l->next)
+    {
+      state = (PpPrinterState *) l->data;
+
+      printer_entry = g_hash_table_lookup (priv->printer_entries, state->printer_name);
+      if (printer_entry == NULL)
+        {
+          /* A printer we did not know about yet */
+          actualize_printers_list (self);
+          return;
+        }
+
+      pp_printer_entry_update_state (printer_entry,
+                                     state->printer_state,
+                                     state->printer_state_reasons,
+                                     state->is_accepting_jobs);
+
+      if (state->jobs_changed)
+        pp_printer_entry_update_jobs_count (printer_entry);
+    }
+}
+
 static void
 add_printer_entry (CcPrintersPanel *self,
-                   cups_dest_t      printer)
+                   cups_dest_t      printer,
+                   gint             position)
 {
   CcPrintersPanelPrivate *priv;
   PpPrinterEntry         *printer_entry;
@@ -767,8 +707,8 @@ add_printer_entry (CcPrintersPanel *self,
                     G_CALLBACK (on_printer_deleted),
                     self);
 
-  gtk_list_box_insert (GTK_LIST_BOX (content), GTK_WIDGET (printer_entry), -1);
-  gtk_widget_show_all (content);
+  gtk_list_box_insert (GTK_LIST_BOX (content), GTK_WIDGET (printer_entry), position);
+  gtk_widget_show (GTK_WIDGET (printer_entry));
 
   g_hash_table_insert (priv->printer_entries, g_strdup (printer.name), printer_entry);
 }
@@ -791,6 +731,56 @@ set_current_page (GObject      *source_object,
     gtk_stack_set_visible_child_name (GTK_STACK (widget), "no-cups-page");
 }
 
+static cups_dest_t *
+find_dest (cups_dest_t *dests,
+           int          num_dests,
+           const gchar *name)
+{
+  int i;
+
+  for (i = 0; i < num_dests; i++)
+    if (g_strcmp0 (dests[i].name, name) == 0)
+      return &dests[i];
+
+  return NULL;
+}
+
+static gboolean
+dests_equal (cups_dest_t *a,
+             cups_dest_t *b)
+{
+  int i;
+
+  if (g_strcmp0 (a->instance, b->instance) != 0 ||
+      a->is_default != b->is_default ||
+      a->num_options != b->num_options)
+    return FALSE;
+
+  for (i = 0; i < a->num_options; i++)
+    if (g_strcmp0 (a->options[i].value,
+                   cupsGetOption (a->options[i].name, b->num_options, b->options)) != 0)
+      return FALSE;
+
+  return TRUE;
+}
+
+static void
+remove_printer_entry (CcPrintersPanel *self,
+                      const gchar     *printer_name)
+{
+  CcPrintersPanelPrivate *priv;
+  GtkWidget              *printer_entry;
+
+  priv = PRINTERS_PANEL_PRIVATE (self);
+
+  printer_entry = g_hash_table_lookup (priv->printer_entries, printer_name);
+  if (printer_entry != NULL)
+    {
+      g_hash_table_remove (priv->printer_entries, printer_name);
+      gtk_widget_destroy (printer_entry);
+    }
+}
+
 static void
 actualize_printers_list_cb (GObject      *source_object,
                             GAsyncResult *result,
@@ -801,7 +791,13 @@ actualize_printers_list_cb (GObject      *source_object,
   GtkWidget              *widget;
   PpCups                 *cups = PP_CUPS (source_object);
   PpCupsDests            *cups_dests;
+  cups_dest_t            *old_dests;
+  cups_dest_t            *old_dest;
+  GtkWidget              *printer_entry;
   GError                 *error = NULL;
+  GList                  *names, *l;
+  gint                    position = 0;
+  int                     old_num_dests;
   int                     i;
 
   cups_dests = pp_cups_get_dests_finish (cups, result, &error);
@@ -819,7 +815,8 @@ actualize_printers_list_cb (GObject      *source_object,
 
   priv = PRINTERS_PANEL_PRIVATE (self);
 
-  free_dests (self);
+  old_dests = priv->dests;
+  old_num_dests = priv->num_dests;
   priv->dests = cups_dests->dests;
   priv->num_dests = cups_dests->num_of_dests;
   g_free (cups_dests);
@@ -830,15 +827,56 @@ actualize_printers_list_cb (GObject      *source_object,
   else
     gtk_stack_set_visible_child_name (GTK_STACK (widget), "printers-list");
 
-  widget = (GtkWidget*) gtk_builder_get_object (priv->builder, "content");
-  gtk_container_foreach (GTK_CONTAINER (widget), (GtkCallback) gtk_widget_destroy, NULL);
+  /* The entries are built with the permissions of the user */
+  if (priv->printer_entries_authorized != priv->is_authorized)
+    {
+      names = g_hash_table_get_keys (priv->printer_entries);
+      for (l = names; l != NULL; l = l->next)
+        remove_printer_entry (self, l->data);
+      g_list_free (names);
+
+      priv->printer_entries_authorized = priv->is_authorized;
+    }
+
+  /* Remove the entries of printers which are gone */
+  names = g_hash_table_get_keys (priv->printer_entries);
+  for (l = names; l != NULL; l = l->next)
+    {
+      if (g_strcmp0 (l->data, priv->deleted_printer_name) == 0 ||
+          find_dest (priv->dests, priv->num_dests, l->data) == NULL)
+        remove_printer_entry (self, l->data);
+    }
+  g_list_free (names);
+
+  /* Keep the entries of printers which did not change and
+   * replace the others at the same position
+   */
   for (i = 0; i < priv->num_dests; i++)
     {
       if (g_strcmp0 (priv->dests[i].name, priv->deleted_printer_name) == 0)
           continue;
 
-      add_printer_entry (self, priv->dests[i]);
+      printer_entry = g_hash_table_lookup (priv->printer_entries, priv->dests[i].name);
+      if (printer_entry != NULL)
+        {
+          old_dest = find_dest (old_dests, old_num_dests, priv->dests[i].name);
+          if (old_dest != NULL && dests_equal (old_dest, &priv->dests[i]))
+            {
+              /* It might have been hidden while being deleted */
+              gtk_widget_show (printer_entry);
+              position++;
+              continue;
+            }
+
+          remove_printer_entry (self, priv->dests[i].name);
+        }
+
+      add_printer_entry (self, priv->dests[i], position);
+      position++;
     }
+
+  if (old_num_dests > 0)
+    cupsFreeDests (old_num_dests, old_dests);
 }
 
 static void
@@ -1098,9 +1136,49 @@ get_all_ppds_async_cb (PPDList  *ppds,
 {
   CcPrintersPanelPrivate *priv;
   CcPrintersPanel        *self = (CcPrintersPanel*) user_data;
+  PPDList                *old_list;
 
   priv = self->priv = PRINTERS_PANEL_PRIVATE (self);
 
+  /* Keep the cached list if CUPS could not be asked */
+  if (ppds)
+    {
+      old_list = priv->all_ppds_list;
+      priv->all_ppds_list = ppds;
+
+      if (priv->pp_ppd_selection_dialog)
+        pp_ppd_selection_dialog_set_ppd_list (priv->pp_ppd_selection_dialog,
+                                              priv->all_ppds_list);
+
+      if (priv->pp_new_printer_dialog)
+        pp_new_printer_dialog_set_ppd_list (priv->pp_new_printer_dialog,
+                                            priv->all_ppds_list);
+
+      ppd_list_free (old_list);
+    }
+
+  g_object_unref (priv->get_all_ppds_cancellable);
+  priv->get_all_ppds_cancellable = NULL;
+}
+
+static void
+ppds_cache_loaded_cb (PPDList  *ppds,
+                      gpointer  user_data)
+{
+  CcPrintersPanelPrivate *priv;
+  CcPrintersPanel        *self = (CcPrintersPanel*) user_data;
+
+  priv = self->priv = PRINTERS_PANEL_PRIVATE (self);
+
+  g_clear_object (&priv->load_ppds_cache_cancellable);
+
+  /* CUPS may have answered first */
+  if (ppds == NULL || priv->all_ppds_list != NULL)
+    {
+      ppd_list_free (ppds);
+      return;
+    }
+
   priv->all_ppds_list = ppds;
 
   if (priv->pp_ppd_selection_dialog)
@@ -1110,9 +1188,6 @@ get_all_ppds_async_cb (PPDList  *ppds,
   if (priv->pp_new_printer_dialog)
     pp_new_printer_dialog_set_ppd_list (priv->pp_new_printer_dialog,
                                         priv->all_ppds_list);
-
-  g_object_unref (priv->get_all_ppds_cancellable);
-  priv->get_all_ppds_cancellable = NULL;
 }
 
 static gboolean
@@ -1208,6 +1283,11 @@ cc_printers_panel_init (CcPrintersPanel *self)
                                                  g_str_equal,
                                                  g_free,
                                                  NULL);
+  priv->printer_entries_authorized = FALSE;
+
+  priv->printer_events = pp_printer_events_new (PRINTER_EVENTS_INTERVAL,
+                                                printer_events_cb,
+                                                self);
 
   priv->actualize_printers_list_cancellable = g_cancellable_new ();
 
@@ -1294,6 +1374,12 @@ Please check your installation");
   actualize_printers_list (self);
   attach_to_cups_notifier (self);
 
+  /* Show the PPDs known from the last time as soon as they are read, and
+   * refresh them */
+  priv->load_ppds_cache_cancellable = g_cancellable_new ();
+  ppd_list_load_from_cache_async (priv->load_ppds_cache_cancellable,
+                                  ppds_cache_loaded_cb,
+                                  self);
   priv->get_all_ppds_cancellable = g_cancellable_new ();
   get_all_ppds_async (priv->get_all_ppds_cancellable,
                       get_all_ppds_async_cb,
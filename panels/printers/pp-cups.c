@@ -18,17 +18,87 @@
  * Author: Marek Kasik <mkasik@redhat.com>
  */
 
+#include <stdlib.h>
+
 #include "pp-cups.h"
+#include "pp-job.h"
 
 #if (CUPS_VERSION_MAJOR > 1) || (CUPS_VERSION_MINOR > 5)
 #define HAVE_CUPS_1_6 1
 #endif
 
 #ifndef HAVE_CUPS_1_6
+#define ippGetBoolean(attr, element) attr->values[element].boolean
+#define ippGetCount(attr)     attr->num_values
+#define ippGetGroupTag(attr)  attr->group_tag
 #define ippGetInteger(attr, element) attr->values[element].integer
+#define ippGetName(attr)      attr->name
 #define ippGetStatusCode(ipp) ipp->request.status.status_code
+#define ippGetString(attr, element, language) attr->values[element].string.text
+#define ippGetValueTag(attr)  attr->value_tag
+
+static int
+ippGetRange (ipp_attribute_t *attr,
+             int element,
+             int *upper)
+{
+  *upper = attr->values[element].range.upper;
+  return (attr->values[element].range.lower);
+}
+
+static ipp_attribute_t *
+ippFirstAttribute (ipp_t *ipp)
+{
+  if (!ipp)
+    return (NULL);
+  return (ipp->current = ipp->attrs);
+}
+
+static ipp_attribute_t *
+ippNextAttribute (ipp_t *ipp)
+{
+  if (!ipp || !ipp->current)
+    return (NULL);
+  return (ipp->current = ipp->current->next);
+}
 #endif
 
+/*
+ * Queries of printers go through a single worker thread, which keeps
+ * a connection to the CUPS server open instead of connecting for every
+ * request. Requests queued while the thread is busy are handled together:
+ * identical ones are sent only once, and attribute queries for several
+ * printers are sent as one CUPS-Get-Printers request.
+ * The thread exits, closing the connection, when it has been idle for
+ * ENGINE_IDLE_TIMEOUT.
+ */
+#define ENGINE_IDLE_TIMEOUT (10 * G_TIME_SPAN_SECOND)
+
+typedef enum
+{
+  REQUEST_GET_PRINTER_ATTRIBUTES,
+  REQUEST_GET_NAMED_DEST,
+  REQUEST_GET_PPD,
+  REQUEST_GET_JOBS
+} RequestType;
+
+typedef struct
+{
+  RequestType   type;
+  gchar        *printer_name;
+  gchar       **attributes;
+  gchar        *host_name;
+  gint          port;
+  gboolean      my_jobs;
+  gint          which_jobs;
+  GList        *tasks;
+} Request;
+
+static GMutex   engine_mutex;
+static GCond    engine_cond;
+static GQueue   engine_requests = G_QUEUE_INIT;
+static gboolean engine_running = FALSE;
+
 G_DEFINE_TYPE (PpCups, pp_cups, G_TYPE_OBJECT);
 
 static void
@@ -56,6 +126,842 @@ pp_cups_new ()
   return g_object_new (PP_TYPE_CUPS, NULL);
 }
 
+static void
+request_free (Request *request)
+{
+  g_free (request->printer_name);
+  g_strfreev (request->attributes);
+  g_free (request->host_name);
+  g_list_free_full (request->tasks, g_object_unref);
+  g_slice_free (Request, request);
+}
+
+/* Returns errors to the cancelled tasks, and whether any task is left */
+static gboolean
+request_is_cancelled (Request *request)
+{
+  GList *l, *next;
+
+  for (l = request->tasks; l != NULL; l = next)
+    {
+      next = l->next;
+
+      if (g_task_return_error_if_cancelled (l->data))
+        {
+          g_object_unref (l->data);
+          request->tasks = g_list_delete_link (request->tasks, l);
+        }
+    }
+
+  return request->tasks == NULL;
+}
+
+static void
+ipp_attribute_free2 (gpointer attr)
+{
+  ipp_attribute_free ((IPPAttribute *) attr);
+}
+
+static IPPAttribute *
+ipp_attribute_new_from_ipp (ipp_attribute_t *attr,
+                            const gchar     *name)
+{
+  IPPAttribute *attribute;
+  gint          i;
+
+  if (attr == NULL || ippGetCount (attr) <= 0 || ippGetValueTag (attr) == IPP_TAG_NOVALUE)
+    return NULL;
+
+  attribute = g_new0 (IPPAttribute, 1);
+  attribute->attribute_name = g_strdup (name);
+  attribute->attribute_values = g_new0 (IPPAttributeValue, ippGetCount (attr));
+  attribute->num_of_values = ippGetCount (attr);
+
+  if (ippGetValueTag (attr) == IPP_TAG_INTEGER ||
+      ippGetValueTag (attr) == IPP_TAG_ENUM)
+    {
+      attribute->attribute_type = IPP_ATTRIBUTE_TYPE_INTEGER;
+
+      for (i = 0; i < ippGetCount (attr); i++)
+        attribute->attribute_values[i].integer_value = ippGetInteger (attr, i);
+    }
+  else if (ippGetValueTag (attr) == IPP_TAG_NAME ||
+           ippGetValueTag (attr) == IPP_TAG_STRING ||
+           ippGetValueTag (attr) == IPP_TAG_TEXT ||
+           ippGetValueTag (attr) == IPP_TAG_URI ||
+           ippGetValueTag (attr) == IPP_TAG_KEYWORD ||
+           ippGetValueTag (attr) == IPP_TAG_URISCHEME)
+    {
+      attribute->attribute_type = IPP_ATTRIBUTE_TYPE_STRING;
+
+      for (i = 0; i < ippGetCount (attr); i++)
+        attribute->attribute_values[i].string_value = g_strdup (ippGetString (attr, i, NULL));
+    }
+  else if (ippGetValueTag (attr) == IPP_TAG_RANGE)
+    {
+      attribute->attribute_type = IPP_ATTRIBUTE_TYPE_RANGE;
+
+      for (i = 0; i < ippGetCount (attr); i++)
+        {
+          attribute->attribute_values[i].lower_range =
+            ippGetRange (attr, i, &(attribute->attribute_values[i].upper_range));
+        }
+    }
+  else if (ippGetValueTag (attr) == IPP_TAG_BOOLEAN)
+    {
+      attribute->attribute_type = IPP_ATTRIBUTE_TYPE_BOOLEAN;
+
+      for (i = 0; i < ippGetCount (attr); i++)
+        attribute->attribute_values[i].boolean_value = ippGetBoolean (attr, i);
+    }
+
+  return attribute;
+}
+
+/*
+ * Converts the attributes named @names found in @attributes, a table of
+ * ipp_attribute_t, to a table of IPPAttribute. Returns NULL if none of
+ * them was found.
+ */
+static GHashTable *
+attributes_table_new (GHashTable  *attributes,
+                      gchar      **names)
+{
+  GHashTable *result = NULL;
+  gint        i;
+
+  for (i = 0; names[i] != NULL; i++)
+    {
+      IPPAttribute *attribute;
+
+      attribute = ipp_attribute_new_from_ipp (g_hash_table_lookup (attributes, names[i]), names[i]);
+      if (attribute == NULL)
+        continue;
+
+      if (result == NULL)
+        result = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, ipp_attribute_free2);
+
+      g_hash_table_insert (result, g_strdup (names[i]), attribute);
+    }
+
+  return result;
+}
+
+static GHashTable *
+attributes_table_copy (GHashTable *table)
+{
+  GHashTableIter  iter;
+  GHashTable     *result;
+  gpointer        key, value;
+
+  if (table == NULL)
+    return NULL;
+
+  result = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, ipp_attribute_free2);
+
+  g_hash_table_iter_init (&iter, table);
+  while (g_hash_table_iter_next (&iter, &key, &value))
+    g_hash_table_insert (result, g_strdup (key), ipp_attribute_copy (value));
+
+  return result;
+}
+
+/* Every task waiting for @request gets its own copy of @table */
+static void
+request_return_attributes (Request    *request,
+                           GHashTable *table)
+{
+  GList *l;
+
+  for (l = request->tasks; l != NULL; l = l->next)
+    {
+      g_task_return_pointer (l->data,
+                             l->next ? attributes_table_copy (table) : table,
+                             (GDestroyNotify) g_hash_table_unref);
+    }
+}
+
+/* Maps the names of the attributes in the current group of @response */
+static GHashTable *
+read_attributes_group (ipp_t            *response,
+                       ipp_attribute_t **attr)
+{
+  GHashTable *attributes;
+
+  attributes = g_hash_table_new (g_str_hash, g_str_equal);
+
+  while (*attr != NULL && ippGetGroupTag (*attr) == IPP_TAG_PRINTER)
+    {
+      if (ippGetName (*attr) != NULL)
+        g_hash_table_insert (attributes, (gpointer) ippGetName (*attr), *attr);
+
+      *attr = ippNextAttribute (response);
+    }
+
+  return attributes;
+}
+
+static void
+handle_get_printer_attributes (http_t  *http,
+                               Request *request)
+{
+  GHashTable *attributes = NULL;
+  GHashTable *result = NULL;
+  ipp_attribute_t *attr;
+  ipp_t      *response;
+  ipp_t      *ipp_request;
+  gchar      *printer_uri;
+
+  printer_uri = g_strdup_printf ("ipp://localhost/printers/%s", request->printer_name);
+
+  ipp_request = ippNewRequest (IPP_GET_PRINTER_ATTRIBUTES);
+  ippAddString (ipp_request, IPP_TAG_OPERATION, IPP_TAG_URI,
+                "printer-uri", NULL, printer_uri);
+  ippAddStrings (ipp_request, IPP_TAG_OPERATION, IPP_TAG_KEYWORD,
+                 "requested-attributes", g_strv_length (request->attributes), NULL,
+                 (const char **) request->attributes);
+  response = cupsDoRequest (http, ipp_request, "/");
+
+  if (response != NULL && ippGetStatusCode (response) <= IPP_OK_CONFLICT)
+    {
+      for (attr = ippFirstAttribute (response); attr != NULL; attr = ippNextAttribute (response))
+        {
+          if (ippGetGroupTag (attr) == IPP_TAG_PRINTER)
+            break;
+        }
+
+      attributes = read_attributes_group (response, &attr);
+      result = attributes_table_new (attributes, request->attributes);
+      g_hash_table_destroy (attributes);
+    }
+
+  request_return_attributes (request, result);
+
+  ippDelete (response);
+  g_free (printer_uri);
+}
+
+/*
+ * Gets the attributes of several printers with one request. Returns the
+ * requests which could not be answered this way, e.g. because the printer
+ * is not listed by CUPS-Get-Printers.
+ */
+static GList *
+handle_get_printers_attributes (http_t *http,
+                                GList  *requests)
+{
+  ipp_attribute_t *attr;
+  GHashTable      *names;
+  GHashTable      *attributes;
+  GPtrArray       *requested_attributes;
+  GList           *remaining = NULL;
+  GList           *l;
+  ipp_t           *ipp_request;
+  ipp_t           *response;
+  gint             i;
+
+  names = g_hash_table_new (g_str_hash, g_str_equal);
+  g_hash_table_add (names, "printer-name");
+  for (l = requests; l != NULL; l = l->next)
+    {
+      Request *request = l->data;
+
+      for (i = 0; request->attributes[i] != NULL; i++)
+        g_hash_table_add (names, request->attributes[i]);
+    }
+
+  requested_attributes = g_ptr_array_new ();
+  for (l = g_hash_table_get_keys (names); l != NULL; l = g_list_delete_link (l, l))
+    g_ptr_array_add (requested_attributes, l->data);
+
+  ipp_request = ippNewRequest (CUPS_GET_PRINTERS);
+  ippAddStrings (ipp_request, IPP_TAG_OPERATION, IPP_TAG_KEYWORD,
+                 "requested-attributes", requested_attributes->len, NULL,
+                 (const char **) requested_attributes->pdata);
+  response = cupsDoRequest (http, ipp_request, "/");
+
+  g_ptr_array_free (requested_attributes, TRUE);
+  g_hash_table_destroy (names);
+
+  if (response == NULL || ippGetStatusCode (response) > IPP_OK_CONFLICT)
+    {
+      ippDelete (response);
+      return g_list_copy (requests);
+    }
+
+  remaining = g_list_copy (requests);
+
+  attr = ippFirstAttribute (response);
+  while (attr != NULL)
+    {
+      const gchar *printer_name = NULL;
+
+      while (attr != NULL && ippGetGroupTag (attr) != IPP_TAG_PRINTER)
+        attr = ippNextAttribute (response);
+
+      if (attr == NULL)
+        break;
+
+      attributes = read_attributes_group (response, &attr);
+
+      if (g_hash_table_contains (attributes, "printer-name"))
+        printer_name = ippGetString (g_hash_table_lookup (attributes, "printer-name"), 0, NULL);
+
+      for (l = remaining; l != NULL && printer_name != NULL; )
+        {
+          Request *request = l->data;
+          GList   *next = l->next;
+
+          if (g_strcmp0 (request->printer_name, printer_name) == 0)
+            {
+              request_return_attributes (request, attributes_table_new (attributes, request->attributes));
+              remaining = g_list_delete_link (remaining, l);
+            }
+
+          l = next;
+        }
+
+      g_hash_table_destroy (attributes);
+    }
+
+  ippDelete (response);
+
+  return remaining;
+}
+
+static void
+handle_get_named_dest (http_t  *http,
+                       Request *request)
+{
+  cups_dest_t *dest;
+  GList       *l;
+
+  dest = http ? cupsGetNamedDest (http, request->printer_name, NULL) : NULL;
+
+  for (l = request->tasks; l != NULL; l = l->next)
+    {
+      cups_dest_t *copy = NULL;
+
+      if (dest != NULL && l->next != NULL)
+        cupsCopyDest (dest, 0, &copy);
+      else
+        copy = g_steal_pointer (&dest);
+
+      g_task_return_pointer (l->data, copy, (GDestroyNotify) pp_cups_dest_free);
+    }
+}
+
+static void
+handle_get_ppd (http_t  *http,
+                Request *request)
+{
+  const gchar *ppd_filename = NULL;
+  http_t      *host_http = NULL;
+
+  if (request->host_name != NULL)
+    {
+      host_http = httpConnect (request->host_name, request->port);
+      if (host_http != NULL)
+        ppd_filename = cupsGetPPD2 (host_http, request->printer_name);
+    }
+  else if (http != NULL)
+    {
+      ppd_filename = cupsGetPPD2 (http, request->printer_name);
+    }
+
+  /* PPDs are not shared, every caller removes its own copy */
+  g_task_return_pointer (request->tasks->data, g_strdup (ppd_filename), g_free);
+
+  if (host_http != NULL)
+    httpClose (host_http);
+}
+
+/* Jobs are requested in pages, so that a long queue is not
+ * transferred in a single response */
+#define JOBS_PAGE_SIZE 500
+
+static void
+jobs_free (GList *jobs)
+{
+  g_list_free_full (jobs, g_object_unref);
+}
+
+/* Parses the jobs of one Get-Jobs response, returns the number of jobs
+ * it contained; jobs already in @seen are skipped */
+static gint
+append_jobs (ipp_t       *response,
+             GHashTable  *seen,
+             GList      **list)
+{
+  ipp_attribute_t *attr;
+  const gchar     *title;
+  gint             num_jobs = 0;
+  gint             id;
+  gint             state;
+
+  attr = ippFirstAttribute (response);
+  while (attr != NULL)
+    {
+      while (attr != NULL && ippGetGroupTag (attr) != IPP_TAG_JOB)
+        attr = ippNextAttribute (response);
+
+      if (attr == NULL)
+        break;
+
+      id = 0;
+      state = IPP_JOB_PENDING;
+      title = NULL;
+
+      while (attr != NULL && ippGetGroupTag (attr) == IPP_TAG_JOB)
+        {
+          if (g_strcmp0 (ippGetName (attr), "job-id") == 0 &&
+              ippGetValueTag (attr) == IPP_TAG_INTEGER)
+            id = ippGetInteger (attr, 0);
+          else if (g_strcmp0 (ippGetName (attr), "job-state") == 0 &&
+                   ippGetValueTag (attr) == IPP_TAG_ENUM)
+            state = ippGetInteger (attr, 0);
+          else if (g_strcmp0 (ippGetName (attr), "job-name") == 0)
+            title = ippGetString (attr, 0, NULL);
+
+          attr = ippNextAttribute (response);
+        }
+
+      num_jobs++;
+
+      if (id == 0 || g_hash_table_contains (seen, GINT_TO_POINTER (id)))
+        continue;
+
+      g_hash_table_add (seen, GINT_TO_POINTER (id));
+      *list = g_list_prepend (*list, g_object_new (pp_job_get_type (),
+                                                   "id",    id,
+                                                   "title", title,
+                                                   "state", state,
+                                                   NULL));
+    }
+
+  return num_jobs;
+}
+
+static void
+handle_get_jobs (http_t  *http,
+                 Request *request)
+{
+  static const char * const requested_attributes[] =
+    {
+      "job-id",
+      "job-name",
+      "job-state"
+    };
+  GHashTable  *seen;
+  const gchar *which_jobs;
+  ipp_t       *ipp_request;
+  ipp_t       *response;
+  gchar       *printer_uri;
+  GList       *jobs = NULL;
+  GList       *l;
+  guint        num_seen;
+  gint         first_index;
+  gint         num_jobs;
+
+  printer_uri = g_strdup_printf ("ipp://localhost/printers/%s", request->printer_name);
+
+  switch (request->which_jobs)
+    {
+      case CUPS_WHICHJOBS_ALL:
+        which_jobs = "all";
+        break;
+      case CUPS_WHICHJOBS_COMPLETED:
+        which_jobs = "completed";
+        break;
+      default:
+        which_jobs = "not-completed";
+        break;
+    }
+
+  seen = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+  for (first_index = 1; http != NULL; first_index += num_jobs)
+    {
+      /* Stop paging through a long queue once nobody waits for it */
+      if (first_index > 1 && request_is_cancelled (request))
+        break;
+
+      ipp_request = ippNewRequest (IPP_GET_JOBS);
+      ippAddString (ipp_request, IPP_TAG_OPERATION, IPP_TAG_URI,
+                    "printer-uri", NULL, printer_uri);
+      ippAddString (ipp_request, IPP_TAG_OPERATION, IPP_TAG_NAME,
+                    "requesting-user-name", NULL, cupsUser ());
+      ippAddString (ipp_request, IPP_TAG_OPERATION, IPP_TAG_KEYWORD,
+                    "which-jobs", NULL, which_jobs);
+      if (request->my_jobs)
+        ippAddBoolean (ipp_request, IPP_TAG_OPERATION, "my-jobs", 1);
+      ippAddInteger (ipp_request, IPP_TAG_OPERATION, IPP_TAG_INTEGER,
+                     "first-index", first_index);
+      ippAddInteger (ipp_request, IPP_TAG_OPERATION, IPP_TAG_INTEGER,
+                     "limit", JOBS_PAGE_SIZE);
+      ippAddStrings (ipp_request, IPP_TAG_OPERATION, IPP_TAG_KEYWORD,
+                     "requested-attributes", G_N_ELEMENTS (requested_attributes),
+                     NULL, requested_attributes);
+
+      response = cupsDoRequest (http, ipp_request, "/");
+      if (response == NULL)
+        break;
+
+      num_seen = g_hash_table_size (seen);
+      num_jobs = append_jobs (response, seen, &jobs);
+      ippDelete (response);
+
+      /* Servers not supporting "first-index" return the first page again */
+      if (num_jobs < JOBS_PAGE_SIZE || g_hash_table_size (seen) == num_seen)
+        break;
+    }
+
+  jobs = g_list_reverse (jobs);
+
+  for (l = request->tasks; l != NULL; l = l->next)
+    {
+      g_task_return_pointer (l->data,
+                             l->next ? g_list_copy_deep (jobs, (GCopyFunc) g_object_ref, NULL) : g_steal_pointer (&jobs),
+                             (GDestroyNotify) jobs_free);
+    }
+
+  jobs_free (jobs);
+  g_hash_table_destroy (seen);
+  g_free (printer_uri);
+}
+
+static void
+handle_requests (http_t *http,
+                 GList  *requests)
+{
+  GHashTable *printers;
+  GList      *attribute_requests = NULL;
+  GList      *l;
+
+  printers = g_hash_table_new (g_str_hash, g_str_equal);
+
+  for (l = requests; l != NULL; l = l->next)
+    {
+      Request *request = l->data;
+
+      if (request_is_cancelled (request))
+        continue;
+
+      if (request->type == REQUEST_GET_PRINTER_ATTRIBUTES)
+        {
+          attribute_requests = g_list_prepend (attribute_requests, request);
+          g_hash_table_add (printers, request->printer_name);
+        }
+      else if (request->type == REQUEST_GET_PPD)
+        {
+          handle_get_ppd (http, request);
+        }
+      else if (request->type == REQUEST_GET_JOBS)
+        {
+          handle_get_jobs (http, request);
+        }
+      else
+        {
+          handle_get_named_dest (http, request);
+        }
+    }
+
+  attribute_requests = g_list_reverse (attribute_requests);
+
+  if (http != NULL && g_hash_table_size (printers) > 1)
+    attribute_requests = handle_get_printers_attributes (http, attribute_requests);
+
+  for (l = attribute_requests; l != NULL; l = l->next)
+    {
+      if (http != NULL)
+        handle_get_printer_attributes (http, l->data);
+      else
+        request_return_attributes (l->data, NULL);
+    }
+
+  g_list_free (attribute_requests);
+  g_hash_table_destroy (printers);
+}
+
+static gpointer
+engine_thread (gpointer user_data)
+{
+  http_t *http = NULL;
+  GList  *requests;
+  gint64  end_time;
+
+  while (TRUE)
+    {
+      g_mutex_lock (&engine_mutex);
+
+      end_time = g_get_monotonic_time () + ENGINE_IDLE_TIMEOUT;
+      while (g_queue_is_empty (&engine_requests))
+        {
+          if (!g_cond_wait_until (&engine_cond, &engine_mutex, end_time) &&
+              g_queue_is_empty (&engine_requests))
+            {
+              engine_running = FALSE;
+              g_mutex_unlock (&engine_mutex);
+
+              if (http != NULL)
+                httpClose (http);
+
+              return NULL;
+            }
+        }
+
+      /* Take everything which was queued in the meantime */
+      requests = engine_requests.head;
+      g_queue_init (&engine_requests);
+
+      g_mutex_unlock (&engine_mutex);
+
+      if (http == NULL)
+        http = httpConnectEncrypt (cupsServer (), ippPort (), cupsEncryption ());
+
+      handle_requests (http, requests);
+
+      g_list_free_full (requests, (GDestroyNotify) request_free);
+    }
+
+  return NULL;
+}
+
+static gboolean
+strv_equal (gchar **a,
+            gchar **b)
+{
+  gint i;
+
+  if (a == NULL || b == NULL)
+    return a == b;
+
+  for (i = 0; a[i] != NULL && b[i] != NULL; i++)
+    {
+      if (g_strcmp0 (a[i], b[i]) != 0)
+        return FALSE;
+    }
+
+  return a[i] == NULL && b[i] == NULL;
+}
+
+static gint
+compare_attribute_names (gconstpointer a,
+                         gconstpointer b)
+{
+  return g_strcmp0 (*(const gchar **) a, *(const gchar **) b);
+}
+
+/* Queues a request for @task, or adds @task to an identical queued request */
+static void
+engine_push (RequestType   type,
+             const gchar  *printer_name,
+             gchar       **attributes,
+             const gchar  *host_name,
+             gint          port,
+             gboolean      my_jobs,
+             gint          which_jobs,
+             GTask        *task)
+{
+  Request *request = NULL;
+  GList   *l;
+
+  g_mutex_lock (&engine_mutex);
+
+  if (type != REQUEST_GET_PPD)
+    {
+      for (l = engine_requests.head; l != NULL; l = l->next)
+        {
+          Request *queued = l->data;
+
+          if (queued->type == type &&
+              g_strcmp0 (queued->printer_name, printer_name) == 0 &&
+              strv_equal (queued->attributes, attributes) &&
+              queued->my_jobs == my_jobs &&
+              queued->which_jobs == which_jobs)
+            {
+              request = queued;
+              break;
+            }
+        }
+    }
+
+  if (request == NULL)
+    {
+      request = g_slice_new0 (Request);
+      request->type = type;
+      request->printer_name = g_strdup (printer_name);
+      request->attributes = g_strdupv (attributes);
+      request->host_name = g_strdup (host_name);
+      request->port = port;
+      request->my_jobs = my_jobs;
+      request->which_jobs = which_jobs;
+
+      g_queue_push_tail (&engine_requests, request);
+    }
+
+  request->tasks = g_list_append (request->tasks, g_object_ref (task));
+
+  if (!engine_running)
+    {
+      engine_running = TRUE;
+      g_thread_unref (g_thread_new ("pp-cups-engine", engine_thread, NULL));
+    }
+  else
+    {
+      g_cond_signal (&engine_cond);
+    }
+
+  g_mutex_unlock (&engine_mutex);
+}
+
+/**
+ * pp_cups_get_printer_attributes_async:
+ * @attributes: names of the requested attributes
+ *
+ * Gets the attributes of the printer. Identical queries are sent only
+ * once, and queries for several printers are batched.
+ */
+void
+pp_cups_get_printer_attributes_async (PpCups              *cups,
+                                      const gchar         *printer_name,
+                                      gchar              **attributes,
+                                      GCancellable        *cancellable,
+                                      GAsyncReadyCallback  callback,
+                                      gpointer             user_data)
+{
+  GTask  *task;
+  gchar **sorted_attributes;
+
+  task = g_task_new (cups, cancellable, callback, user_data);
+
+  if (printer_name == NULL || attributes == NULL || attributes[0] == NULL)
+    {
+      g_task_return_pointer (task, NULL, NULL);
+      g_object_unref (task);
+      return;
+    }
+
+  /* Sorted so that the same attributes in another order are coalesced */
+  sorted_attributes = g_strdupv (attributes);
+  qsort (sorted_attributes, g_strv_length (sorted_attributes), sizeof (gchar *), compare_attribute_names);
+
+  engine_push (REQUEST_GET_PRINTER_ATTRIBUTES, printer_name, sorted_attributes, NULL, 0, FALSE, 0, task);
+
+  g_strfreev (sorted_attributes);
+  g_object_unref (task);
+}
+
+/**
+ * pp_cups_get_printer_attributes_finish:
+ *
+ * Returns: (transfer full) (nullable): a table mapping names of attributes
+ *     to #IPPAttribute, or %NULL if none of them was found
+ */
+GHashTable *
+pp_cups_get_printer_attributes_finish (PpCups        *cups,
+                                       GAsyncResult  *result,
+                                       GError       **error)
+{
+  g_return_val_if_fail (g_task_is_valid (result, cups), NULL);
+
+  return g_task_propagate_pointer (G_TASK (result), error);
+}
+
+void
+pp_cups_get_named_dest_async (PpCups              *cups,
+                              const gchar         *printer_name,
+                              GCancellable        *cancellable,
+                              GAsyncReadyCallback  callback,
+                              gpointer             user_data)
+{
+  GTask *task;
+
+  task = g_task_new (cups, cancellable, callback, user_data);
+  engine_push (REQUEST_GET_NAMED_DEST, printer_name, NULL, NULL, 0, FALSE, 0, task);
+  g_object_unref (task);
+}
+
+/* Returns: (transfer full): free it with pp_cups_dest_free() */
+cups_dest_t *
+pp_cups_get_named_dest_finish (PpCups        *cups,
+                               GAsyncResult  *result,
+                               GError       **error)
+{
+  g_return_val_if_fail (g_task_is_valid (result, cups), NULL);
+
+  return g_task_propagate_pointer (G_TASK (result), error);
+}
+
+void
+pp_cups_dest_free (cups_dest_t *dest)
+{
+  cupsFreeDests (1, dest);
+}
+
+/* Gets the PPD of the printer from the local server or from @host_name */
+void
+pp_cups_get_ppd_async (PpCups              *cups,
+                       const gchar         *printer_name,
+                       const gchar         *host_name,
+                       gint                 port,
+                       GCancellable        *cancellable,
+                       GAsyncReadyCallback  callback,
+                       gpointer             user_data)
+{
+  GTask *task;
+
+  task = g_task_new (cups, cancellable, callback, user_data);
+  engine_push (REQUEST_GET_PPD, printer_name, NULL, host_name, port, FALSE, 0, task);
+  g_object_unref (task);
+}
+
+/* Returns: (transfer full): the name of a temporary copy of the PPD */
+gchar *
+pp_cups_get_ppd_finish (PpCups        *cups,
+                        GAsyncResult  *result,
+                        GError       **error)
+{
+  g_return_val_if_fail (g_task_is_valid (result, cups), NULL);
+
+  return g_task_propagate_pointer (G_TASK (result), error);
+}
+
+/**
+ * pp_cups_get_jobs_async:
+ * @which_jobs: one of CUPS_WHICHJOBS_ALL, CUPS_WHICHJOBS_ACTIVE and
+ *     CUPS_WHICHJOBS_COMPLETED
+ *
+ * Gets the jobs of the printer, page by page over the connection shared
+ * with the other queries.
+ */
+void
+pp_cups_get_jobs_async (PpCups              *cups,
+                        const gchar         *printer_name,
+                        gboolean             my_jobs,
+                        gint                 which_jobs,
+                        GCancellable        *cancellable,
+                        GAsyncReadyCallback  callback,
+                        gpointer             user_data)
+{
+  GTask *task;
+
+  task = g_task_new (cups, cancellable, callback, user_data);
+  engine_push (REQUEST_GET_JOBS, printer_name, NULL, NULL, 0, my_jobs, which_jobs, task);
+  g_object_unref (task);
+}
+
+/* Returns: (transfer full) (element-type PpJob): the jobs, oldest first */
+GList *
+pp_cups_get_jobs_finish (PpCups        *cups,
+                         GAsyncResult  *result,
+                         GError       **error)
+{
+  g_return_val_if_fail (g_task_is_valid (result, cups), NULL);
+
+  return g_task_propagate_pointer (G_TASK (result), error);
+}
+
 static void
 pp_cups_dests_free (PpCupsDests *dests)
 {
@@ -91,6 +91,53 @@ void         pp_cups_renew_subscription_async  (PpCups                *cups,
 gint         pp_cups_renew_subscription_finish (PpCups                *cups,
                                                 GAsyncResult          *result);
 
+void         pp_cups_get_printer_attributes_async  (PpCups               *cups,
+                                                    const gchar          *printer_name,
+                                                    gchar               **attributes,
+                                                    GCancellable         *cancellable,
+                                                    GAsyncReadyCallback   callback,
+                                                    gpointer              user_data);
+
+GHashTable  *pp_cups_get_printer_attributes_finish (PpCups               *cups,
+                                                    GAsyncResult         *result,
+                                                    GError              **error);
+
+void         pp_cups_get_named_dest_async  (PpCups               *cups,
+                                            const gchar          *printer_name,
+                                            GCancellable         *cancellable,
+                                            GAsyncReadyCallback   callback,
+                                            gpointer              user_data);
+
+cups_dest_t *pp_cups_get_named_dest_finish (PpCups               *cups,
+                                            GAsyncResult         *result,
+                                            GError              **error);
+
+void         pp_cups_dest_free             (cups_dest_t          *dest);
+
+void         pp_cups_get_ppd_async  (PpCups               *cups,
+                                     const gchar          *printer_name,
+                                     const gchar          *host_name,
+                                     gint                  port,
+                                     GCancellable         *cancellable,
+                                     GAsyncReadyCallback   callback,
+                                     gpointer              user_data);
+
+gchar       *pp_cups_get_ppd_finish (PpCups               *cups,
+                                     GAsyncResult         *result,
+                                     GError              **error);
+
+void         pp_cups_get_jobs_async  (PpCups               *cups,
+                                      const gchar          *printer_name,
+                                      gboolean              my_jobs,
+                                      gint                  which_jobs,
+                                      GCancellable         *cancellable,
+                                      GAsyncReadyCallback   callback,
+                                      gpointer              user_data);
+
+GList       *pp_cups_get_jobs_finish (PpCups               *cups,
+                                      GAsyncResult         *result,
+                                      GError              **error);
+
 G_END_DECLS
 
 #endif /* __PP_CUPS_H__ */
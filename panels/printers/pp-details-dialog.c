@@ -56,6 +56,7 @@ struct _PpDetailsDialog {
   gchar        *ppd_file_name;
   PPDList      *all_ppds_list;
   GCancellable *get_all_ppds_cancellable;
+  GCancellable *load_ppds_cache_cancellable;
   GCancellable *get_ppd_names_cancellable;
 
   /* Dialogs */
@@ -243,14 +244,41 @@ get_all_ppds_async_cb (PPDList  *ppds,
 {
   PpDetailsDialog *self = user_data;
 
+  /* Keep the cached list if CUPS could not be asked */
+  if (ppds)
+    {
+      ppd_list_free (self->all_ppds_list);
+      self->all_ppds_list = ppds;
+
+      if (self->pp_ppd_selection_dialog)
+        pp_ppd_selection_dialog_set_ppd_list (self->pp_ppd_selection_dialog,
+                                              self->all_ppds_list);
+    }
+
+  g_object_unref (self->get_all_ppds_cancellable);
+  self->get_all_ppds_cancellable = NULL;
+}
+
+static void
+ppds_cache_loaded_cb (PPDList  *ppds,
+                      gpointer  user_data)
+{
+  PpDetailsDialog *self = user_data;
+
+  g_clear_object (&self->load_ppds_cache_cancellable);
+
+  /* CUPS may have answered first */
+  if (ppds == NULL || self->all_ppds_list != NULL)
+    {
+      ppd_list_free (ppds);
+      return;
+    }
+
   self->all_ppds_list = ppds;
 
   if (self->pp_ppd_selection_dialog)
     pp_ppd_selection_dialog_set_ppd_list (self->pp_ppd_selection_dialog,
                                           self->all_ppds_list);
-
-  g_object_unref (self->get_all_ppds_cancellable);
-  self->get_all_ppds_cancellable = NULL;
 }
 
 static void
@@ -288,8 +316,11 @@ select_ppd_in_dialog (GtkButton       *button,
           manufacturer = g_strdup ("Raw");
         }
 
-       if (self->all_ppds_list == NULL)
+       if (self->all_ppds_list == NULL &&
+           self->get_all_ppds_cancellable == NULL)
          {
+           self->load_ppds_cache_cancellable = g_cancellable_new ();
+           ppd_list_load_from_cache_async (self->load_ppds_cache_cancellable, ppds_cache_loaded_cb, self);
            self->get_all_ppds_cancellable = g_cancellable_new ();
            get_all_ppds_async (self->get_all_ppds_cancellable, get_all_ppds_async_cb, self);
          }
@@ -449,6 +480,12 @@ pp_details_dialog_free (PpDetailsDialog *self)
           g_clear_object (&self->get_all_ppds_cancellable);
         }
 
+      if (self->load_ppds_cache_cancellable != NULL)
+        {
+          g_cancellable_cancel (self->load_ppds_cache_cancellable);
+          g_clear_object (&self->load_ppds_cache_cancellable);
+        }
+
       if (self->get_ppd_names_cancellable != NULL)
         {
           g_cancellable_cancel (self->get_ppd_names_cancellable);
@@ -0,0 +1,489 @@
+/*
+ * Copyright 2017 Red Hat, Inc
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include "pp-discovery.h"
+
+#include "pp-host.h"
+#include "pp-samba.h"
+#include "pp-utils.h"
+
+/*
+ * PpDiscovery probes one host with all requested backends at once.
+ *
+ * Devices are announced by "device-found" as soon as the backend which
+ * found them returns. Backends often find the same device (e.g. SNMP and
+ * JetDirect both report socket://host:9100), so devices are keyed by their
+ * canonical URI; a duplicate is dropped, or announced by "device-replaced"
+ * if it carries more information than the device found first.
+ *
+ * Every backend has a deadline. When it passes, the backend is cancelled and
+ * counted as done right away, so that "finished" is not held back by a host
+ * which does not answer. Whatever the backend returns afterwards is dropped.
+ */
+
+enum
+{
+  BACKEND_REMOTE_CUPS = 0,
+  BACKEND_SNMP,
+  BACKEND_JETDIRECT,
+  BACKEND_LPD,
+  BACKEND_SAMBA,
+  N_BACKENDS
+};
+
+/* In milliseconds, the LPD backend tries many queue names one by one */
+static const guint default_deadlines[N_BACKENDS] =
+{
+  5000,  /* remote CUPS */
+  5000,  /* SNMP */
+  3000,  /* JetDirect */
+  10000, /* LPD */
+  10000  /* Samba */
+};
+
+typedef struct
+{
+  PpDiscovery  *discovery;
+  PpHost       *host;
+  GCancellable *cancellable;
+  guint         deadline_id;
+  gint          backend;
+  gboolean      running;
+} Probe;
+
+struct _PpDiscovery
+{
+  GObject       parent_instance;
+
+  gchar        *hostname;
+  gint          ports[N_BACKENDS];
+  guint         deadlines[N_BACKENDS];
+
+  GCancellable *cancellable;
+  gulong        cancelled_id;
+
+  /* Canonical URI -> PpPrintDevice */
+  GHashTable   *devices;
+
+  Probe        *probes[N_BACKENDS];
+  guint         n_running;
+};
+
+G_DEFINE_TYPE (PpDiscovery, pp_discovery, G_TYPE_OBJECT)
+
+enum
+{
+  DEVICE_FOUND,
+  DEVICE_REPLACED,
+  FINISHED,
+  LAST_SIGNAL
+};
+
+static guint signals[LAST_SIGNAL] = { 0 };
+
+static void
+probe_free (Probe *probe)
+{
+  g_clear_object (&probe->cancellable);
+  g_clear_object (&probe->host);
+  g_object_unref (probe->discovery);
+  g_free (probe);
+}
+
+static void
+disconnect_cancellable (PpDiscovery *self)
+{
+  if (self->cancelled_id != 0)
+    {
+      g_cancellable_disconnect (self->cancellable, self->cancelled_id);
+      self->cancelled_id = 0;
+    }
+
+  g_clear_object (&self->cancellable);
+}
+
+static void
+probe_finish (Probe *probe)
+{
+  PpDiscovery *self = probe->discovery;
+
+  if (!probe->running)
+    return;
+
+  probe->running = FALSE;
+
+  if (probe->deadline_id != 0)
+    {
+      g_source_remove (probe->deadline_id);
+      probe->deadline_id = 0;
+    }
+
+  self->probes[probe->backend] = NULL;
+  self->n_running--;
+
+  if (self->n_running == 0)
+    {
+      disconnect_cancellable (self);
+      g_signal_emit (self, signals[FINISHED], 0);
+    }
+}
+
+static gint
+get_device_score (PpPrintDevice *device)
+{
+  gint score = 0;
+
+  if (pp_print_device_get_device_id (device) != NULL)
+    score += 2;
+
+  if (pp_print_device_get_device_make_and_model (device) != NULL)
+    score += 1;
+
+  return score;
+}
+
+static void
+add_device (PpDiscovery   *self,
+            PpPrintDevice *device)
+{
+  PpPrintDevice *known_device;
+  gchar         *key;
+
+  key = canonicalize_device_uri (pp_print_device_get_device_uri (device));
+  if (key == NULL)
+    {
+      /* E.g. a Samba server which needs authentication */
+      g_signal_emit (self, signals[DEVICE_FOUND], 0, device);
+      return;
+    }
+
+  known_device = g_hash_table_lookup (self->devices, key);
+  if (known_device == NULL)
+    {
+      g_hash_table_insert (self->devices, key, g_object_ref (device));
+      g_signal_emit (self, signals[DEVICE_FOUND], 0, device);
+    }
+  else if (get_device_score (device) > get_device_score (known_device))
+    {
+      g_object_ref (known_device);
+      g_hash_table_insert (self->devices, key, g_object_ref (device));
+      g_signal_emit (self, signals[DEVICE_REPLACED], 0, known_device, device);
+      g_object_unref (known_device);
+    }
+  else
+    {
+      g_free (key);
+    }
+}
+
+static void
+probe_done_cb (GObject      *source_object,
+               GAsyncResult *res,
+               gpointer      user_data)
+{
+  PpDevicesList *result = NULL;
+  GError        *error = NULL;
+  Probe         *probe = user_data;
+  GList         *iter;
+
+  switch (probe->backend)
+    {
+      case BACKEND_REMOTE_CUPS:
+        result = pp_host_get_remote_cups_devices_finish (probe->host, res, &error);
+        break;
+      case BACKEND_SNMP:
+        result = pp_host_get_snmp_devices_finish (probe->host, res, &error);
+        break;
+      case BACKEND_JETDIRECT:
+        result = pp_host_get_jetdirect_devices_finish (probe->host, res, &error);
+        break;
+      case BACKEND_LPD:
+        result = pp_host_get_lpd_devices_finish (probe->host, res, &error);
+        break;
+      case BACKEND_SAMBA:
+        result = pp_samba_get_devices_finish (PP_SAMBA (probe->host), res, &error);
+        break;
+    }
+
+  if (result != NULL)
+    {
+      if (probe->running && !g_cancellable_is_cancelled (probe->cancellable))
+        {
+          for (iter = result->devices; iter != NULL; iter = iter->next)
+            add_device (probe->discovery, iter->data);
+        }
+
+      pp_devices_list_free (result);
+    }
+  else
+    {
+      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        g_warning ("%s", error->message);
+
+      g_error_free (error);
+    }
+
+  probe_finish (probe);
+  probe_free (probe);
+}
+
+static gboolean
+probe_deadline_cb (gpointer user_data)
+{
+  Probe *probe = user_data;
+
+  g_debug ("Discovery backend %d on %s timed out",
+           probe->backend,
+           probe->discovery->hostname);
+
+  probe->deadline_id = 0;
+  g_cancellable_cancel (probe->cancellable);
+  probe_finish (probe);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+probe_start (PpDiscovery *self,
+             gint         backend)
+{
+  Probe *probe;
+
+  probe = g_new0 (Probe, 1);
+  probe->discovery = g_object_ref (self);
+  probe->cancellable = g_cancellable_new ();
+  probe->backend = backend;
+  probe->running = TRUE;
+
+  if (backend == BACKEND_SAMBA)
+    probe->host = PP_HOST (pp_samba_new (self->hostname));
+  else
+    probe->host = pp_host_new (self->hostname);
+
+  if (self->ports[backend] != PP_HOST_UNSET_PORT)
+    g_object_set (probe->host, "port", self->ports[backend], NULL);
+
+  if (self->deadlines[backend] > 0)
+    probe->deadline_id = g_timeout_add (self->deadlines[backend], probe_deadline_cb, probe);
+
+  self->probes[backend] = probe;
+  self->n_running++;
+
+  switch (backend)
+    {
+      case BACKEND_REMOTE_CUPS:
+        pp_host_get_remote_cups_devices_async (probe->host, probe->cancellable, probe_done_cb, probe);
+        break;
+      case BACKEND_SNMP:
+        pp_host_get_snmp_devices_async (probe->host, probe->cancellable, probe_done_cb, probe);
+        break;
+      case BACKEND_JETDIRECT:
+        pp_host_get_jetdirect_devices_async (probe->host, probe->cancellable, probe_done_cb, probe);
+        break;
+      case BACKEND_LPD:
+        pp_host_get_lpd_devices_async (probe->host, probe->cancellable, probe_done_cb, probe);
+        break;
+      case BACKEND_SAMBA:
+        /* Servers which need authentication are reported as such,
+         * the user can unlock them from the list of devices.
+         */
+        pp_samba_get_devices_async (PP_SAMBA (probe->host), FALSE, probe->cancellable, probe_done_cb, probe);
+        break;
+    }
+}
+
+static void
+cancelled_cb (GCancellable *cancellable,
+              PpDiscovery  *self)
+{
+  gint i;
+
+  for (i = 0; i < N_BACKENDS; i++)
+    {
+      if (self->probes[i] != NULL)
+        g_cancellable_cancel (self->probes[i]->cancellable);
+    }
+}
+
+/**
+ * pp_discovery_start:
+ * @discovery: a #PpDiscovery
+ * @backends: the backends to run
+ * @cancellable: (nullable): a #GCancellable, cancelling it cancels all
+ *     running backends
+ *
+ * Starts all @backends at once. Found devices are announced by
+ * "device-found" and "device-replaced", "finished" is emitted when the
+ * last backend returned or passed its deadline.
+ */
+void
+pp_discovery_start (PpDiscovery         *self,
+                    PpDiscoveryBackends  backends,
+                    GCancellable        *cancellable)
+{
+  gint i;
+
+  g_return_if_fail (PP_IS_DISCOVERY (self));
+  g_return_if_fail (self->n_running == 0);
+
+  if (backends == 0)
+    {
+      g_signal_emit (self, signals[FINISHED], 0);
+      return;
+    }
+
+  for (i = 0; i < N_BACKENDS; i++)
+    {
+      if (backends & (1 << i))
+        probe_start (self, i);
+    }
+
+  if (cancellable != NULL)
+    {
+      self->cancellable = g_object_ref (cancellable);
+      self->cancelled_id = g_cancellable_connect (cancellable,
+                                                  G_CALLBACK (cancelled_cb),
+                                                  self,
+                                                  NULL);
+    }
+}
+
+gboolean
+pp_discovery_is_running (PpDiscovery *self)
+{
+  g_return_val_if_fail (PP_IS_DISCOVERY (self), FALSE);
+
+  return self->n_running > 0;
+}
+
+/* Ports of backends which were not given one stay at their default */
+void
+pp_discovery_set_port (PpDiscovery         *self,
+                       PpDiscoveryBackends  backends,
+                       gint                 port)
+{
+  gint i;
+
+  g_return_if_fail (PP_IS_DISCOVERY (self));
+
+  for (i = 0; i < N_BACKENDS; i++)
+    {
+      if (backends & (1 << i))
+        self->ports[i] = port;
+    }
+}
+
+/* A deadline of 0 lets the backends run until they return */
+void
+pp_discovery_set_deadline (PpDiscovery         *self,
+                           PpDiscoveryBackends  backends,
+                           guint                msec)
+{
+  gint i;
+
+  g_return_if_fail (PP_IS_DISCOVERY (self));
+
+  for (i = 0; i < N_BACKENDS; i++)
+    {
+      if (backends & (1 << i))
+        self->deadlines[i] = msec;
+    }
+}
+
+static void
+pp_discovery_dispose (GObject *object)
+{
+  PpDiscovery *self = PP_DISCOVERY (object);
+
+  disconnect_cancellable (self);
+
+  G_OBJECT_CLASS (pp_discovery_parent_class)->dispose (object);
+}
+
+static void
+pp_discovery_finalize (GObject *object)
+{
+  PpDiscovery *self = PP_DISCOVERY (object);
+
+  g_hash_table_unref (self->devices);
+  g_free (self->hostname);
+
+  G_OBJECT_CLASS (pp_discovery_parent_class)->finalize (object);
+}
+
+static void
+pp_discovery_class_init (PpDiscoveryClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->dispose = pp_discovery_dispose;
+  object_class->finalize = pp_discovery_finalize;
+
+  signals[DEVICE_FOUND] =
+    g_signal_new ("device-found",
+                  G_TYPE_FROM_CLASS (klass),
+                  G_SIGNAL_RUN_LAST,
+                  0,
+                  NULL, NULL, NULL,
+                  G_TYPE_NONE, 1,
+                  PP_TYPE_PRINT_DEVICE);
+
+  signals[DEVICE_REPLACED] =
+    g_signal_new ("device-replaced",
+                  G_TYPE_FROM_CLASS (klass),
+                  G_SIGNAL_RUN_LAST,
+                  0,
+                  NULL, NULL, NULL,
+                  G_TYPE_NONE, 2,
+                  PP_TYPE_PRINT_DEVICE,
+                  PP_TYPE_PRINT_DEVICE);
+
+  signals[FINISHED] =
+    g_signal_new ("finished",
+                  G_TYPE_FROM_CLASS (klass),
+                  G_SIGNAL_RUN_LAST,
+                  0,
+                  NULL, NULL, NULL,
+                  G_TYPE_NONE, 0);
+}
+
+static void
+pp_discovery_init (PpDiscovery *self)
+{
+  gint i;
+
+  for (i = 0; i < N_BACKENDS; i++)
+    {
+      self->ports[i] = PP_HOST_UNSET_PORT;
+      self->deadlines[i] = default_deadlines[i];
+    }
+
+  self->devices = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_object_unref);
+}
+
+PpDiscovery *
+pp_discovery_new (const gchar *hostname)
+{
+  PpDiscovery *self;
+
+  self = g_object_new (PP_TYPE_DISCOVERY, NULL);
+  self->hostname = g_strdup (hostname);
+
+  return self;
+}
@@ -0,0 +1,60 @@
+/*
+ * Copyright 2017 Red Hat, Inc
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __PP_DISCOVERY_H__
+#define __PP_DISCOVERY_H__
+
+#include <glib-object.h>
+#include <gio/gio.h>
+
+#include "pp-print-device.h"
+
+G_BEGIN_DECLS
+
+#define PP_TYPE_DISCOVERY (pp_discovery_get_type ())
+
+G_DECLARE_FINAL_TYPE (PpDiscovery, pp_discovery, PP, DISCOVERY, GObject)
+
+typedef enum
+{
+  PP_DISCOVERY_REMOTE_CUPS = 1 << 0,
+  PP_DISCOVERY_SNMP        = 1 << 1,
+  PP_DISCOVERY_JETDIRECT   = 1 << 2,
+  PP_DISCOVERY_LPD         = 1 << 3,
+  PP_DISCOVERY_SAMBA       = 1 << 4,
+  PP_DISCOVERY_ALL         = (1 << 5) - 1
+} PpDiscoveryBackends;
+
+PpDiscovery *pp_discovery_new          (const gchar         *hostname);
+
+void         pp_discovery_set_port     (PpDiscovery         *discovery,
+                                        PpDiscoveryBackends  backends,
+                                        gint                 port);
+
+void         pp_discovery_set_deadline (PpDiscovery         *discovery,
+                                        PpDiscoveryBackends  backends,
+                                        guint                msec);
+
+void         pp_discovery_start        (PpDiscovery         *discovery,
+                                        PpDiscoveryBackends  backends,
+                                        GCancellable        *cancellable);
+
+gboolean     pp_discovery_is_running   (PpDiscovery         *discovery);
+
+G_END_DECLS
+
+#endif /* __PP_DISCOVERY_H__ */
@@ -24,6 +24,9 @@
 
 #define BUFFER_LENGTH 1024
 
+/* Timeout of connections and socket I/O in seconds */
+#define CONNECTION_TIMEOUT 3
+
 struct _PpHostPrivate
 {
   gchar *hostname;
@@ -256,11 +259,11 @@ _pp_host_get_snmp_devices_thread (GSimpleAsyncResult *res,
   PpPrintDevice  *device;
   gboolean        is_network_device;
   GSDData        *data;
-  GError         *error;
+  GError         *error = NULL;
   gchar         **argv;
   gchar          *stdout_string = NULL;
   gchar          *stderr_string = NULL;
-  gint            exit_status;
+  gint            exit_status = -1;
 
   data = g_simple_async_result_get_op_res_gpointer (res);
   data->devices = g_new0 (PpDevicesList, 1);
@@ -286,6 +289,14 @@ _pp_host_get_snmp_devices_thread (GSimpleAsyncResult *res,
   g_free (argv[0]);
   g_free (argv);
 
+  if (error != NULL)
+    {
+      g_debug ("Could not run the SNMP backend: %s", error->message);
+      g_error_free (error);
+    }
+
+  g_free (stderr_string);
+
   if (exit_status == 0 && stdout_string)
     {
       gchar **printer_informations = NULL;
@@ -546,6 +557,10 @@ jetdirect_connection_test_cb (GObject      *source_object,
 
       data->devices->devices = g_list_append (data->devices->devices, device);
     }
+  else
+    {
+      g_clear_error (&error);
+    }
 
   result = data->devices;
   data->devices = NULL;
@@ -585,6 +600,7 @@ pp_host_get_jetdirect_devices_async (PpHost              *host,
   if (address != NULL && address[0] != '/')
     {
       client = g_socket_client_new ();
+      g_socket_client_set_timeout (client, CONNECTION_TIMEOUT);
 
       g_socket_client_connect_to_host_async (client,
                                              address,
@@ -652,7 +668,7 @@ test_lpd_queue (GSocketClient *client,
           bytes_written = g_output_stream_write (output,
                                                  buffer,
                                                  length,
-                                                 NULL,
+                                                 cancellable,
                                                  &error);
 
           if (bytes_written != -1)
@@ -660,7 +676,7 @@ test_lpd_queue (GSocketClient *client,
               bytes_read = g_input_stream_read (input,
                                                 buffer,
                                                 BUFFER_LENGTH,
-                                                NULL,
+                                                cancellable,
                                                 &error);
 
               if (bytes_read != -1)
@@ -673,8 +689,9 @@ test_lpd_queue (GSocketClient *client,
                       bytes_written = g_output_stream_write (output,
                                                              buffer,
                                                              length,
-                                                             NULL,
+                                                             cancellable,
                                                              &error);
+                      g_clear_error (&error);
 
                       result = TRUE;
                     }
@@ -693,6 +710,10 @@ test_lpd_queue (GSocketClient *client,
       g_io_stream_close (G_IO_STREAM (connection), NULL, NULL);
       g_object_unref (connection);
     }
+  else
+    {
+      g_clear_error (&error);
+    }
 
   return result;
 }
@@ -733,6 +754,7 @@ _pp_host_get_lpd_devices_thread (GTask        *task,
     goto out;
 
   client = g_socket_client_new ();
+  g_socket_client_set_timeout (client, CONNECTION_TIMEOUT);
 
   connection = g_socket_client_connect_to_host (client,
                                                 address,
@@ -770,6 +792,9 @@ _pp_host_get_lpd_devices_thread (GTask        *task,
         {
           candidate = (gchar *) iter->data;
 
+          if (g_cancellable_is_cancelled (cancellable))
+            break;
+
           if (test_lpd_queue (client,
                               address,
                               port,
@@ -804,6 +829,11 @@ _pp_host_get_lpd_devices_thread (GTask        *task,
         }
 
       g_list_free_full (candidates, g_free);
+      g_free (found_queue);
+    }
+  else
+    {
+      g_clear_error (&error);
     }
 
   g_object_unref (client);
@@ -217,11 +217,19 @@ pp_job_set_property (GObject      *object,
         priv->id = g_value_get_int (value);
         break;
       case PROP_TITLE:
-        g_free (priv->title);
-        priv->title = g_value_dup_string (value);
+        if (g_strcmp0 (priv->title, g_value_get_string (value)) != 0)
+          {
+            g_free (priv->title);
+            priv->title = g_value_dup_string (value);
+            g_object_notify_by_pspec (object, pspec);
+          }
         break;
       case PROP_STATE:
-        priv->state = g_value_get_int (value);
+        if (priv->state != g_value_get_int (value))
+          {
+            priv->state = g_value_get_int (value);
+            g_object_notify_by_pspec (object, pspec);
+          }
         break;
       default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
@@ -261,14 +269,14 @@ pp_job_class_init (PpJobClass *class)
                                                 "Title",
                                                 "Title of this print job",
                                                 NULL,
-                                                G_PARAM_READWRITE);
+                                                G_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY);
   properties[PROP_STATE] = g_param_spec_int ("state",
                                              "State",
                                              "State of this print job (Paused, Completed, Cancelled,...)",
                                              0,
                                              G_MAXINT,
                                              0,
-                                             G_PARAM_READWRITE);
+                                             G_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY);
 
   g_object_class_install_properties (object_class, LAST_PROPERTY, properties);
 }
@@ -43,15 +43,157 @@
 #define CLOCK_SCHEMA "org.gnome.desktop.interface"
 #define CLOCK_FORMAT_KEY "clock-format"
 
+/* Number of rows created at once, more are added when the
+ * list is scrolled to its end */
+#define JOBS_ROWS_STEP 50
+
 static void pp_jobs_dialog_hide (PpJobsDialog *dialog);
 
+/*
+ * A model showing the first items of another model, so that rows of the
+ * list box are created only for the jobs which can be scrolled to.
+ */
+#define PP_TYPE_JOBS_SLICE (pp_jobs_slice_get_type ())
+G_DECLARE_FINAL_TYPE (PpJobsSlice, pp_jobs_slice, PP, JOBS_SLICE, GObject)
+
+struct _PpJobsSlice
+{
+  GObject     parent_instance;
+
+  GListModel *model;
+  guint       size;
+  guint       n_items;
+};
+
+static void pp_jobs_slice_list_model_init (GListModelInterface *iface);
+
+G_DEFINE_TYPE_WITH_CODE (PpJobsSlice, pp_jobs_slice, G_TYPE_OBJECT,
+                         G_IMPLEMENT_INTERFACE (G_TYPE_LIST_MODEL, pp_jobs_slice_list_model_init))
+
+static GType
+pp_jobs_slice_get_item_type (GListModel *list)
+{
+  return g_list_model_get_item_type (PP_JOBS_SLICE (list)->model);
+}
+
+static guint
+pp_jobs_slice_get_n_items (GListModel *list)
+{
+  return PP_JOBS_SLICE (list)->n_items;
+}
+
+static gpointer
+pp_jobs_slice_get_item (GListModel *list,
+                        guint       position)
+{
+  PpJobsSlice *self = PP_JOBS_SLICE (list);
+
+  if (position >= self->n_items)
+    return NULL;
+
+  return g_list_model_get_item (self->model, position);
+}
+
+static void
+pp_jobs_slice_list_model_init (GListModelInterface *iface)
+{
+  iface->get_item_type = pp_jobs_slice_get_item_type;
+  iface->get_n_items = pp_jobs_slice_get_n_items;
+  iface->get_item = pp_jobs_slice_get_item;
+}
+
+static void
+pp_jobs_slice_items_changed_cb (GListModel  *model,
+                                guint        position,
+                                guint        removed,
+                                guint        added,
+                                PpJobsSlice *self)
+{
+  guint old_n_items = self->n_items;
+
+  self->n_items = MIN (self->size, g_list_model_get_n_items (model));
+
+  if (position >= old_n_items && position >= self->n_items)
+    return;
+
+  /* Unless as many items were added as removed, all the following
+   * items moved and the slice changed up to its end */
+  if (removed == added)
+    g_list_model_items_changed (G_LIST_MODEL (self),
+                                position,
+                                MIN (removed, old_n_items - position),
+                                MIN (added, self->n_items - position));
+  else
+    g_list_model_items_changed (G_LIST_MODEL (self),
+                                position,
+                                old_n_items - MIN (position, old_n_items),
+                                self->n_items - MIN (position, self->n_items));
+}
+
+static void
+pp_jobs_slice_dispose (GObject *object)
+{
+  PpJobsSlice *self = PP_JOBS_SLICE (object);
+
+  if (self->model != NULL)
+    {
+      g_signal_handlers_disconnect_by_func (self->model, pp_jobs_slice_items_changed_cb, self);
+      g_clear_object (&self->model);
+    }
+
+  G_OBJECT_CLASS (pp_jobs_slice_parent_class)->dispose (object);
+}
+
+static void
+pp_jobs_slice_class_init (PpJobsSliceClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->dispose = pp_jobs_slice_dispose;
+}
+
+static void
+pp_jobs_slice_init (PpJobsSlice *self)
+{
+}
+
+static PpJobsSlice *
+pp_jobs_slice_new (GListModel *model,
+                   guint       size)
+{
+  PpJobsSlice *self;
+
+  self = g_object_new (PP_TYPE_JOBS_SLICE, NULL);
+  self->model = g_object_ref (model);
+  self->size = size;
+  self->n_items = MIN (size, g_list_model_get_n_items (model));
+
+  g_signal_connect (model, "items-changed", G_CALLBACK (pp_jobs_slice_items_changed_cb), self);
+
+  return self;
+}
+
+static void
+pp_jobs_slice_grow (PpJobsSlice *self,
+                    guint        step)
+{
+  guint old_n_items = self->n_items;
+
+  self->size += step;
+  self->n_items = MIN (self->size, g_list_model_get_n_items (self->model));
+
+  if (self->n_items > old_n_items)
+    g_list_model_items_changed (G_LIST_MODEL (self), old_n_items, 0, self->n_items - old_n_items);
+}
+
 struct _PpJobsDialog {
   GtkBuilder *builder;
   GtkWidget  *parent;
 
-  GtkWidget  *dialog;
-  GListStore *store;
-  GtkListBox *listbox;
+  GtkWidget   *dialog;
+  GListStore  *store;
+  PpJobsSlice *slice;
+  GtkListBox  *listbox;
 
   UserResponseCallback user_callback;
   gpointer             user_data;
@@ -84,18 +226,10 @@ job_pause_cb (GtkButton *button,
                                                       GTK_ICON_SIZE_SMALL_TOOLBAR));
 }
 
-static GtkWidget *
-create_listbox_row (gpointer item,
-                    gpointer user_data)
+static gchar *
+get_state_string (gint job_state)
 {
-  PpJob     *job = (PpJob *)item;
-  GtkWidget *box;
-  GtkWidget *widget;
-  gchar     *title;
-  gchar     *state_string = NULL;
-  gint       job_state;
-
-  g_object_get (job, "title", &title, "state", &job_state, NULL);
+  gchar *state_string = NULL;
 
   switch (job_state)
     {
@@ -129,6 +263,55 @@ create_listbox_row (gpointer item,
         break;
     }
 
+  return state_string;
+}
+
+/* Updates the row of @job in place when the list is refreshed */
+static void
+job_notify_cb (PpJob      *job,
+               GParamSpec *pspec,
+               GtkWidget  *box)
+{
+  GtkWidget *title_label;
+  GtkWidget *state_label;
+  GtkWidget *pause_button;
+  gchar     *title;
+  gchar     *state_string;
+  gint       job_state;
+
+  title_label = g_object_get_data (G_OBJECT (box), "title-label");
+  state_label = g_object_get_data (G_OBJECT (box), "state-label");
+  pause_button = g_object_get_data (G_OBJECT (box), "pause-button");
+
+  g_object_get (job, "title", &title, "state", &job_state, NULL);
+  state_string = get_state_string (job_state);
+
+  gtk_label_set_text (GTK_LABEL (title_label), title);
+  gtk_label_set_text (GTK_LABEL (state_label), state_string);
+  gtk_button_set_image (GTK_BUTTON (pause_button),
+                        gtk_image_new_from_icon_name (job_state == IPP_JOB_HELD ?
+                                                      "media-playback-start-symbolic" : "media-playback-pause-symbolic",
+                                                      GTK_ICON_SIZE_SMALL_TOOLBAR));
+
+  g_free (state_string);
+  g_free (title);
+}
+
+static GtkWidget *
+create_listbox_row (gpointer item,
+                    gpointer user_data)
+{
+  PpJob     *job = (PpJob *)item;
+  GtkWidget *box;
+  GtkWidget *widget;
+  gchar     *title;
+  gchar     *state_string = NULL;
+  gint       job_state;
+
+  g_object_get (job, "title", &title, "state", &job_state, NULL);
+
+  state_string = get_state_string (job_state);
+
   box = gtk_box_new (GTK_ORIENTATION_HORIZONTAL, 0);
   g_object_set (box, "margin", 6, NULL);
   gtk_container_set_border_width (GTK_CONTAINER (box), 2);
@@ -136,27 +319,134 @@ create_listbox_row (gpointer item,
   widget = gtk_label_new (title);
   gtk_widget_set_halign (widget, GTK_ALIGN_START);
   gtk_box_pack_start (GTK_BOX (box), widget, TRUE, TRUE, 10);
+  g_object_set_data (G_OBJECT (box), "title-label", widget);
 
   widget = gtk_label_new (state_string);
   gtk_widget_set_halign (widget, GTK_ALIGN_END);
   gtk_widget_set_margin_end (widget, 64);
   gtk_box_pack_start (GTK_BOX (box), widget, FALSE, FALSE, 10);
+  g_object_set_data (G_OBJECT (box), "state-label", widget);
 
   widget = gtk_button_new_from_icon_name (job_state == IPP_JOB_HELD ? "media-playback-start-symbolic" : "media-playback-pause-symbolic",
                                           GTK_ICON_SIZE_SMALL_TOOLBAR);
   g_signal_connect (widget, "clicked", G_CALLBACK (job_pause_cb), item);
   gtk_box_pack_start (GTK_BOX (box), widget, FALSE, FALSE, 4);
+  g_object_set_data (G_OBJECT (box), "pause-button", widget);
 
   widget = gtk_button_new_from_icon_name ("edit-delete-symbolic",
                                           GTK_ICON_SIZE_SMALL_TOOLBAR);
   g_signal_connect (widget, "clicked", G_CALLBACK (job_stop_cb), item);
   gtk_box_pack_start (GTK_BOX (box), widget, FALSE, FALSE, 4);
 
+  g_signal_connect_object (job, "notify", G_CALLBACK (job_notify_cb), box, 0);
+
   gtk_widget_show_all (box);
 
+  g_free (state_string);
+  g_free (title);
+
   return box;
 }
 
+static gint
+get_job_id (PpJob *job)
+{
+  gint id;
+
+  g_object_get (job, "id", &id, NULL);
+
+  return id;
+}
+
+/* Brings @store in line with @jobs, keeping the jobs (and their rows)
+ * which are still queued and updating them in place */
+static void
+merge_jobs (GListStore *store,
+            GList      *jobs)
+{
+  GHashTable *new_jobs;
+  GHashTable *old_jobs;
+  GPtrArray  *items;
+  PpJob      *new_job;
+  PpJob      *old_job;
+  PpJob      *item;
+  PpJob      *other;
+  GList      *l;
+  gchar      *title;
+  guint       n_items;
+  guint       i, j;
+  gint        job_state;
+
+  n_items = g_list_model_get_n_items (G_LIST_MODEL (store));
+
+  /* Opening the dialog, add all the rows at once */
+  if (n_items == 0)
+    {
+      items = g_ptr_array_new ();
+      for (l = jobs; l != NULL; l = l->next)
+        g_ptr_array_add (items, l->data);
+      g_list_store_splice (store, 0, 0, items->pdata, items->len);
+      g_ptr_array_free (items, TRUE);
+      return;
+    }
+
+  new_jobs = g_hash_table_new (g_direct_hash, g_direct_equal);
+  for (l = jobs; l != NULL; l = l->next)
+    g_hash_table_insert (new_jobs, GINT_TO_POINTER (get_job_id (l->data)), l->data);
+
+  /* Remove the jobs which are gone */
+  old_jobs = g_hash_table_new (g_direct_hash, g_direct_equal);
+  for (i = n_items; i > 0; i--)
+    {
+      old_job = g_list_model_get_item (G_LIST_MODEL (store), i - 1);
+
+      if (g_hash_table_contains (new_jobs, GINT_TO_POINTER (get_job_id (old_job))))
+        g_hash_table_insert (old_jobs, GINT_TO_POINTER (get_job_id (old_job)), old_job);
+      else
+        g_list_store_remove (store, i - 1);
+
+      g_object_unref (old_job);
+    }
+
+  for (l = jobs, i = 0; l != NULL; l = l->next, i++)
+    {
+      new_job = l->data;
+      old_job = g_hash_table_lookup (old_jobs, GINT_TO_POINTER (get_job_id (new_job)));
+
+      if (old_job == NULL)
+        {
+          g_list_store_insert (store, i, new_job);
+          continue;
+        }
+
+      /* The queue was reordered */
+      item = g_list_model_get_item (G_LIST_MODEL (store), i);
+      if (item != old_job)
+        {
+          for (j = i + 1; j < g_list_model_get_n_items (G_LIST_MODEL (store)); j++)
+            {
+              other = g_list_model_get_item (G_LIST_MODEL (store), j);
+              if (other == old_job)
+                {
+                  g_list_store_remove (store, j);
+                  g_list_store_insert (store, i, other);
+                  g_object_unref (other);
+                  break;
+                }
+              g_object_unref (other);
+            }
+        }
+      g_object_unref (item);
+
+      g_object_get (new_job, "title", &title, "state", &job_state, NULL);
+      g_object_set (old_job, "title", title, "state", job_state, NULL);
+      g_free (title);
+    }
+
+  g_hash_table_destroy (old_jobs);
+  g_hash_table_destroy (new_jobs);
+}
+
 static void
 update_jobs_list_cb (GObject      *source_object,
                      GAsyncResult *result,
@@ -167,11 +457,9 @@ update_jobs_list_cb (GObject      *source_object,
   GtkWidget    *clear_all_button;
   GtkStack     *stack;
   GError       *error = NULL;
-  GList        *jobs, *l;
+  GList        *jobs;
   gint          num_of_jobs;
 
-  g_list_store_remove_all (dialog->store);
-
   stack = GTK_STACK (gtk_builder_get_object (GTK_BUILDER (dialog->builder), "stack"));
   clear_all_button = GTK_WIDGET (gtk_builder_get_object (GTK_BUILDER (dialog->builder), "jobs-clear-all-button"));
 
@@ -199,12 +487,9 @@ update_jobs_list_cb (GObject      *source_object,
       gtk_stack_set_visible_child_name (stack, "no-jobs-page");
     }
 
-  for (l = jobs; l != NULL; l = l->next)
-    {
-      g_list_store_append (dialog->store, l->data);
-    }
+  merge_jobs (dialog->store, jobs);
 
-  g_list_free (jobs);
+  g_list_free_full (jobs, g_object_unref);
   g_clear_object (&dialog->get_jobs_cancellable);
 }
 
@@ -262,9 +547,21 @@ on_clear_all_button_clicked (GtkButton *button,
       PpJob *job = PP_JOB (g_list_model_get_item (G_LIST_MODEL (dialog->store), i));
 
       pp_job_cancel_purge_async (job, FALSE);
+      g_object_unref (job);
     }
 }
 
+static void
+on_edge_reached (GtkScrolledWindow *scrolled_window,
+                 GtkPositionType    pos,
+                 gpointer           user_data)
+{
+  PpJobsDialog *dialog = user_data;
+
+  if (pos == GTK_POS_BOTTOM)
+    pp_jobs_slice_grow (dialog->slice, JOBS_ROWS_STEP);
+}
+
 PpJobsDialog *
 pp_jobs_dialog_new (GtkWindow            *parent,
                     UserResponseCallback  user_callback,
@@ -273,6 +570,7 @@ pp_jobs_dialog_new (GtkWindow            *parent,
 {
   PpJobsDialog    *dialog;
   GtkButton       *clear_all_button;
+  GtkWidget       *scrolled_window;
   GError          *error = NULL;
   gchar           *objects[] = { "jobs-dialog", NULL };
   guint            builder_result;
@@ -315,9 +613,13 @@ pp_jobs_dialog_new (GtkWindow            *parent,
   gtk_list_box_set_header_func (dialog->listbox,
                                 cc_list_box_update_header_func, NULL, NULL);
   dialog->store = g_list_store_new (pp_job_get_type ());
-  gtk_list_box_bind_model (dialog->listbox, G_LIST_MODEL (dialog->store),
+  dialog->slice = pp_jobs_slice_new (G_LIST_MODEL (dialog->store), JOBS_ROWS_STEP);
+  gtk_list_box_bind_model (dialog->listbox, G_LIST_MODEL (dialog->slice),
                            create_listbox_row, NULL, NULL);
 
+  scrolled_window = GTK_WIDGET (gtk_builder_get_object (dialog->builder, "scrolledwindow"));
+  g_signal_connect (scrolled_window, "edge-reached", G_CALLBACK (on_edge_reached), dialog);
+
   update_jobs_list (dialog);
 
   gtk_window_set_transient_for (GTK_WINDOW (dialog->dialog), GTK_WINDOW (parent));
@@ -357,6 +659,9 @@ pp_jobs_dialog_free (PpJobsDialog *dialog)
   gtk_widget_destroy (GTK_WIDGET (dialog->dialog));
   dialog->dialog = NULL;
 
+  g_clear_object (&dialog->slice);
+  g_clear_object (&dialog->store);
+
   g_clear_object (&dialog->builder);
   g_free (dialog->printer_name);
   g_free (dialog);
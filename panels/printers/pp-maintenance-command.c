@@ -23,6 +23,7 @@
 #include "pp-maintenance-command.h"
 
 #include "pp-utils.h"
+#include "pp-cups.h"
 
 #if (CUPS_VERSION_MAJOR > 1) || (CUPS_VERSION_MINOR > 5)
 #define HAVE_CUPS_1_6 1
@@ -302,101 +303,78 @@ pp_maintenance_command_execute_finish (PpMaintenanceCommand  *command,
   return g_task_propagate_boolean (G_TASK (result), error);
 }
 
-static gboolean
-_pp_maintenance_command_is_supported (const gchar *printer_name,
-                                      const gchar *command)
+static void
+_pp_maintenance_command_is_supported_cb (GObject      *source_object,
+                                         GAsyncResult *res,
+                                         gpointer      user_data)
 {
-  ipp_attribute_t   *attr = NULL;
-  gboolean           is_supported = FALSE;
-  ipp_t             *request;
-  ipp_t             *response = NULL;
-  gchar             *printer_uri;
-  gchar             *command_lowercase;
-  GPtrArray         *available_commands = NULL;
-  int                i;
-
-  printer_uri = g_strdup_printf ("ipp://localhost/printers/%s",
-                                 printer_name);
-
-  request = ippNewRequest (IPP_GET_PRINTER_ATTRIBUTES);
-  ippAddString (request, IPP_TAG_OPERATION, IPP_TAG_URI,
-                "printer-uri", NULL, printer_uri);
-  ippAddString (request, IPP_TAG_OPERATION, IPP_TAG_KEYWORD,
-                "requested-attributes", NULL, "printer-commands");
-  response = cupsDoRequest (CUPS_HTTP_DEFAULT, request, "/");
-  if (response != NULL)
-    {
-      if (ippGetStatusCode (response) <= IPP_OK_CONFLICT)
-        {
-          int commands_count;
+  PpMaintenanceCommand        *command;
+  PpMaintenanceCommandPrivate *priv;
+  IPPAttribute                *attr = NULL;
+  GHashTable                  *attributes;
+  gboolean                     is_supported = FALSE;
+  GError                      *error = NULL;
+  GTask                       *task = G_TASK (user_data);
+  int                          i;
 
-          attr = ippFindAttribute (response, "printer-commands", IPP_TAG_ZERO);
-          commands_count = attr != NULL ? ippGetCount (attr) : 0;
-          if (commands_count > 0 &&
-              ippGetValueTag (attr) != IPP_TAG_NOVALUE &&
-              (ippGetValueTag (attr) == IPP_TAG_KEYWORD))
-            {
-              available_commands = g_ptr_array_new_full (commands_count, g_free);
-              for (i = 0; i < commands_count; ++i)
-                {
-                  /* Array gains ownership of the lower-cased string */
-                  g_ptr_array_add (available_commands, g_ascii_strdown (ippGetString (attr, i, NULL), -1));
-                }
-            }
-        }
+  command = PP_MAINTENANCE_COMMAND (g_task_get_source_object (task));
+  priv = command->priv;
 
-      ippDelete (response);
+  attributes = pp_cups_get_printer_attributes_finish (PP_CUPS (source_object), res, &error);
+  if (error != NULL)
+    {
+      g_task_return_error (task, error);
+      g_object_unref (task);
+      return;
     }
 
-  if (available_commands != NULL)
+  if (attributes != NULL)
+    attr = g_hash_table_lookup (attributes, "printer-commands");
+
+  if (attr != NULL && attr->attribute_type == IPP_ATTRIBUTE_TYPE_STRING)
     {
-      command_lowercase = g_ascii_strdown (command, -1);
-      for (i = 0; i < available_commands->len; ++i)
+      for (i = 0; i < attr->num_of_values; i++)
         {
-          const gchar *available_command = g_ptr_array_index (available_commands, i);
-          if (g_strcmp0 (available_command, command_lowercase) == 0)
+          if (g_ascii_strcasecmp (attr->attribute_values[i].string_value, priv->command) == 0)
             {
               is_supported = TRUE;
               break;
             }
         }
-
-      g_free (command_lowercase);
-      g_ptr_array_free (available_commands, TRUE);
     }
 
-  g_free (printer_uri);
+  g_task_return_boolean (task, is_supported);
 
-  return is_supported;
-}
-
-static void
-_pp_maintenance_command_is_supported_thread (GTask        *task,
-                                             gpointer      source_object,
-                                             gpointer      task_data,
-                                             GCancellable *cancellable)
-{
-  PpMaintenanceCommand        *command = PP_MAINTENANCE_COMMAND (source_object);
-  PpMaintenanceCommandPrivate *priv = command->priv;
-  gboolean                     success = FALSE;
-
-  success = _pp_maintenance_command_is_supported (priv->printer_name, priv->command);
-  g_task_return_boolean (task, success);
+  g_clear_pointer (&attributes, g_hash_table_unref);
+  g_object_unref (task);
 }
 
+/*
+ * Asks through PpCups, so that the entries of all printers asking
+ * at the same time are answered by a single request.
+ */
 void
 pp_maintenance_command_is_supported_async  (PpMaintenanceCommand *command,
                                             GCancellable         *cancellable,
                                             GAsyncReadyCallback   callback,
                                             gpointer              user_data)
 {
-  GTask *task;
+  PpMaintenanceCommandPrivate *priv = command->priv;
+  gchar                       *attributes[] = { "printer-commands", NULL };
+  PpCups                      *cups;
+  GTask                       *task;
 
   task = g_task_new (command, cancellable, callback, user_data);
   g_task_set_check_cancellable (task, TRUE);
-  g_task_run_in_thread (task, _pp_maintenance_command_is_supported_thread);
 
-  g_object_unref (task);
+  cups = pp_cups_new ();
+  pp_cups_get_printer_attributes_async (cups,
+                                        priv->printer_name,
+                                        attributes,
+                                        cancellable,
+                                        _pp_maintenance_command_is_supported_cb,
+                                        task);
+  g_object_unref (cups);
 }
 
 gboolean
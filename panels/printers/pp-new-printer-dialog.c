@@ -34,6 +34,7 @@
 #include "pp-utils.h"
 #include "pp-host.h"
 #include "pp-cups.h"
+#include "pp-discovery.h"
 #include "pp-samba.h"
 #include "pp-new-printer.h"
 
@@ -126,12 +127,9 @@ struct _PpNewPrinterDialogPrivate
   GIcon *remote_printer_icon;
   GIcon *authenticated_server_icon;
 
-  PpHost  *snmp_host;
-  PpHost  *socket_host;
-  PpHost  *lpd_host;
-  PpHost  *remote_cups_host;
-  PpSamba *samba_host;
-  guint    host_search_timeout_id;
+  PpDiscovery *discovery;
+  PpSamba     *samba_host;
+  guint        host_search_timeout_id;
 };
 
 #define PP_NEW_PRINTER_DIALOG_GET_PRIVATE(obj) (G_TYPE_INSTANCE_GET_PRIVATE ((obj), PP_TYPE_NEW_PRINTER_DIALOG, PpNewPrinterDialogPrivate))
@@ -216,6 +214,7 @@ pp_new_printer_dialog_set_ppd_list (PpNewPrinterDialog *dialog,
 {
   PpNewPrinterDialogPrivate *priv = dialog->priv;
 
+  ppd_list_free (priv->list);
   priv->list = ppd_list_copy (list);
 
   if (priv->ppd_selection_dialog)
@@ -595,6 +594,14 @@ pp_new_printer_dialog_finalize (GObject *object)
       g_clear_object (&priv->remote_host_cancellable);
     }
 
+  if (priv->discovery != NULL)
+    {
+      g_signal_handlers_disconnect_by_data (priv->discovery, dialog);
+      g_clear_object (&priv->discovery);
+    }
+
+  g_clear_object (&priv->samba_host);
+
   if (priv->cancellable)
     {
       g_cancellable_cancel (priv->cancellable);
@@ -620,6 +627,8 @@ pp_new_printer_dialog_finalize (GObject *object)
   g_clear_object (&priv->remote_printer_icon);
   g_clear_object (&priv->authenticated_server_icon);
 
+  g_clear_pointer (&priv->list, ppd_list_free);
+
   G_OBJECT_CLASS (pp_new_printer_dialog_parent_class)->finalize (object);
 }
 
@@ -860,11 +869,7 @@ update_dialog_state (PpNewPrinterDialog *dialog)
   gboolean                   searching;
 
   searching = priv->cups_searching ||
-              priv->remote_cups_host != NULL ||
-              priv->snmp_host != NULL ||
-              priv->socket_host != NULL ||
-              priv->lpd_host != NULL ||
-              priv->samba_host != NULL ||
+              (priv->discovery != NULL && pp_discovery_is_running (priv->discovery)) ||
               priv->samba_authenticated_searching ||
               priv->samba_searching;
 
@@ -1187,150 +1192,6 @@ get_cups_devices_cb (GList    *devices,
   g_list_free_full (devices, (GDestroyNotify) g_object_unref);
 }
 
-static void
-get_snmp_devices_cb (GObject      *source_object,
-                     GAsyncResult *res,
-                     gpointer      user_data)
-{
-  PpNewPrinterDialog        *dialog;
-  PpNewPrinterDialogPrivate *priv;
-  PpHost                    *host = (PpHost *) source_object;
-  GError                    *error = NULL;
-  PpDevicesList             *result;
-
-  result = pp_host_get_snmp_devices_finish (host, res, &error);
-  g_object_unref (source_object);
-
-  if (result)
-    {
-      dialog = PP_NEW_PRINTER_DIALOG (user_data);
-      priv = dialog->priv;
-
-      if ((gpointer) source_object == (gpointer) priv->snmp_host)
-        priv->snmp_host = NULL;
-
-      add_devices_to_list (dialog, result->devices);
-
-      update_dialog_state (dialog);
-
-      pp_devices_list_free (result);
-    }
-  else
-    {
-      if (error->domain != G_IO_ERROR ||
-          error->code != G_IO_ERROR_CANCELLED)
-        {
-          dialog = PP_NEW_PRINTER_DIALOG (user_data);
-          priv = dialog->priv;
-
-          g_warning ("%s", error->message);
-
-          if ((gpointer) source_object == (gpointer) priv->snmp_host)
-            priv->snmp_host = NULL;
-
-          update_dialog_state (dialog);
-        }
-
-      g_error_free (error);
-    }
-}
-
-static void
-get_remote_cups_devices_cb (GObject      *source_object,
-                            GAsyncResult *res,
-                            gpointer      user_data)
-{
-  PpNewPrinterDialog        *dialog;
-  PpNewPrinterDialogPrivate *priv;
-  PpHost                    *host = (PpHost *) source_object;
-  GError                    *error = NULL;
-  PpDevicesList             *result;
-
-  result = pp_host_get_remote_cups_devices_finish (host, res, &error);
-  g_object_unref (source_object);
-
-  if (result)
-    {
-      dialog = PP_NEW_PRINTER_DIALOG (user_data);
-      priv = dialog->priv;
-
-      if ((gpointer) source_object == (gpointer) priv->remote_cups_host)
-        priv->remote_cups_host = NULL;
-
-      add_devices_to_list (dialog, result->devices);
-
-      update_dialog_state (dialog);
-
-      pp_devices_list_free (result);
-    }
-  else
-    {
-      if (error->domain != G_IO_ERROR ||
-          error->code != G_IO_ERROR_CANCELLED)
-        {
-          dialog = PP_NEW_PRINTER_DIALOG (user_data);
-          priv = dialog->priv;
-
-          g_warning ("%s", error->message);
-
-          if ((gpointer) source_object == (gpointer) priv->remote_cups_host)
-            priv->remote_cups_host = NULL;
-
-          update_dialog_state (dialog);
-        }
-
-      g_error_free (error);
-    }
-}
-
-static void
-get_samba_host_devices_cb (GObject      *source_object,
-                           GAsyncResult *res,
-                           gpointer      user_data)
-{
-  PpNewPrinterDialogPrivate *priv;
-  PpNewPrinterDialog        *dialog;
-  PpDevicesList             *result;
-  PpSamba                   *samba = (PpSamba *) source_object;
-  GError                    *error = NULL;
-
-  result = pp_samba_get_devices_finish (samba, res, &error);
-  g_object_unref (source_object);
-
-  if (result)
-    {
-      dialog = PP_NEW_PRINTER_DIALOG (user_data);
-      priv = dialog->priv;
-
-      if ((gpointer) source_object == (gpointer) priv->samba_host)
-        priv->samba_host = NULL;
-
-      add_devices_to_list (dialog, result->devices);
-
-      update_dialog_state (dialog);
-
-      pp_devices_list_free (result);
-    }
-  else
-    {
-      if (error->domain != G_IO_ERROR ||
-          error->code != G_IO_ERROR_CANCELLED)
-        {
-          dialog = PP_NEW_PRINTER_DIALOG (user_data);
-          priv = dialog->priv;
-
-          g_warning ("%s", error->message);
-
-          if ((gpointer) source_object == (gpointer) priv->samba_host)
-            priv->samba_host = NULL;
-
-          update_dialog_state (dialog);
-        }
-
-      g_error_free (error);
-    }
-}
-
 static void
 get_samba_devices_cb (GObject      *source_object,
                       GAsyncResult *res,
@@ -1377,100 +1238,6 @@ get_samba_devices_cb (GObject      *source_object,
     }
 }
 
-static void
-get_jetdirect_devices_cb (GObject      *source_object,
-                          GAsyncResult *res,
-                          gpointer      user_data)
-{
-  PpNewPrinterDialog        *dialog;
-  PpNewPrinterDialogPrivate *priv;
-  PpHost                    *host = (PpHost *) source_object;
-  GError                    *error = NULL;
-  PpDevicesList             *result;
-
-  result = pp_host_get_jetdirect_devices_finish (host, res, &error);
-  g_object_unref (source_object);
-
-  if (result != NULL)
-    {
-      dialog = PP_NEW_PRINTER_DIALOG (user_data);
-      priv = dialog->priv;
-
-      if ((gpointer) source_object == (gpointer) priv->socket_host)
-        priv->socket_host = NULL;
-
-      add_devices_to_list (dialog, result->devices);
-
-      update_dialog_state (dialog);
-
-      pp_devices_list_free (result);
-    }
-  else
-    {
-      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
-        {
-          dialog = PP_NEW_PRINTER_DIALOG (user_data);
-          priv = dialog->priv;
-
-          g_warning ("%s", error->message);
-
-          if ((gpointer) source_object == (gpointer) priv->socket_host)
-            priv->socket_host = NULL;
-
-          update_dialog_state (dialog);
-        }
-
-      g_error_free (error);
-    }
-}
-
-static void
-get_lpd_devices_cb (GObject      *source_object,
-                    GAsyncResult *res,
-                    gpointer      user_data)
-{
-  PpNewPrinterDialog        *dialog;
-  PpNewPrinterDialogPrivate *priv;
-  PpHost                    *host = (PpHost *) source_object;
-  GError                    *error = NULL;
-  PpDevicesList             *result;
-
-  result = pp_host_get_lpd_devices_finish (host, res, &error);
-  g_object_unref (source_object);
-
-  if (result != NULL)
-    {
-      dialog = PP_NEW_PRINTER_DIALOG (user_data);
-      priv = dialog->priv;
-
-      if ((gpointer) source_object == (gpointer) priv->lpd_host)
-        priv->lpd_host = NULL;
-
-      add_devices_to_list (dialog, result->devices);
-
-      update_dialog_state (dialog);
-
-      pp_devices_list_free (result);
-    }
-  else
-    {
-      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
-        {
-          dialog = PP_NEW_PRINTER_DIALOG (user_data);
-          priv = dialog->priv;
-
-          g_warning ("%s", error->message);
-
-          if ((gpointer) source_object == (gpointer) priv->lpd_host)
-            priv->lpd_host = NULL;
-
-          update_dialog_state (dialog);
-        }
-
-      g_error_free (error);
-    }
-}
-
 static void
 get_cups_devices (PpNewPrinterDialog *dialog)
 {
@@ -1552,6 +1319,62 @@ search_for_remote_printers_free (THostSearchData *data)
   g_free (data);
 }
 
+static void
+remove_device (PpNewPrinterDialog *dialog,
+               PpPrintDevice      *device)
+{
+  PpNewPrinterDialogPrivate *priv = dialog->priv;
+  PpPrintDevice             *store_device;
+  GtkTreeIter                iter;
+  gboolean                   cont;
+
+  cont = gtk_tree_model_get_iter_first (GTK_TREE_MODEL (priv->store), &iter);
+  while (cont)
+    {
+      gtk_tree_model_get (GTK_TREE_MODEL (priv->store), &iter,
+                          DEVICE_COLUMN, &store_device,
+                          -1);
+
+      g_object_unref (store_device);
+
+      if (store_device == device)
+        {
+          gtk_list_store_remove (priv->store, &iter);
+          break;
+        }
+
+      cont = gtk_tree_model_iter_next (GTK_TREE_MODEL (priv->store), &iter);
+    }
+}
+
+static void
+discovery_device_found_cb (PpDiscovery        *discovery,
+                           PpPrintDevice      *device,
+                           PpNewPrinterDialog *dialog)
+{
+  add_device_to_list (dialog, device);
+  update_dialog_state (dialog);
+}
+
+/* Another backend found the same device with more details */
+static void
+discovery_device_replaced_cb (PpDiscovery        *discovery,
+                              PpPrintDevice      *old_device,
+                              PpPrintDevice      *new_device,
+                              PpNewPrinterDialog *dialog)
+{
+  remove_device (dialog, old_device);
+  add_device_to_list (dialog, new_device);
+  update_dialog_state (dialog);
+}
+
+static void
+discovery_finished_cb (PpDiscovery        *discovery,
+                       PpNewPrinterDialog *dialog)
+{
+  update_dialog_state (dialog);
+}
+
 static gboolean
 search_for_remote_printers (THostSearchData *data)
 {
@@ -1563,59 +1386,43 @@ search_for_remote_printers (THostSearchData *data)
       g_clear_object (&priv->remote_host_cancellable);
     }
 
+  if (priv->discovery != NULL)
+    {
+      g_signal_handlers_disconnect_by_data (priv->discovery, data->dialog);
+      g_clear_object (&priv->discovery);
+    }
+
   priv->remote_host_cancellable = g_cancellable_new ();
 
-  priv->remote_cups_host = pp_host_new (data->host_name);
-  priv->snmp_host = pp_host_new (data->host_name);
-  priv->socket_host = pp_host_new (data->host_name);
-  priv->lpd_host = pp_host_new (data->host_name);
+  priv->discovery = pp_discovery_new (data->host_name);
 
   if (data->host_port != PP_HOST_UNSET_PORT)
     {
-      g_object_set (priv->remote_cups_host, "port", data->host_port, NULL);
-      g_object_set (priv->snmp_host, "port", data->host_port, NULL);
+      pp_discovery_set_port (priv->discovery,
+                             PP_DISCOVERY_REMOTE_CUPS | PP_DISCOVERY_SNMP,
+                             data->host_port);
 
       /* Accept port different from the default one only if user specifies
        * scheme (for socket and lpd printers).
        */
       if (data->host_scheme != NULL &&
           g_ascii_strcasecmp (data->host_scheme, "socket") == 0)
-        g_object_set (priv->socket_host, "port", data->host_port, NULL);
+        pp_discovery_set_port (priv->discovery, PP_DISCOVERY_JETDIRECT, data->host_port);
 
       if (data->host_scheme != NULL &&
           g_ascii_strcasecmp (data->host_scheme, "lpd") == 0)
-        g_object_set (priv->lpd_host, "port", data->host_port, NULL);
+        pp_discovery_set_port (priv->discovery, PP_DISCOVERY_LPD, data->host_port);
     }
 
-  priv->samba_host = pp_samba_new (data->host_name);
+  g_signal_connect (priv->discovery, "device-found", G_CALLBACK (discovery_device_found_cb), data->dialog);
+  g_signal_connect (priv->discovery, "device-replaced", G_CALLBACK (discovery_device_replaced_cb), data->dialog);
+  g_signal_connect (priv->discovery, "finished", G_CALLBACK (discovery_finished_cb), data->dialog);
 
-  update_dialog_state (data->dialog);
+  pp_discovery_start (priv->discovery,
+                      PP_DISCOVERY_ALL,
+                      priv->remote_host_cancellable);
 
-  pp_host_get_remote_cups_devices_async (priv->remote_cups_host,
-                                         priv->remote_host_cancellable,
-                                         get_remote_cups_devices_cb,
-                                         data->dialog);
-
-  pp_host_get_snmp_devices_async (priv->snmp_host,
-                                  priv->remote_host_cancellable,
-                                  get_snmp_devices_cb,
-                                  data->dialog);
-
-  pp_host_get_jetdirect_devices_async (priv->socket_host,
-                                       priv->remote_host_cancellable,
-                                       get_jetdirect_devices_cb,
-                                       data->dialog);
-
-  pp_host_get_lpd_devices_async (priv->lpd_host,
-                                 priv->remote_host_cancellable,
-                                 get_lpd_devices_cb,
-                                 data->dialog);
-
-  pp_samba_get_devices_async (priv->samba_host,
-                              TRUE,
-                              priv->remote_host_cancellable,
-                              get_samba_host_devices_cb,
-                              data->dialog);
+  update_dialog_state (data->dialog);
 
   priv->host_search_timeout_id = 0;
 
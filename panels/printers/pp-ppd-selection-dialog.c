@@ -66,6 +66,127 @@ struct _PpPPDSelectionDialog {
   PPDList *list;
 };
 
+static gint
+get_manufacturer_index (PPDList     *list,
+                        const gchar *manufacturer_name)
+{
+  gint i;
+
+  for (i = 0; i < list->num_of_manufacturers; i++)
+    {
+      if (g_strcmp0 (manufacturer_name,
+                     list->manufacturers[i]->manufacturer_name) == 0)
+        return i;
+    }
+
+  return -1;
+}
+
+/*
+ * Updates @store to contain @names in the given order, with @display_names.
+ * Rows which are still there are kept, so that the selection and
+ * the scroll position do not change when a new list of PPDs arrives.
+ */
+static void
+merge_store (GtkListStore  *store,
+             gint           names_column,
+             gint           display_names_column,
+             const gchar  **names,
+             const gchar  **display_names,
+             gint           n_names)
+{
+  GtkTreeModel *model = GTK_TREE_MODEL (store);
+  GHashTable   *new_names;
+  GtkTreeIter   iter;
+  gboolean      valid;
+  gchar        *name;
+  gchar        *display_name;
+  gint          i;
+
+  new_names = g_hash_table_new (g_str_hash, g_str_equal);
+  for (i = 0; i < n_names; i++)
+    g_hash_table_add (new_names, (gpointer) names[i]);
+
+  valid = gtk_tree_model_get_iter_first (model, &iter);
+  i = 0;
+  while (valid || i < n_names)
+    {
+      if (!valid)
+        {
+          gtk_list_store_insert_with_values (store, NULL, -1,
+                                             names_column, names[i],
+                                             display_names_column, display_names[i],
+                                             -1);
+          i++;
+          continue;
+        }
+
+      gtk_tree_model_get (model, &iter,
+                          names_column, &name,
+                          display_names_column, &display_name,
+                          -1);
+
+      if (i < n_names && g_strcmp0 (name, names[i]) == 0)
+        {
+          if (g_strcmp0 (display_name, display_names[i]) != 0)
+            gtk_list_store_set (store, &iter,
+                                display_names_column, display_names[i],
+                                -1);
+
+          valid = gtk_tree_model_iter_next (model, &iter);
+          i++;
+        }
+      else if (i >= n_names || name == NULL || !g_hash_table_contains (new_names, name))
+        {
+          valid = gtk_list_store_remove (store, &iter);
+        }
+      else
+        {
+          GtkTreeIter new_iter;
+
+          gtk_list_store_insert_before (store, &new_iter, &iter);
+          gtk_list_store_set (store, &new_iter,
+                              names_column, names[i],
+                              display_names_column, display_names[i],
+                              -1);
+          i++;
+        }
+
+      g_free (name);
+      g_free (display_name);
+    }
+
+  g_hash_table_destroy (new_names);
+}
+
+static void
+merge_models_list (GtkListStore        *store,
+                   PPDManufacturerItem *manufacturer)
+{
+  const gchar **names;
+  const gchar **display_names;
+  gint          i;
+
+  names = g_new (const gchar *, manufacturer->num_of_ppds);
+  display_names = g_new (const gchar *, manufacturer->num_of_ppds);
+
+  for (i = 0; i < manufacturer->num_of_ppds; i++)
+    {
+      names[i] = manufacturer->ppds[i]->ppd_name;
+      display_names[i] = manufacturer->ppds[i]->ppd_display_name;
+    }
+
+  merge_store (store,
+               PPD_NAMES_COLUMN,
+               PPD_DISPLAY_NAMES_COLUMN,
+               names,
+               display_names,
+               manufacturer->num_of_ppds);
+
+  g_free (names);
+  g_free (display_names);
+}
+
 static void
 manufacturer_selection_changed_cb (GtkTreeSelection *selection,
                                    gpointer          user_data)
@@ -87,16 +208,7 @@ manufacturer_selection_changed_cb (GtkTreeSelection *selection,
 
   if (manufacturer_name)
     {
-      index = -1;
-      for (i = 0; i < dialog->list->num_of_manufacturers; i++)
-        {
-          if (g_strcmp0 (manufacturer_name,
-                         dialog->list->manufacturers[i]->manufacturer_name) == 0)
-            {
-              index = i;
-              break;
-            }
-        }
+      index = get_manufacturer_index (dialog->list, manufacturer_name);
 
       if (index >= 0)
         {
@@ -154,6 +266,73 @@ model_selection_changed_cb (GtkTreeSelection *selection,
     }
 }
 
+/*
+ * Merges a new list of PPDs into the shown ones, e.g. when the list
+ * loaded from the cache gets refreshed.
+ */
+static void
+update_ppds_list (PpPPDSelectionDialog *dialog)
+{
+  GtkTreeSelection  *selection;
+  GtkTreeModel      *model;
+  GtkTreeView       *manufacturers_treeview;
+  GtkTreeView       *models_treeview;
+  GtkTreeIter        iter;
+  const gchar      **names;
+  const gchar      **display_names;
+  gchar             *manufacturer_name = NULL;
+  gint               i, index;
+
+  manufacturers_treeview = (GtkTreeView*)
+    gtk_builder_get_object (dialog->builder, "ppd-selection-manufacturers-treeview");
+  models_treeview = (GtkTreeView*)
+    gtk_builder_get_object (dialog->builder, "ppd-selection-models-treeview");
+
+  names = g_new (const gchar *, dialog->list->num_of_manufacturers);
+  display_names = g_new (const gchar *, dialog->list->num_of_manufacturers);
+
+  for (i = 0; i < dialog->list->num_of_manufacturers; i++)
+    {
+      names[i] = dialog->list->manufacturers[i]->manufacturer_name;
+      display_names[i] = dialog->list->manufacturers[i]->manufacturer_display_name;
+    }
+
+  /* Don't refill the models for every removed or inserted manufacturer */
+  selection = gtk_tree_view_get_selection (manufacturers_treeview);
+  g_signal_handlers_block_by_func (selection, manufacturer_selection_changed_cb, dialog);
+
+  merge_store (GTK_LIST_STORE (gtk_tree_view_get_model (manufacturers_treeview)),
+               PPD_MANUFACTURERS_NAMES_COLUMN,
+               PPD_MANUFACTURERS_DISPLAY_NAMES_COLUMN,
+               names,
+               display_names,
+               dialog->list->num_of_manufacturers);
+
+  g_signal_handlers_unblock_by_func (selection, manufacturer_selection_changed_cb, dialog);
+
+  g_free (names);
+  g_free (display_names);
+
+  model = gtk_tree_view_get_model (models_treeview);
+  if (model == NULL)
+    return;
+
+  if (gtk_tree_selection_get_selected (selection, NULL, &iter))
+    {
+      gtk_tree_model_get (gtk_tree_view_get_model (manufacturers_treeview), &iter,
+                          PPD_MANUFACTURERS_NAMES_COLUMN, &manufacturer_name,
+                          -1);
+    }
+
+  index = get_manufacturer_index (dialog->list, manufacturer_name);
+  if (index >= 0)
+    merge_models_list (GTK_LIST_STORE (model), dialog->list->manufacturers[index]);
+  else
+    gtk_list_store_clear (GTK_LIST_STORE (model));
+
+  g_free (manufacturer_name);
+}
+
 static void
 fill_ppds_list (PpPPDSelectionDialog *dialog)
 {
@@ -178,7 +357,11 @@ fill_ppds_list (PpPPDSelectionDialog *dialog)
   treeview = (GtkTreeView*)
     gtk_builder_get_object (dialog->builder, "ppd-selection-manufacturers-treeview");
 
-  if (dialog->list)
+  if (dialog->list && gtk_tree_view_get_model (treeview) != NULL)
+    {
+      update_ppds_list (dialog);
+    }
+  else if (dialog->list)
     {
       store = gtk_list_store_new (2, G_TYPE_STRING, G_TYPE_STRING);
 
@@ -393,6 +576,8 @@ pp_ppd_selection_dialog_free (PpPPDSelectionDialog *dialog)
 
   g_free (dialog->manufacturer);
 
+  ppd_list_free (dialog->list);
+
   g_free (dialog);
 }
 
@@ -412,8 +597,12 @@ void
 pp_ppd_selection_dialog_set_ppd_list (PpPPDSelectionDialog *dialog,
                                       PPDList              *list)
 {
-  dialog->list = list;
+  PPDList *old_list = dialog->list;
+
+  dialog->list = ppd_list_copy (list);
   fill_ppds_list (dialog);
+
+  ppd_list_free (old_list);
 }
 
 static void
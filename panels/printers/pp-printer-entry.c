@@ -687,20 +687,19 @@ pp_printer_entry_get_size_group_widgets (PpPrinterEntry *self)
   return widgets;
 }
 
-PpPrinterEntry *
-pp_printer_entry_new (cups_dest_t  printer,
-                      gboolean     is_authorized)
+/**
+ * pp_printer_entry_update_state:
+ *
+ * Updates the status shown by @self, e.g. from the payload of a
+ * PrinterStateChanged or PrinterStopped notification, without asking
+ * CUPS for the whole destination again.
+ */
+void
+pp_printer_entry_update_state (PpPrinterEntry *self,
+                               gint            printer_state,
+                               const gchar    *reason,
+                               gboolean        is_accepting_jobs)
 {
-  PpPrinterEntry *self;
-  cups_ptype_t    printer_type = 0;
-  gboolean        is_accepting_jobs;
-  gchar          *instance;
-  gchar          *printer_uri = NULL;
-  gchar          *location = NULL;
-  gchar          *printer_icon_name = NULL;
-  gchar          *default_icon_name = NULL;
-  gchar          *printer_make_and_model = NULL;
-  gchar          *reason = NULL;
   gchar         **printer_reasons = NULL;
   gchar          *status = NULL;
   gchar          *printer_status = NULL;
@@ -762,53 +761,8 @@ pp_printer_entry_new (cups_dest_t  printer,
       N_("The optical photo conductor is no longer functioning")
     };
 
-  self = g_object_new (PP_PRINTER_ENTRY_TYPE, "printer-name", printer.name, NULL);
-
-  self->inklevel = g_slice_new0 (InkLevelData);
-
-  if (printer.instance)
-    {
-      instance = g_strdup_printf ("%s / %s", printer.name, printer.instance);
-    }
-  else
-    {
-      instance = g_strdup (printer.name);
-    }
-
-  self->printer_state = PRINTER_READY;
-
-  for (i = 0; i < printer.num_options; i++)
-    {
-      if (g_strcmp0 (printer.options[i].name, "device-uri") == 0)
-        self->printer_uri = printer.options[i].value;
-      else if (g_strcmp0 (printer.options[i].name, "printer-uri-supported") == 0)
-        printer_uri = printer.options[i].value;
-      else if (g_strcmp0 (printer.options[i].name, "printer-type") == 0)
-        printer_type = atoi (printer.options[i].value);
-      else if (g_strcmp0 (printer.options[i].name, "printer-location") == 0)
-        location = printer.options[i].value;
-      else if (g_strcmp0 (printer.options[i].name, "printer-state-reasons") == 0)
-        reason = printer.options[i].value;
-      else if (g_strcmp0 (printer.options[i].name, "marker-names") == 0)
-        self->inklevel->marker_names = g_strcompress (printer.options[i].value);
-      else if (g_strcmp0 (printer.options[i].name, "marker-levels") == 0)
-        self->inklevel->marker_levels = g_strdup (printer.options[i].value);
-      else if (g_strcmp0 (printer.options[i].name, "marker-colors") == 0)
-        self->inklevel->marker_colors = g_strdup (printer.options[i].value);
-      else if (g_strcmp0 (printer.options[i].name, "marker-types") == 0)
-        self->inklevel->marker_types = g_strdup (printer.options[i].value);
-      else if (g_strcmp0 (printer.options[i].name, "printer-make-and-model") == 0)
-        printer_make_and_model = printer.options[i].value;
-      else if (g_strcmp0 (printer.options[i].name, "printer-state") == 0)
-        self->printer_state = atoi (printer.options[i].value);
-      else if (g_strcmp0 (printer.options[i].name, "printer-is-accepting-jobs") == 0)
-        {
-          if (g_strcmp0 (printer.options[i].value, "true") == 0)
-            is_accepting_jobs = TRUE;
-          else
-            is_accepting_jobs = FALSE;
-        }
-    }
+  self->printer_state = printer_state;
+  self->is_accepting_jobs = is_accepting_jobs;
 
   /* Find the first of the most severe reasons
    * and show it in the status field
@@ -860,6 +814,12 @@ pp_printer_entry_new (cups_dest_t  printer,
       gtk_label_set_label (self->error_status, status);
       gtk_widget_set_visible (GTK_WIDGET (self->printer_error), TRUE);
     }
+  else
+    {
+      gtk_widget_set_visible (GTK_WIDGET (self->printer_error), FALSE);
+    }
+
+  g_free (status);
 
   switch (self->printer_state)
     {
@@ -885,6 +845,75 @@ pp_printer_entry_new (cups_dest_t  printer,
         break;
     }
 
+  gtk_label_set_text (self->printer_status, printer_status);
+  g_free (printer_status);
+}
+
+PpPrinterEntry *
+pp_printer_entry_new (cups_dest_t  printer,
+                      gboolean     is_authorized)
+{
+  PpPrinterEntry *self;
+  cups_ptype_t    printer_type = 0;
+  gboolean        is_accepting_jobs = TRUE;
+  gint            printer_state = PRINTER_READY;
+  gchar          *instance;
+  gchar          *printer_uri = NULL;
+  gchar          *location = NULL;
+  gchar          *printer_icon_name = NULL;
+  gchar          *default_icon_name = NULL;
+  gchar          *printer_make_and_model = NULL;
+  gchar          *reason = NULL;
+  int             i;
+
+  self = g_object_new (PP_PRINTER_ENTRY_TYPE, "printer-name", printer.name, NULL);
+
+  self->inklevel = g_slice_new0 (InkLevelData);
+
+  if (printer.instance)
+    {
+      instance = g_strdup_printf ("%s / %s", printer.name, printer.instance);
+    }
+  else
+    {
+      instance = g_strdup (printer.name);
+    }
+
+  for (i = 0; i < printer.num_options; i++)
+    {
+      if (g_strcmp0 (printer.options[i].name, "device-uri") == 0)
+        self->printer_uri = g_strdup (printer.options[i].value);
+      else if (g_strcmp0 (printer.options[i].name, "printer-uri-supported") == 0)
+        printer_uri = printer.options[i].value;
+      else if (g_strcmp0 (printer.options[i].name, "printer-type") == 0)
+        printer_type = atoi (printer.options[i].value);
+      else if (g_strcmp0 (printer.options[i].name, "printer-location") == 0)
+        location = printer.options[i].value;
+      else if (g_strcmp0 (printer.options[i].name, "printer-state-reasons") == 0)
+        reason = printer.options[i].value;
+      else if (g_strcmp0 (printer.options[i].name, "marker-names") == 0)
+        self->inklevel->marker_names = g_strcompress (printer.options[i].value);
+      else if (g_strcmp0 (printer.options[i].name, "marker-levels") == 0)
+        self->inklevel->marker_levels = g_strdup (printer.options[i].value);
+      else if (g_strcmp0 (printer.options[i].name, "marker-colors") == 0)
+        self->inklevel->marker_colors = g_strdup (printer.options[i].value);
+      else if (g_strcmp0 (printer.options[i].name, "marker-types") == 0)
+        self->inklevel->marker_types = g_strdup (printer.options[i].value);
+      else if (g_strcmp0 (printer.options[i].name, "printer-make-and-model") == 0)
+        printer_make_and_model = printer.options[i].value;
+      else if (g_strcmp0 (printer.options[i].name, "printer-state") == 0)
+        printer_state = atoi (printer.options[i].value);
+      else if (g_strcmp0 (printer.options[i].name, "printer-is-accepting-jobs") == 0)
+        {
+          if (g_strcmp0 (printer.options[i].value, "true") == 0)
+            is_accepting_jobs = TRUE;
+          else
+            is_accepting_jobs = FALSE;
+        }
+    }
+
+  pp_printer_entry_update_state (self, printer_state, reason, is_accepting_jobs);
+
   if (printer_is_local (printer_type, self->printer_uri))
     printer_icon_name = g_strdup ("printer");
   else
@@ -892,7 +921,6 @@ pp_printer_entry_new (cups_dest_t  printer,
 
   g_object_set (self, "printer-location", location, NULL);
 
-  self->is_accepting_jobs = is_accepting_jobs;
   self->is_authorized = is_authorized;
 
   self->printer_hostname = printer_get_hostname (printer_type, self->printer_uri, printer_uri);
@@ -905,8 +933,6 @@ pp_printer_entry_new (cups_dest_t  printer,
   check_clean_heads_maintenance_command (self);
 
   gtk_image_set_from_icon_name (self->printer_icon, printer_icon_name, GTK_ICON_SIZE_DIALOG);
-  gtk_label_set_text (self->printer_status, printer_status);
-  g_free (printer_status);
   gtk_label_set_text (self->printer_name_label, instance);
   g_signal_handlers_block_by_func (self->printer_default_checkbutton, set_as_default_printer, self);
   gtk_toggle_button_set_active (GTK_TOGGLE_BUTTON (self->printer_default_checkbutton), printer.is_default);
@@ -966,6 +992,7 @@ pp_printer_entry_dispose (GObject *object)
     pp_jobs_dialog_set_callback (self->pp_jobs_dialog, printer_jobs_dialog_free_cb, self->pp_jobs_dialog);
 
   g_clear_pointer (&self->printer_name, g_free);
+  g_clear_pointer (&self->printer_uri, g_free);
   g_clear_pointer (&self->printer_location, g_free);
   g_clear_pointer (&self->printer_make_and_model, g_free);
   g_clear_pointer (&self->printer_hostname, g_free);
@@ -36,6 +36,11 @@ PpPrinterEntry *pp_printer_entry_new  (cups_dest_t printer,
 
 void            pp_printer_entry_update_jobs_count (PpPrinterEntry *self);
 
+void            pp_printer_entry_update_state (PpPrinterEntry *self,
+                                               gint            printer_state,
+                                               const gchar    *printer_state_reasons,
+                                               gboolean        is_accepting_jobs);
+
 GSList         *pp_printer_entry_get_size_group_widgets (PpPrinterEntry *self);
 
 #endif /* PP_PRINTER_ENTRY_H */
@@ -0,0 +1,230 @@
+/*
+ * Copyright 2017 Red Hat, Inc
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include "pp-printer-events.h"
+
+/*
+ * Collects the printer notifications of the CUPS notifier and hands them
+ * over in batches. The first notification starts a timeout of @interval
+ * ms, the notifications received until it fires are coalesced so that
+ * only the last state of each printer is reported. A busy print server
+ * sends state changes several times per second, this keeps the panel
+ * from reacting to each of them.
+ *
+ * Added or deleted printers can not be handled from the payload of
+ * the notification, they are reported as "printers_changed". Job
+ * notifications carry the state of their printer too, the printer is
+ * reported with "jobs_changed" set.
+ */
+
+struct _PpPrinterEvents
+{
+  guint                interval;
+  PpPrinterEventsFunc  func;
+  gpointer             user_data;
+
+  /* The pending states in the order of their first notification,
+   * and the same states indexed by the name of their printer */
+  GQueue              *states;
+  GHashTable          *states_index;
+  gboolean             printers_changed;
+
+  guint                flush_id;
+};
+
+static void
+printer_state_free (PpPrinterState *state)
+{
+  g_free (state->printer_name);
+  g_free (state->printer_state_reasons);
+  g_slice_free (PpPrinterState, state);
+}
+
+PpPrinterEvents *
+pp_printer_events_new (guint                interval,
+                       PpPrinterEventsFunc  func,
+                       gpointer             user_data)
+{
+  PpPrinterEvents *events;
+
+  events = g_slice_new0 (PpPrinterEvents);
+  events->interval = interval;
+  events->func = func;
+  events->user_data = user_data;
+  events->states = g_queue_new ();
+  events->states_index = g_hash_table_new (g_str_hash, g_str_equal);
+
+  return events;
+}
+
+static void
+set_state (PpPrinterEvents *events,
+           const gchar     *printer_name,
+           guint            printer_state,
+           const gchar     *printer_state_reasons,
+           gboolean         is_accepting_jobs,
+           gboolean         jobs_changed)
+{
+  PpPrinterState *state;
+
+  state = g_hash_table_lookup (events->states_index, printer_name);
+  if (state == NULL)
+    {
+      state = g_slice_new0 (PpPrinterState);
+      state->printer_name = g_strdup (printer_name);
+      g_queue_push_tail (events->states, state);
+      g_hash_table_insert (events->states_index, state->printer_name, state);
+    }
+
+  state->printer_state = printer_state;
+  g_free (state->printer_state_reasons);
+  state->printer_state_reasons = g_strdup (printer_state_reasons);
+  state->is_accepting_jobs = is_accepting_jobs;
+  state->jobs_changed |= jobs_changed;
+}
+
+static gboolean
+flush_cb (gpointer user_data)
+{
+  PpPrinterEvents *events = user_data;
+
+  events->flush_id = 0;
+  pp_printer_events_flush (events);
+
+  return G_SOURCE_REMOVE;
+}
+
+/**
+ * pp_printer_events_push:
+ * @events: a #PpPrinterEvents
+ * @signal_name: the name of the signal of the CUPS notifier
+ * @parameters: the parameters of the signal
+ *
+ * Queues the notification, signals which do not concern printers
+ * are ignored.
+ */
+void
+pp_printer_events_push (PpPrinterEvents *events,
+                        const gchar     *signal_name,
+                        GVariant        *parameters)
+{
+  const gchar    *printer_state_reasons;
+  const gchar    *printer_name;
+  gboolean        is_accepting_jobs;
+  guint           printer_state;
+
+  if (g_strcmp0 (signal_name, "PrinterAdded") == 0 ||
+      g_strcmp0 (signal_name, "PrinterDeleted") == 0)
+    {
+      events->printers_changed = TRUE;
+    }
+  else if (g_strcmp0 (signal_name, "PrinterStateChanged") == 0 ||
+           g_strcmp0 (signal_name, "PrinterStopped") == 0)
+    {
+      if (g_variant_n_children (parameters) == 6)
+        {
+          g_variant_get (parameters, "(&s&s&su&sb)",
+                         NULL,
+                         NULL,
+                         &printer_name,
+                         &printer_state,
+                         &printer_state_reasons,
+                         &is_accepting_jobs);
+
+          set_state (events, printer_name, printer_state, printer_state_reasons, is_accepting_jobs, FALSE);
+        }
+      else
+        {
+          /* Nothing to update the printer from */
+          events->printers_changed = TRUE;
+        }
+    }
+  else if (g_strcmp0 (signal_name, "JobCreated") == 0 ||
+           g_strcmp0 (signal_name, "JobCompleted") == 0)
+    {
+      if (g_variant_n_children (parameters) != 11)
+        return;
+
+      g_variant_get (parameters, "(&s&s&su&sbuu&s&su)",
+                     NULL,
+                     NULL,
+                     &printer_name,
+                     &printer_state,
+                     &printer_state_reasons,
+                     &is_accepting_jobs,
+                     NULL,
+                     NULL,
+                     NULL,
+                     NULL,
+                     NULL);
+
+      set_state (events, printer_name, printer_state, printer_state_reasons, is_accepting_jobs, TRUE);
+    }
+  else
+    {
+      return;
+    }
+
+  if (events->flush_id == 0)
+    events->flush_id = g_timeout_add (events->interval, flush_cb, events);
+}
+
+/**
+ * pp_printer_events_flush:
+ * @events: a #PpPrinterEvents
+ *
+ * Reports the pending notifications right away.
+ */
+void
+pp_printer_events_flush (PpPrinterEvents *events)
+{
+  gboolean  printers_changed;
+  GList    *states;
+
+  if (events->flush_id != 0)
+    {
+      g_source_remove (events->flush_id);
+      events->flush_id = 0;
+    }
+
+  if (g_queue_is_empty (events->states) && !events->printers_changed)
+    return;
+
+  states = events->states->head;
+  printers_changed = events->printers_changed;
+
+  g_queue_init (events->states);
+  g_hash_table_remove_all (events->states_index);
+  events->printers_changed = FALSE;
+
+  events->func (states, printers_changed, events->user_data);
+
+  g_list_free_full (states, (GDestroyNotify) printer_state_free);
+}
+
+void
+pp_printer_events_free (PpPrinterEvents *events)
+{
+  if (events->flush_id != 0)
+    g_source_remove (events->flush_id);
+
+  g_queue_free_full (events->states, (GDestroyNotify) printer_state_free);
+  g_hash_table_destroy (events->states_index);
+  g_slice_free (PpPrinterEvents, events);
+}
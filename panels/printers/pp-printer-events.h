@@ -0,0 +1,51 @@
+/*
+ * Copyright 2017 Red Hat, Inc
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __PP_PRINTER_EVENTS_H__
+#define __PP_PRINTER_EVENTS_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct
+{
+  gchar    *printer_name;
+  gint      printer_state;
+  gchar    *printer_state_reasons;
+  gboolean  is_accepting_jobs;
+  gboolean  jobs_changed;
+} PpPrinterState;
+
+typedef void (*PpPrinterEventsFunc) (GList    *states,
+                                     gboolean  printers_changed,
+                                     gpointer  user_data);
+
+typedef struct _PpPrinterEvents PpPrinterEvents;
+
+PpPrinterEvents *pp_printer_events_new   (guint                interval,
+                                          PpPrinterEventsFunc  func,
+                                          gpointer             user_data);
+void             pp_printer_events_push  (PpPrinterEvents     *events,
+                                          const gchar         *signal_name,
+                                          GVariant            *parameters);
+void             pp_printer_events_flush (PpPrinterEvents     *events);
+void             pp_printer_events_free  (PpPrinterEvents     *events);
+
+G_END_DECLS
+
+#endif /* __PP_PRINTER_EVENTS_H__ */
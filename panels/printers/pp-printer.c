@@ -20,6 +20,7 @@
 
 #include "pp-printer.h"
 
+#include "pp-cups.h"
 #include "pp-job.h"
 
 #if (CUPS_VERSION_MAJOR == 1) && (CUPS_VERSION_MINOR <= 6)
@@ -293,54 +294,25 @@ pp_printer_rename_finish (PpPrinter     *printer,
   return g_task_propagate_boolean (G_TASK (res), error);
 }
 
-typedef struct
-{
-  gboolean  myjobs;
-  gint      which_jobs;
-} GetJobsData;
-
 static void
-get_jobs_thread (GTask        *task,
-                 gpointer      source_object,
-                 gpointer      task_data,
-                 GCancellable *cancellable)
+get_jobs_cb (GObject      *source_object,
+             GAsyncResult *res,
+             gpointer      user_data)
 {
-  GetJobsData *get_jobs_data = task_data;
-  cups_job_t  *jobs = NULL;
-  PpPrinter   *printer = PP_PRINTER (source_object);
-  gchar       *printer_name;
-  GList       *list = NULL;
-  gint         num_jobs;
-  gint         i;
-
-  g_object_get (printer, "printer-name", &printer_name, NULL);
-
-  num_jobs = cupsGetJobs (&jobs,
-                          printer_name,
-                          get_jobs_data->myjobs ? 1 : 0,
-                          get_jobs_data->which_jobs);
-  g_free (printer_name);
-
-  for (i = 0; i < num_jobs; i++)
-    {
-      PpJob *job;
-
-      job = g_object_new (pp_job_get_type (),
-                          "id",    jobs[i].id,
-                          "title", jobs[i].title,
-                          "state", jobs[i].state,
-                          NULL);
+  GTask  *task = user_data;
+  GError *error = NULL;
+  GList  *jobs;
 
-      list = g_list_append (list, job);
-    }
-  cupsFreeJobs (num_jobs, jobs);
+  jobs = pp_cups_get_jobs_finish (PP_CUPS (source_object), res, &error);
+  if (error != NULL)
+    g_task_return_error (task, error);
+  else
+    g_task_return_pointer (task, jobs, (GDestroyNotify) g_list_free);
 
-  if (g_task_set_return_on_cancel (task, FALSE))
-    {
-      g_task_return_pointer (task, list, (GDestroyNotify) g_list_free);
-    }
+  g_object_unref (task);
 }
 
+/* The jobs are requested over the connection which PpCups keeps open */
 void
 pp_printer_get_jobs_async (PpPrinter           *printer,
                            gboolean             myjobs,
@@ -349,18 +321,20 @@ pp_printer_get_jobs_async (PpPrinter           *printer,
                            GAsyncReadyCallback  callback,
                            gpointer             user_data)
 {
-  GetJobsData *get_jobs_data;
-  GTask       *task;
-
-  get_jobs_data = g_new (GetJobsData, 1);
-  get_jobs_data->myjobs = myjobs;
-  get_jobs_data->which_jobs = which_jobs;
+  PpCups *cups;
+  GTask  *task;
 
   task = g_task_new (G_OBJECT (printer), cancellable, callback, user_data);
-  g_task_set_task_data (task, get_jobs_data, g_free);
-  g_task_set_return_on_cancel (task, TRUE);
-  g_task_run_in_thread (task, get_jobs_thread);
-  g_object_unref (task);
+
+  cups = pp_cups_new ();
+  pp_cups_get_jobs_async (cups,
+                          printer->priv->printer_name,
+                          myjobs,
+                          which_jobs,
+                          cancellable,
+                          get_jobs_cb,
+                          task);
+  g_object_unref (cups);
 }
 
 GList *
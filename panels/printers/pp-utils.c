@@ -27,6 +27,8 @@
 #include <cups/ppd.h>
 
 #include "pp-utils.h"
+#include "pp-cups.h"
+#include "cc-cache-file.h"
 
 #define DBUS_TIMEOUT      120000
 #define DBUS_TIMEOUT_LONG 600000
@@ -45,15 +47,6 @@
 #define ippGetString(attr, element, language) attr->values[element].string.text
 #define ippGetBoolean(attr, element) attr->values[element].boolean
 
-static int
-ippGetRange (ipp_attribute_t *attr,
-             int element,
-             int *upper)
-{
-  *upper = attr->values[element].range.upper;
-  return (attr->values[element].range.lower);
-}
-
 static ipp_attribute_t *
 ippFirstAttribute (ipp_t *ipp)
 {
@@ -1246,163 +1239,23 @@ get_page_size_from_locale (void)
 
 typedef struct
 {
-  gchar        *printer_name;
-  gchar       **attributes_names;
-  GHashTable   *result;
   GIACallback   callback;
   gpointer      user_data;
-  GMainContext *context;
 } GIAData;
 
-static gboolean
-get_ipp_attributes_idle_cb (gpointer user_data)
-{
-  GIAData *data = (GIAData *) user_data;
-
-  data->callback (data->result, data->user_data);
-
-  return FALSE;
-}
-
-static void
-get_ipp_attributes_data_free (gpointer user_data)
-{
-  GIAData *data = (GIAData *) user_data;
-
-  if (data->context)
-    g_main_context_unref (data->context);
-  g_free (data->printer_name);
-  if (data->attributes_names)
-    g_strfreev (data->attributes_names);
-  g_free (data);
-}
-
 static void
-get_ipp_attributes_cb (gpointer user_data)
-{
-  GIAData *data = (GIAData *) user_data;
-  GSource *idle_source;
-
-  idle_source = g_idle_source_new ();
-  g_source_set_callback (idle_source,
-                         get_ipp_attributes_idle_cb,
-                         data,
-                         get_ipp_attributes_data_free);
-  g_source_attach (idle_source, data->context);
-  g_source_unref (idle_source);
-}
-
-static void
-ipp_attribute_free2 (gpointer attr)
-{
-  IPPAttribute *attribute = (IPPAttribute *) attr;
-  ipp_attribute_free (attribute);
-}
-
-static gpointer
-get_ipp_attributes_func (gpointer user_data)
+get_ipp_attributes_cb (GObject      *source_object,
+                       GAsyncResult *res,
+                       gpointer      user_data)
 {
-  ipp_attribute_t  *attr = NULL;
-  GIAData          *data = (GIAData *) user_data;
-  ipp_t            *request;
-  ipp_t            *response = NULL;
-  gchar            *printer_uri;
-  char            **requested_attrs = NULL;
-  gint              i, j, length = 0;
+  GIAData    *data = (GIAData *) user_data;
+  GHashTable *result;
 
-  printer_uri = g_strdup_printf ("ipp://localhost/printers/%s", data->printer_name);
+  result = pp_cups_get_printer_attributes_finish (PP_CUPS (source_object), res, NULL);
 
-  if (data->attributes_names)
-    {
-      length = g_strv_length (data->attributes_names);
+  data->callback (result, data->user_data);
 
-      requested_attrs = g_new0 (char *, length);
-      for (i = 0; data->attributes_names[i]; i++)
-        requested_attrs[i] = g_strdup (data->attributes_names[i]);
-
-      request = ippNewRequest (IPP_GET_PRINTER_ATTRIBUTES);
-      ippAddString (request, IPP_TAG_OPERATION, IPP_TAG_URI,
-                    "printer-uri", NULL, printer_uri);
-      ippAddStrings (request, IPP_TAG_OPERATION, IPP_TAG_KEYWORD,
-                     "requested-attributes", length, NULL, (const char **) requested_attrs);
-      response = cupsDoRequest (CUPS_HTTP_DEFAULT, request, "/");
-    }
-
-  if (response)
-    {
-      if (ippGetStatusCode (response) <= IPP_OK_CONFLICT)
-        {
-          for (j = 0; j < length; j++)
-            {
-              attr = ippFindAttribute (response, requested_attrs[j], IPP_TAG_ZERO);
-              if (attr && ippGetCount (attr) > 0 && ippGetValueTag (attr) != IPP_TAG_NOVALUE)
-                {
-                  IPPAttribute *attribute;
-
-                  attribute = g_new0 (IPPAttribute, 1);
-                  attribute->attribute_name = g_strdup (requested_attrs[j]);
-                  attribute->attribute_values = g_new0 (IPPAttributeValue, ippGetCount (attr));
-                  attribute->num_of_values = ippGetCount (attr);
-
-                  if (ippGetValueTag (attr) == IPP_TAG_INTEGER ||
-                      ippGetValueTag (attr) == IPP_TAG_ENUM)
-                    {
-                      attribute->attribute_type = IPP_ATTRIBUTE_TYPE_INTEGER;
-
-                      for (i = 0; i < ippGetCount (attr); i++)
-                        attribute->attribute_values[i].integer_value = ippGetInteger (attr, i);
-                    }
-                  else if (ippGetValueTag (attr) == IPP_TAG_NAME ||
-                           ippGetValueTag (attr) == IPP_TAG_STRING ||
-                           ippGetValueTag (attr) == IPP_TAG_TEXT ||
-                           ippGetValueTag (attr) == IPP_TAG_URI ||
-                           ippGetValueTag (attr) == IPP_TAG_KEYWORD ||
-                           ippGetValueTag (attr) == IPP_TAG_URISCHEME)
-                    {
-                      attribute->attribute_type = IPP_ATTRIBUTE_TYPE_STRING;
-
-                      for (i = 0; i < ippGetCount (attr); i++)
-                        attribute->attribute_values[i].string_value = g_strdup (ippGetString (attr, i, NULL));
-                    }
-                  else if (ippGetValueTag (attr) == IPP_TAG_RANGE)
-                    {
-                      attribute->attribute_type = IPP_ATTRIBUTE_TYPE_RANGE;
-
-                      for (i = 0; i < ippGetCount (attr); i++)
-                        {
-                          attribute->attribute_values[i].lower_range =
-                            ippGetRange (attr, i, &(attribute->attribute_values[i].upper_range));
-                        }
-                    }
-                  else if (ippGetValueTag (attr) == IPP_TAG_BOOLEAN)
-                    {
-                      attribute->attribute_type = IPP_ATTRIBUTE_TYPE_BOOLEAN;
-
-                      for (i = 0; i < ippGetCount (attr); i++)
-                        attribute->attribute_values[i].boolean_value = ippGetBoolean (attr, i);
-                    }
-
-                  if (!data->result)
-                    data->result = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, ipp_attribute_free2);
-
-                  g_hash_table_insert (data->result, g_strdup (requested_attrs[j]), attribute);
-                }
-            }
-        }
-
-      ippDelete (response);
-    }
-
-
-  for (i = 0; i < length; i++)
-    g_free (requested_attrs[i]);
-  g_free (requested_attrs);
-
-  g_free (printer_uri);
-
-  get_ipp_attributes_cb (data);
-
-  return NULL;
+  g_free (data);
 }
 
 void
@@ -1412,33 +1265,20 @@ get_ipp_attributes_async (const gchar  *printer_name,
                           gpointer      user_data)
 {
   GIAData *data;
-  GThread *thread;
-  GError  *error = NULL;
+  PpCups  *cups;
 
   data = g_new0 (GIAData, 1);
-  data->printer_name = g_strdup (printer_name);
-  data->attributes_names = g_strdupv (attributes_names);
   data->callback = callback;
   data->user_data = user_data;
-  data->context = g_main_context_ref_thread_default ();
-
-  thread = g_thread_try_new ("get-ipp-attributes",
-                             get_ipp_attributes_func,
-                             data,
-                             &error);
 
-  if (!thread)
-    {
-      g_warning ("%s", error->message);
-      callback (NULL, user_data);
-
-      g_error_free (error);
-      get_ipp_attributes_data_free (data);
-    }
-  else
-    {
-      g_thread_unref (thread);
-    }
+  cups = pp_cups_new ();
+  pp_cups_get_printer_attributes_async (cups,
+                                        printer_name,
+                                        attributes_names,
+                                        NULL,
+                                        get_ipp_attributes_cb,
+                                        data);
+  g_object_unref (cups);
 }
 
 IPPAttribute *
@@ -2651,6 +2491,224 @@ static const struct {
   { "zebra", "Zebra" },
 };
 
+#define PPDS_CACHE_NAME "ppds.cache"
+#define PPDS_CACHE_TYPE "a(ssa(ss))"
+
+/*
+ * Directories scanned by cups-driverd for PPDs and driver information files.
+ * Drivers are usually installed into their own subdirectories, so these
+ * and their direct subdirectories are watched.
+ */
+static const gchar *ppd_directories[] = {
+  "/usr/share/cups/model",
+  "/usr/share/cups/drv",
+  "/usr/lib/cups/driver",
+  "/usr/share/ppd",
+  "/usr/local/share/ppd",
+  "/opt/share/ppd",
+};
+
+static gchar *
+get_ppds_cache_stamp (void)
+{
+  return g_strdup_printf ("1;%s;%s;%d", PACKAGE_VERSION, cupsServer (), ippPort ());
+}
+
+static gchar **
+get_ppds_watched_paths (void)
+{
+  GPtrArray *paths;
+  gint       i;
+
+  paths = g_ptr_array_new ();
+
+  for (i = 0; i < G_N_ELEMENTS (ppd_directories); i++)
+    {
+      const gchar *name;
+      GDir        *dir;
+
+      g_ptr_array_add (paths, g_strdup (ppd_directories[i]));
+
+      dir = g_dir_open (ppd_directories[i], 0, NULL);
+      if (!dir)
+        continue;
+
+      while ((name = g_dir_read_name (dir)) != NULL)
+        {
+          gchar *path = g_build_filename (ppd_directories[i], name, NULL);
+
+          if (g_file_test (path, G_FILE_TEST_IS_DIR))
+            g_ptr_array_add (paths, path);
+          else
+            g_free (path);
+        }
+
+      g_dir_close (dir);
+    }
+
+  g_ptr_array_add (paths, NULL);
+
+  return (gchar **) g_ptr_array_free (paths, FALSE);
+}
+
+static void
+save_ppds_cache (PPDList *list)
+{
+  GVariantBuilder  builder;
+  gchar          **watched_paths;
+  gchar           *stamp;
+  gint             i, j;
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE (PPDS_CACHE_TYPE));
+
+  for (i = 0; i < list->num_of_manufacturers; i++)
+    {
+      PPDManufacturerItem *manufacturer = list->manufacturers[i];
+
+      g_variant_builder_open (&builder, G_VARIANT_TYPE ("(ssa(ss))"));
+      g_variant_builder_add (&builder, "s", manufacturer->manufacturer_name);
+      g_variant_builder_add (&builder, "s", manufacturer->manufacturer_display_name);
+
+      g_variant_builder_open (&builder, G_VARIANT_TYPE ("a(ss)"));
+      for (j = 0; j < manufacturer->num_of_ppds; j++)
+        g_variant_builder_add (&builder, "(ss)",
+                               manufacturer->ppds[j]->ppd_name,
+                               manufacturer->ppds[j]->ppd_display_name);
+      g_variant_builder_close (&builder);
+
+      g_variant_builder_close (&builder);
+    }
+
+  stamp = get_ppds_cache_stamp ();
+  watched_paths = get_ppds_watched_paths ();
+
+  cc_cache_file_save (PPDS_CACHE_NAME,
+                      stamp,
+                      (const gchar * const *) watched_paths,
+                      g_variant_builder_end (&builder));
+
+  g_strfreev (watched_paths);
+  g_free (stamp);
+}
+
+/*
+ * Returns the list of PPDs which get_all_ppds_async() got the last time,
+ * if the PPD directories did not change since. It is meant to be shown
+ * right away, while get_all_ppds_async() asks CUPS in the background.
+ */
+PPDList *
+ppd_list_load_from_cache (void)
+{
+  GVariantIter  manufacturers_iter;
+  GVariantIter *ppds_iter;
+  GVariant     *cache;
+  PPDList      *result;
+  const gchar  *manufacturer_name;
+  const gchar  *manufacturer_display_name;
+  const gchar  *ppd_name;
+  const gchar  *ppd_display_name;
+  gchar        *stamp;
+  gint          i, j;
+
+  stamp = get_ppds_cache_stamp ();
+  cache = cc_cache_file_load (PPDS_CACHE_NAME, stamp, G_VARIANT_TYPE (PPDS_CACHE_TYPE));
+  g_free (stamp);
+
+  if (!cache)
+    return NULL;
+
+  result = g_new0 (PPDList, 1);
+  result->num_of_manufacturers = g_variant_iter_init (&manufacturers_iter, cache);
+  result->manufacturers = g_new0 (PPDManufacturerItem *, result->num_of_manufacturers);
+
+  i = 0;
+  while (g_variant_iter_next (&manufacturers_iter, "(&s&sa(ss))",
+                              &manufacturer_name,
+                              &manufacturer_display_name,
+                              &ppds_iter))
+    {
+      result->manufacturers[i] = g_new0 (PPDManufacturerItem, 1);
+      result->manufacturers[i]->manufacturer_name = g_strdup (manufacturer_name);
+      result->manufacturers[i]->manufacturer_display_name = g_strdup (manufacturer_display_name);
+      result->manufacturers[i]->num_of_ppds = g_variant_iter_n_children (ppds_iter);
+      result->manufacturers[i]->ppds = g_new0 (PPDName *, result->manufacturers[i]->num_of_ppds);
+
+      j = 0;
+      while (g_variant_iter_next (ppds_iter, "(&s&s)", &ppd_name, &ppd_display_name))
+        {
+          result->manufacturers[i]->ppds[j] = g_new0 (PPDName, 1);
+          result->manufacturers[i]->ppds[j]->ppd_name = g_strdup (ppd_name);
+          result->manufacturers[i]->ppds[j]->ppd_display_name = g_strdup (ppd_display_name);
+          result->manufacturers[i]->ppds[j]->ppd_match_level = -1;
+          j++;
+        }
+
+      g_variant_iter_free (ppds_iter);
+      i++;
+    }
+
+  g_variant_unref (cache);
+
+  return result;
+}
+
+typedef struct
+{
+  GAPCallback callback;
+  gpointer    user_data;
+} LoadPPDsCacheData;
+
+static void
+load_ppds_cache_thread (GTask        *task,
+                        gpointer      source_object,
+                        gpointer      task_data,
+                        GCancellable *cancellable)
+{
+  g_task_return_pointer (task, ppd_list_load_from_cache (), (GDestroyNotify) ppd_list_free);
+}
+
+static void
+load_ppds_cache_cb (GObject      *source_object,
+                    GAsyncResult *res,
+                    gpointer      user_data)
+{
+  LoadPPDsCacheData *data = user_data;
+  PPDList           *ppds;
+  GError            *error = NULL;
+
+  ppds = g_task_propagate_pointer (G_TASK (res), &error);
+
+  /* Don't call callback if cancelled */
+  if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+    g_error_free (error);
+  else
+    data->callback (ppds, data->user_data);
+
+  g_free (data);
+}
+
+/*
+ * Loads the list of PPDs of ppd_list_load_from_cache() in a thread, as
+ * mapping and parsing it takes a while with many drivers installed. The
+ * callback gets NULL if there is no valid cache.
+ */
+void
+ppd_list_load_from_cache_async (GCancellable *cancellable,
+                                GAPCallback   callback,
+                                gpointer      user_data)
+{
+  LoadPPDsCacheData *data;
+  GTask             *task;
+
+  data = g_new0 (LoadPPDsCacheData, 1);
+  data->callback = callback;
+  data->user_data = user_data;
+
+  task = g_task_new (NULL, cancellable, load_ppds_cache_cb, data);
+  g_task_run_in_thread (task, load_ppds_cache_thread);
+  g_object_unref (task);
+}
+
 static gpointer
 get_all_ppds_func (gpointer user_data)
 {
@@ -2875,6 +2933,8 @@ get_all_ppds_func (gpointer user_data)
       g_list_free_full (sort_list, g_free);
       g_hash_table_destroy (ppds_hash);
       g_hash_table_destroy (manufacturers_hash);
+
+      save_ppds_cache (data->result);
     }
 
   get_all_ppds_cb (data);
@@ -2884,6 +2944,7 @@ get_all_ppds_func (gpointer user_data)
 
 /*
  * Get names of all installed PPDs sorted by manufacturers names.
+ * The result is also saved for ppd_list_load_from_cache().
  */
 void
 get_all_ppds_async (GCancellable *cancellable,
@@ -3018,77 +3079,24 @@ get_standard_manufacturers_name (gchar *name)
 
 typedef struct
 {
-  gchar        *printer_name;
-  gchar        *host_name;
-  gint          port;
-  gchar        *result;
   PGPCallback   callback;
   gpointer      user_data;
-  GMainContext *context;
 } PGPData;
 
-static gboolean
-printer_get_ppd_idle_cb (gpointer user_data)
-{
-  PGPData *data = (PGPData *) user_data;
-
-  data->callback (data->result, data->user_data);
-
-  return FALSE;
-}
-
 static void
-printer_get_ppd_data_free (gpointer user_data)
-{
-  PGPData *data = (PGPData *) user_data;
-
-  if (data->context)
-    g_main_context_unref (data->context);
-  g_free (data->result);
-  g_free (data->printer_name);
-  g_free (data->host_name);
-  g_free (data);
-}
-
-static void
-printer_get_ppd_cb (gpointer user_data)
-{
-  PGPData *data = (PGPData *) user_data;
-  GSource *idle_source;
-
-  idle_source = g_idle_source_new ();
-  g_source_set_callback (idle_source,
-                         printer_get_ppd_idle_cb,
-                         data,
-                         printer_get_ppd_data_free);
-  g_source_attach (idle_source, data->context);
-  g_source_unref (idle_source);
-}
-
-static gpointer
-printer_get_ppd_func (gpointer user_data)
+printer_get_ppd_cb (GObject      *source_object,
+                    GAsyncResult *res,
+                    gpointer      user_data)
 {
   PGPData *data = (PGPData *) user_data;
+  gchar   *result;
 
-  if (data->host_name)
-    {
-      http_t *http;
-
-      http = httpConnect (data->host_name, data->port);
-      if (http)
-        {
-          data->result = g_strdup (cupsGetPPD2 (http, data->printer_name));
-          httpClose (http);
-        }
-    }
-  else
-    {
-      data->result = g_strdup (cupsGetPPD (data->printer_name));
-    }
+  result = pp_cups_get_ppd_finish (PP_CUPS (source_object), res, NULL);
 
-  printer_get_ppd_cb (data);
+  data->callback (result, data->user_data);
 
-  return NULL;
+  g_free (result);
+  g_free (data);
 }
 
 void
@@ -3099,34 +3107,21 @@ printer_get_ppd_async (const gchar *printer_name,
                        gpointer     user_data)
 {
   PGPData *data;
-  GThread *thread;
-  GError  *error = NULL;
+  PpCups  *cups;
 
   data = g_new0 (PGPData, 1);
-  data->printer_name = g_strdup (printer_name);
-  data->host_name = g_strdup (host_name);
-  data->port = port;
   data->callback = callback;
   data->user_data = user_data;
-  data->context = g_main_context_ref_thread_default ();
 
-  thread = g_thread_try_new ("printer-get-ppd",
-                             printer_get_ppd_func,
-                             data,
-                             &error);
-
-  if (!thread)
-    {
-      g_warning ("%s", error->message);
-      callback (NULL, user_data);
-
-      g_error_free (error);
-      printer_get_ppd_data_free (data);
-    }
-  else
-    {
-      g_thread_unref (thread);
-    }
+  cups = pp_cups_new ();
+  pp_cups_get_ppd_async (cups,
+                         printer_name,
+                         host_name,
+                         port,
+                         NULL,
+                         printer_get_ppd_cb,
+                         data);
+  g_object_unref (cups);
 }
 
 void
@@ -3141,59 +3136,23 @@ pp_devices_list_free (PpDevicesList *result)
 
 typedef struct
 {
-  gchar        *printer_name;
-  cups_dest_t  *result;
   GNDCallback   callback;
   gpointer      user_data;
-  GMainContext *context;
 } GNDData;
 
-static gboolean
-get_named_dest_idle_cb (gpointer user_data)
-{
-  GNDData *data = (GNDData *) user_data;
-
-  data->callback (data->result, data->user_data);
-
-  return FALSE;
-}
-
 static void
-get_named_dest_data_free (gpointer user_data)
-{
-  GNDData *data = (GNDData *) user_data;
-
-  if (data->context)
-    g_main_context_unref (data->context);
-  g_free (data->printer_name);
-  g_free (data);
-}
-
-static void
-get_named_dest_cb (gpointer user_data)
-{
-  GNDData *data = (GNDData *) user_data;
-  GSource *idle_source;
-
-  idle_source = g_idle_source_new ();
-  g_source_set_callback (idle_source,
-                         get_named_dest_idle_cb,
-                         data,
-                         get_named_dest_data_free);
-  g_source_attach (idle_source, data->context);
-  g_source_unref (idle_source);
-}
-
-static gpointer
-get_named_dest_func (gpointer user_data)
+get_named_dest_cb (GObject      *source_object,
+                   GAsyncResult *res,
+                   gpointer      user_data)
 {
-  GNDData *data = (GNDData *) user_data;
+  GNDData     *data = (GNDData *) user_data;
+  cups_dest_t *result;
 
-  data->result = cupsGetNamedDest (CUPS_HTTP_DEFAULT, data->printer_name, NULL);
+  result = pp_cups_get_named_dest_finish (PP_CUPS (source_object), res, NULL);
 
-  get_named_dest_cb (data);
+  data->callback (result, data->user_data);
 
-  return NULL;
+  g_free (data);
 }
 
 void
@@ -3202,32 +3161,19 @@ get_named_dest_async (const gchar *printer_name,
                       gpointer     user_data)
 {
   GNDData *data;
-  GThread *thread;
-  GError  *error = NULL;
+  PpCups  *cups;
 
   data = g_new0 (GNDData, 1);
-  data->printer_name = g_strdup (printer_name);
   data->callback = callback;
   data->user_data = user_data;
-  data->context = g_main_context_ref_thread_default ();
-
-  thread = g_thread_try_new ("get-named-dest",
-                             get_named_dest_func,
-                             data,
-                             &error);
-
-  if (!thread)
-    {
-      g_warning ("%s", error->message);
-      callback (NULL, user_data);
 
-      g_error_free (error);
-      get_named_dest_data_free (data);
-    }
-  else
-    {
-      g_thread_unref (thread);
-    }
+  cups = pp_cups_new ();
+  pp_cups_get_named_dest_async (cups,
+                                printer_name,
+                                NULL,
+                                get_named_dest_cb,
+                                data);
+  g_object_unref (cups);
 }
 
 typedef struct
@@ -3847,3 +3793,90 @@ shift_string_left (gchar *str)
       memmove (str, next, strlen (next) + 1);
     }
 }
+
+static gint
+get_default_port (const gchar *scheme)
+{
+  if (g_strcmp0 (scheme, "ipp") == 0 ||
+      g_strcmp0 (scheme, "ipps") == 0)
+    return 631;
+  else if (g_strcmp0 (scheme, "socket") == 0)
+    return 9100;
+  else if (g_strcmp0 (scheme, "lpd") == 0)
+    return 515;
+  else if (g_strcmp0 (scheme, "http") == 0)
+    return 80;
+  else if (g_strcmp0 (scheme, "https") == 0)
+    return 443;
+
+  return 0;
+}
+
+/*
+ * Returns a string under which all URIs of one device compare equal:
+ * the scheme and the host name are lowercased, the default port of the
+ * scheme and trailing slashes are dropped. URIs which can not be parsed
+ * are returned unchanged.
+ */
+gchar *
+canonicalize_device_uri (const gchar *device_uri)
+{
+  http_uri_status_t  status;
+  char               scheme[HTTP_MAX_URI];
+  char               username[HTTP_MAX_URI];
+  char               hostname[HTTP_MAX_URI];
+  char               resource[HTTP_MAX_URI];
+  gchar             *lower_scheme;
+  gchar             *lower_hostname;
+  gchar             *port_string = NULL;
+  gchar             *result;
+  gsize              length;
+  int                port;
+
+  if (device_uri == NULL)
+    return NULL;
+
+  status = httpSeparateURI (HTTP_URI_CODING_NONE,
+                            device_uri,
+                            scheme, HTTP_MAX_URI,
+                            username, HTTP_MAX_URI,
+                            hostname, HTTP_MAX_URI,
+                            &port,
+                            resource, HTTP_MAX_URI);
+
+  if (status < HTTP_URI_STATUS_OK || hostname[0] == '\0')
+    return g_strdup (device_uri);
+
+  lower_scheme = g_ascii_strdown (scheme, -1);
+  lower_hostname = g_ascii_strdown (hostname, -1);
+
+  length = strlen (resource);
+  while (length > 0 && resource[length - 1] == '/')
+    resource[--length] = '\0';
+
+  if (port > 0 && port != get_default_port (lower_scheme))
+    port_string = g_strdup_printf (":%d", port);
+
+  result = g_strdup_printf ("%s://%s%s%s%s%s%s",
+                            lower_scheme,
+                            username,
+                            username[0] != '\0' ? "@" : "",
+                            strchr (lower_hostname, ':') != NULL ? "[" : "",
+                            lower_hostname,
+                            strchr (lower_hostname, ':') != NULL ? "]" : "",
+                            port_string != NULL ? port_string : "");
+
+  if (resource[0] != '\0')
+    {
+      gchar *tmp = result;
+
+      result = g_strconcat (tmp, resource, NULL);
+      g_free (tmp);
+    }
+
+  g_free (port_string);
+  g_free (lower_hostname);
+  g_free (lower_scheme);
+
+  return result;
+}
@@ -173,6 +173,11 @@ void        get_all_ppds_async (GCancellable *cancellable,
                                 GAPCallback   callback,
                                 gpointer      user_data);
 
+PPDList    *ppd_list_load_from_cache (void);
+void        ppd_list_load_from_cache_async (GCancellable *cancellable,
+                                            GAPCallback   callback,
+                                            gpointer      user_data);
+
 PPDList    *ppd_list_copy (PPDList *list);
 void        ppd_list_free (PPDList *list);
 
@@ -265,6 +270,8 @@ gchar      *canonicalize_device_name (GList         *device_names,
 
 void        shift_string_left (gchar *str);
 
+gchar      *canonicalize_device_uri (const gchar *device_uri);
+
 G_END_DECLS
 
 #endif /* __PP_UTILS_H */
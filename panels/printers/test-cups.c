@@ -0,0 +1,437 @@
+#include "config.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <locale.h>
+#include <glib.h>
+#include <gio/gio.h>
+#include <cups/cups.h>
+
+#include "pp-cups.h"
+
+/*
+ * A minimal IPP server, answering Get-Printer-Attributes and
+ * CUPS-Get-Printers for the printers "printer-0" to "printer-9".
+ * Requests for the printer "slow" are answered only once
+ * release_slow_printer() is called.
+ */
+
+#define N_PRINTERS 10
+
+static gint     n_connections;
+static gint     n_get_printer_attributes;
+static gint     n_get_printers;
+
+static GMutex   slow_mutex;
+static GCond    slow_cond;
+static gboolean slow_requested;
+static gboolean slow_released;
+
+typedef struct
+{
+  const guint8 *data;
+  gsize         length;
+  gsize         position;
+} Buffer;
+
+static ssize_t
+buffer_read_cb (void        *context,
+                ipp_uchar_t *buffer,
+                size_t       bytes)
+{
+  Buffer *input = context;
+  gsize   length;
+
+  length = MIN (bytes, input->length - input->position);
+  memcpy (buffer, input->data + input->position, length);
+  input->position += length;
+
+  return length;
+}
+
+static ssize_t
+buffer_write_cb (void        *context,
+                 ipp_uchar_t *buffer,
+                 size_t       bytes)
+{
+  g_byte_array_append (context, buffer, bytes);
+
+  return bytes;
+}
+
+static void
+add_printer (ipp_t *response,
+             gint   index)
+{
+  const gchar *commands[] = { "Clean", "PrintSelfTestPage" };
+  gchar       *name;
+  gchar       *location;
+
+  name = g_strdup_printf ("printer-%d", index);
+  location = g_strdup_printf ("Room %d", index);
+
+  ippAddString (response, IPP_TAG_PRINTER, IPP_TAG_NAME, "printer-name", NULL, name);
+  ippAddString (response, IPP_TAG_PRINTER, IPP_TAG_TEXT, "printer-location", NULL, location);
+  ippAddInteger (response, IPP_TAG_PRINTER, IPP_TAG_ENUM, "printer-state", IPP_PRINTER_IDLE);
+  ippAddStrings (response, IPP_TAG_PRINTER, IPP_TAG_KEYWORD, "printer-commands", 2, NULL, commands);
+
+  g_free (location);
+  g_free (name);
+}
+
+static GByteArray *
+handle_ipp_request (const guint8 *data,
+                    gsize         length)
+{
+  ipp_attribute_t *attr;
+  GByteArray      *output;
+  ipp_state_t      state;
+  Buffer           input = { data, length, 0 };
+  ipp_t           *request;
+  ipp_t           *response;
+  gint             i;
+
+  request = ippNew ();
+  do
+    state = ippReadIO (&input, buffer_read_cb, 1, NULL, request);
+  while (state != IPP_DATA && state != IPP_ERROR);
+
+  response = ippNewResponse (request);
+
+  if (ippGetOperation (request) == IPP_GET_PRINTER_ATTRIBUTES)
+    {
+      const gchar *uri = NULL;
+      const gchar *name;
+
+      g_atomic_int_inc (&n_get_printer_attributes);
+
+      attr = ippFindAttribute (request, "printer-uri", IPP_TAG_URI);
+      if (attr != NULL)
+        uri = ippGetString (attr, 0, NULL);
+      name = uri != NULL ? strrchr (uri, '/') + 1 : "";
+
+      if (g_strcmp0 (name, "slow") == 0)
+        {
+          g_mutex_lock (&slow_mutex);
+          slow_requested = TRUE;
+          g_cond_broadcast (&slow_cond);
+          while (!slow_released)
+            g_cond_wait (&slow_cond, &slow_mutex);
+          g_mutex_unlock (&slow_mutex);
+
+          ippAddInteger (response, IPP_TAG_PRINTER, IPP_TAG_ENUM, "printer-state", IPP_PRINTER_STOPPED);
+        }
+      else if (g_str_has_prefix (name, "printer-"))
+        {
+          add_printer (response, atoi (name + strlen ("printer-")));
+        }
+      else
+        {
+          ippSetStatusCode (response, IPP_NOT_FOUND);
+        }
+    }
+  else if (ippGetOperation (request) == CUPS_GET_PRINTERS)
+    {
+      g_atomic_int_inc (&n_get_printers);
+
+      for (i = 0; i < N_PRINTERS; i++)
+        {
+          if (i > 0)
+            ippAddSeparator (response);
+          add_printer (response, i);
+        }
+    }
+  else
+    {
+      ippSetStatusCode (response, IPP_OPERATION_NOT_SUPPORTED);
+    }
+
+  output = g_byte_array_new ();
+  ippSetState (response, IPP_IDLE);
+  do
+    state = ippWriteIO (output, buffer_write_cb, 1, NULL, response);
+  while (state != IPP_DATA && state != IPP_ERROR);
+
+  ippDelete (request);
+  ippDelete (response);
+
+  return output;
+}
+
+static gpointer
+connection_thread (gpointer user_data)
+{
+  GSocketConnection *connection = user_data;
+  GDataInputStream  *input;
+  GOutputStream     *output;
+  gchar             *line;
+
+  input = g_data_input_stream_new (g_io_stream_get_input_stream (G_IO_STREAM (connection)));
+  g_data_input_stream_set_newline_type (input, G_DATA_STREAM_NEWLINE_TYPE_CR_LF);
+  output = g_io_stream_get_output_stream (G_IO_STREAM (connection));
+
+  /* Every iteration handles one HTTP request of the connection */
+  while ((line = g_data_input_stream_read_line (input, NULL, NULL, NULL)) != NULL)
+    {
+      GByteArray *response;
+      gboolean    expect_continue = FALSE;
+      guint8     *body;
+      gchar      *header;
+      gsize       content_length = 0;
+
+      g_free (line);
+
+      while ((line = g_data_input_stream_read_line (input, NULL, NULL, NULL)) != NULL &&
+             line[0] != '\0')
+        {
+          if (g_ascii_strncasecmp (line, "Content-Length:", 15) == 0)
+            content_length = g_ascii_strtoull (line + 15, NULL, 10);
+          else if (g_ascii_strncasecmp (line, "Expect:", 7) == 0)
+            expect_continue = TRUE;
+
+          g_free (line);
+        }
+
+      if (line == NULL)
+        break;
+      g_free (line);
+
+      if (expect_continue)
+        g_output_stream_write_all (output, "HTTP/1.1 100 Continue\r\n\r\n", 25, NULL, NULL, NULL);
+
+      body = g_malloc (content_length);
+      if (!g_input_stream_read_all (G_INPUT_STREAM (input), body, content_length, NULL, NULL, NULL))
+        {
+          g_free (body);
+          break;
+        }
+
+      response = handle_ipp_request (body, content_length);
+      header = g_strdup_printf ("HTTP/1.1 200 OK\r\n"
+                                "Content-Type: application/ipp\r\n"
+                                "Content-Length: %u\r\n"
+                                "\r\n",
+                                response->len);
+
+      g_output_stream_write_all (output, header, strlen (header), NULL, NULL, NULL);
+      g_output_stream_write_all (output, response->data, response->len, NULL, NULL, NULL);
+
+      g_byte_array_unref (response);
+      g_free (header);
+      g_free (body);
+    }
+
+  g_object_unref (input);
+  g_object_unref (connection);
+
+  return NULL;
+}
+
+static gpointer
+server_thread (gpointer user_data)
+{
+  GSocketListener   *listener = user_data;
+  GSocketConnection *connection;
+
+  while ((connection = g_socket_listener_accept (listener, NULL, NULL, NULL)) != NULL)
+    {
+      g_atomic_int_inc (&n_connections);
+      g_thread_unref (g_thread_new ("mock-ipp-connection", connection_thread, connection));
+    }
+
+  return NULL;
+}
+
+static void
+start_server (void)
+{
+  GSocketListener *listener;
+  GError          *error = NULL;
+  gchar           *server;
+  guint16          port;
+
+  listener = g_socket_listener_new ();
+  port = g_socket_listener_add_any_inet_port (listener, NULL, &error);
+  g_assert_no_error (error);
+
+  server = g_strdup_printf ("127.0.0.1:%u", port);
+  g_setenv ("CUPS_SERVER", server, TRUE);
+  g_free (server);
+
+  g_thread_unref (g_thread_new ("mock-ipp-server", server_thread, listener));
+}
+
+static void
+release_slow_printer (void)
+{
+  g_mutex_lock (&slow_mutex);
+  while (!slow_requested)
+    g_cond_wait (&slow_cond, &slow_mutex);
+  slow_released = TRUE;
+  g_cond_broadcast (&slow_cond);
+  g_mutex_unlock (&slow_mutex);
+}
+
+typedef struct
+{
+  GMainLoop  *loop;
+  gint        pending;
+  GPtrArray  *results;
+} TestData;
+
+static void
+get_printer_attributes_cb (GObject      *source_object,
+                           GAsyncResult *res,
+                           gpointer      user_data)
+{
+  TestData   *data = user_data;
+  GHashTable *table;
+  GError     *error = NULL;
+
+  table = pp_cups_get_printer_attributes_finish (PP_CUPS (source_object), res, &error);
+  g_assert_no_error (error);
+  g_assert_nonnull (table);
+
+  g_ptr_array_add (data->results, table);
+
+  if (--data->pending == 0)
+    g_main_loop_quit (data->loop);
+}
+
+static void
+get_printer_attributes (PpCups      *cups,
+                        TestData    *data,
+                        const gchar *printer_name,
+                        gchar      **attributes)
+{
+  data->pending++;
+  pp_cups_get_printer_attributes_async (cups, printer_name, attributes, NULL,
+                                        get_printer_attributes_cb, data);
+}
+
+static void
+test_get_printer_attributes (void)
+{
+  gchar        *attributes[] = { "printer-location", "printer-state", "printer-uri-supported", NULL };
+  IPPAttribute *attr;
+  GHashTable   *table;
+  TestData      data = { NULL, 0, NULL };
+  PpCups       *cups;
+
+  data.loop = g_main_loop_new (NULL, FALSE);
+  data.results = g_ptr_array_new_with_free_func ((GDestroyNotify) g_hash_table_unref);
+  cups = pp_cups_new ();
+
+  get_printer_attributes (cups, &data, "printer-3", attributes);
+  g_main_loop_run (data.loop);
+
+  g_assert_cmpint (data.results->len, ==, 1);
+  table = g_ptr_array_index (data.results, 0);
+
+  /* Attributes the printer does not have are left out */
+  g_assert_cmpint (g_hash_table_size (table), ==, 2);
+
+  attr = g_hash_table_lookup (table, "printer-location");
+  g_assert_nonnull (attr);
+  g_assert_cmpint (attr->attribute_type, ==, IPP_ATTRIBUTE_TYPE_STRING);
+  g_assert_cmpstr (attr->attribute_values[0].string_value, ==, "Room 3");
+
+  attr = g_hash_table_lookup (table, "printer-state");
+  g_assert_nonnull (attr);
+  g_assert_cmpint (attr->attribute_type, ==, IPP_ATTRIBUTE_TYPE_INTEGER);
+  g_assert_cmpint (attr->attribute_values[0].integer_value, ==, IPP_PRINTER_IDLE);
+
+  g_object_unref (cups);
+  g_ptr_array_unref (data.results);
+  g_main_loop_unref (data.loop);
+}
+
+static void
+test_coalesce_and_batch (void)
+{
+  gchar        *state[] = { "printer-state", NULL };
+  gchar        *location_state[] = { "printer-location", "printer-state", NULL };
+  gchar        *state_location[] = { "printer-state", "printer-location", NULL };
+  gchar        *commands[] = { "printer-commands", NULL };
+  IPPAttribute *attr;
+  GHashTable   *table;
+  TestData      data = { NULL, 0, NULL };
+  PpCups       *cups;
+  gint          get_printer_attributes_before;
+  gint          get_printers_before;
+  gint          i, j;
+
+  data.loop = g_main_loop_new (NULL, FALSE);
+  data.results = g_ptr_array_new_with_free_func ((GDestroyNotify) g_hash_table_unref);
+  cups = pp_cups_new ();
+
+  get_printer_attributes_before = g_atomic_int_get (&n_get_printer_attributes);
+  get_printers_before = g_atomic_int_get (&n_get_printers);
+
+  /* Keep the worker busy while the other requests are queued */
+  get_printer_attributes (cups, &data, "slow", state);
+
+  for (i = 0; i < 10; i++)
+    get_printer_attributes (cups, &data, "printer-1", i % 2 ? location_state : state_location);
+
+  for (i = 2; i < N_PRINTERS; i++)
+    {
+      gchar *name = g_strdup_printf ("printer-%d", i);
+
+      get_printer_attributes (cups, &data, name, commands);
+      g_free (name);
+    }
+
+  release_slow_printer ();
+  g_main_loop_run (data.loop);
+
+  g_assert_cmpint (data.results->len, ==, 1 + 10 + N_PRINTERS - 2);
+
+  /* Only the request for "slow" was sent on its own, the identical ones
+   * were sent once, together with the ones for the other printers */
+  g_assert_cmpint (g_atomic_int_get (&n_get_printer_attributes) - get_printer_attributes_before, ==, 1);
+  g_assert_cmpint (g_atomic_int_get (&n_get_printers) - get_printers_before, ==, 1);
+
+  for (i = 1; i < data.results->len; i++)
+    {
+      table = g_ptr_array_index (data.results, i);
+
+      /* Every caller gets its own table */
+      for (j = 0; j < i; j++)
+        g_assert (table != g_ptr_array_index (data.results, j));
+
+      if (g_hash_table_contains (table, "printer-commands"))
+        {
+          attr = g_hash_table_lookup (table, "printer-commands");
+          g_assert_cmpint (attr->num_of_values, ==, 2);
+          g_assert_cmpstr (attr->attribute_values[0].string_value, ==, "Clean");
+        }
+      else
+        {
+          attr = g_hash_table_lookup (table, "printer-location");
+          g_assert_nonnull (attr);
+          g_assert_cmpstr (attr->attribute_values[0].string_value, ==, "Room 1");
+        }
+    }
+
+  /* All the requests of this test program used the same connection */
+  g_assert_cmpint (g_atomic_int_get (&n_connections), ==, 1);
+
+  g_object_unref (cups);
+  g_ptr_array_unref (data.results);
+  g_main_loop_unref (data.loop);
+}
+
+int
+main (int argc, char **argv)
+{
+  setlocale (LC_ALL, "");
+  g_test_init (&argc, &argv, NULL);
+
+  start_server ();
+
+  g_test_add_func ("/printers/cups/get-printer-attributes", test_get_printer_attributes);
+  g_test_add_func ("/printers/cups/coalesce-and-batch", test_coalesce_and_batch);
+
+  return g_test_run ();
+}
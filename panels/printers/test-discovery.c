@@ -0,0 +1,321 @@
+#include "config.h"
+
+#include <string.h>
+#include <glib.h>
+#include <gio/gio.h>
+
+#include "pp-discovery.h"
+#include "pp-host.h"
+#include "pp-utils.h"
+
+/* The one queue the fake LPD server accepts jobs for */
+#define FAKE_LPD_QUEUE "lp"
+
+/* Fails the test instead of hanging when "finished" never comes */
+#define TEST_TIMEOUT 20
+
+typedef struct
+{
+  GMainLoop *loop;
+  GPtrArray *uris;
+  guint      n_finished;
+  gint64     finished_time;
+} DiscoveryData;
+
+static void
+device_found_cb (PpDiscovery   *discovery,
+                 PpPrintDevice *device,
+                 DiscoveryData *data)
+{
+  g_ptr_array_add (data->uris, g_strdup (pp_print_device_get_device_uri (device)));
+}
+
+static void
+finished_cb (PpDiscovery   *discovery,
+             DiscoveryData *data)
+{
+  data->n_finished++;
+  data->finished_time = g_get_monotonic_time ();
+  g_main_loop_quit (data->loop);
+}
+
+static gboolean
+timeout_cb (gpointer user_data)
+{
+  g_error ("The discovery did not finish in time");
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+run_discovery (PpDiscovery         *discovery,
+               PpDiscoveryBackends  backends,
+               DiscoveryData       *data)
+{
+  guint timeout_id;
+
+  data->loop = g_main_loop_new (NULL, FALSE);
+  data->uris = g_ptr_array_new_with_free_func (g_free);
+
+  g_signal_connect (discovery, "device-found", G_CALLBACK (device_found_cb), data);
+  g_signal_connect (discovery, "finished", G_CALLBACK (finished_cb), data);
+
+  timeout_id = g_timeout_add_seconds (TEST_TIMEOUT, timeout_cb, NULL);
+
+  pp_discovery_start (discovery, backends, NULL);
+  g_assert_true (pp_discovery_is_running (discovery));
+
+  g_main_loop_run (data->loop);
+
+  g_assert_false (pp_discovery_is_running (discovery));
+  g_assert_cmpuint (data->n_finished, ==, 1);
+
+  g_source_remove (timeout_id);
+  g_main_loop_unref (data->loop);
+}
+
+static guint16
+listen_on_loopback (GSocketService *service)
+{
+  GSocketAddress *address;
+  GSocketAddress *effective_address = NULL;
+  GInetAddress   *loopback;
+  GError         *error = NULL;
+  guint16         port;
+
+  loopback = g_inet_address_new_loopback (G_SOCKET_FAMILY_IPV4);
+  address = g_inet_socket_address_new (loopback, 0);
+
+  g_socket_listener_add_address (G_SOCKET_LISTENER (service),
+                                 address,
+                                 G_SOCKET_TYPE_STREAM,
+                                 G_SOCKET_PROTOCOL_TCP,
+                                 NULL,
+                                 &effective_address,
+                                 &error);
+  g_assert_no_error (error);
+
+  port = g_inet_socket_address_get_port (G_INET_SOCKET_ADDRESS (effective_address));
+
+  g_socket_service_start (service);
+
+  g_object_unref (effective_address);
+  g_object_unref (address);
+  g_object_unref (loopback);
+
+  return port;
+}
+
+static void
+stop_service (GSocketService *service)
+{
+  g_socket_service_stop (service);
+  g_socket_listener_close (G_SOCKET_LISTENER (service));
+  g_object_unref (service);
+}
+
+/* Answers the "receive a printer job" command of RFC 1179 with 0 for
+ * FAKE_LPD_QUEUE and with 1 for all other queues.
+ */
+static gboolean
+fake_lpd_run_cb (GThreadedSocketService *service,
+                 GSocketConnection      *connection,
+                 GObject                *source_object,
+                 gpointer                user_data)
+{
+  GOutputStream *output;
+  GInputStream  *input;
+  gssize         length;
+  gchar          buffer[256];
+  gchar          reply;
+
+  input = g_io_stream_get_input_stream (G_IO_STREAM (connection));
+  output = g_io_stream_get_output_stream (G_IO_STREAM (connection));
+
+  length = g_input_stream_read (input, buffer, sizeof (buffer) - 1, NULL, NULL);
+  if (length <= 0)
+    return TRUE;
+
+  buffer[length] = '\0';
+
+  reply = strcmp (buffer, "\2" FAKE_LPD_QUEUE "\n") == 0 ? 0 : 1;
+  g_output_stream_write_all (output, &reply, 1, NULL, NULL, NULL);
+
+  /* The job is aborted right away */
+  if (reply == 0)
+    g_input_stream_read (input, buffer, sizeof (buffer), NULL, NULL);
+
+  return TRUE;
+}
+
+/* Accepts connections but never answers */
+static gboolean
+tarpit_run_cb (GThreadedSocketService *service,
+               GSocketConnection      *connection,
+               GObject                *source_object,
+               gpointer                user_data)
+{
+  GInputStream *input;
+  gchar         buffer[256];
+
+  input = g_io_stream_get_input_stream (G_IO_STREAM (connection));
+
+  while (g_input_stream_read (input, buffer, sizeof (buffer), NULL, NULL) > 0)
+    ;
+
+  return TRUE;
+}
+
+static GSocketService *
+fake_lpd_new (gboolean  tarpit,
+              guint16  *port)
+{
+  GSocketService *service;
+
+  service = g_threaded_socket_service_new (-1);
+  g_signal_connect (service,
+                    "run",
+                    tarpit ? G_CALLBACK (tarpit_run_cb) : G_CALLBACK (fake_lpd_run_cb),
+                    NULL);
+
+  *port = listen_on_loopback (service);
+
+  return service;
+}
+
+static void
+test_lpd (void)
+{
+  GSocketService *service;
+  DiscoveryData   data = { 0 };
+  PpDiscovery    *discovery;
+  gchar          *expected_uri;
+  guint16         port;
+
+  service = fake_lpd_new (FALSE, &port);
+
+  discovery = pp_discovery_new ("127.0.0.1");
+  pp_discovery_set_port (discovery, PP_DISCOVERY_LPD, port);
+  run_discovery (discovery, PP_DISCOVERY_LPD, &data);
+
+  expected_uri = g_strdup_printf ("lpd://127.0.0.1:%u/" FAKE_LPD_QUEUE, port);
+  g_assert_cmpuint (data.uris->len, ==, 1);
+  g_assert_cmpstr (g_ptr_array_index (data.uris, 0), ==, expected_uri);
+
+  g_free (expected_uri);
+  g_ptr_array_unref (data.uris);
+  g_object_unref (discovery);
+  stop_service (service);
+}
+
+static void
+test_jetdirect (void)
+{
+  GSocketService *service;
+  DiscoveryData   data = { 0 };
+  PpDiscovery    *discovery;
+  gchar          *expected_uri;
+  guint16         port;
+
+  service = g_socket_service_new ();
+  port = listen_on_loopback (service);
+
+  discovery = pp_discovery_new ("127.0.0.1");
+  pp_discovery_set_port (discovery, PP_DISCOVERY_JETDIRECT, port);
+  run_discovery (discovery, PP_DISCOVERY_JETDIRECT, &data);
+
+  expected_uri = g_strdup_printf ("socket://127.0.0.1:%u", port);
+  g_assert_cmpuint (data.uris->len, ==, 1);
+  g_assert_cmpstr (g_ptr_array_index (data.uris, 0), ==, expected_uri);
+
+  g_free (expected_uri);
+  g_ptr_array_unref (data.uris);
+  g_object_unref (discovery);
+  stop_service (service);
+}
+
+/* A backend which does not answer must neither hold back the results of the
+ * other backends nor "finished".
+ */
+static void
+test_deadline (void)
+{
+  GSocketService *jetdirect_service;
+  GSocketService *lpd_service;
+  DiscoveryData   data = { 0 };
+  PpDiscovery    *discovery;
+  gchar          *expected_uri;
+  guint16         jetdirect_port;
+  guint16         lpd_port;
+  gint64          begin;
+
+  jetdirect_service = g_socket_service_new ();
+  jetdirect_port = listen_on_loopback (jetdirect_service);
+  lpd_service = fake_lpd_new (TRUE, &lpd_port);
+
+  discovery = pp_discovery_new ("127.0.0.1");
+  pp_discovery_set_port (discovery, PP_DISCOVERY_JETDIRECT, jetdirect_port);
+  pp_discovery_set_port (discovery, PP_DISCOVERY_LPD, lpd_port);
+  pp_discovery_set_deadline (discovery, PP_DISCOVERY_LPD, 200);
+
+  begin = g_get_monotonic_time ();
+  run_discovery (discovery, PP_DISCOVERY_JETDIRECT | PP_DISCOVERY_LPD, &data);
+
+  g_assert_cmpint (data.finished_time - begin, <, 2 * G_USEC_PER_SEC);
+
+  expected_uri = g_strdup_printf ("socket://127.0.0.1:%u", jetdirect_port);
+  g_assert_cmpuint (data.uris->len, ==, 1);
+  g_assert_cmpstr (g_ptr_array_index (data.uris, 0), ==, expected_uri);
+
+  g_free (expected_uri);
+  g_ptr_array_unref (data.uris);
+  g_object_unref (discovery);
+  stop_service (lpd_service);
+  stop_service (jetdirect_service);
+}
+
+static void
+test_canonical_uri (void)
+{
+  static const struct
+  {
+    const gchar *uri;
+    const gchar *canonical_uri;
+  } uris[] =
+  {
+    { "socket://Printer.Example.COM:9100", "socket://printer.example.com" },
+    { "SOCKET://printer.example.com", "socket://printer.example.com" },
+    { "socket://printer.example.com:9101", "socket://printer.example.com:9101" },
+    { "lpd://printer.example.com:515/lp/", "lpd://printer.example.com/lp" },
+    { "ipp://printer.example.com:631/printers/office", "ipp://printer.example.com/printers/office" },
+    { "ipp://Printer.example.com/printers/Office", "ipp://printer.example.com/printers/Office" },
+    { "ipp://[fe80::1]:8631/ipp/print", "ipp://[fe80::1]:8631/ipp/print" },
+    { "smb://WORKGROUP/Server/Share%20Name", "smb://workgroup/Server/Share%20Name" },
+    { "usb://HP/LaserJet?serial=00XY", "usb://hp/LaserJet?serial=00XY" },
+    { "not a uri", "not a uri" }
+  };
+  gchar *canonical_uri;
+  guint  i;
+
+  for (i = 0; i < G_N_ELEMENTS (uris); i++)
+    {
+      canonical_uri = canonicalize_device_uri (uris[i].uri);
+      g_assert_cmpstr (canonical_uri, ==, uris[i].canonical_uri);
+      g_free (canonical_uri);
+    }
+
+  g_assert_null (canonicalize_device_uri (NULL));
+}
+
+int
+main (int argc, char **argv)
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/printers/discovery/canonical-uri", test_canonical_uri);
+  g_test_add_func ("/printers/discovery/lpd", test_lpd);
+  g_test_add_func ("/printers/discovery/jetdirect", test_jetdirect);
+  g_test_add_func ("/printers/discovery/deadline", test_deadline);
+
+  return g_test_run ();
+}
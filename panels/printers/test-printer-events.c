@@ -0,0 +1,339 @@
+#include "config.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <glib.h>
+#include <cups/cups.h>
+
+#include "pp-printer-events.h"
+
+/* Shorter than the gaps between the bursts of the recording */
+#define TEST_INTERVAL 50
+
+typedef struct
+{
+  GMainLoop *loop;
+  guint      n_batches;
+  GList     *states;
+  gboolean   printers_changed;
+} BatchData;
+
+typedef struct
+{
+  gchar    *signal_name;
+  gchar    *printer_name;
+  guint     printer_state;
+  gchar    *printer_state_reasons;
+  gboolean  is_accepting_jobs;
+} RecordedEvent;
+
+static void
+recorded_event_free (RecordedEvent *event)
+{
+  g_free (event->signal_name);
+  g_free (event->printer_name);
+  g_free (event->printer_state_reasons);
+  g_free (event);
+}
+
+static void
+bursts_free (GPtrArray *bursts)
+{
+  g_ptr_array_free (bursts, TRUE);
+}
+
+/* Returns an array of bursts, each of them an array of RecordedEvent */
+static GPtrArray *
+parse_recording (const gchar *contents)
+{
+  GPtrArray  *bursts;
+  GPtrArray  *burst;
+  gchar     **lines;
+  guint       i;
+
+  bursts = g_ptr_array_new_with_free_func ((GDestroyNotify) g_ptr_array_unref);
+  burst = g_ptr_array_new_with_free_func ((GDestroyNotify) recorded_event_free);
+  g_ptr_array_add (bursts, burst);
+
+  lines = g_strsplit (contents, "\n", -1);
+  for (i = 0; lines[i] != NULL; i++)
+    {
+      RecordedEvent  *event;
+      gchar         **items;
+
+      if (*lines[i] == '#' || *lines[i] == '\0')
+        continue;
+
+      if (g_str_equal (lines[i], "-"))
+        {
+          burst = g_ptr_array_new_with_free_func ((GDestroyNotify) recorded_event_free);
+          g_ptr_array_add (bursts, burst);
+          continue;
+        }
+
+      items = g_strsplit (lines[i], "\t", -1);
+      g_assert_cmpuint (g_strv_length (items), ==, 5);
+
+      event = g_new0 (RecordedEvent, 1);
+      event->signal_name = g_strdup (items[0]);
+      event->printer_name = g_strdup (items[1]);
+      event->printer_state = atoi (items[2]);
+      event->printer_state_reasons = g_strdup (items[3]);
+      event->is_accepting_jobs = g_str_equal (items[4], "true");
+      g_ptr_array_add (burst, event);
+
+      g_strfreev (items);
+    }
+  g_strfreev (lines);
+
+  return bursts;
+}
+
+static void
+push_event (PpPrinterEvents *events,
+            RecordedEvent   *event)
+{
+  GVariant *parameters;
+  gchar    *text;
+  gchar    *printer_uri;
+
+  text = g_strdup_printf ("%s: %s", event->signal_name, event->printer_name);
+  printer_uri = g_strdup_printf ("ipp://localhost/printers/%s", event->printer_name);
+
+  if (g_str_has_prefix (event->signal_name, "Job"))
+    parameters = g_variant_new ("(sssusbuussu)",
+                                text,
+                                printer_uri,
+                                event->printer_name,
+                                event->printer_state,
+                                event->printer_state_reasons,
+                                event->is_accepting_jobs,
+                                42,
+                                IPP_JOB_PROCESSING,
+                                "none",
+                                "Document",
+                                0);
+  else
+    parameters = g_variant_new ("(sssusb)",
+                                text,
+                                printer_uri,
+                                event->printer_name,
+                                event->printer_state,
+                                event->printer_state_reasons,
+                                event->is_accepting_jobs);
+  g_variant_ref_sink (parameters);
+
+  pp_printer_events_push (events, event->signal_name, parameters);
+
+  g_variant_unref (parameters);
+  g_free (printer_uri);
+  g_free (text);
+}
+
+static void
+printer_state_copy_free (PpPrinterState *state)
+{
+  g_free (state->printer_name);
+  g_free (state->printer_state_reasons);
+  g_free (state);
+}
+
+static void
+batch_cb (GList    *states,
+          gboolean  printers_changed,
+          gpointer  user_data)
+{
+  BatchData *data = user_data;
+  GList     *l;
+
+  data->n_batches++;
+  data->printers_changed = printers_changed;
+
+  /* The states are freed once this returns */
+  for (l = states; l != NULL; l = l->next)
+    {
+      PpPrinterState *state = l->data;
+      PpPrinterState *copy;
+
+      copy = g_new0 (PpPrinterState, 1);
+      copy->printer_name = g_strdup (state->printer_name);
+      copy->printer_state = state->printer_state;
+      copy->printer_state_reasons = g_strdup (state->printer_state_reasons);
+      copy->is_accepting_jobs = state->is_accepting_jobs;
+      copy->jobs_changed = state->jobs_changed;
+      data->states = g_list_append (data->states, copy);
+    }
+
+  g_main_loop_quit (data->loop);
+}
+
+static gboolean
+quit_cb (gpointer user_data)
+{
+  g_main_loop_quit (user_data);
+
+  return G_SOURCE_REMOVE;
+}
+
+/* Checks that a burst is reported as a single batch holding the last
+ * state of each printer, in the order of their first notification */
+static void
+check_batch (BatchData *data,
+             GPtrArray *burst)
+{
+  GPtrArray  *expected;
+  GHashTable *jobs_changed;
+  gboolean    printers_changed = FALSE;
+  GList     *l;
+  guint      i, j;
+
+  expected = g_ptr_array_new ();
+  jobs_changed = g_hash_table_new (g_str_hash, g_str_equal);
+  for (i = 0; i < burst->len; i++)
+    {
+      RecordedEvent *event = g_ptr_array_index (burst, i);
+
+      if (g_str_equal (event->signal_name, "PrinterAdded") ||
+          g_str_equal (event->signal_name, "PrinterDeleted"))
+        {
+          printers_changed = TRUE;
+          continue;
+        }
+
+      if (g_str_has_prefix (event->signal_name, "Job"))
+        g_hash_table_add (jobs_changed, event->printer_name);
+
+      for (j = 0; j < expected->len; j++)
+        {
+          RecordedEvent *other = g_ptr_array_index (expected, j);
+
+          if (g_str_equal (other->printer_name, event->printer_name))
+            {
+              expected->pdata[j] = event;
+              break;
+            }
+        }
+
+      if (j == expected->len)
+        g_ptr_array_add (expected, event);
+    }
+
+  g_assert_cmpint (data->printers_changed, ==, printers_changed);
+  g_assert_cmpuint (g_list_length (data->states), ==, expected->len);
+
+  for (l = data->states, i = 0; l != NULL; l = l->next, i++)
+    {
+      PpPrinterState *state = l->data;
+      RecordedEvent  *event = g_ptr_array_index (expected, i);
+
+      g_assert_cmpstr (state->printer_name, ==, event->printer_name);
+      g_assert_cmpint (state->printer_state, ==, event->printer_state);
+      g_assert_cmpstr (state->printer_state_reasons, ==, event->printer_state_reasons);
+      g_assert_cmpint (state->is_accepting_jobs, ==, event->is_accepting_jobs);
+      g_assert_cmpint (state->jobs_changed, ==, g_hash_table_contains (jobs_changed, event->printer_name));
+    }
+
+  g_hash_table_destroy (jobs_changed);
+  g_ptr_array_free (expected, TRUE);
+}
+
+static void
+test_storm (gconstpointer user_data)
+{
+  PpPrinterEvents *events;
+  BatchData        data = { NULL, 0, NULL, FALSE };
+  GPtrArray       *bursts;
+  guint            i, j;
+
+  bursts = parse_recording (user_data);
+  g_assert_cmpuint (bursts->len, >, 1);
+
+  data.loop = g_main_loop_new (NULL, FALSE);
+  events = pp_printer_events_new (TEST_INTERVAL, batch_cb, &data);
+
+  for (i = 0; i < bursts->len; i++)
+    {
+      GPtrArray *burst = g_ptr_array_index (bursts, i);
+
+      for (j = 0; j < burst->len; j++)
+        push_event (events, g_ptr_array_index (burst, j));
+
+      /* Nothing is reported before the interval elapsed */
+      g_assert_cmpuint (data.n_batches, ==, i);
+
+      g_main_loop_run (data.loop);
+
+      g_assert_cmpuint (data.n_batches, ==, i + 1);
+      check_batch (&data, burst);
+
+      g_list_free_full (data.states, (GDestroyNotify) printer_state_copy_free);
+      data.states = NULL;
+    }
+
+  /* Nothing is left to report */
+  g_timeout_add (TEST_INTERVAL * 2, quit_cb, data.loop);
+  g_main_loop_run (data.loop);
+  g_assert_cmpuint (data.n_batches, ==, bursts->len);
+
+  pp_printer_events_free (events);
+  g_main_loop_unref (data.loop);
+  bursts_free (bursts);
+}
+
+static void
+test_flush (void)
+{
+  PpPrinterEvents *events;
+  BatchData        data = { NULL, 0, NULL, FALSE };
+  GVariant        *parameters;
+
+  data.loop = g_main_loop_new (NULL, FALSE);
+  events = pp_printer_events_new (TEST_INTERVAL, batch_cb, &data);
+
+  parameters = g_variant_ref_sink (g_variant_new ("(s)", "Notification"));
+
+  /* Job notifications are not handled here */
+  pp_printer_events_push (events, "JobCreated", parameters);
+  pp_printer_events_flush (events);
+  g_assert_cmpuint (data.n_batches, ==, 0);
+
+  /* Without the state of the printer the list has to be reloaded */
+  pp_printer_events_push (events, "PrinterStateChanged", parameters);
+  pp_printer_events_flush (events);
+  g_assert_cmpuint (data.n_batches, ==, 1);
+  g_assert_true (data.printers_changed);
+  g_assert_null (data.states);
+
+  /* The timeout was removed by the flush */
+  g_timeout_add (TEST_INTERVAL * 2, quit_cb, data.loop);
+  g_main_loop_run (data.loop);
+  g_assert_cmpuint (data.n_batches, ==, 1);
+
+  g_variant_unref (parameters);
+  pp_printer_events_free (events);
+  g_main_loop_unref (data.loop);
+}
+
+int
+main (int argc, char **argv)
+{
+  char *contents;
+  int   result;
+
+  g_test_init (&argc, &argv, NULL);
+
+  if (g_file_get_contents (TEST_SRCDIR "/printer-events-test.txt", &contents, NULL, NULL) == FALSE)
+    {
+      g_warning ("Failed to load '%s'", TEST_SRCDIR "/printer-events-test.txt");
+      return 1;
+    }
+
+  g_test_add_data_func ("/printers/events/storm", contents, test_storm);
+  g_test_add_func ("/printers/events/flush", test_flush);
+
+  result = g_test_run ();
+
+  g_free (contents);
+
+  return result;
+}
@@ -23,6 +23,7 @@
 #include <libgnome-desktop/gnome-languages.h>
 
 #include "shell/list-box-helper.h"
+#include "cc-cache-file.h"
 #include "cc-common-language.h"
 #include "cc-util.h"
 #include "cc-input-chooser.h"
@@ -38,6 +39,14 @@
 #define MAIN_WINDOW_WIDTH_RATIO 0.60
 #define FILTER_TIMEOUT 150 /* ms */
 
+/* The locales and input sources are compiled into a catalogue once and
+   cached, see load_locale_catalogue() and load_ibus_catalogue() */
+#define CATALOGUE_NAME         "input-sources.cache"
+#define CATALOGUE_VERSION      "1"
+#define CATALOGUE_TYPE         "(a(sss)a(sssssas)as)"
+#define IBUS_CATALOGUE_NAME    "input-sources-ibus.cache"
+#define IBUS_CATALOGUE_TYPE    "a(sssasas)"
+
 typedef enum {
   ROW_TRAVEL_DIRECTION_NONE,
   ROW_TRAVEL_DIRECTION_FORWARD,
@@ -50,6 +59,29 @@ typedef enum {
   ROW_LABEL_POSITION_END
 } RowLabelPosition;
 
+/* The strings point into the catalogues */
+typedef struct {
+  const gchar *name;
+  const gchar *unaccented_name;
+} SourceInfo;
+
+typedef struct {
+  const gchar *id;
+  const gchar *name;
+  const gchar *unaccented_name;
+  const gchar *untranslated_name;
+  const gchar *default_type;
+  const gchar *default_id;
+  GPtrArray *layout_ids;
+  GPtrArray *engine_ids;
+
+  /* Created on demand */
+  GtkListBoxRow *default_input_source_row;
+  GtkListBoxRow *locale_row;
+  GtkListBoxRow *back_row;
+  GPtrArray *input_source_rows;
+} LocaleInfo;
+
 typedef struct {
   /* Not owned */
   GtkWidget *add_button;
@@ -59,12 +91,18 @@ typedef struct {
   GtkAdjustment *adjustment;
   GnomeXkbInfo *xkb_info;
   GHashTable *ibus_engines;
+  LocaleInfo *shown_locale;
 
   /* Owned */
   GtkListBoxRow *more_row;
   GtkWidget *no_results;
+  GVariant *catalogue;
+  GVariant *ibus_catalogue;
+  GHashTable *layouts;
+  GHashTable *engines;
   GHashTable *locales;
   GHashTable *locales_by_language;
+  GHashTable *initial_languages;
   gboolean showing_extra;
   guint filter_timeout_id;
   gchar **filter_words;
@@ -75,35 +113,53 @@ typedef struct {
 #define GET_PRIVATE(chooser) ((CcInputChooserPrivate *) g_object_get_data (G_OBJECT (chooser), "private"))
 #define WID(name) ((GtkWidget *) gtk_builder_get_object (builder, name))
 
-typedef struct {
-  gchar *id;
-  gchar *name;
-  gchar *unaccented_name;
-  gchar *untranslated_name;
-  GtkListBoxRow *default_input_source_row;
-  GtkListBoxRow *locale_row;
-  GtkListBoxRow *back_row;
-  GHashTable *layout_rows_by_id;
-  GHashTable *engine_rows_by_id;
-} LocaleInfo;
+static LocaleInfo *
+locale_info_new (const gchar *id,
+                 const gchar *name,
+                 const gchar *unaccented_name,
+                 const gchar *untranslated_name)
+{
+  LocaleInfo *info;
+
+  info = g_new0 (LocaleInfo, 1);
+  info->id = id;
+  info->name = name;
+  info->unaccented_name = unaccented_name;
+  info->untranslated_name = untranslated_name;
+  info->layout_ids = g_ptr_array_new ();
+  info->engine_ids = g_ptr_array_new ();
+
+  return info;
+}
+
+static void
+locale_info_clear_input_source_rows (LocaleInfo *info)
+{
+  g_clear_object (&info->default_input_source_row);
+  g_clear_pointer (&info->input_source_rows, g_ptr_array_unref);
+}
 
 static void
 locale_info_free (gpointer data)
 {
   LocaleInfo *info = data;
 
-  g_free (info->id);
-  g_free (info->name);
-  g_free (info->unaccented_name);
-  g_free (info->untranslated_name);
-  g_clear_object (&info->default_input_source_row);
+  locale_info_clear_input_source_rows (info);
   g_clear_object (&info->locale_row);
   g_clear_object (&info->back_row);
-  g_hash_table_destroy (info->layout_rows_by_id);
-  g_hash_table_destroy (info->engine_rows_by_id);
+  g_ptr_array_unref (info->layout_ids);
+  g_ptr_array_unref (info->engine_ids);
   g_free (info);
 }
 
+static gboolean
+locale_info_has_input_sources (LocaleInfo *info)
+{
+  return info->default_id != NULL ||
+         info->layout_ids->len > 0 ||
+         info->engine_ids->len > 0;
+}
+
 static void
 set_row_widget_margins (GtkWidget *widget)
 {
@@ -210,65 +266,45 @@ locale_row_new (const gchar *text)
 
 static GtkListBoxRow *
 input_source_row_new (GtkWidget   *chooser,
-                         const gchar *type,
-                         const gchar *id)
+                      const gchar *type,
+                      const gchar *id)
 {
   CcInputChooserPrivate *priv = GET_PRIVATE (chooser);
-  GtkWidget *row = NULL;
+  SourceInfo *source = NULL;
+  GtkWidget *row;
   GtkWidget *widget;
 
   if (g_str_equal (type, INPUT_SOURCE_TYPE_XKB))
-    {
-      const gchar *display_name;
-
-      gnome_xkb_info_get_layout_info (priv->xkb_info, id, &display_name, NULL, NULL, NULL);
-
-      row = gtk_list_box_row_new ();
-      widget = padded_label_new (display_name,
-                                 ROW_LABEL_POSITION_START,
-                                 ROW_TRAVEL_DIRECTION_NONE,
-                                 FALSE);
-      gtk_container_add (GTK_CONTAINER (row), widget);
-      g_object_set_data (G_OBJECT (row), "name", (gpointer) display_name);
-      g_object_set_data_full (G_OBJECT (row), "unaccented-name",
-                              cc_util_normalize_casefold_and_unaccent (display_name), g_free);
-    }
+    source = g_hash_table_lookup (priv->layouts, id);
   else if (g_str_equal (type, INPUT_SOURCE_TYPE_IBUS))
+    source = g_hash_table_lookup (priv->engines, id);
+
+  if (!source)
+    return NULL;
+
+  row = gtk_list_box_row_new ();
+  widget = padded_label_new (source->name,
+                             ROW_LABEL_POSITION_START,
+                             ROW_TRAVEL_DIRECTION_NONE,
+                             FALSE);
+  gtk_container_add (GTK_CONTAINER (row), widget);
+
+  if (g_str_equal (type, INPUT_SOURCE_TYPE_IBUS))
     {
-#ifdef HAVE_IBUS
-      gchar *display_name;
       GtkWidget *image;
 
-      display_name = engine_get_display_name (g_hash_table_lookup (priv->ibus_engines, id));
-
-      row = gtk_list_box_row_new ();
-      widget = padded_label_new (display_name,
-                                 ROW_LABEL_POSITION_START,
-                                 ROW_TRAVEL_DIRECTION_NONE,
-                                 FALSE);
-      gtk_container_add (GTK_CONTAINER (row), widget);
       image = gtk_image_new_from_icon_name ("system-run-symbolic", GTK_ICON_SIZE_MENU);
       set_row_widget_margins (image);
       gtk_style_context_add_class (gtk_widget_get_style_context (image), "dim-label");
       gtk_box_pack_start (GTK_BOX (widget), image, FALSE, TRUE, 0);
-
-      g_object_set_data_full (G_OBJECT (row), "name", display_name, g_free);
-      g_object_set_data_full (G_OBJECT (row), "unaccented-name",
-                              cc_util_normalize_casefold_and_unaccent (display_name), g_free);
-#else
-      widget = NULL;
-#endif  /* HAVE_IBUS */
     }
 
-  if (row)
-    {
-      g_object_set_data (G_OBJECT (row), "type", (gpointer) type);
-      g_object_set_data (G_OBJECT (row), "id", (gpointer) id);
-
-      return GTK_LIST_BOX_ROW (row);
-    }
+  g_object_set_data (G_OBJECT (row), "name", (gpointer) source->name);
+  g_object_set_data (G_OBJECT (row), "unaccented-name", (gpointer) source->unaccented_name);
+  g_object_set_data (G_OBJECT (row), "type", (gpointer) type);
+  g_object_set_data (G_OBJECT (row), "id", (gpointer) id);
 
-  return NULL;
+  return GTK_LIST_BOX_ROW (row);
 }
 
 static void
@@ -305,25 +341,65 @@ set_fixed_size (GtkWidget *chooser)
                                   GTK_POLICY_AUTOMATIC);
 }
 
+static void
+add_input_source_row (GtkWidget   *chooser,
+                      LocaleInfo  *info,
+                      const gchar *type,
+                      const gchar *id)
+{
+  GtkListBoxRow *row;
+
+  row = input_source_row_new (chooser, type, id);
+  if (row)
+    {
+      g_object_set_data (G_OBJECT (row), "locale-info", info);
+      g_ptr_array_add (info->input_source_rows, g_object_ref_sink (row));
+    }
+}
+
+static void
+ensure_input_source_rows (GtkWidget  *chooser,
+                          LocaleInfo *info)
+{
+  guint i;
+
+  if (info->input_source_rows)
+    return;
+
+  info->input_source_rows = g_ptr_array_new_with_free_func (g_object_unref);
+
+  if (info->default_id)
+    {
+      info->default_input_source_row = input_source_row_new (chooser, info->default_type, info->default_id);
+      if (info->default_input_source_row)
+        {
+          g_object_ref_sink (info->default_input_source_row);
+          g_object_set_data (G_OBJECT (info->default_input_source_row), "default", GINT_TO_POINTER (TRUE));
+          g_object_set_data (G_OBJECT (info->default_input_source_row), "locale-info", info);
+        }
+    }
+
+  for (i = 0; i < info->layout_ids->len; i++)
+    add_input_source_row (chooser, info, INPUT_SOURCE_TYPE_XKB, g_ptr_array_index (info->layout_ids, i));
+
+  for (i = 0; i < info->engine_ids->len; i++)
+    add_input_source_row (chooser, info, INPUT_SOURCE_TYPE_IBUS, g_ptr_array_index (info->engine_ids, i));
+}
+
 static void
 add_input_source_rows_for_locale (GtkWidget  *chooser,
                                   LocaleInfo *info)
 {
   CcInputChooserPrivate *priv = GET_PRIVATE (chooser);
-  GtkWidget *row;
-  GHashTableIter iter;
-  const gchar *id;
+  guint i;
+
+  ensure_input_source_rows (chooser, info);
 
   if (info->default_input_source_row)
     gtk_container_add (GTK_CONTAINER (priv->list), GTK_WIDGET (info->default_input_source_row));
 
-  g_hash_table_iter_init (&iter, info->layout_rows_by_id);
-  while (g_hash_table_iter_next (&iter, (gpointer *) &id, (gpointer *) &row))
-    gtk_container_add (GTK_CONTAINER (priv->list), row);
-
-  g_hash_table_iter_init (&iter, info->engine_rows_by_id);
-  while (g_hash_table_iter_next (&iter, (gpointer *) &id, (gpointer *) &row))
-    gtk_container_add (GTK_CONTAINER (priv->list), row);
+  for (i = 0; i < info->input_source_rows->len; i++)
+    gtk_container_add (GTK_CONTAINER (priv->list), g_ptr_array_index (info->input_source_rows, i));
 }
 
 static void
@@ -335,6 +411,7 @@ show_input_sources_for_locale (GtkWidget   *chooser,
   set_fixed_size (chooser);
 
   remove_all_children (GTK_CONTAINER (priv->list));
+  priv->shown_locale = info;
 
   if (!info->back_row)
     {
@@ -367,39 +444,110 @@ is_current_locale (const gchar *locale)
   return g_strcmp0 (setlocale (LC_CTYPE, NULL), locale) == 0;
 }
 
+static gboolean
+match_all (gchar       **words,
+           const gchar  *str)
+{
+  gchar **w;
+
+  for (w = words; *w; ++w)
+    if (!strstr (str, *w))
+      return FALSE;
+
+  return TRUE;
+}
+
+static gboolean
+match_source_in_table (gchar      **words,
+                       GHashTable  *sources,
+                       GPtrArray   *ids)
+{
+  SourceInfo *source;
+  guint i;
+
+  for (i = 0; i < ids->len; i++)
+    {
+      source = g_hash_table_lookup (sources, g_ptr_array_index (ids, i));
+      if (source && match_all (words, source->unaccented_name))
+        return TRUE;
+    }
+  return FALSE;
+}
+
+static gboolean
+locale_info_matches (CcInputChooserPrivate  *priv,
+                     LocaleInfo             *info,
+                     gchar                 **words)
+{
+  if (match_all (words, info->unaccented_name))
+    return TRUE;
+
+  if (match_all (words, info->untranslated_name))
+    return TRUE;
+
+  if (match_source_in_table (words, priv->layouts, info->layout_ids))
+    return TRUE;
+
+  if (match_source_in_table (words, priv->engines, info->engine_ids))
+    return TRUE;
+
+  return FALSE;
+}
+
+/* Only creates the rows of the locales that the filter lets through, the
+   other ones are created once "More…" is activated or a search matches
+   them. */
 static void
-show_locale_rows (GtkWidget *chooser)
+add_locale_rows (GtkWidget *chooser)
 {
   CcInputChooserPrivate *priv = GET_PRIVATE (chooser);
-  GHashTable *initial = NULL;
   LocaleInfo *info;
   GHashTableIter iter;
+  gboolean is_extra;
 
-  remove_all_children (GTK_CONTAINER (priv->list));
-
-  if (!priv->showing_extra)
-    initial = cc_common_language_get_initial_languages ();
+  if (!priv->initial_languages)
+    priv->initial_languages = cc_common_language_get_initial_languages ();
 
   g_hash_table_iter_init (&iter, priv->locales);
   while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &info))
     {
-      if (!info->default_input_source_row &&
-          !g_hash_table_size (info->layout_rows_by_id) &&
-          !g_hash_table_size (info->engine_rows_by_id))
+      if (!locale_info_has_input_sources (info))
+        continue;
+
+      if (info->locale_row &&
+          gtk_widget_get_parent (GTK_WIDGET (info->locale_row)) == priv->list)
+        continue;
+
+      is_extra = !g_hash_table_contains (priv->initial_languages, info->id) &&
+                 !is_current_locale (info->id);
+
+      if (!priv->showing_extra && is_extra)
+        continue;
+
+      if (priv->filter_words && !locale_info_matches (priv, info, priv->filter_words))
         continue;
 
       if (!info->locale_row)
         {
           info->locale_row = g_object_ref_sink (locale_row_new (info->name));
           g_object_set_data (G_OBJECT (info->locale_row), "locale-info", info);
-
-          if (!priv->showing_extra &&
-              !g_hash_table_contains (initial, info->id) &&
-              !is_current_locale (info->id))
-            g_object_set_data (G_OBJECT (info->locale_row), "is-extra", GINT_TO_POINTER (TRUE));
+          g_object_set_data (G_OBJECT (info->locale_row), "is-extra", GINT_TO_POINTER (is_extra));
         }
       gtk_container_add (GTK_CONTAINER (priv->list), GTK_WIDGET (info->locale_row));
+      gtk_widget_show_all (GTK_WIDGET (info->locale_row));
     }
+}
+
+static void
+show_locale_rows (GtkWidget *chooser)
+{
+  CcInputChooserPrivate *priv = GET_PRIVATE (chooser);
+
+  remove_all_children (GTK_CONTAINER (priv->list));
+  priv->shown_locale = NULL;
+
+  g_clear_pointer (&priv->initial_languages, g_hash_table_destroy);
+  add_locale_rows (chooser);
 
   gtk_container_add (GTK_CONTAINER (priv->list), GTK_WIDGET (priv->more_row));
 
@@ -415,9 +563,6 @@ show_locale_rows (GtkWidget *chooser)
   if (gtk_widget_is_visible (priv->filter_entry) &&
       !gtk_widget_is_focus (priv->filter_entry))
     gtk_widget_grab_focus (priv->filter_entry);
-
-  if (!priv->showing_extra)
-    g_hash_table_destroy (initial);
 }
 
 static gint
@@ -473,37 +618,6 @@ list_sort (gconstpointer a,
   return g_strcmp0 (la, lb);
 }
 
-static gboolean
-match_all (gchar       **words,
-           const gchar  *str)
-{
-  gchar **w;
-
-  for (w = words; *w; ++w)
-    if (!strstr (str, *w))
-      return FALSE;
-
-  return TRUE;
-}
-
-static gboolean
-match_source_in_table (gchar      **words,
-                       GHashTable  *table)
-{
-  GHashTableIter iter;
-  gpointer row;
-  const gchar *source_name;
-
-  g_hash_table_iter_init (&iter, table);
-  while (g_hash_table_iter_next (&iter, NULL, &row))
-    {
-      source_name = g_object_get_data (G_OBJECT (row), "unaccented-name");
-      if (source_name && match_all (words, source_name))
-        return TRUE;
-    }
-  return FALSE;
-}
-
 static gboolean
 list_filter (GtkListBoxRow *row,
              gpointer   user_data)
@@ -530,27 +644,17 @@ list_filter (GtkListBoxRow *row,
   if (row == info->back_row)
     return TRUE;
 
+  source_name = g_object_get_data (G_OBJECT (row), "unaccented-name");
+  if (!source_name)
+    return locale_info_matches (priv, info, priv->filter_words);
+
   if (match_all (priv->filter_words, info->unaccented_name))
     return TRUE;
 
   if (match_all (priv->filter_words, info->untranslated_name))
     return TRUE;
 
-  source_name = g_object_get_data (G_OBJECT (row), "unaccented-name");
-  if (source_name)
-    {
-      if (match_all (priv->filter_words, source_name))
-        return TRUE;
-    }
-  else
-    {
-      if (match_source_in_table (priv->filter_words, info->layout_rows_by_id))
-        return TRUE;
-      if (match_source_in_table (priv->filter_words, info->engine_rows_by_id))
-        return TRUE;
-    }
-
-  return FALSE;
+  return match_all (priv->filter_words, source_name);
 }
 
 static gboolean
@@ -592,6 +696,8 @@ do_filter (GtkWidget *chooser)
   if (!priv->filter_words || !priv->filter_words[0])
     {
       g_clear_pointer (&priv->filter_words, g_strfreev);
+      if (!priv->shown_locale)
+        add_locale_rows (chooser);
       gtk_list_box_invalidate_filter (GTK_LIST_BOX (priv->list));
       gtk_list_box_set_placeholder (GTK_LIST_BOX (priv->list), NULL);
     }
@@ -599,6 +705,8 @@ do_filter (GtkWidget *chooser)
     {
       if (!previous_words || strvs_differ (priv->filter_words, previous_words))
         {
+          if (!priv->shown_locale)
+            add_locale_rows (chooser);
           gtk_list_box_invalidate_filter (GTK_LIST_BOX (priv->list));
           gtk_list_box_set_placeholder (GTK_LIST_BOX (priv->list), priv->no_results);
         }
@@ -629,6 +737,7 @@ show_more (GtkWidget *chooser)
   gtk_widget_grab_focus (priv->filter_entry);
 
   priv->showing_extra = TRUE;
+  add_locale_rows (chooser);
 
   gtk_list_box_invalidate_filter (GTK_LIST_BOX (priv->list));
 }
@@ -709,117 +818,379 @@ list_button_release_event (GtkListBox *box,
   return FALSE;
 }
 
+/* The catalogues are rebuilt when locales or keyboard layouts are
+   installed or removed */
+static const gchar *catalogue_watched_paths[] = {
+  XKB_BASE "/rules/evdev.xml",
+  SYSTEM_LOCALE_DIR,
+  SYSTEM_LOCALE_DIR "/locale-archive",
+  NULL
+};
+
+static gchar *
+get_catalogue_stamp (void)
+{
+  const gchar *language = g_getenv ("LANGUAGE");
+
+  /* The names are translated */
+  return g_strjoin (";",
+                    CATALOGUE_VERSION,
+                    PACKAGE_VERSION,
+                    XKB_CONFIG_VERSION,
+                    setlocale (LC_MESSAGES, NULL),
+                    language ? language : "",
+                    NULL);
+}
+
 static void
-add_default_row (GtkWidget   *chooser,
-                 LocaleInfo  *info,
-                 const gchar *type,
-                 const gchar *id)
+add_ids_to_set (GHashTable *set,
+                GList      *list)
 {
-  info->default_input_source_row = input_source_row_new (chooser, type, id);
-  if (info->default_input_source_row)
+  while (list)
     {
-      g_object_ref_sink (info->default_input_source_row);
-      g_object_set_data (G_OBJECT (info->default_input_source_row), "default", GINT_TO_POINTER (TRUE));
-      g_object_set_data (G_OBJECT (info->default_input_source_row), "locale-info", info);
+      g_hash_table_add (set, list->data);
+      list = list->next;
     }
 }
 
 static void
-add_rows_to_table (GtkWidget   *chooser,
-                   LocaleInfo  *info,
-                   GList       *list,
-                   const gchar *type,
-                   const gchar *default_id)
+add_locale_to_catalogue (GVariantBuilder *builder,
+                         GnomeXkbInfo    *xkb_info,
+                         const gchar     *locale,
+                         const gchar     *lang_code,
+                         const gchar     *country_code,
+                         GHashTable      *layouts_with_locale)
 {
-  GHashTable *table;
-  GtkListBoxRow *row;
-  const gchar *id;
-
-  if (g_str_equal (type, INPUT_SOURCE_TYPE_XKB))
-    table = info->layout_rows_by_id;
-  else if (g_str_equal (type, INPUT_SOURCE_TYPE_IBUS))
-    table = info->engine_rows_by_id;
-  else
-    return;
+  GHashTable *layouts;
+  GHashTableIter iter;
+  GList *list;
+  gchar *name;
+  gchar *untranslated_name;
+  gchar *language;
+  gchar *tmp;
+  const gchar *type = NULL;
+  const gchar *id = NULL;
+  const gchar *default_id = "";
+  const gchar *layout_id;
+
+  name = gnome_get_language_from_locale (locale, NULL);
+  tmp = gnome_get_language_from_locale (locale, "C");
+  untranslated_name = cc_util_normalize_casefold_and_unaccent (tmp);
+  g_free (tmp);
+  language = gnome_get_language_from_code (lang_code, NULL);
 
-  while (list)
+  if (name && untranslated_name && language)
     {
-      id = (const gchar *) list->data;
+      if (gnome_get_input_source_from_locale (locale, &type, &id) &&
+          g_str_equal (type, INPUT_SOURCE_TYPE_XKB))
+        {
+          default_id = id;
+          g_hash_table_add (layouts_with_locale, (gpointer) id);
+        }
+
+      layouts = g_hash_table_new (g_str_hash, g_str_equal);
 
-      /* The widget for the default input source lives elsewhere */
-      if (g_strcmp0 (id, default_id))
+      list = gnome_xkb_info_get_layouts_for_language (xkb_info, lang_code);
+      add_ids_to_set (layouts, list);
+      g_list_free (list);
+
+      if (country_code != NULL)
         {
-          row = input_source_row_new (chooser, type, id);
-          if (row)
-            {
-              g_object_set_data (G_OBJECT (row), "locale-info", info);
-              g_hash_table_replace (table, (gpointer) id, g_object_ref_sink (row));
-            }
+          list = gnome_xkb_info_get_layouts_for_country (xkb_info, country_code);
+          add_ids_to_set (layouts, list);
+          g_list_free (list);
         }
-      list = list->next;
+
+      /* The default input source is listed on its own */
+      g_hash_table_remove (layouts, default_id);
+
+      tmp = cc_util_normalize_casefold_and_unaccent (name);
+
+      g_variant_builder_open (builder, G_VARIANT_TYPE ("(sssssas)"));
+      g_variant_builder_add (builder, "s", locale);
+      g_variant_builder_add (builder, "s", name);
+      g_variant_builder_add (builder, "s", tmp);
+      g_variant_builder_add (builder, "s", untranslated_name);
+      g_variant_builder_add (builder, "s", language);
+      g_variant_builder_add (builder, "s", default_id);
+      g_variant_builder_open (builder, G_VARIANT_TYPE ("as"));
+      g_hash_table_iter_init (&iter, layouts);
+      while (g_hash_table_iter_next (&iter, (gpointer *) &layout_id, NULL))
+        {
+          g_variant_builder_add (builder, "s", layout_id);
+          g_hash_table_add (layouts_with_locale, (gpointer) layout_id);
+        }
+      g_variant_builder_close (builder);
+      g_variant_builder_close (builder);
+
+      g_free (tmp);
+      g_hash_table_destroy (layouts);
     }
+
+  g_free (language);
+  g_free (untranslated_name);
+  g_free (name);
 }
 
-static void
-add_row (GtkWidget   *chooser,
-         LocaleInfo  *info,
-         const gchar *type,
-         const gchar *id)
+static GVariant *
+build_locale_catalogue (GnomeXkbInfo *xkb_info)
 {
-  GList tmp = { 0 };
-  tmp.data = (gpointer) id;
-  add_rows_to_table (chooser, info, &tmp, type, NULL);
+  GVariantBuilder builder;
+  GHashTable *layouts_with_locale;
+  GHashTable *locales;
+  gchar **locale_ids;
+  gchar **locale;
+  GList *list, *l;
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE (CATALOGUE_TYPE));
+
+  layouts_with_locale = g_hash_table_new (g_str_hash, g_str_equal);
+  locales = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+  list = gnome_xkb_info_get_all_layouts (xkb_info);
+
+  g_variant_builder_open (&builder, G_VARIANT_TYPE ("a(sss)"));
+  for (l = list; l; l = l->next)
+    {
+      const gchar *display_name = NULL;
+      gchar *unaccented_name;
+
+      gnome_xkb_info_get_layout_info (xkb_info, l->data, &display_name, NULL, NULL, NULL);
+      if (!display_name)
+        continue;
+
+      unaccented_name = cc_util_normalize_casefold_and_unaccent (display_name);
+      g_variant_builder_add (&builder, "(sss)", l->data, display_name, unaccented_name);
+      g_free (unaccented_name);
+    }
+  g_variant_builder_close (&builder);
+
+  g_variant_builder_open (&builder, G_VARIANT_TYPE ("a(sssssas)"));
+  locale_ids = gnome_get_all_locales ();
+  for (locale = locale_ids; *locale; ++locale)
+    {
+      gchar *lang_code, *country_code;
+      gchar *simple_locale;
+
+      if (!gnome_parse_locale (*locale, &lang_code, &country_code, NULL, NULL))
+        continue;
+
+      if (country_code != NULL)
+        simple_locale = g_strdup_printf ("%s_%s.UTF-8", lang_code, country_code);
+      else
+        simple_locale = g_strdup_printf ("%s.UTF-8", lang_code);
+
+      if (!g_hash_table_contains (locales, simple_locale))
+        {
+          add_locale_to_catalogue (&builder, xkb_info, simple_locale, lang_code, country_code,
+                                   layouts_with_locale);
+          g_hash_table_add (locales, simple_locale);
+        }
+      else
+        {
+          g_free (simple_locale);
+        }
+
+      g_free (lang_code);
+      g_free (country_code);
+    }
+  g_strfreev (locale_ids);
+  g_variant_builder_close (&builder);
+
+  /* The remaining layouts go to the "Other" locale */
+  g_variant_builder_open (&builder, G_VARIANT_TYPE ("as"));
+  for (l = list; l; l = l->next)
+    if (!g_hash_table_contains (layouts_with_locale, l->data))
+      g_variant_builder_add (&builder, "s", l->data);
+  g_variant_builder_close (&builder);
+
+  g_list_free (list);
+  g_hash_table_destroy (locales);
+  g_hash_table_destroy (layouts_with_locale);
+
+  return g_variant_builder_end (&builder);
 }
 
+/* Loads the locales and their keyboard layouts from the catalogue, which
+   is compiled on the first run and whenever the locale or the installed
+   locales and layouts change. Only the names and search keys are read
+   here, the rows are created on demand. */
 static void
-add_row_other (GtkWidget   *chooser,
-               const gchar *type,
-               const gchar *id)
+load_locale_catalogue (GtkWidget *chooser)
 {
   CcInputChooserPrivate *priv = GET_PRIVATE (chooser);
-  LocaleInfo *info = g_hash_table_lookup (priv->locales, "");
-  add_row (chooser, info, type, id);
+  GVariant *layouts;
+  GVariant *locales;
+  GVariantIter iter;
+  GHashTable *set;
+  LocaleInfo *info;
+  SourceInfo *source;
+  const gchar **layout_ids;
+  const gchar *id, *name, *unaccented_name, *untranslated_name;
+  const gchar *language, *default_id;
+  gchar *stamp;
+  guint i;
+
+  stamp = get_catalogue_stamp ();
+  priv->catalogue = cc_cache_file_load (CATALOGUE_NAME, stamp, G_VARIANT_TYPE (CATALOGUE_TYPE));
+  if (!priv->catalogue)
+    {
+      priv->catalogue = g_variant_ref_sink (build_locale_catalogue (priv->xkb_info));
+      cc_cache_file_save (CATALOGUE_NAME, stamp, catalogue_watched_paths, priv->catalogue);
+    }
+  g_free (stamp);
+
+  priv->layouts = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, g_free);
+  priv->engines = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, g_free);
+  priv->locales = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                         NULL, locale_info_free);
+  priv->locales_by_language = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                                     NULL, (GDestroyNotify) g_hash_table_destroy);
+
+  /* The strings stay valid as long as the catalogue is referenced */
+  g_variant_get (priv->catalogue, "(@a(sss)@a(sssssas)^a&s)", &layouts, &locales, &layout_ids);
+
+  g_variant_iter_init (&iter, layouts);
+  while (g_variant_iter_next (&iter, "(&s&s&s)", &id, &name, &unaccented_name))
+    {
+      source = g_new (SourceInfo, 1);
+      source->name = name;
+      source->unaccented_name = unaccented_name;
+      g_hash_table_replace (priv->layouts, (gpointer) id, source);
+    }
+
+  /* Add a "Other" locale to hold the remaining input sources */
+  info = locale_info_new ("", C_("Input Source", "Other"), "", "");
+  for (i = 0; layout_ids[i]; i++)
+    g_ptr_array_add (info->layout_ids, (gpointer) layout_ids[i]);
+  g_hash_table_replace (priv->locales, (gpointer) info->id, info);
+  g_free (layout_ids);
+
+  g_variant_iter_init (&iter, locales);
+  while (g_variant_iter_next (&iter, "(&s&s&s&s&s&s^a&s)",
+                              &id, &name, &unaccented_name, &untranslated_name,
+                              &language, &default_id, &layout_ids))
+    {
+      info = locale_info_new (id, name, unaccented_name, untranslated_name);
+      if (default_id[0])
+        {
+          info->default_type = INPUT_SOURCE_TYPE_XKB;
+          info->default_id = default_id;
+        }
+      for (i = 0; layout_ids[i]; i++)
+        g_ptr_array_add (info->layout_ids, (gpointer) layout_ids[i]);
+      g_free (layout_ids);
+
+      g_hash_table_replace (priv->locales, (gpointer) id, info);
+
+      set = g_hash_table_lookup (priv->locales_by_language, language);
+      if (!set)
+        {
+          set = g_hash_table_new (NULL, NULL);
+          g_hash_table_replace (priv->locales_by_language, (gpointer) language, set);
+        }
+      g_hash_table_add (set, info);
+    }
+
+  g_variant_unref (layouts);
+  g_variant_unref (locales);
 }
 
 #ifdef HAVE_IBUS
-static gboolean
-maybe_set_as_default (GtkWidget   *chooser,
-                      LocaleInfo  *info,
-                      const gchar *engine_id)
+static gint
+compare_strings (gconstpointer a,
+                 gconstpointer b)
 {
-  const gchar *type, *id;
-
-  if (!gnome_get_input_source_from_locale (info->id, &type, &id))
-    return FALSE;
+  return g_strcmp0 (*(const gchar **) a, *(const gchar **) b);
+}
 
-  if (g_str_equal (type, INPUT_SOURCE_TYPE_IBUS) &&
-      g_str_equal (id, engine_id) &&
-      info->default_input_source_row == NULL)
+static gchar *
+get_ibus_catalogue_stamp (GHashTable *ibus_engines)
+{
+  GHashTableIter iter;
+  GPtrArray *engines;
+  IBusEngineDesc *engine;
+  const gchar *engine_id;
+  const gchar *version;
+  gchar *catalogue_stamp;
+  gchar *checksum;
+  gchar *stamp;
+  gchar *tmp;
+
+  /* Engines are installed and updated independently of IBus */
+  engines = g_ptr_array_new_with_free_func (g_free);
+  g_hash_table_iter_init (&iter, ibus_engines);
+  while (g_hash_table_iter_next (&iter, (gpointer *) &engine_id, (gpointer *) &engine))
     {
-      add_default_row (chooser, info, type, id);
-      return TRUE;
+      version = ibus_engine_desc_get_version (engine);
+      g_ptr_array_add (engines, g_strdup_printf ("%s=%s", engine_id, version ? version : ""));
     }
+  g_ptr_array_sort (engines, compare_strings);
+  g_ptr_array_add (engines, NULL);
+
+  tmp = g_strjoinv ("\n", (gchar **) engines->pdata);
+  checksum = g_compute_checksum_for_string (G_CHECKSUM_SHA1, tmp, -1);
+  g_free (tmp);
+
+  catalogue_stamp = get_catalogue_stamp ();
+  stamp = g_strdup_printf ("%s;%d.%d.%d;%s",
+                           catalogue_stamp,
+                           IBUS_MAJOR_VERSION,
+                           IBUS_MINOR_VERSION,
+                           IBUS_MICRO_VERSION,
+                           checksum);
+
+  g_free (catalogue_stamp);
+  g_free (checksum);
+  g_ptr_array_unref (engines);
+
+  return stamp;
+}
 
-  return FALSE;
+static gboolean
+is_default_engine (const gchar *locale,
+                   const gchar *engine_id)
+{
+  const gchar *type, *id;
+
+  return gnome_get_input_source_from_locale (locale, &type, &id) &&
+         g_str_equal (type, INPUT_SOURCE_TYPE_IBUS) &&
+         g_str_equal (id, engine_id);
 }
 
 static void
-get_ibus_locale_infos (GtkWidget *chooser)
+add_engine_to_locale (LocaleInfo  *info,
+                      const gchar *engine_id,
+                      GPtrArray   *default_for,
+                      GPtrArray   *locales)
+{
+  if (is_default_engine (info->id, engine_id))
+    g_ptr_array_add (default_for, (gpointer) info->id);
+  else
+    g_ptr_array_add (locales, (gpointer) info->id);
+}
+
+static GVariant *
+build_ibus_catalogue (GtkWidget *chooser)
 {
   CcInputChooserPrivate *priv = GET_PRIVATE (chooser);
+  GVariantBuilder builder;
   GHashTableIter iter;
   LocaleInfo *info;
   const gchar *engine_id;
   IBusEngineDesc *engine;
 
-  if (!priv->ibus_engines || priv->is_login)
-    return;
+  g_variant_builder_init (&builder, G_VARIANT_TYPE (IBUS_CATALOGUE_TYPE));
 
   g_hash_table_iter_init (&iter, priv->ibus_engines);
   while (g_hash_table_iter_next (&iter, (gpointer *) &engine_id, (gpointer *) &engine))
     {
+      GPtrArray *default_for = g_ptr_array_new ();
+      GPtrArray *locales = g_ptr_array_new ();
       gchar *lang_code = NULL;
       gchar *country_code = NULL;
+      gchar *display_name;
+      gchar *unaccented_name;
       const gchar *ibus_locale = ibus_engine_desc_get_language (engine);
 
       if (gnome_parse_locale (ibus_locale, &lang_code, &country_code, NULL, NULL) &&
@@ -830,30 +1201,13 @@ get_ibus_locale_infos (GtkWidget *chooser)
 
           info = g_hash_table_lookup (priv->locales, locale);
           if (info)
-            {
-              const gchar *type, *id;
-
-              if (gnome_get_input_source_from_locale (locale, &type, &id) &&
-                  g_str_equal (type, INPUT_SOURCE_TYPE_IBUS) &&
-                  g_str_equal (id, engine_id))
-                {
-                  add_default_row (chooser, info, type, id);
-                }
-              else
-                {
-                  add_row (chooser, info, INPUT_SOURCE_TYPE_IBUS, engine_id);
-                }
-            }
-          else
-            {
-              add_row_other (chooser, INPUT_SOURCE_TYPE_IBUS, engine_id);
-            }
+            add_engine_to_locale (info, engine_id, default_for, locales);
 
           g_free (locale);
         }
       else if (lang_code != NULL)
         {
-          GHashTableIter iter;
+          GHashTableIter locales_iter;
           GHashTable *locales_for_language;
           gchar *language;
 
@@ -869,165 +1223,102 @@ get_ibus_locale_infos (GtkWidget *chooser)
 
           if (locales_for_language)
             {
-              g_hash_table_iter_init (&iter, locales_for_language);
-              while (g_hash_table_iter_next (&iter, (gpointer *) &info, NULL))
-                if (!maybe_set_as_default (chooser, info, engine_id))
-                  add_row (chooser, info, INPUT_SOURCE_TYPE_IBUS, engine_id);
-            }
-          else
-            {
-              add_row_other (chooser, INPUT_SOURCE_TYPE_IBUS, engine_id);
+              g_hash_table_iter_init (&locales_iter, locales_for_language);
+              while (g_hash_table_iter_next (&locales_iter, (gpointer *) &info, NULL))
+                add_engine_to_locale (info, engine_id, default_for, locales);
             }
         }
-      else
-        {
-          add_row_other (chooser, INPUT_SOURCE_TYPE_IBUS, engine_id);
-        }
-
-      g_free (country_code);
-      g_free (lang_code);
-    }
-}
-#endif  /* HAVE_IBUS */
 
-static void
-add_locale_to_table (GHashTable  *table,
-                     const gchar *lang_code,
-                     LocaleInfo  *info)
-{
-  GHashTable *set;
-  gchar *language;
+      display_name = engine_get_display_name (engine);
+      unaccented_name = cc_util_normalize_casefold_and_unaccent (display_name);
 
-  language = gnome_get_language_from_code (lang_code, NULL);
+      /* Engines without a locale go to the "Other" locale */
+      g_variant_builder_add (&builder, "(sss@as@as)",
+                             engine_id,
+                             display_name,
+                             unaccented_name,
+                             g_variant_new_strv ((const gchar * const *) default_for->pdata, default_for->len),
+                             g_variant_new_strv ((const gchar * const *) locales->pdata, locales->len));
 
-  set = g_hash_table_lookup (table, language);
-  if (!set)
-    {
-      set = g_hash_table_new (NULL, NULL);
-      g_hash_table_replace (table, g_strdup (language), set);
+      g_free (unaccented_name);
+      g_free (display_name);
+      g_free (country_code);
+      g_free (lang_code);
+      g_ptr_array_unref (default_for);
+      g_ptr_array_unref (locales);
     }
-  g_hash_table_add (set, info);
 
-  g_free (language);
+  return g_variant_builder_end (&builder);
 }
 
 static void
-add_ids_to_set (GHashTable *set,
-                GList      *list)
-{
-  while (list)
-    {
-      g_hash_table_add (set, list->data);
-      list = list->next;
-    }
-}
-
-static void
-get_locale_infos (GtkWidget *chooser)
+load_ibus_catalogue (GtkWidget *chooser)
 {
   CcInputChooserPrivate *priv = GET_PRIVATE (chooser);
-  GHashTable *layouts_with_locale;
+  GHashTableIter iter;
+  GVariantIter catalogue_iter;
+  LocaleInfo *other;
   LocaleInfo *info;
-  gchar **locale_ids;
-  gchar **locale;
-  GList *list, *l;
+  SourceInfo *source;
+  const gchar **default_for;
+  const gchar **locales;
+  const gchar *engine_id, *name, *unaccented_name;
+  gchar *stamp;
+  guint i;
 
-  priv->locales = g_hash_table_new_full (g_str_hash, g_str_equal,
-                                         NULL, locale_info_free);
-  priv->locales_by_language = g_hash_table_new_full (g_str_hash, g_str_equal,
-                                                     g_free, (GDestroyNotify) g_hash_table_destroy);
-
-  layouts_with_locale = g_hash_table_new (g_str_hash, g_str_equal);
+  if (!priv->ibus_engines || priv->is_login)
+    return;
 
-  locale_ids = gnome_get_all_locales ();
-  for (locale = locale_ids; *locale; ++locale)
+  stamp = get_ibus_catalogue_stamp (priv->ibus_engines);
+  priv->ibus_catalogue = cc_cache_file_load (IBUS_CATALOGUE_NAME, stamp, G_VARIANT_TYPE (IBUS_CATALOGUE_TYPE));
+  if (!priv->ibus_catalogue)
     {
-      gchar *lang_code, *country_code;
-      gchar *simple_locale;
-      gchar *tmp;
-      const gchar *type = NULL;
-      const gchar *id = NULL;
+      priv->ibus_catalogue = g_variant_ref_sink (build_ibus_catalogue (chooser));
+      cc_cache_file_save (IBUS_CATALOGUE_NAME, stamp, catalogue_watched_paths, priv->ibus_catalogue);
+    }
+  g_free (stamp);
 
-      if (!gnome_parse_locale (*locale, &lang_code, &country_code, NULL, NULL))
-        continue;
+  other = g_hash_table_lookup (priv->locales, "");
 
-      if (country_code != NULL)
-	simple_locale = g_strdup_printf ("%s_%s.UTF-8", lang_code, country_code);
-      else
-	simple_locale = g_strdup_printf ("%s.UTF-8", lang_code);
+  g_variant_iter_init (&catalogue_iter, priv->ibus_catalogue);
+  while (g_variant_iter_next (&catalogue_iter, "(&s&s&s^a&s^a&s)",
+                              &engine_id, &name, &unaccented_name, &default_for, &locales))
+    {
+      source = g_new (SourceInfo, 1);
+      source->name = name;
+      source->unaccented_name = unaccented_name;
+      g_hash_table_replace (priv->engines, (gpointer) engine_id, source);
 
-      if (g_hash_table_contains (priv->locales, simple_locale))
+      for (i = 0; default_for[i]; i++)
         {
-          g_free (simple_locale);
-          g_free (country_code);
-          g_free (lang_code);
-          continue;
+          info = g_hash_table_lookup (priv->locales, default_for[i]);
+          if (info)
+            {
+              info->default_type = INPUT_SOURCE_TYPE_IBUS;
+              info->default_id = engine_id;
+            }
         }
 
-      info = g_new0 (LocaleInfo, 1);
-      info->id = simple_locale; /* Take ownership */
-      info->name = gnome_get_language_from_locale (simple_locale, NULL);
-      info->unaccented_name = cc_util_normalize_casefold_and_unaccent (info->name);
-      tmp = gnome_get_language_from_locale (simple_locale, "C");
-      info->untranslated_name = cc_util_normalize_casefold_and_unaccent (tmp);
-      g_free (tmp);
-
-      g_hash_table_replace (priv->locales, simple_locale, info);
-      add_locale_to_table (priv->locales_by_language, lang_code, info);
-
-      if (gnome_get_input_source_from_locale (simple_locale, &type, &id) &&
-          g_str_equal (type, INPUT_SOURCE_TYPE_XKB))
+      for (i = 0; locales[i]; i++)
         {
-          add_default_row (chooser, info, type, id);
-          g_hash_table_add (layouts_with_locale, (gpointer) id);
+          info = g_hash_table_lookup (priv->locales, locales[i]);
+          if (info)
+            g_ptr_array_add (info->engine_ids, (gpointer) engine_id);
         }
 
-      /* We don't own these ids */
-      info->layout_rows_by_id = g_hash_table_new_full (g_str_hash, g_str_equal,
-                                                       NULL, g_object_unref);
-      info->engine_rows_by_id = g_hash_table_new_full (g_str_hash, g_str_equal,
-                                                       NULL, g_object_unref);
+      if (!default_for[0] && !locales[0])
+        g_ptr_array_add (other->engine_ids, (gpointer) engine_id);
 
-      list = gnome_xkb_info_get_layouts_for_language (priv->xkb_info, lang_code);
-      add_rows_to_table (chooser, info, list, INPUT_SOURCE_TYPE_XKB, id);
-      add_ids_to_set (layouts_with_locale, list);
-      g_list_free (list);
-
-      if (country_code != NULL)
-        {
-          list = gnome_xkb_info_get_layouts_for_country (priv->xkb_info, country_code);
-          add_rows_to_table (chooser, info, list, INPUT_SOURCE_TYPE_XKB, id);
-          add_ids_to_set (layouts_with_locale, list);
-          g_list_free (list);
-        }
-
-      g_free (lang_code);
-      g_free (country_code);
+      g_free (default_for);
+      g_free (locales);
     }
-  g_strfreev (locale_ids);
-
-  /* Add a "Other" locale to hold the remaining input sources */
-  info = g_new0 (LocaleInfo, 1);
-  info->id = g_strdup ("");
-  info->name = g_strdup (C_("Input Source", "Other"));
-  info->unaccented_name = g_strdup ("");
-  info->untranslated_name = g_strdup ("");
-  g_hash_table_replace (priv->locales, info->id, info);
-
-  info->layout_rows_by_id = g_hash_table_new_full (g_str_hash, g_str_equal,
-                                                   NULL, g_object_unref);
-  info->engine_rows_by_id = g_hash_table_new_full (g_str_hash, g_str_equal,
-                                                   NULL, g_object_unref);
-
-  list = gnome_xkb_info_get_all_layouts (priv->xkb_info);
-  for (l = list; l; l = l->next)
-    if (!g_hash_table_contains (layouts_with_locale, l->data))
-      add_row_other (chooser, INPUT_SOURCE_TYPE_XKB, l->data);
 
-  g_list_free (list);
-
-  g_hash_table_destroy (layouts_with_locale);
+  /* Rows created before the engines were known lack them */
+  g_hash_table_iter_init (&iter, priv->locales);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &info))
+    locale_info_clear_input_source_rows (info);
 }
+#endif  /* HAVE_IBUS */
 
 static void
 cc_input_chooser_private_free (gpointer data)
@@ -1038,6 +1329,11 @@ cc_input_chooser_private_free (gpointer data)
   g_object_unref (priv->no_results);
   g_hash_table_destroy (priv->locales);
   g_hash_table_destroy (priv->locales_by_language);
+  g_hash_table_destroy (priv->layouts);
+  g_hash_table_destroy (priv->engines);
+  g_clear_pointer (&priv->initial_languages, g_hash_table_destroy);
+  g_variant_unref (priv->catalogue);
+  g_clear_pointer (&priv->ibus_catalogue, g_variant_unref);
   g_strfreev (priv->filter_words);
   if (priv->filter_timeout_id)
     g_source_remove (priv->filter_timeout_id);
@@ -1106,9 +1402,9 @@ cc_input_chooser_new (GtkWindow    *main_window,
   if (priv->is_login)
     gtk_widget_show (WID ("login-label"));
 
-  get_locale_infos (chooser);
+  load_locale_catalogue (chooser);
 #ifdef HAVE_IBUS
-  get_ibus_locale_infos (chooser);
+  load_ibus_catalogue (chooser);
 #endif  /* HAVE_IBUS */
   show_locale_rows (chooser);
 
@@ -1136,7 +1432,7 @@ cc_input_chooser_set_ibus_engines (GtkWidget  *chooser,
   g_return_if_fail (priv->ibus_engines == NULL);
 
   priv->ibus_engines = ibus_engines;
-  get_ibus_locale_infos (chooser);
+  load_ibus_catalogue (chooser);
   show_locale_rows (chooser);
 #endif  /* HAVE_IBUS */
 }
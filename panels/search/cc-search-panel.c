@@ -20,6 +20,8 @@
 
 #include "cc-search-panel.h"
 #include "cc-search-locations-dialog.h"
+#include "cc-search-provider-index.h"
+#include "cc-app-registry.h"
 #include "cc-search-resources.h"
 #include "shell/list-box-helper.h"
 
@@ -44,8 +46,6 @@ struct _CcSearchPanelPrivate
   CcSearchLocationsDialog  *locations_dialog;
 };
 
-#define SHELL_PROVIDER_GROUP "Shell Search Provider"
-
 static gint
 list_sort_func (gconstpointer a,
                 gconstpointer b,
@@ -499,194 +499,150 @@ search_panel_add_one_app_info (CcSearchPanel *self,
   gtk_widget_show_all (row);
 }
 
-static void
-search_panel_add_one_provider (CcSearchPanel *self,
-                               GFile *provider)
+static gboolean
+search_panel_is_provider (CcSearchPanel *self,
+                          const gchar   *desktop_id)
 {
-  gchar *path, *desktop_id;
-  GKeyFile *keyfile;
-  GAppInfo *app_info;
-  GError *error = NULL;
-  gboolean default_disabled;
-
-  path = g_file_get_path (provider);
-  keyfile = g_key_file_new ();
-  g_key_file_load_from_file (keyfile, path, G_KEY_FILE_NONE, &error);
+  g_autoptr(GPtrArray) providers = NULL;
+  guint i;
 
-  if (error != NULL)
+  providers = cc_search_provider_index_get_providers (cc_search_provider_index_get_default ());
+  for (i = 0; providers != NULL && i < providers->len; i++)
     {
-      g_warning ("Error loading %s: %s - search provider will be ignored",
-                 path, error->message);
-      goto out;
-    }
+      CcSearchProviderInfo *info = g_ptr_array_index (providers, i);
 
-  if (!g_key_file_has_group (keyfile, SHELL_PROVIDER_GROUP))
-    {
-      g_debug ("Shell search provider group missing from '%s', ignoring", path);
-      goto out;
+      if (g_strcmp0 (info->desktop_id, desktop_id) == 0)
+        return TRUE;
     }
 
-  desktop_id = g_key_file_get_string (keyfile, SHELL_PROVIDER_GROUP,
-                                      "DesktopId", &error);
-
-  if (error != NULL)
-    {
-      g_warning ("Unable to read desktop ID from %s: %s - search provider will be ignored",
-                 path, error->message);
-      goto out;
-    }
-
-  app_info = G_APP_INFO (g_desktop_app_info_new (desktop_id));
-
-  if (app_info == NULL)
-    {
-      g_debug ("Could not find application with desktop ID '%s' referenced in '%s', ignoring",
-               desktop_id, path);
-      g_free (desktop_id);
-      goto out;
-    }
-
-  g_free (desktop_id);
-  default_disabled = g_key_file_get_boolean (keyfile, SHELL_PROVIDER_GROUP,
-                                             "DefaultDisabled", NULL);
-  search_panel_add_one_app_info (self, app_info, !default_disabled);
-  g_object_unref (app_info);
-
- out:
-  g_free (path);
-  g_clear_error (&error);
-  g_key_file_unref (keyfile);
+  return FALSE;
 }
 
 static void
-search_providers_discover_ready (GObject *source,
-                                 GAsyncResult *result,
-                                 gpointer user_data)
+search_panel_add_providers (CcSearchPanel *self)
 {
-  GList *providers, *l;
-  GFile *provider;
-  CcSearchPanel *self = CC_SEARCH_PANEL (source);
-  GError *error = NULL;
+  g_autoptr(GPtrArray) providers = NULL;
+  GList *children, *l;
+  guint i;
 
-  providers = g_task_propagate_pointer (G_TASK (result), &error);
+  children = gtk_container_get_children (GTK_CONTAINER (self->priv->list_box));
+  for (l = children; l != NULL; l = l->next)
+    gtk_widget_destroy (l->data);
+  g_list_free (children);
 
-  if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+  /* undo search_panel_set_no_providers(), in case providers appeared */
+  gtk_widget_set_valign (self->priv->list_box, GTK_ALIGN_FILL);
+
+  providers = cc_search_provider_index_get_providers (cc_search_provider_index_get_default ());
+  for (i = 0; providers != NULL && i < providers->len; i++)
     {
-      g_error_free (error);
-      return;
-    }
+      CcSearchProviderInfo *info = g_ptr_array_index (providers, i);
+      GDesktopAppInfo *app_info;
 
-  g_clear_object (&self->priv->load_cancellable);
+      app_info = cc_app_registry_lookup (cc_app_registry_get_default (), info->desktop_id);
+      if (app_info == NULL)
+        {
+          g_debug ("Could not find application with desktop ID '%s' referenced in '%s', ignoring",
+                   info->desktop_id, info->path);
+          continue;
+        }
 
-  if (providers == NULL)
-    {
-      search_panel_set_no_providers (self);
-      return;
+      search_panel_add_one_app_info (self, G_APP_INFO (app_info), !info->default_disabled);
     }
 
-  for (l = providers; l != NULL; l = l->next)
+  children = gtk_container_get_children (GTK_CONTAINER (self->priv->list_box));
+  if (children == NULL)
     {
-      provider = l->data;
-      search_panel_add_one_provider (self, provider);
-      g_object_unref (provider);
+      search_panel_set_no_providers (self);
+      return;
     }
+  g_list_free (children);
 
   /* propagate a write to GSettings, to make sure we always have
    * all the providers in the list.
    */
   search_panel_propagate_sort_order (self);
-  g_list_free (providers);
 }
 
-static GList *
-search_providers_discover_one_directory (const gchar *system_dir,
-                                         GCancellable *cancellable)
+static void
+search_providers_changed (CcSearchPanel *self)
 {
-  GList *providers = NULL;
-  gchar *providers_path;
-  GFile *providers_location, *provider;
-  GFileInfo *info;
-  GFileEnumerator *enumerator;
-  GError *error = NULL;
-
-  providers_path = g_build_filename (system_dir, "gnome-shell", "search-providers", NULL);
-  providers_location = g_file_new_for_path (providers_path);
+  if (self->priv->load_cancellable != NULL)
+    return;
 
-  enumerator = g_file_enumerate_children (providers_location,
-                                          "standard::type,standard::name,standard::content-type",
-                                          G_FILE_QUERY_INFO_NONE,
-                                          cancellable, &error);
+  search_panel_add_providers (self);
+}
 
-  if (error != NULL)
-    {
-      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND) &&
-          !g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
-        g_warning ("Error opening %s: %s - search provider configuration won't be possible",
-                   providers_path, error->message);
-      g_clear_error (&error);
+static void
+search_provider_app_changed (CcSearchPanel   *self,
+                             GDesktopAppInfo *app_info)
+{
+  if (self->priv->load_cancellable != NULL)
+    return;
 
-      goto out;
-    }
+  if (search_panel_is_provider (self, g_app_info_get_id (G_APP_INFO (app_info))))
+    search_panel_add_providers (self);
+}
 
-  while ((info = g_file_enumerator_next_file (enumerator, cancellable, &error)) != NULL)
-    {
-      provider = g_file_get_child (providers_location, g_file_info_get_name (info));
-      providers = g_list_prepend (providers, provider);
-      g_object_unref (info);
-    }
+static void
+search_providers_loaded (GObject *source,
+                         GAsyncResult *result,
+                         gpointer user_data)
+{
+  CcSearchPanel *self = user_data;
+  GError *error = NULL;
 
-  if (error != NULL)
+  if (!cc_search_provider_index_load_finish (CC_SEARCH_PROVIDER_INDEX (source), result, &error))
     {
       if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
-        g_warning ("Error reading from %s: %s - search providers might be missing from the panel",
-                   providers_path, error->message);
-      g_clear_error (&error);
+        g_warning ("Could not load the search providers: %s", error->message);
+      g_error_free (error);
+      return;
     }
 
- out:
-  g_clear_object (&enumerator);
-  g_clear_object (&providers_location);
-  g_free (providers_path);
-
-  return providers;
+  g_clear_object (&self->priv->load_cancellable);
+  search_panel_add_providers (self);
 }
 
 static void
-search_providers_discover_thread (GTask *task,
-                                  gpointer source_object,
-                                  gpointer task_data,
-                                  GCancellable *cancellable)
+search_apps_loaded (GObject *source,
+                    GAsyncResult *result,
+                    gpointer user_data)
 {
-  GList *providers = NULL;
-  const gchar * const *system_data_dirs;
-  int idx;
+  CcSearchPanel *self = user_data;
+  GError *error = NULL;
 
-  system_data_dirs = g_get_system_data_dirs ();
-  for (idx = 0; system_data_dirs[idx] != NULL; idx++)
+  if (!cc_app_registry_load_finish (CC_APP_REGISTRY (source), result, &error))
     {
-      providers = g_list_concat (search_providers_discover_one_directory (system_data_dirs[idx], cancellable),
-                                 providers);
-
-      if (g_task_return_error_if_cancelled (task))
-        {
-          g_list_free_full (providers, g_object_unref);
-          return;
-        }
+      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        g_warning ("Could not load the applications: %s", error->message);
+      g_error_free (error);
+      return;
     }
 
-  g_task_return_pointer (task, providers, NULL);
+  cc_search_provider_index_load_async (cc_search_provider_index_get_default (),
+                                       self->priv->load_cancellable,
+                                       search_providers_loaded, self);
 }
 
 static void
 populate_search_providers (CcSearchPanel *self)
 {
-  GTask *task;
-
+  CcAppRegistry *registry = cc_app_registry_get_default ();
+
+  g_signal_connect_swapped (cc_search_provider_index_get_default (), "changed",
+                            G_CALLBACK (search_providers_changed), self);
+  g_signal_connect_swapped (registry, "app-added",
+                            G_CALLBACK (search_provider_app_changed), self);
+  g_signal_connect_swapped (registry, "app-removed",
+                            G_CALLBACK (search_provider_app_changed), self);
+  g_signal_connect_swapped (registry, "app-changed",
+                            G_CALLBACK (search_provider_app_changed), self);
+
+  /* Both are shared, so this is immediate when the panel is shown again */
   self->priv->load_cancellable = g_cancellable_new ();
-  task = g_task_new (self, self->priv->load_cancellable,
-                     search_providers_discover_ready, self);
-  g_task_run_in_thread (task, search_providers_discover_thread);
-  g_object_unref (task);
+  cc_app_registry_load_async (registry, self->priv->load_cancellable,
+                              search_apps_loaded, self);
 }
 
 static void
@@ -694,6 +650,9 @@ cc_search_panel_dispose (GObject *object)
 {
   CcSearchPanelPrivate *priv = CC_SEARCH_PANEL (object)->priv;
 
+  g_signal_handlers_disconnect_by_data (cc_search_provider_index_get_default (), object);
+  g_signal_handlers_disconnect_by_data (cc_app_registry_get_default (), object);
+
   if (priv->load_cancellable != NULL)
     g_cancellable_cancel (priv->load_cancellable);
   g_clear_object (&priv->load_cancellable);
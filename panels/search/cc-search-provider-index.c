@@ -0,0 +1,602 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*-
+ *
+ * Copyright (C) 2017 The GNOME Foundation
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include "cc-cache-file.h"
+#include "cc-search-provider-index.h"
+
+/* The search providers installed in the gnome-shell/search-providers
+ * directories of the system data directories.
+ *
+ * The providers are read once per process, and kept in memory. They are
+ * also saved with cc_cache_file_save(), watching the directories and
+ * provider files, so that a new process only parses the key files again
+ * when one of them changed.
+ *
+ * The directories are monitored. When something changes in them, the
+ * directories are scanned again, ignoring the cache file, and "changed"
+ * is emitted if the providers are not the same anymore.
+ */
+
+#define SHELL_PROVIDER_GROUP  "Shell Search Provider"
+#define PROVIDERS_CACHE_NAME  "search-providers.cache"
+#define PROVIDERS_CACHE_TYPE  "a(ssb)"
+#define PROVIDERS_CACHE_VERSION 1
+
+/* Changes usually come in bursts, e.g. from a package manager */
+#define RESCAN_DELAY_MS 200
+
+struct _CcSearchProviderIndex
+{
+  GObject    parent_instance;
+
+  gchar    **data_dirs;
+  GPtrArray *monitors;
+
+  /* of CcSearchProviderInfo, replaced rather than modified */
+  GPtrArray *providers;
+
+  gboolean   loading;
+  gboolean   dirty;
+  guint      rescan_id;
+  GList     *load_tasks;
+};
+
+G_DEFINE_TYPE (CcSearchProviderIndex, cc_search_provider_index, G_TYPE_OBJECT)
+
+enum {
+  CHANGED,
+  LAST_SIGNAL
+};
+
+static guint signals[LAST_SIGNAL] = { 0 };
+
+typedef struct
+{
+  gchar    **data_dirs;
+  gboolean   use_cache;
+} LoadData;
+
+static void
+load_data_free (LoadData *data)
+{
+  g_strfreev (data->data_dirs);
+  g_free (data);
+}
+
+static void
+provider_info_free (CcSearchProviderInfo *info)
+{
+  g_free (info->path);
+  g_free (info->desktop_id);
+  g_free (info);
+}
+
+static CcSearchProviderInfo *
+provider_info_new (const gchar *path,
+                   const gchar *desktop_id,
+                   gboolean     default_disabled)
+{
+  CcSearchProviderInfo *info;
+
+  info = g_new (CcSearchProviderInfo, 1);
+  info->path = g_strdup (path);
+  info->desktop_id = g_strdup (desktop_id);
+  info->default_disabled = default_disabled;
+
+  return info;
+}
+
+static gboolean
+providers_equal (GPtrArray *a,
+                 GPtrArray *b)
+{
+  guint i;
+
+  if (a == NULL || b == NULL || a->len != b->len)
+    return FALSE;
+
+  for (i = 0; i < a->len; i++)
+    {
+      CcSearchProviderInfo *info_a = g_ptr_array_index (a, i);
+      CcSearchProviderInfo *info_b = g_ptr_array_index (b, i);
+
+      if (g_strcmp0 (info_a->path, info_b->path) != 0 ||
+          g_strcmp0 (info_a->desktop_id, info_b->desktop_id) != 0 ||
+          info_a->default_disabled != info_b->default_disabled)
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+static gchar *
+get_providers_dir (const gchar *data_dir)
+{
+  return g_build_filename (data_dir, "gnome-shell", "search-providers", NULL);
+}
+
+static gchar *
+get_cache_stamp (const gchar * const *data_dirs)
+{
+  g_autofree gchar *joined_dirs = NULL;
+
+  joined_dirs = g_strjoinv (":", (gchar **) data_dirs);
+
+  return g_strdup_printf ("%d;%s;%s",
+                          PROVIDERS_CACHE_VERSION,
+                          PACKAGE_VERSION,
+                          joined_dirs);
+}
+
+static CcSearchProviderInfo *
+load_provider (const gchar *path)
+{
+  CcSearchProviderInfo *info = NULL;
+  g_autoptr(GKeyFile) keyfile = NULL;
+  g_autoptr(GError) error = NULL;
+  g_autofree gchar *desktop_id = NULL;
+  gboolean default_disabled;
+
+  keyfile = g_key_file_new ();
+  if (!g_key_file_load_from_file (keyfile, path, G_KEY_FILE_NONE, &error))
+    {
+      g_warning ("Error loading %s: %s - search provider will be ignored",
+                 path, error->message);
+      return NULL;
+    }
+
+  if (!g_key_file_has_group (keyfile, SHELL_PROVIDER_GROUP))
+    {
+      g_debug ("Shell search provider group missing from '%s', ignoring", path);
+      return NULL;
+    }
+
+  desktop_id = g_key_file_get_string (keyfile, SHELL_PROVIDER_GROUP,
+                                      "DesktopId", &error);
+  if (error != NULL)
+    {
+      g_warning ("Unable to read desktop ID from %s: %s - search provider will be ignored",
+                 path, error->message);
+      return NULL;
+    }
+
+  default_disabled = g_key_file_get_boolean (keyfile, SHELL_PROVIDER_GROUP,
+                                             "DefaultDisabled", NULL);
+  info = provider_info_new (path, desktop_id, default_disabled);
+
+  return info;
+}
+
+/* Reads the providers of all the directories. A provider file hides the
+ * ones with the same name in the following data directories. */
+static GPtrArray *
+scan_providers (const gchar * const *data_dirs,
+                GPtrArray           *watched_paths,
+                GCancellable        *cancellable)
+{
+  g_autoptr(GHashTable) seen = NULL;
+  GPtrArray *providers;
+  guint i;
+
+  providers = g_ptr_array_new_with_free_func ((GDestroyNotify) provider_info_free);
+  seen = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+  for (i = 0; data_dirs[i] != NULL && !g_cancellable_is_cancelled (cancellable); i++)
+    {
+      g_autofree gchar *providers_path = NULL;
+      g_autoptr(GError) error = NULL;
+      const gchar *name;
+      GDir *dir;
+
+      providers_path = get_providers_dir (data_dirs[i]);
+      g_ptr_array_add (watched_paths, g_strdup (providers_path));
+
+      dir = g_dir_open (providers_path, 0, &error);
+      if (dir == NULL)
+        {
+          if (!g_error_matches (error, G_FILE_ERROR, G_FILE_ERROR_NOENT))
+            g_warning ("Error opening %s: %s - search provider configuration won't be possible",
+                       providers_path, error->message);
+          continue;
+        }
+
+      while ((name = g_dir_read_name (dir)) != NULL)
+        {
+          CcSearchProviderInfo *info;
+          gchar *path;
+
+          if (g_hash_table_contains (seen, name))
+            continue;
+          g_hash_table_add (seen, g_strdup (name));
+
+          path = g_build_filename (providers_path, name, NULL);
+          g_ptr_array_add (watched_paths, path);
+
+          info = load_provider (path);
+          if (info != NULL)
+            g_ptr_array_add (providers, info);
+        }
+
+      g_dir_close (dir);
+    }
+
+  return providers;
+}
+
+static GPtrArray *
+providers_from_variant (GVariant *variant)
+{
+  GPtrArray *providers;
+  GVariantIter iter;
+  const gchar *path;
+  const gchar *desktop_id;
+  gboolean default_disabled;
+
+  providers = g_ptr_array_new_with_free_func ((GDestroyNotify) provider_info_free);
+
+  g_variant_iter_init (&iter, variant);
+  while (g_variant_iter_next (&iter, "(&s&sb)", &path, &desktop_id, &default_disabled))
+    g_ptr_array_add (providers, provider_info_new (path, desktop_id, default_disabled));
+
+  return providers;
+}
+
+static GVariant *
+providers_to_variant (GPtrArray *providers)
+{
+  GVariantBuilder builder;
+  guint i;
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE (PROVIDERS_CACHE_TYPE));
+  for (i = 0; i < providers->len; i++)
+    {
+      CcSearchProviderInfo *info = g_ptr_array_index (providers, i);
+
+      g_variant_builder_add (&builder, "(ssb)",
+                             info->path, info->desktop_id, info->default_disabled);
+    }
+
+  return g_variant_builder_end (&builder);
+}
+
+static void
+load_thread (GTask        *task,
+             gpointer      source_object,
+             gpointer      task_data,
+             GCancellable *cancellable)
+{
+  LoadData *data = task_data;
+  g_autoptr(GPtrArray) watched_paths = NULL;
+  g_autofree gchar *stamp = NULL;
+  GPtrArray *providers;
+
+  stamp = get_cache_stamp ((const gchar * const *) data->data_dirs);
+
+  if (data->use_cache)
+    {
+      g_autoptr(GVariant) cache = NULL;
+
+      cache = cc_cache_file_load (PROVIDERS_CACHE_NAME, stamp,
+                                  G_VARIANT_TYPE (PROVIDERS_CACHE_TYPE));
+      if (cache != NULL)
+        {
+          g_task_return_pointer (task, providers_from_variant (cache),
+                                 (GDestroyNotify) g_ptr_array_unref);
+          return;
+        }
+    }
+
+  watched_paths = g_ptr_array_new_with_free_func (g_free);
+  providers = scan_providers ((const gchar * const *) data->data_dirs,
+                              watched_paths, cancellable);
+
+  if (g_task_return_error_if_cancelled (task))
+    {
+      g_ptr_array_unref (providers);
+      return;
+    }
+
+  g_ptr_array_add (watched_paths, NULL);
+  cc_cache_file_save (PROVIDERS_CACHE_NAME,
+                      stamp,
+                      (const gchar * const *) watched_paths->pdata,
+                      providers_to_variant (providers));
+
+  g_task_return_pointer (task, providers, (GDestroyNotify) g_ptr_array_unref);
+}
+
+static void start_load (CcSearchProviderIndex *self);
+
+static void
+complete_load_tasks (CcSearchProviderIndex *self)
+{
+  GList *load_tasks, *l;
+
+  load_tasks = self->load_tasks;
+  self->load_tasks = NULL;
+
+  for (l = load_tasks; l != NULL; l = l->next)
+    {
+      g_task_return_boolean (l->data, TRUE);
+      g_object_unref (l->data);
+    }
+  g_list_free (load_tasks);
+}
+
+static void
+directory_changed_cb (GFileMonitor          *monitor,
+                      GFile                 *file,
+                      GFile                 *other_file,
+                      GFileMonitorEvent      event_type,
+                      CcSearchProviderIndex *self);
+
+static void
+ensure_monitors (CcSearchProviderIndex *self)
+{
+  guint i;
+
+  if (self->monitors != NULL)
+    return;
+
+  self->monitors = g_ptr_array_new_with_free_func (g_object_unref);
+  for (i = 0; self->data_dirs[i] != NULL; i++)
+    {
+      g_autofree gchar *providers_path = NULL;
+      g_autoptr(GFile) providers_location = NULL;
+      g_autoptr(GError) error = NULL;
+      GFileMonitor *monitor;
+
+      providers_path = get_providers_dir (self->data_dirs[i]);
+      providers_location = g_file_new_for_path (providers_path);
+
+      monitor = g_file_monitor_directory (providers_location,
+                                          G_FILE_MONITOR_NONE,
+                                          NULL,
+                                          &error);
+      if (monitor == NULL)
+        {
+          g_debug ("Could not monitor %s: %s", providers_path, error->message);
+          continue;
+        }
+
+      g_signal_connect (monitor, "changed",
+                        G_CALLBACK (directory_changed_cb), self);
+      g_ptr_array_add (self->monitors, monitor);
+    }
+}
+
+static void
+load_cb (GObject      *source_object,
+         GAsyncResult *res,
+         gpointer      user_data)
+{
+  CcSearchProviderIndex *self = CC_SEARCH_PROVIDER_INDEX (source_object);
+  GPtrArray *providers;
+  gboolean changed;
+
+  self->loading = FALSE;
+  providers = g_task_propagate_pointer (G_TASK (res), NULL);
+
+  /* Monitor from the first load on, so nothing is missed in between */
+  ensure_monitors (self);
+
+  if (self->dirty)
+    {
+      /* Something changed while loading, the result is stale already */
+      g_ptr_array_unref (providers);
+      start_load (self);
+      return;
+    }
+
+  changed = self->providers != NULL && !providers_equal (self->providers, providers);
+  g_clear_pointer (&self->providers, g_ptr_array_unref);
+  self->providers = providers;
+
+  complete_load_tasks (self);
+
+  if (changed)
+    g_signal_emit (self, signals[CHANGED], 0);
+}
+
+static void
+start_load (CcSearchProviderIndex *self)
+{
+  LoadData *data;
+  GTask *task;
+
+  if (self->loading)
+    return;
+
+  data = g_new (LoadData, 1);
+  data->data_dirs = g_strdupv (self->data_dirs);
+  /* Once something changed, the cache file is known to be stale */
+  data->use_cache = !self->dirty && self->providers == NULL;
+
+  self->loading = TRUE;
+  self->dirty = FALSE;
+
+  task = g_task_new (self, NULL, load_cb, NULL);
+  g_task_set_source_tag (task, start_load);
+  g_task_set_task_data (task, data, (GDestroyNotify) load_data_free);
+  g_task_run_in_thread (task, load_thread);
+  g_object_unref (task);
+}
+
+static gboolean
+rescan_timeout_cb (gpointer user_data)
+{
+  CcSearchProviderIndex *self = user_data;
+
+  self->rescan_id = 0;
+  start_load (self);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+directory_changed_cb (GFileMonitor          *monitor,
+                      GFile                 *file,
+                      GFile                 *other_file,
+                      GFileMonitorEvent      event_type,
+                      CcSearchProviderIndex *self)
+{
+  switch (event_type)
+    {
+    case G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT:
+    case G_FILE_MONITOR_EVENT_DELETED:
+    case G_FILE_MONITOR_EVENT_CREATED:
+    case G_FILE_MONITOR_EVENT_MOVED:
+    case G_FILE_MONITOR_EVENT_RENAMED:
+    case G_FILE_MONITOR_EVENT_MOVED_IN:
+    case G_FILE_MONITOR_EVENT_MOVED_OUT:
+      break;
+    default:
+      return;
+    }
+
+  self->dirty = TRUE;
+
+  if (self->rescan_id == 0)
+    self->rescan_id = g_timeout_add (RESCAN_DELAY_MS, rescan_timeout_cb, self);
+}
+
+static void
+cc_search_provider_index_finalize (GObject *object)
+{
+  CcSearchProviderIndex *self = CC_SEARCH_PROVIDER_INDEX (object);
+  guint i;
+
+  if (self->rescan_id != 0)
+    g_source_remove (self->rescan_id);
+
+  for (i = 0; self->monitors != NULL && i < self->monitors->len; i++)
+    g_signal_handlers_disconnect_by_func (g_ptr_array_index (self->monitors, i),
+                                          directory_changed_cb, self);
+
+  g_clear_pointer (&self->monitors, g_ptr_array_unref);
+  g_clear_pointer (&self->providers, g_ptr_array_unref);
+  g_strfreev (self->data_dirs);
+
+  G_OBJECT_CLASS (cc_search_provider_index_parent_class)->finalize (object);
+}
+
+static void
+cc_search_provider_index_class_init (CcSearchProviderIndexClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->finalize = cc_search_provider_index_finalize;
+
+  signals[CHANGED] = g_signal_new ("changed",
+                                   G_TYPE_FROM_CLASS (klass),
+                                   G_SIGNAL_RUN_LAST,
+                                   0, NULL, NULL,
+                                   g_cclosure_marshal_VOID__VOID,
+                                   G_TYPE_NONE, 0);
+}
+
+static void
+cc_search_provider_index_init (CcSearchProviderIndex *self)
+{
+  self->data_dirs = g_strdupv ((gchar **) g_get_system_data_dirs ());
+}
+
+CcSearchProviderIndex *
+cc_search_provider_index_new (void)
+{
+  return g_object_new (CC_TYPE_SEARCH_PROVIDER_INDEX, NULL);
+}
+
+/**
+ * cc_search_provider_index_get_default:
+ *
+ * Returns: (transfer none): the index shared by the process
+ */
+CcSearchProviderIndex *
+cc_search_provider_index_get_default (void)
+{
+  static CcSearchProviderIndex *default_index = NULL;
+
+  if (default_index == NULL)
+    default_index = cc_search_provider_index_new ();
+
+  return default_index;
+}
+
+/**
+ * cc_search_provider_index_load_async:
+ *
+ * Makes sure the providers are known and up to date. This completes
+ * right away unless they were never loaded or changed since.
+ */
+void
+cc_search_provider_index_load_async (CcSearchProviderIndex *self,
+                                     GCancellable          *cancellable,
+                                     GAsyncReadyCallback    callback,
+                                     gpointer               user_data)
+{
+  GTask *task;
+
+  g_return_if_fail (CC_IS_SEARCH_PROVIDER_INDEX (self));
+
+  task = g_task_new (self, cancellable, callback, user_data);
+  g_task_set_source_tag (task, cc_search_provider_index_load_async);
+
+  if (self->providers != NULL && !self->dirty && !self->loading)
+    {
+      g_task_return_boolean (task, TRUE);
+      g_object_unref (task);
+      return;
+    }
+
+  self->load_tasks = g_list_prepend (self->load_tasks, task);
+
+  /* A pending rescan will complete the task */
+  if (self->rescan_id == 0)
+    start_load (self);
+}
+
+gboolean
+cc_search_provider_index_load_finish (CcSearchProviderIndex  *self,
+                                      GAsyncResult           *res,
+                                      GError                **error)
+{
+  g_return_val_if_fail (g_task_is_valid (res, self), FALSE);
+
+  return g_task_propagate_boolean (G_TASK (res), error);
+}
+
+/**
+ * cc_search_provider_index_get_providers:
+ *
+ * Returns: (transfer full) (nullable) (element-type CcSearchProviderInfo):
+ *     the providers, which must not be modified, or %NULL if they were
+ *     not loaded yet
+ */
+GPtrArray *
+cc_search_provider_index_get_providers (CcSearchProviderIndex *self)
+{
+  g_return_val_if_fail (CC_IS_SEARCH_PROVIDER_INDEX (self), NULL);
+
+  if (self->providers == NULL)
+    return NULL;
+
+  return g_ptr_array_ref (self->providers);
+}
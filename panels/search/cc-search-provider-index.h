@@ -0,0 +1,51 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*-
+ *
+ * Copyright (C) 2017 The GNOME Foundation
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CC_SEARCH_PROVIDER_INDEX_H
+#define _CC_SEARCH_PROVIDER_INDEX_H
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+typedef struct
+{
+  gchar    *path;
+  gchar    *desktop_id;
+  gboolean  default_disabled;
+} CcSearchProviderInfo;
+
+#define CC_TYPE_SEARCH_PROVIDER_INDEX (cc_search_provider_index_get_type ())
+G_DECLARE_FINAL_TYPE (CcSearchProviderIndex, cc_search_provider_index, CC, SEARCH_PROVIDER_INDEX, GObject)
+
+CcSearchProviderIndex *cc_search_provider_index_new           (void);
+CcSearchProviderIndex *cc_search_provider_index_get_default   (void);
+
+void                   cc_search_provider_index_load_async    (CcSearchProviderIndex  *self,
+                                                               GCancellable           *cancellable,
+                                                               GAsyncReadyCallback     callback,
+                                                               gpointer                user_data);
+gboolean               cc_search_provider_index_load_finish   (CcSearchProviderIndex  *self,
+                                                               GAsyncResult           *res,
+                                                               GError                **error);
+
+GPtrArray             *cc_search_provider_index_get_providers (CcSearchProviderIndex  *self);
+
+G_END_DECLS
+
+#endif /* _CC_SEARCH_PROVIDER_INDEX_H */
@@ -0,0 +1,396 @@
+#include "config.h"
+
+#include <glib/gstdio.h>
+#include <gio/gio.h>
+
+#include "cc-cache-file.h"
+#include "cc-search-provider-index.h"
+
+/* Run with "-m perf" to get the loading timings */
+#define N_DATA_DIRS 4
+#define N_PROVIDERS_PER_DIR 250
+/* Every data directory overrides half of the providers of the previous one */
+#define N_PROVIDERS (N_PROVIDERS_PER_DIR + (N_DATA_DIRS - 1) * N_PROVIDERS_PER_DIR / 2)
+#define N_BENCHMARK_LOADS 5
+
+static char *test_dir;
+static char *providers_dirs[N_DATA_DIRS];
+
+static void
+load_cb (GObject      *source_object,
+         GAsyncResult *res,
+         gpointer      user_data)
+{
+  GMainLoop *loop = user_data;
+  GError *error = NULL;
+
+  g_assert_true (cc_search_provider_index_load_finish (CC_SEARCH_PROVIDER_INDEX (source_object),
+                                                       res, &error));
+  g_assert_no_error (error);
+
+  g_main_loop_quit (loop);
+}
+
+static GPtrArray *
+load_index (CcSearchProviderIndex *index)
+{
+  GMainLoop *loop;
+
+  loop = g_main_loop_new (NULL, FALSE);
+  cc_search_provider_index_load_async (index, NULL, load_cb, loop);
+  g_main_loop_run (loop);
+  g_main_loop_unref (loop);
+
+  return cc_search_provider_index_get_providers (index);
+}
+
+static CcSearchProviderInfo *
+find_provider (GPtrArray  *providers,
+               const char *desktop_id)
+{
+  guint i;
+
+  for (i = 0; i < providers->len; i++)
+    {
+      CcSearchProviderInfo *info = g_ptr_array_index (providers, i);
+
+      if (g_strcmp0 (info->desktop_id, desktop_id) == 0)
+        return info;
+    }
+
+  return NULL;
+}
+
+static void
+assert_providers (GPtrArray *providers)
+{
+  CcSearchProviderInfo *info;
+  char *path;
+
+  g_assert_nonnull (providers);
+  g_assert_cmpuint (providers->len, ==, N_PROVIDERS);
+
+  /* The first data directory wins */
+  info = find_provider (providers, "org.example.App0.desktop");
+  g_assert_nonnull (info);
+  g_assert_false (info->default_disabled);
+  path = g_build_filename (providers_dirs[0], "org.example.App0.search-provider.ini", NULL);
+  g_assert_cmpstr (info->path, ==, path);
+  g_free (path);
+
+  info = find_provider (providers, "org.example.App200.desktop");
+  g_assert_nonnull (info);
+  g_assert_false (info->default_disabled);
+
+  info = find_provider (providers, "org.example.App300.desktop");
+  g_assert_nonnull (info);
+  g_assert_true (info->default_disabled);
+}
+
+static void
+test_load (void)
+{
+  CcSearchProviderIndex *index;
+  GPtrArray *providers;
+  char *cache_path;
+
+  cc_cache_file_remove ("search-providers.cache");
+
+  index = cc_search_provider_index_get_default ();
+  g_assert_null (cc_search_provider_index_get_providers (index));
+
+  providers = load_index (index);
+  assert_providers (providers);
+  g_ptr_array_unref (providers);
+
+  cache_path = cc_cache_file_get_path ("search-providers.cache");
+  g_assert_true (g_file_test (cache_path, G_FILE_TEST_EXISTS));
+  g_free (cache_path);
+}
+
+static void
+test_cache (void)
+{
+  CcSearchProviderIndex *index;
+  GPtrArray *providers;
+
+  /* A new process reads the cache file instead */
+  index = cc_search_provider_index_new ();
+  providers = load_index (index);
+  assert_providers (providers);
+  g_ptr_array_unref (providers);
+  g_object_unref (index);
+}
+
+static gboolean
+has_provider (CcSearchProviderIndex *index,
+              const char            *desktop_id)
+{
+  GPtrArray *providers;
+  gboolean found;
+
+  providers = cc_search_provider_index_get_providers (index);
+  found = find_provider (providers, desktop_id) != NULL;
+  g_ptr_array_unref (providers);
+
+  return found;
+}
+
+static void
+changed_cb (CcSearchProviderIndex *index,
+            GMainLoop             *loop)
+{
+  g_main_loop_quit (loop);
+}
+
+static gboolean
+changes_timeout_cb (gpointer user_data)
+{
+  g_assert_not_reached ();
+  return G_SOURCE_REMOVE;
+}
+
+static void
+test_changes (void)
+{
+  CcSearchProviderIndex *index;
+  GPtrArray *providers;
+  GMainLoop *loop;
+  char *path;
+  guint timeout_id;
+
+  index = cc_search_provider_index_get_default ();
+  loop = g_main_loop_new (NULL, FALSE);
+  g_signal_connect (index, "changed", G_CALLBACK (changed_cb), loop);
+  timeout_id = g_timeout_add_seconds (10, changes_timeout_cb, NULL);
+
+  /* A new provider is picked up */
+  path = g_build_filename (providers_dirs[N_DATA_DIRS - 1], "org.example.NewApp.search-provider.ini", NULL);
+  g_assert_true (g_file_set_contents (path,
+                                      "[Shell Search Provider]\n"
+                                      "DesktopId=org.example.NewApp.desktop\n"
+                                      "BusName=org.example.NewApp\n"
+                                      "ObjectPath=/org/example/NewApp/SearchProvider\n"
+                                      "Version=2\n",
+                                      -1, NULL));
+  while (!has_provider (index, "org.example.NewApp.desktop"))
+    g_main_loop_run (loop);
+
+  providers = load_index (index);
+  g_assert_cmpuint (providers->len, ==, N_PROVIDERS + 1);
+  g_ptr_array_unref (providers);
+
+  /* and dropped once removed */
+  g_assert_cmpint (g_unlink (path), ==, 0);
+  while (has_provider (index, "org.example.NewApp.desktop"))
+    g_main_loop_run (loop);
+
+  providers = load_index (index);
+  assert_providers (providers);
+  g_ptr_array_unref (providers);
+
+  g_source_remove (timeout_id);
+  g_signal_handlers_disconnect_by_data (index, loop);
+  g_main_loop_unref (loop);
+  g_free (path);
+}
+
+static void
+test_benchmark (void)
+{
+  CcSearchProviderIndex *index;
+  GPtrArray *providers;
+  GTimer *timer;
+  gdouble scan_time = G_MAXDOUBLE;
+  gdouble cache_time = G_MAXDOUBLE;
+  gdouble memory_time = G_MAXDOUBLE;
+  guint i;
+
+  if (!g_test_perf ())
+    return;
+
+  timer = g_timer_new ();
+  for (i = 0; i < N_BENCHMARK_LOADS; i++)
+    {
+      cc_cache_file_remove ("search-providers.cache");
+      index = cc_search_provider_index_new ();
+
+      g_timer_start (timer);
+      providers = load_index (index);
+      scan_time = MIN (scan_time, g_timer_elapsed (timer, NULL));
+
+      g_assert_cmpuint (providers->len, ==, N_PROVIDERS);
+      g_ptr_array_unref (providers);
+      g_object_unref (index);
+    }
+
+  for (i = 0; i < N_BENCHMARK_LOADS; i++)
+    {
+      index = cc_search_provider_index_new ();
+
+      g_timer_start (timer);
+      providers = load_index (index);
+      cache_time = MIN (cache_time, g_timer_elapsed (timer, NULL));
+
+      g_assert_cmpuint (providers->len, ==, N_PROVIDERS);
+      g_ptr_array_unref (providers);
+      g_object_unref (index);
+    }
+
+  index = cc_search_provider_index_get_default ();
+  for (i = 0; i < N_BENCHMARK_LOADS; i++)
+    {
+      g_timer_start (timer);
+      providers = load_index (index);
+      memory_time = MIN (memory_time, g_timer_elapsed (timer, NULL));
+
+      g_assert_cmpuint (providers->len, ==, N_PROVIDERS);
+      g_ptr_array_unref (providers);
+    }
+
+  g_test_minimized_result (scan_time,
+                           "Scanned %d providers in %d data directories in %.1f ms",
+                           N_PROVIDERS, N_DATA_DIRS, scan_time * 1000);
+  g_test_minimized_result (cache_time,
+                           "Loaded them from the cache file in %.1f ms",
+                           cache_time * 1000);
+  g_test_minimized_result (memory_time,
+                           "Loaded them again from memory in %.3f ms",
+                           memory_time * 1000);
+
+  g_timer_destroy (timer);
+}
+
+static char *
+provider_filename (guint i)
+{
+  return g_strdup_printf ("org.example.App%u.search-provider.ini", i);
+}
+
+/* Data directories with only the generated search providers, the later
+ * ones providing some of the earlier providers too, enabled by default
+ * only in the first directory */
+static void
+create_data_dirs (void)
+{
+  GPtrArray *data_dirs;
+  char *readme;
+  char *joined_dirs;
+  char *cache_dir;
+  guint i, j;
+
+  test_dir = g_dir_make_tmp ("test-search-provider-index-XXXXXX", NULL);
+  g_assert_nonnull (test_dir);
+
+  data_dirs = g_ptr_array_new_with_free_func (g_free);
+  for (i = 0; i < N_DATA_DIRS; i++)
+    {
+      char *name;
+      char *data_dir;
+
+      name = g_strdup_printf ("data%u", i);
+      data_dir = g_build_filename (test_dir, name, NULL);
+      providers_dirs[i] = g_build_filename (data_dir, "gnome-shell", "search-providers", NULL);
+      g_assert_cmpint (g_mkdir_with_parents (providers_dirs[i], 0700), ==, 0);
+
+      for (j = i * N_PROVIDERS_PER_DIR / 2; j < i * N_PROVIDERS_PER_DIR / 2 + N_PROVIDERS_PER_DIR; j++)
+        {
+          char *filename;
+          char *path;
+          char *contents;
+
+          contents = g_strdup_printf ("[Shell Search Provider]\n"
+                                      "DesktopId=org.example.App%u.desktop\n"
+                                      "BusName=org.example.App%u\n"
+                                      "ObjectPath=/org/example/App%u/SearchProvider\n"
+                                      "Version=2\n"
+                                      "DefaultDisabled=%s\n",
+                                      j, j, j, i > 0 ? "true" : "false");
+          filename = provider_filename (j);
+          path = g_build_filename (providers_dirs[i], filename, NULL);
+          g_assert_true (g_file_set_contents (path, contents, -1, NULL));
+
+          g_free (path);
+          g_free (filename);
+          g_free (contents);
+        }
+
+      g_ptr_array_add (data_dirs, data_dir);
+      g_free (name);
+    }
+  g_ptr_array_add (data_dirs, NULL);
+
+  /* Not a provider, ignored */
+  readme = g_build_filename (providers_dirs[0], "README", NULL);
+  g_assert_true (g_file_set_contents (readme, "[Other Group]\nKey=Value\n", -1, NULL));
+
+  cache_dir = g_build_filename (test_dir, "cache", NULL);
+  joined_dirs = g_strjoinv (":", (char **) data_dirs->pdata);
+
+  g_setenv ("XDG_DATA_DIRS", joined_dirs, TRUE);
+  g_setenv ("XDG_CACHE_HOME", cache_dir, TRUE);
+
+  g_free (joined_dirs);
+  g_free (cache_dir);
+  g_free (readme);
+  g_ptr_array_unref (data_dirs);
+}
+
+static void
+remove_dir (const char *path)
+{
+  const char *name;
+  GDir *dir;
+
+  dir = g_dir_open (path, 0, NULL);
+  if (dir == NULL)
+    return;
+
+  while ((name = g_dir_read_name (dir)) != NULL)
+    {
+      char *child;
+
+      child = g_build_filename (path, name, NULL);
+      if (g_file_test (child, G_FILE_TEST_IS_DIR))
+        remove_dir (child);
+      else
+        g_unlink (child);
+      g_free (child);
+    }
+
+  g_dir_close (dir);
+  g_rmdir (path);
+}
+
+static void
+remove_data_dirs (void)
+{
+  guint i;
+
+  remove_dir (test_dir);
+
+  for (i = 0; i < N_DATA_DIRS; i++)
+    g_free (providers_dirs[i]);
+  g_free (test_dir);
+}
+
+int
+main (int argc, char **argv)
+{
+  int ret;
+
+  create_data_dirs ();
+
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/search/provider-index/load", test_load);
+  g_test_add_func ("/search/provider-index/cache", test_cache);
+  g_test_add_func ("/search/provider-index/changes", test_changes);
+  g_test_add_func ("/search/provider-index/benchmark", test_benchmark);
+
+  ret = g_test_run ();
+
+  remove_data_dirs ();
+
+  return ret;
+}
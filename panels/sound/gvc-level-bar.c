@@ -37,9 +37,23 @@
 #define VERTICAL_BAR_WIDTH         6
 #define MIN_VERTICAL_BAR_HEIGHT    400
 
+/* How fast the peak falls back, in full scales per second, and how
+ * long the highest peak stays shown */
+#define PEAK_DECAY_RATE            3.75
+#define MAX_PEAK_HOLD              G_USEC_PER_SEC
+
+typedef enum {
+        SEGMENT_OFF,
+        SEGMENT_ON,
+        SEGMENT_RMS,
+        SEGMENT_MAX_PEAK,
+        NUM_SEGMENT_STATES
+} SegmentState;
+
 typedef struct {
         int          peak_num;
         int          max_peak_num;
+        int          rms_num;
 
         GdkRectangle area;
         int          delta;
@@ -66,10 +80,17 @@ struct _GvcLevelBar
         GtkAdjustment *rms_adjustment;
         GvcLevelScale  scale;
         gdouble        peak_fraction;
+        gdouble        pending_peak_fraction;
         gdouble        rms_fraction;
         gdouble        max_peak;
-        guint          max_peak_id;
+        gint64         max_peak_time;
+        gint64         last_frame_time;
+        guint          tick_id;
         LevelBarLayout layout;
+
+        /* The segments pre-rendered in each state, for the current
+         * layout and scale factor */
+        cairo_surface_t *segments[NUM_SEGMENT_STATES];
 };
 
 enum
@@ -94,14 +115,15 @@ G_DEFINE_TYPE (GvcLevelBar, gvc_level_bar, GTK_TYPE_WIDGET)
                 if (rectangle1.height != rectangle2.height) return TRUE; \
         }
 
+/* Whether the segments need to be rendered again */
 static gboolean
 layout_changed (LevelBarLayout *layout1,
                 LevelBarLayout *layout2)
 {
         check_rectangle (layout1->area, layout2->area);
         if (layout1->delta != layout2->delta) return TRUE;
-        if (layout1->peak_num != layout2->peak_num) return TRUE;
-        if (layout1->max_peak_num != layout2->max_peak_num) return TRUE;
+        if (layout1->box_width != layout2->box_width) return TRUE;
+        if (layout1->box_height != layout2->box_height) return TRUE;
         if (layout1->bg_r != layout2->bg_r
             || layout1->bg_g != layout2->bg_g
             || layout1->bg_b != layout2->bg_b)
@@ -146,27 +168,58 @@ fraction_from_adjustment (GvcLevelBar   *bar,
         return fraction;
 }
 
-static gboolean
-reset_max_peak (GvcLevelBar *bar)
+static void
+clear_segments (GvcLevelBar *bar)
 {
-        gdouble min;
+        guint i;
 
-        min = gtk_adjustment_get_lower (bar->peak_adjustment);
-        bar->max_peak = min;
-        bar->layout.max_peak_num = 0;
-        gtk_widget_queue_draw (GTK_WIDGET (bar));
-        bar->max_peak_id = 0;
-        return FALSE;
+        for (i = 0; i < NUM_SEGMENT_STATES; i++)
+                g_clear_pointer (&bar->segments[i], cairo_surface_destroy);
+}
+
+static SegmentState
+get_segment_state (LevelBarLayout *layout,
+                   int             i)
+{
+        if ((layout->max_peak_num - 1) == i)
+                return SEGMENT_MAX_PEAK;
+        else if ((layout->rms_num - 1) >= i)
+                return SEGMENT_RMS;
+        else if ((layout->peak_num - 1) >= i)
+                return SEGMENT_ON;
+        else
+                return SEGMENT_OFF;
+}
+
+static void
+get_segment_rectangle (GvcLevelBar  *bar,
+                       int           i,
+                       GdkRectangle *rect)
+{
+        if (bar->orientation == GTK_ORIENTATION_VERTICAL) {
+                rect->x = bar->layout.area.x;
+                rect->y = i * bar->layout.delta;
+        } else {
+                rect->x = i * bar->layout.delta;
+                rect->y = bar->layout.area.y;
+
+                if (gtk_widget_get_direction (GTK_WIDGET (bar)) == GTK_TEXT_DIR_RTL)
+                        rect->x = gtk_widget_get_allocated_width (GTK_WIDGET (bar)) - rect->x - bar->layout.box_width;
+        }
+
+        rect->width = bar->layout.box_width;
+        rect->height = bar->layout.box_height;
 }
 
 static void
 bar_calc_layout (GvcLevelBar *bar)
 {
         GdkColor color;
-        int      peak_level;
-        int      max_peak_level;
         GtkAllocation allocation;
         GtkStyle *style;
+        LevelBarLayout layout;
+
+        layout = bar->layout;
 
         gtk_widget_get_allocation (GTK_WIDGET (bar), &allocation);
         bar->layout.area.width = allocation.width - 2;
@@ -187,9 +240,6 @@ bar_calc_layout (GvcLevelBar *bar)
         bar->layout.fl_b = (float)color.blue / 65535.0;
 
         if (bar->orientation == GTK_ORIENTATION_VERTICAL) {
-                peak_level = bar->peak_fraction * bar->layout.area.height;
-                max_peak_level = bar->max_peak * bar->layout.area.height;
-
                 bar->layout.delta = bar->layout.area.height / NUM_BOXES;
                 bar->layout.area.x = 0;
                 bar->layout.area.y = 0;
@@ -197,9 +247,6 @@ bar_calc_layout (GvcLevelBar *bar)
                 bar->layout.box_width = bar->layout.area.width;
                 bar->layout.box_radius = bar->layout.box_width / 2;
         } else {
-                peak_level = bar->peak_fraction * bar->layout.area.width;
-                max_peak_level = bar->max_peak * bar->layout.area.width;
-
                 bar->layout.delta = bar->layout.area.width / NUM_BOXES;
                 bar->layout.area.x = 0;
                 bar->layout.area.y = 0;
@@ -208,38 +255,125 @@ bar_calc_layout (GvcLevelBar *bar)
                 bar->layout.box_radius = bar->layout.box_height / 2;
         }
 
-        /* This can happen if the level bar isn't realized */
-        if (bar->layout.delta == 0)
-                return;
-
-        bar->layout.peak_num = peak_level / bar->layout.delta;
-        bar->layout.max_peak_num = max_peak_level / bar->layout.delta;
+        if (layout_changed (&bar->layout, &layout)) {
+                clear_segments (bar);
+                gtk_widget_queue_draw (GTK_WIDGET (bar));
+        }
 }
 
+/* Works out which segments are lit from the shown peaks and RMS level,
+ * and only queues a redraw of the segments that changed */
 static void
-update_peak_value (GvcLevelBar *bar)
+update_peak_nums (GvcLevelBar *bar)
 {
-        gdouble        val;
         LevelBarLayout layout;
+        GdkRectangle   damage = { 0, 0, 0, 0 };
+        int            length;
+        int            i;
+
+        /* This can happen if the level bar isn't realized */
+        if (bar->layout.delta == 0)
+                return;
 
         layout = bar->layout;
 
-        val = fraction_from_adjustment (bar, bar->peak_adjustment);
-        bar->peak_fraction = val;
+        if (bar->orientation == GTK_ORIENTATION_VERTICAL)
+                length = bar->layout.area.height;
+        else
+                length = bar->layout.area.width;
 
-        if (val > bar->max_peak) {
-                if (bar->max_peak_id > 0) {
-                        g_source_remove (bar->max_peak_id);
-                }
-                bar->max_peak_id = g_timeout_add_seconds (1, (GSourceFunc)reset_max_peak, bar);
-                bar->max_peak = val;
+        bar->layout.peak_num = (int) (bar->peak_fraction * length) / bar->layout.delta;
+        bar->layout.max_peak_num = (int) (bar->max_peak * length) / bar->layout.delta;
+        bar->layout.rms_num = (int) (bar->rms_fraction * length) / bar->layout.delta;
+
+        if (bar->layout.peak_num == layout.peak_num &&
+            bar->layout.max_peak_num == layout.max_peak_num &&
+            bar->layout.rms_num == layout.rms_num)
+                return;
+
+        for (i = 0; i < NUM_BOXES; i++) {
+                GdkRectangle rect;
+
+                if (get_segment_state (&bar->layout, i) == get_segment_state (&layout, i))
+                        continue;
+
+                get_segment_rectangle (bar, i, &rect);
+                if (damage.width == 0)
+                        damage = rect;
+                else
+                        gdk_rectangle_union (&damage, &rect, &damage);
         }
 
-        bar_calc_layout (bar);
+        if (damage.width > 0)
+                gtk_widget_queue_draw_area (GTK_WIDGET (bar),
+                                            damage.x, damage.y,
+                                            damage.width, damage.height);
+}
 
-        if (layout_changed (&bar->layout, &layout)) {
-                gtk_widget_queue_draw (GTK_WIDGET (bar));
+static gboolean
+on_tick (GtkWidget     *widget,
+         GdkFrameClock *frame_clock,
+         gpointer       user_data)
+{
+        GvcLevelBar *bar = GVC_LEVEL_BAR (widget);
+        gint64       frame_time;
+        gdouble      target;
+        gdouble      decayed;
+
+        frame_time = gdk_frame_clock_get_frame_time (frame_clock);
+
+        /* The highest of the values set since the last frame */
+        target = MAX (bar->pending_peak_fraction,
+                      fraction_from_adjustment (bar, bar->peak_adjustment));
+        bar->pending_peak_fraction = 0;
+
+        decayed = bar->peak_fraction;
+        if (bar->last_frame_time != 0)
+                decayed -= PEAK_DECAY_RATE * (frame_time - bar->last_frame_time) / G_USEC_PER_SEC;
+        bar->peak_fraction = MAX (target, decayed);
+        bar->last_frame_time = frame_time;
+
+        if (bar->peak_fraction > bar->max_peak) {
+                bar->max_peak = bar->peak_fraction;
+                bar->max_peak_time = frame_time;
+        } else if (bar->max_peak > 0 &&
+                   frame_time - bar->max_peak_time >= MAX_PEAK_HOLD) {
+                bar->max_peak = 0;
         }
+
+        update_peak_nums (bar);
+
+        /* Keep going until the peak has settled and the highest one is
+         * no longer shown */
+        if (bar->peak_fraction > target || bar->max_peak > 0)
+                return G_SOURCE_CONTINUE;
+
+        bar->tick_id = 0;
+        bar->last_frame_time = 0;
+
+        return G_SOURCE_REMOVE;
+}
+
+static void
+queue_tick (GvcLevelBar *bar)
+{
+        if (bar->tick_id != 0)
+                return;
+
+        bar->tick_id = gtk_widget_add_tick_callback (GTK_WIDGET (bar), on_tick, NULL, NULL);
+}
+
+static void
+update_peak_value (GvcLevelBar *bar)
+{
+        gdouble val;
+
+        /* Values are only taken into account on the next frame, however
+         * often they change */
+        val = fraction_from_adjustment (bar, bar->peak_adjustment);
+        bar->pending_peak_fraction = MAX (bar->pending_peak_fraction, val);
+
+        queue_tick (bar);
 }
 
 static void
@@ -247,8 +381,11 @@ update_rms_value (GvcLevelBar *bar)
 {
         gdouble val;
 
+        /* Like the peak, shown on the next frame */
         val = fraction_from_adjustment (bar, bar->rms_adjustment);
         bar->rms_fraction = val;
+
+        queue_tick (bar);
 }
 
 GtkOrientation
@@ -266,7 +403,7 @@ gvc_level_bar_set_orientation (GvcLevelBar   *bar,
 
         if (orientation != bar->orientation) {
                 bar->orientation = orientation;
-                gtk_widget_queue_draw (GTK_WIDGET (bar));
+                gtk_widget_queue_resize (GTK_WIDGET (bar));
                 g_object_notify (G_OBJECT (bar), "orientation");
         }
 }
@@ -319,7 +456,7 @@ gvc_level_bar_set_rms_adjustment (GvcLevelBar   *bar,
         g_return_if_fail (GTK_IS_ADJUSTMENT (adjustment));
 
         if (bar->rms_adjustment != NULL) {
-                g_signal_handlers_disconnect_by_func (bar->peak_adjustment,
+                g_signal_handlers_disconnect_by_func (bar->rms_adjustment,
                                                       G_CALLBACK (on_rms_adjustment_value_changed),
                                                       bar);
                 g_object_unref (bar->rms_adjustment);
@@ -327,10 +464,9 @@ gvc_level_bar_set_rms_adjustment (GvcLevelBar   *bar,
 
         bar->rms_adjustment = g_object_ref_sink (adjustment);
 
-
-        g_signal_connect (bar->peak_adjustment,
+        g_signal_connect (bar->rms_adjustment,
                           "value-changed",
-                          G_CALLBACK (on_peak_adjustment_value_changed),
+                          G_CALLBACK (on_rms_adjustment_value_changed),
                           bar);
 
         update_rms_value (bar);
@@ -513,6 +649,30 @@ gvc_level_bar_size_allocate (GtkWidget     *widget,
         }
 
         bar_calc_layout (bar);
+        update_peak_nums (bar);
+}
+
+static void
+gvc_level_bar_style_updated (GtkWidget *widget)
+{
+        GTK_WIDGET_CLASS (gvc_level_bar_parent_class)->style_updated (widget);
+
+        bar_calc_layout (GVC_LEVEL_BAR (widget));
+}
+
+static void
+gvc_level_bar_unrealize (GtkWidget *widget)
+{
+        clear_segments (GVC_LEVEL_BAR (widget));
+
+        GTK_WIDGET_CLASS (gvc_level_bar_parent_class)->unrealize (widget);
+}
+
+static void
+on_scale_factor_notify (GvcLevelBar *bar)
+{
+        clear_segments (bar);
+        gtk_widget_queue_draw (GTK_WIDGET (bar));
 }
 
 static void
@@ -572,97 +732,119 @@ curved_rectangle (cairo_t *cr,
         cairo_close_path (cr);
 }
 
+static void
+render_segment (GvcLevelBar  *bar,
+                cairo_t      *cr,
+                SegmentState  state)
+{
+        curved_rectangle (cr,
+                          0.5,
+                          0.5,
+                          bar->layout.box_width - 1,
+                          bar->layout.box_height - 1,
+                          bar->layout.box_radius);
+
+        switch (state) {
+        case SEGMENT_MAX_PEAK:
+                /* fill peak foreground */
+                cairo_set_source_rgb (cr, bar->layout.fl_r, bar->layout.fl_g, bar->layout.fl_b);
+                cairo_fill_preserve (cr);
+                break;
+        case SEGMENT_RMS:
+                /* fill background */
+                cairo_set_source_rgb (cr, bar->layout.bg_r, bar->layout.bg_g, bar->layout.bg_b);
+                cairo_fill_preserve (cr);
+                /* fill foreground, stronger than the peak */
+                cairo_set_source_rgba (cr, bar->layout.fl_r, bar->layout.fl_g, bar->layout.fl_b, 0.8);
+                cairo_fill_preserve (cr);
+                break;
+        case SEGMENT_ON:
+                /* fill background */
+                cairo_set_source_rgb (cr, bar->layout.bg_r, bar->layout.bg_g, bar->layout.bg_b);
+                cairo_fill_preserve (cr);
+                /* fill foreground */
+                cairo_set_source_rgba (cr, bar->layout.fl_r, bar->layout.fl_g, bar->layout.fl_b, 0.5);
+                cairo_fill_preserve (cr);
+                break;
+        case SEGMENT_OFF:
+                /* fill background */
+                cairo_set_source_rgb (cr, bar->layout.bg_r, bar->layout.bg_g, bar->layout.bg_b);
+                cairo_fill_preserve (cr);
+                break;
+        default:
+                g_assert_not_reached ();
+        }
+
+        /* stroke border */
+        cairo_set_source_rgb (cr, bar->layout.bdr_r, bar->layout.bdr_g, bar->layout.bdr_b);
+        cairo_set_line_width (cr, 1);
+        cairo_stroke (cr);
+}
+
+static gboolean
+ensure_segments (GvcLevelBar *bar)
+{
+        GdkWindow *window;
+        guint      i;
+
+        if (bar->segments[0] != NULL)
+                return TRUE;
+
+        window = gtk_widget_get_window (GTK_WIDGET (bar));
+        if (window == NULL ||
+            bar->layout.box_width <= 0 ||
+            bar->layout.box_height <= 0)
+                return FALSE;
+
+        /* The surfaces get the scale factor of the window */
+        for (i = 0; i < NUM_SEGMENT_STATES; i++) {
+                cairo_t *cr;
+
+                bar->segments[i] = gdk_window_create_similar_surface (window,
+                                                                      CAIRO_CONTENT_COLOR_ALPHA,
+                                                                      bar->layout.box_width,
+                                                                      bar->layout.box_height);
+                cr = cairo_create (bar->segments[i]);
+                render_segment (bar, cr, i);
+                cairo_destroy (cr);
+        }
+
+        return TRUE;
+}
+
 static int
 gvc_level_bar_draw (GtkWidget *widget,
                     cairo_t   *cr)
 {
-        GvcLevelBar     *bar;
+        GvcLevelBar  *bar;
+        GdkRectangle  clip;
+        int           i;
 
         g_return_val_if_fail (GVC_IS_LEVEL_BAR (widget), FALSE);
 
         bar = GVC_LEVEL_BAR (widget);
 
-        cairo_save (cr);
+        if (!ensure_segments (bar))
+                return FALSE;
 
-        if (bar->orientation == GTK_ORIENTATION_VERTICAL) {
-                int i;
-                int by;
-
-                for (i = 0; i < NUM_BOXES; i++) {
-                        by = i * bar->layout.delta;
-                        curved_rectangle (cr,
-                                          bar->layout.area.x + 0.5,
-                                          by + 0.5,
-                                          bar->layout.box_width - 1,
-                                          bar->layout.box_height - 1,
-                                          bar->layout.box_radius);
-                        if ((bar->layout.max_peak_num - 1) == i) {
-                                /* fill peak foreground */
-                                cairo_set_source_rgb (cr, bar->layout.fl_r, bar->layout.fl_g, bar->layout.fl_b);
-                                cairo_fill_preserve (cr);
-                        } else if ((bar->layout.peak_num - 1) >= i) {
-                                /* fill background */
-                                cairo_set_source_rgb (cr, bar->layout.bg_r, bar->layout.bg_g, bar->layout.bg_b);
-                                cairo_fill_preserve (cr);
-                                /* fill foreground */
-                                cairo_set_source_rgba (cr, bar->layout.fl_r, bar->layout.fl_g, bar->layout.fl_b, 0.5);
-                                cairo_fill_preserve (cr);
-                        } else {
-                                /* fill background */
-                                cairo_set_source_rgb (cr, bar->layout.bg_r, bar->layout.bg_g, bar->layout.bg_b);
-                                cairo_fill_preserve (cr);
-                        }
-
-                        /* stroke border */
-                        cairo_set_source_rgb (cr, bar->layout.bdr_r, bar->layout.bdr_g, bar->layout.bdr_b);
-                        cairo_set_line_width (cr, 1);
-                        cairo_stroke (cr);
-                }
+        if (!gdk_cairo_get_clip_rectangle (cr, &clip))
+                return FALSE;
 
-        } else {
-                int i;
-                int bx;
+        /* Only the damaged segments are painted */
+        for (i = 0; i < NUM_BOXES; i++) {
+                GdkRectangle rect;
 
-                if (gtk_widget_get_direction (widget) == GTK_TEXT_DIR_RTL) {
-                        cairo_scale (cr, -1, 1);
-                        cairo_translate (cr, -gtk_widget_get_allocated_width (widget), 0);
-                }
+                get_segment_rectangle (bar, i, &rect);
+                if (!gdk_rectangle_intersect (&rect, &clip, NULL))
+                        continue;
 
-                for (i = 0; i < NUM_BOXES; i++) {
-                        bx = i * bar->layout.delta;
-                        curved_rectangle (cr,
-                                          bx + 0.5,
-                                          bar->layout.area.y + 0.5,
-                                          bar->layout.box_width - 1,
-                                          bar->layout.box_height - 1,
-                                          bar->layout.box_radius);
-
-                        if ((bar->layout.max_peak_num - 1) == i) {
-                                /* fill peak foreground */
-                                cairo_set_source_rgb (cr, bar->layout.fl_r, bar->layout.fl_g, bar->layout.fl_b);
-                                cairo_fill_preserve (cr);
-                        } else if ((bar->layout.peak_num - 1) >= i) {
-                                /* fill background */
-                                cairo_set_source_rgb (cr, bar->layout.bg_r, bar->layout.bg_g, bar->layout.bg_b);
-                                cairo_fill_preserve (cr);
-                                /* fill foreground */
-                                cairo_set_source_rgba (cr, bar->layout.fl_r, bar->layout.fl_g, bar->layout.fl_b, 0.5);
-                                cairo_fill_preserve (cr);
-                        } else {
-                                /* fill background */
-                                cairo_set_source_rgb (cr, bar->layout.bg_r, bar->layout.bg_g, bar->layout.bg_b);
-                                cairo_fill_preserve (cr);
-                        }
-
-                        /* stroke border */
-                        cairo_set_source_rgb (cr, bar->layout.bdr_r, bar->layout.bdr_g, bar->layout.bdr_b);
-                        cairo_set_line_width (cr, 1);
-                        cairo_stroke (cr);
-                }
+                cairo_set_source_surface (cr,
+                                          bar->segments[get_segment_state (&bar->layout, i)],
+                                          rect.x, rect.y);
+                cairo_rectangle (cr, rect.x, rect.y, rect.width, rect.height);
+                cairo_fill (cr);
         }
 
-        cairo_restore (cr);
-
         return FALSE;
 }
 
@@ -681,6 +863,8 @@ gvc_level_bar_class_init (GvcLevelBarClass *klass)
         widget_class->get_preferred_width = gvc_level_bar_get_preferred_width;
         widget_class->get_preferred_height = gvc_level_bar_get_preferred_height;
         widget_class->size_allocate = gvc_level_bar_size_allocate;
+        widget_class->style_updated = gvc_level_bar_style_updated;
+        widget_class->unrealize = gvc_level_bar_unrealize;
 
         g_object_class_install_property (object_class,
                                          PROP_ORIENTATION,
@@ -743,6 +927,9 @@ gvc_level_bar_init (GvcLevelBar *bar)
                           bar);
 
         gtk_widget_set_has_window (GTK_WIDGET (bar), FALSE);
+
+        g_signal_connect (bar, "notify::scale-factor",
+                          G_CALLBACK (on_scale_factor_notify), NULL);
 }
 
 static void
@@ -755,9 +942,7 @@ gvc_level_bar_finalize (GObject *object)
 
         bar = GVC_LEVEL_BAR (object);
 
-        if (bar->max_peak_id > 0) {
-                g_source_remove (bar->max_peak_id);
-        }
+        clear_segments (bar);
 
         G_OBJECT_CLASS (gvc_level_bar_parent_class)->finalize (object);
 }
@@ -41,6 +41,7 @@
 #include "gvc-mixer-dialog.h"
 #include "gvc-sound-theme-chooser.h"
 #include "gvc-level-bar.h"
+#include "gvc-peak-meter.h"
 #include "gvc-speaker-test.h"
 #include "gvc-mixer-control-private.h"
 
@@ -56,6 +57,7 @@ struct _GvcMixerDialog
         GtkWidget       *output_bar;
         GtkWidget       *input_bar;
         GtkWidget       *input_level_bar;
+        GtkWidget       *output_level_bar;
         GtkWidget       *effects_bar;
         GtkWidget       *output_stream_box;
         GtkWidget       *sound_effects_box;
@@ -78,7 +80,8 @@ struct _GvcMixerDialog
         GtkWidget       *test_dialog;
         GtkSizeGroup    *size_group;
 
-        gdouble          last_input_peak;
+        GvcPeakMeter    *input_meter;
+        GvcPeakMeter    *output_meter;
         guint            num_apps;
 };
 
@@ -158,6 +161,8 @@ update_output_settings (GvcMixerDialog      *dialog,
         GtkAdjustment       *adj;
 
         g_debug ("Updating output settings");
+
+        gvc_peak_meter_set_stream (dialog->output_meter, NULL);
         if (dialog->output_balance_bar != NULL) {
                 gtk_container_remove (GTK_CONTAINER (dialog->output_settings_box),
                                       dialog->output_balance_bar);
@@ -186,6 +191,8 @@ update_output_settings (GvcMixerDialog      *dialog,
                 return;
         }
 
+        gvc_peak_meter_set_stream (dialog->output_meter, stream);
+
         gvc_channel_bar_set_base_volume (GVC_CHANNEL_BAR (dialog->output_bar),
                                          gvc_mixer_stream_get_base_volume (stream));
         gvc_channel_bar_set_is_amplified (GVC_CHANNEL_BAR (dialog->output_bar),
@@ -284,194 +291,6 @@ update_output_settings (GvcMixerDialog      *dialog,
         gtk_widget_set_sensitive (dialog->output_balance_bar, gvc_channel_map_can_balance (map));
 }
 
-#define DECAY_STEP .15
-
-static void
-update_input_peak (GvcMixerDialog *dialog,
-                   gdouble         v)
-{
-        GtkAdjustment *adj;
-
-        if (dialog->last_input_peak >= DECAY_STEP) {
-                if (v < dialog->last_input_peak - DECAY_STEP) {
-                        v = dialog->last_input_peak - DECAY_STEP;
-                }
-        }
-
-        dialog->last_input_peak = v;
-
-        adj = gvc_level_bar_get_peak_adjustment (GVC_LEVEL_BAR (dialog->input_level_bar));
-        if (v >= 0) {
-                gtk_adjustment_set_value (adj, v);
-        } else {
-                gtk_adjustment_set_value (adj, 0.0);
-        }
-}
-
-static void
-update_input_meter (GvcMixerDialog *dialog,
-                    uint32_t        source_index,
-                    uint32_t        sink_input_idx,
-                    double          v)
-{
-        update_input_peak (dialog, v);
-}
-
-static void
-on_monitor_suspended_callback (pa_stream *s,
-                               void      *userdata)
-{
-        GvcMixerDialog *dialog;
-
-        dialog = userdata;
-
-        if (pa_stream_is_suspended (s)) {
-                g_debug ("Stream suspended");
-                update_input_meter (dialog,
-                                    pa_stream_get_device_index (s),
-                                    PA_INVALID_INDEX,
-                                    -1);
-        }
-}
-
-static void
-on_monitor_read_callback (pa_stream *s,
-                          size_t     length,
-                          void      *userdata)
-{
-        GvcMixerDialog *dialog;
-        const void     *data;
-        double          v;
-
-        dialog = userdata;
-
-        if (pa_stream_peek (s, &data, &length) < 0) {
-                g_warning ("Failed to read data from stream");
-                return;
-        }
-
-        if (!data) {
-                pa_stream_drop (s);
-                return;
-        }
-
-        assert (length > 0);
-        assert (length % sizeof (float) == 0);
-
-        v = ((const float *) data)[length / sizeof (float) -1];
-
-        pa_stream_drop (s);
-
-        if (v < 0) {
-                v = 0;
-        }
-        if (v > 1) {
-                v = 1;
-        }
-
-        update_input_meter (dialog,
-                            pa_stream_get_device_index (s),
-                            pa_stream_get_monitor_stream (s),
-                            v);
-}
-
-static void
-create_monitor_stream_for_source (GvcMixerDialog *dialog,
-                                  GvcMixerStream *stream)
-{
-        pa_stream     *s;
-        char           t[16];
-        pa_buffer_attr attr;
-        pa_sample_spec ss;
-        pa_context    *context;
-        int            res;
-        pa_proplist   *proplist;
-        gboolean       has_monitor;
-
-        if (stream == NULL) {
-                return;
-        }
-        has_monitor = GPOINTER_TO_INT (g_object_get_data (G_OBJECT (stream), "has-monitor"));
-        if (has_monitor != FALSE) {
-                return;
-        }
-
-        g_debug ("Create monitor for %u",
-                 gvc_mixer_stream_get_index (stream));
-
-        context = gvc_mixer_control_get_pa_context (dialog->mixer_control);
-
-        if (pa_context_get_server_protocol_version (context) < 13) {
-                return;
-        }
-
-        ss.channels = 1;
-        ss.format = PA_SAMPLE_FLOAT32;
-        ss.rate = 25;
-
-        memset (&attr, 0, sizeof (attr));
-        attr.fragsize = sizeof (float);
-        attr.maxlength = (uint32_t) -1;
-
-        snprintf (t, sizeof (t), "%u", gvc_mixer_stream_get_index (stream));
-
-        proplist = pa_proplist_new ();
-        pa_proplist_sets (proplist, PA_PROP_APPLICATION_ID, "org.gnome.VolumeControl");
-        s = pa_stream_new_with_proplist (context, _("Peak detect"), &ss, NULL, proplist);
-        pa_proplist_free (proplist);
-        if (s == NULL) {
-                g_warning ("Failed to create monitoring stream");
-                return;
-        }
-
-        pa_stream_set_read_callback (s, on_monitor_read_callback, dialog);
-        pa_stream_set_suspended_callback (s, on_monitor_suspended_callback, dialog);
-
-        res = pa_stream_connect_record (s,
-                                        t,
-                                        &attr,
-                                        (pa_stream_flags_t) (PA_STREAM_DONT_MOVE
-                                                             |PA_STREAM_PEAK_DETECT
-                                                             |PA_STREAM_ADJUST_LATENCY));
-        if (res < 0) {
-                g_warning ("Failed to connect monitoring stream");
-                pa_stream_unref (s);
-        } else {
-                g_object_set_data (G_OBJECT (stream), "has-monitor", GINT_TO_POINTER (TRUE));
-                g_object_set_data (G_OBJECT (dialog->input_level_bar), "pa_stream", s);
-                g_object_set_data (G_OBJECT (dialog->input_level_bar), "stream", stream);
-        }
-}
-
-static void
-stop_monitor_stream_for_source (GvcMixerDialog *dialog)
-{
-        pa_stream      *s;
-        pa_context     *context;
-        int             res;
-        GvcMixerStream *stream;
-
-        s = g_object_get_data (G_OBJECT (dialog->input_level_bar), "pa_stream");
-        if (s == NULL)
-                return;
-        stream = g_object_get_data (G_OBJECT (dialog->input_level_bar), "stream");
-        g_assert (stream != NULL);
-
-        g_debug ("Stopping monitor for %u", pa_stream_get_index (s));
-
-        context = gvc_mixer_control_get_pa_context (dialog->mixer_control);
-
-        if (pa_context_get_server_protocol_version (context) < 13) {
-                return;
-        }
-
-        res = pa_stream_disconnect (s);
-        if (res == 0)
-                g_object_set_data (G_OBJECT (stream), "has-monitor", GINT_TO_POINTER (FALSE));
-        g_object_set_data (G_OBJECT (dialog->input_level_bar), "pa_stream", NULL);
-        g_object_set_data (G_OBJECT (dialog->input_level_bar), "stream", NULL);
-}
-
 static void
 update_input_settings (GvcMixerDialog   *dialog,
                        GvcMixerUIDevice *device)
@@ -482,7 +301,7 @@ update_input_settings (GvcMixerDialog   *dialog,
 
         g_debug ("Updating input settings");
 
-        stop_monitor_stream_for_source (dialog);
+        gvc_peak_meter_set_stream (dialog->input_meter, NULL);
 
         if (dialog->input_profile_combo != NULL) {
                 gtk_container_remove (GTK_CONTAINER (dialog->input_settings_box),
@@ -538,7 +357,7 @@ update_input_settings (GvcMixerDialog   *dialog,
                 gtk_widget_show (dialog->input_profile_combo);
         }
 
-        create_monitor_stream_for_source (dialog, stream);
+        gvc_peak_meter_set_stream (dialog->input_meter, stream);
 }
 
 static void
@@ -1003,13 +822,33 @@ add_stream (GvcMixerDialog *dialog,
                 g_debug ("Adding effects stream");
         } else {
                 /* Must be an application stream */
-                const char *name;
+                const char   *name;
+                GtkWidget    *row;
+                GtkWidget    *level_bar;
+                GvcPeakMeter *meter;
+
                 name = gvc_mixer_stream_get_name (stream);
                 g_debug ("Add bar for application stream : %s", name);
 
                 bar = create_app_bar (dialog, name,
                                       gvc_mixer_stream_get_icon_name (stream));
-                gtk_box_pack_start (GTK_BOX (dialog->applications_box), bar, FALSE, FALSE, 12);
+
+                level_bar = gvc_level_bar_new ();
+                gvc_level_bar_set_scale (GVC_LEVEL_BAR (level_bar),
+                                         GVC_LEVEL_SCALE_LINEAR);
+
+                meter = gvc_peak_meter_new (dialog->mixer_control, GVC_LEVEL_BAR (level_bar));
+                gvc_peak_meter_set_stream (meter, stream);
+                g_object_set_data_full (G_OBJECT (bar), "gvc-mixer-dialog-meter",
+                                        meter, g_object_unref);
+
+                row = gtk_box_new (GTK_ORIENTATION_VERTICAL, 6);
+                gtk_box_pack_start (GTK_BOX (row), bar, FALSE, FALSE, 0);
+                gtk_box_pack_start (GTK_BOX (row), level_bar, FALSE, FALSE, 0);
+                gtk_widget_show_all (row);
+                g_object_set_data (G_OBJECT (bar), "gvc-mixer-dialog-row", row);
+
+                gtk_box_pack_start (GTK_BOX (dialog->applications_box), row, FALSE, FALSE, 12);
                 dialog->num_apps++;
                 gtk_widget_hide (dialog->no_apps_label);
         }
@@ -1358,7 +1197,14 @@ remove_stream (GvcMixerDialog  *dialog,
 
         bar = g_hash_table_lookup (dialog->bars, GUINT_TO_POINTER (id));
         if (bar != NULL) {
+                GtkWidget *row;
+
                 g_hash_table_remove (dialog->bars, GUINT_TO_POINTER (id));
+
+                /* Application bars come with their level bar */
+                row = g_object_get_data (G_OBJECT (bar), "gvc-mixer-dialog-row");
+                if (row != NULL)
+                        bar = row;
                 gtk_container_remove (GTK_CONTAINER (gtk_widget_get_parent (bar)),
                                       bar);
                 dialog->num_apps--;
@@ -1639,6 +1485,17 @@ gvc_mixer_dialog_constructor (GType                  type,
         gtk_box_pack_start (GTK_BOX (self->output_stream_box),
                             self->output_bar, TRUE, TRUE, 12);
 
+        self->output_level_bar = gvc_level_bar_new ();
+        gvc_level_bar_set_scale (GVC_LEVEL_BAR (self->output_level_bar),
+                                 GVC_LEVEL_SCALE_LINEAR);
+        gtk_widget_set_margin_start (self->output_level_bar, 12);
+        gtk_widget_set_margin_end (self->output_level_bar, 12);
+        gtk_box_pack_start (GTK_BOX (main_vbox),
+                            self->output_level_bar,
+                            FALSE, FALSE, 0);
+        self->output_meter = gvc_peak_meter_new (self->mixer_control,
+                                                 GVC_LEVEL_BAR (self->output_level_bar));
+
         self->notebook = gtk_notebook_new ();
         gtk_box_pack_start (GTK_BOX (main_vbox),
                             self->notebook,
@@ -1727,6 +1584,8 @@ gvc_mixer_dialog_constructor (GType                  type,
         gtk_box_pack_start (GTK_BOX (box),
                             self->input_level_bar,
                             TRUE, TRUE, 6);
+        self->input_meter = gvc_peak_meter_new (self->mixer_control,
+                                                GVC_LEVEL_BAR (self->input_level_bar));
 
         ebox = gtk_box_new (GTK_ORIENTATION_HORIZONTAL, 6);
         gtk_box_pack_start (GTK_BOX (box),
@@ -1872,6 +1731,9 @@ gvc_mixer_dialog_dispose (GObject *object)
                 dialog->bars = NULL;
         }
 
+        g_clear_object (&dialog->input_meter);
+        g_clear_object (&dialog->output_meter);
+
         if (dialog->test_dialog != NULL) {
                 gtk_dialog_response (GTK_DIALOG (dialog->test_dialog),
                                      GTK_RESPONSE_OK);
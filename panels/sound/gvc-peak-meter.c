@@ -0,0 +1,400 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2017 The GNOME Foundation
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "config.h"
+
+#include <math.h>
+#include <string.h>
+
+#include <glib.h>
+#include <glib/gi18n-lib.h>
+#include <gtk/gtk.h>
+#include <pulse/pulseaudio.h>
+
+#include "gvc-mixer-sink.h"
+#include "gvc-mixer-sink-input.h"
+#include "gvc-mixer-control-private.h"
+#include "gvc-peak-meter.h"
+
+/* A GvcPeakMeter feeds a GvcLevelBar with the level of a sink, a source
+ * or a sink input, from a PulseAudio peak detection stream.
+ *
+ * The server sends the peak of every PEAK_RATE'th of a second, and the
+ * bar gets the maximum and the RMS of each read. The bar only redraws
+ * once per frame, and makes the peak decay. The stream only runs while
+ * the bar is mapped, and is corked otherwise.
+ */
+
+/* Peak values per second, and per read */
+#define PEAK_RATE       100
+#define PEAK_FRAGMENT   2
+
+struct _GvcPeakMeter
+{
+        GObject          parent_instance;
+
+        GvcMixerControl *control;
+        GvcLevelBar     *bar;
+        GvcMixerStream  *stream;
+
+        pa_stream       *pa_stream;
+};
+
+G_DEFINE_TYPE (GvcPeakMeter, gvc_peak_meter, G_TYPE_OBJECT)
+
+static void
+update_bar (GvcPeakMeter *meter,
+            gdouble       peak,
+            gdouble       rms)
+{
+        if (meter->bar == NULL)
+                return;
+
+        gtk_adjustment_set_value (gvc_level_bar_get_peak_adjustment (meter->bar), peak);
+        gtk_adjustment_set_value (gvc_level_bar_get_rms_adjustment (meter->bar), rms);
+}
+
+static void
+on_monitor_read_callback (pa_stream *s,
+                          size_t     length,
+                          void      *userdata)
+{
+        GvcPeakMeter *meter = userdata;
+        gfloat        peak = 0;
+        gdouble       sum_squares = 0;
+        guint         n_values = 0;
+
+        while (pa_stream_readable_size (s) > 0) {
+                const float *data;
+                size_t       i;
+
+                if (pa_stream_peek (s, (const void **) &data, &length) < 0) {
+                        g_warning ("Failed to read data from stream");
+                        return;
+                }
+
+                /* A hole in the stream */
+                if (!data) {
+                        if (length > 0)
+                                pa_stream_drop (s);
+                        continue;
+                }
+
+                for (i = 0; i < length / sizeof (float); i++) {
+                        gfloat v = CLAMP (data[i], 0, 1);
+
+                        peak = MAX (peak, v);
+                        sum_squares += v * v;
+                        n_values++;
+                }
+
+                pa_stream_drop (s);
+        }
+
+        if (n_values > 0)
+                update_bar (meter, peak, sqrt (sum_squares / n_values));
+}
+
+static void
+on_monitor_suspended_callback (pa_stream *s,
+                               void      *userdata)
+{
+        GvcPeakMeter *meter = userdata;
+
+        if (pa_stream_is_suspended (s)) {
+                g_debug ("Stream suspended");
+                update_bar (meter, 0, 0);
+        }
+}
+
+static void
+release_stream (GvcPeakMeter *meter)
+{
+        pa_stream *s;
+
+        s = meter->pa_stream;
+        if (s == NULL)
+                return;
+
+        meter->pa_stream = NULL;
+
+        pa_stream_set_read_callback (s, NULL, NULL);
+        pa_stream_set_suspended_callback (s, NULL, NULL);
+        pa_stream_set_state_callback (s, NULL, NULL);
+
+        if (PA_STREAM_IS_GOOD (pa_stream_get_state (s)))
+                pa_stream_disconnect (s);
+        pa_stream_unref (s);
+
+        update_bar (meter, 0, 0);
+}
+
+/* Runs the stream only while the bar is mapped. A stream can only be
+ * corked once ready, so this is also called when it becomes ready */
+static void
+update_cork (GvcPeakMeter *meter)
+{
+        pa_operation *o;
+        gboolean      cork;
+
+        if (meter->pa_stream == NULL ||
+            pa_stream_get_state (meter->pa_stream) != PA_STREAM_READY)
+                return;
+
+        cork = meter->bar == NULL || !gtk_widget_get_mapped (GTK_WIDGET (meter->bar));
+        if (cork == pa_stream_is_corked (meter->pa_stream))
+                return;
+
+        g_debug ("%s monitor for %u", cork ? "Suspending" : "Resuming",
+                 pa_stream_get_index (meter->pa_stream));
+
+        o = pa_stream_cork (meter->pa_stream, cork, NULL, NULL);
+        if (o != NULL)
+                pa_operation_unref (o);
+}
+
+static void
+on_monitor_state_callback (pa_stream *s,
+                           void      *userdata)
+{
+        GvcPeakMeter *meter = userdata;
+
+        if (pa_stream_get_state (s) == PA_STREAM_READY) {
+                update_cork (meter);
+                return;
+        }
+
+        /* The monitored stream went away, or was moved elsewhere */
+        if (!PA_STREAM_IS_GOOD (pa_stream_get_state (s))) {
+                g_debug ("Monitor for %u stopped", pa_stream_get_index (s));
+                release_stream (meter);
+        }
+}
+
+static void
+create_stream (GvcPeakMeter *meter)
+{
+        pa_stream        *s;
+        pa_buffer_attr    attr;
+        pa_sample_spec    ss;
+        pa_context       *context;
+        pa_proplist      *proplist;
+        pa_stream_flags_t flags;
+        char             *device;
+        guint             index;
+        int               res;
+
+        context = gvc_mixer_control_get_pa_context (meter->control);
+
+        if (pa_context_get_server_protocol_version (context) < 13) {
+                return;
+        }
+
+        index = gvc_mixer_stream_get_index (meter->stream);
+
+        g_debug ("Create monitor for %u", index);
+
+        ss.channels = 1;
+        ss.format = PA_SAMPLE_FLOAT32;
+        ss.rate = PEAK_RATE;
+
+        memset (&attr, 0, sizeof (attr));
+        attr.fragsize = sizeof (float) * PEAK_FRAGMENT;
+        attr.maxlength = (uint32_t) -1;
+
+        flags = PA_STREAM_DONT_MOVE | PA_STREAM_PEAK_DETECT | PA_STREAM_ADJUST_LATENCY;
+
+        /* Outputs are monitored without keeping them from suspending, and
+         * sink inputs on the monitor of their sink, picked by the server */
+        if (GVC_IS_MIXER_SINK (meter->stream)) {
+                device = g_strdup_printf ("%s.monitor", gvc_mixer_stream_get_name (meter->stream));
+                flags |= PA_STREAM_DONT_INHIBIT_AUTO_SUSPEND;
+        } else if (GVC_IS_MIXER_SINK_INPUT (meter->stream)) {
+                device = NULL;
+                flags |= PA_STREAM_DONT_INHIBIT_AUTO_SUSPEND;
+        } else {
+                device = g_strdup_printf ("%u", index);
+        }
+
+        proplist = pa_proplist_new ();
+        pa_proplist_sets (proplist, PA_PROP_APPLICATION_ID, "org.gnome.VolumeControl");
+        s = pa_stream_new_with_proplist (context, _("Peak detect"), &ss, NULL, proplist);
+        pa_proplist_free (proplist);
+        if (s == NULL) {
+                g_warning ("Failed to create monitoring stream");
+                g_free (device);
+                return;
+        }
+
+        if (GVC_IS_MIXER_SINK_INPUT (meter->stream))
+                pa_stream_set_monitor_stream (s, index);
+
+        pa_stream_set_read_callback (s, on_monitor_read_callback, meter);
+        pa_stream_set_suspended_callback (s, on_monitor_suspended_callback, meter);
+        pa_stream_set_state_callback (s, on_monitor_state_callback, meter);
+
+        res = pa_stream_connect_record (s, device, &attr, flags);
+        if (res < 0) {
+                g_warning ("Failed to connect monitoring stream");
+                pa_stream_unref (s);
+        } else {
+                meter->pa_stream = s;
+        }
+
+        g_free (device);
+}
+
+static void
+start_metering (GvcPeakMeter *meter)
+{
+        if (meter->stream == NULL || meter->bar == NULL)
+                return;
+
+        if (!gtk_widget_get_mapped (GTK_WIDGET (meter->bar)))
+                return;
+
+        if (meter->pa_stream == NULL)
+                create_stream (meter);
+        else
+                update_cork (meter);
+}
+
+static void
+suspend_metering (GvcPeakMeter *meter)
+{
+        update_cork (meter);
+        update_bar (meter, 0, 0);
+}
+
+static void
+on_bar_map (GtkWidget    *widget,
+            GvcPeakMeter *meter)
+{
+        start_metering (meter);
+}
+
+static void
+on_bar_unmap (GtkWidget    *widget,
+              GvcPeakMeter *meter)
+{
+        suspend_metering (meter);
+}
+
+static void
+on_bar_destroy (GtkWidget    *widget,
+                GvcPeakMeter *meter)
+{
+        suspend_metering (meter);
+        release_stream (meter);
+
+        g_signal_handlers_disconnect_by_data (meter->bar, meter);
+        meter->bar = NULL;
+}
+
+/**
+ * gvc_peak_meter_set_stream:
+ * @meter: a #GvcPeakMeter
+ * @stream: (nullable): the sink, source or sink input to meter
+ *
+ * Starts showing the level of @stream in the bar of @meter, as soon as
+ * the bar is mapped.
+ */
+void
+gvc_peak_meter_set_stream (GvcPeakMeter   *meter,
+                           GvcMixerStream *stream)
+{
+        g_return_if_fail (GVC_IS_PEAK_METER (meter));
+        g_return_if_fail (stream == NULL || GVC_IS_MIXER_STREAM (stream));
+
+        if (meter->stream == stream)
+                return;
+
+        suspend_metering (meter);
+        release_stream (meter);
+
+        g_set_object (&meter->stream, stream);
+
+        start_metering (meter);
+}
+
+GvcMixerStream *
+gvc_peak_meter_get_stream (GvcPeakMeter *meter)
+{
+        g_return_val_if_fail (GVC_IS_PEAK_METER (meter), NULL);
+
+        return meter->stream;
+}
+
+static void
+gvc_peak_meter_finalize (GObject *object)
+{
+        GvcPeakMeter *meter = GVC_PEAK_METER (object);
+
+        if (meter->bar != NULL)
+                on_bar_destroy (GTK_WIDGET (meter->bar), meter);
+
+        release_stream (meter);
+
+        g_clear_object (&meter->stream);
+        g_clear_object (&meter->control);
+
+        G_OBJECT_CLASS (gvc_peak_meter_parent_class)->finalize (object);
+}
+
+static void
+gvc_peak_meter_class_init (GvcPeakMeterClass *klass)
+{
+        GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+        object_class->finalize = gvc_peak_meter_finalize;
+}
+
+static void
+gvc_peak_meter_init (GvcPeakMeter *meter)
+{
+}
+
+/**
+ * gvc_peak_meter_new:
+ * @control: a #GvcMixerControl
+ * @bar: the #GvcLevelBar to show the level in
+ *
+ * Creates a meter for @bar, which is used until it's destroyed.
+ *
+ * Returns: (transfer full): a new #GvcPeakMeter
+ */
+GvcPeakMeter *
+gvc_peak_meter_new (GvcMixerControl *control,
+                    GvcLevelBar     *bar)
+{
+        GvcPeakMeter *meter;
+
+        g_return_val_if_fail (GVC_IS_MIXER_CONTROL (control), NULL);
+        g_return_val_if_fail (GVC_IS_LEVEL_BAR (bar), NULL);
+
+        meter = g_object_new (GVC_TYPE_PEAK_METER, NULL);
+        meter->control = g_object_ref (control);
+        meter->bar = bar;
+
+        g_signal_connect (bar, "map", G_CALLBACK (on_bar_map), meter);
+        g_signal_connect (bar, "unmap", G_CALLBACK (on_bar_unmap), meter);
+        g_signal_connect (bar, "destroy", G_CALLBACK (on_bar_destroy), meter);
+
+        return meter;
+}
@@ -0,0 +1,42 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2017 The GNOME Foundation
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef __GVC_PEAK_METER_H
+#define __GVC_PEAK_METER_H
+
+#include <glib-object.h>
+
+#include "gvc-mixer-control.h"
+#include "gvc-level-bar.h"
+
+G_BEGIN_DECLS
+
+#define GVC_TYPE_PEAK_METER (gvc_peak_meter_get_type ())
+G_DECLARE_FINAL_TYPE (GvcPeakMeter, gvc_peak_meter, GVC, PEAK_METER, GObject)
+
+GvcPeakMeter *      gvc_peak_meter_new                (GvcMixerControl *control,
+                                                       GvcLevelBar     *bar);
+
+void                gvc_peak_meter_set_stream         (GvcPeakMeter    *meter,
+                                                       GvcMixerStream  *stream);
+GvcMixerStream *    gvc_peak_meter_get_stream         (GvcPeakMeter    *meter);
+
+G_END_DECLS
+
+#endif /* __GVC_PEAK_METER_H */
@@ -41,6 +41,13 @@ struct _CcSearchProvider
   CcShellSearchProvider2 *skeleton;
 
   GHashTable *iter_table; /* COL_ID -> GtkTreeIter */
+
+  /* Casefolded term -> bitset of the panels matching it. Shell search
+   * sessions start with GetInitialResultSet and then narrow the results
+   * with one term change per keystroke, so most terms are looked up in
+   * the index only once per session.
+   */
+  GHashTable *term_matches;
 };
 
 struct _CcSearchProviderClass
@@ -56,6 +63,8 @@ typedef enum {
 
 G_DEFINE_TYPE (CcSearchProvider, cc_search_provider, G_TYPE_OBJECT)
 
+#define MAX_CACHED_TERMS 64
+
 static char **
 get_casefolded_terms (char **terms)
 {
@@ -72,64 +81,118 @@ get_casefolded_terms (char **terms)
   return casefolded_terms;
 }
 
+static GtkTreeModel *
+get_model (void)
+{
+  CcSearchProviderApp *app;
+
+  app = cc_search_provider_app_get ();
+  return GTK_TREE_MODEL (cc_search_provider_app_get_model (app));
+}
+
+static CcShellSearchIndex *
+get_search_index (void)
+{
+  return cc_shell_model_get_search_index (CC_SHELL_MODEL (get_model ()));
+}
+
+static const guint64 *
+get_term_matches (CcSearchProvider   *self,
+                  CcShellSearchIndex *index,
+                  const gchar        *term)
+{
+  guint64 *matches;
+
+  matches = g_hash_table_lookup (self->term_matches, term);
+  if (matches)
+    return matches;
+
+  if (g_hash_table_size (self->term_matches) >= MAX_CACHED_TERMS)
+    g_hash_table_remove_all (self->term_matches);
+
+  matches = g_new (guint64, cc_shell_search_index_get_n_words (index));
+  cc_shell_search_index_match_term (index, term, CC_SHELL_SEARCH_FIELD_ALL, matches);
+
+  g_hash_table_insert (self->term_matches, g_strdup (term), matches);
+
+  return matches;
+}
+
 static gboolean
-matches_all_terms (GtkTreeModel  *model,
-                   GtkTreeIter   *iter,
-                   char         **terms)
+matches_all_terms (CcSearchProvider    *self,
+                   CcShellSearchIndex  *index,
+                   guint                panel,
+                   char               **terms)
 {
   int i;
 
   for (i = 0; terms[i]; i++)
     {
-      if (!cc_shell_model_iter_matches_search (CC_SHELL_MODEL (model),
-                                               iter,
-                                               terms[i]))
+      const guint64 *matches;
+
+      matches = get_term_matches (self, index, terms[i]);
+      if (!CC_SHELL_SEARCH_INDEX_TEST_BIT (matches, panel))
         return FALSE;
     }
 
   return TRUE;
 }
 
-static GtkTreeModel *
-get_model (void)
-{
-  CcSearchProviderApp *app;
-
-  app = cc_search_provider_app_get ();
-  return GTK_TREE_MODEL (cc_search_provider_app_get_model (app));
-}
-
+/* When @previous_results is not %NULL, only those are considered, which
+ * makes subsearches proportional to the size of the previous result set.
+ */
 static gchar **
-get_results (gchar **terms)
+get_results (CcSearchProvider  *self,
+             gchar            **terms,
+             gchar            **previous_results)
 {
-  GtkTreeModel *model = get_model ();
-  GtkTreeIter iter;
-  GPtrArray *results;
-  gboolean ok;
+  CcShellSearchIndex *index;
+  GArray *panels;
   gchar **casefolded_terms;
+  gchar **results;
+  guint i;
 
+  index = get_search_index ();
   casefolded_terms = get_casefolded_terms (terms);
-  results = g_ptr_array_new ();
+  panels = g_array_new (FALSE, FALSE, sizeof (guint));
 
-  cc_shell_model_set_sort_terms (CC_SHELL_MODEL (model), casefolded_terms);
+  if (previous_results)
+    {
+      for (i = 0; previous_results[i]; i++)
+        {
+          gint panel;
 
-  ok = gtk_tree_model_get_iter_first (model, &iter);
-  while (ok)
+          panel = cc_shell_search_index_lookup (index, previous_results[i]);
+          if (panel < 0)
+            continue;
+
+          if (matches_all_terms (self, index, panel, casefolded_terms))
+            {
+              guint p = panel;
+              g_array_append_val (panels, p);
+            }
+        }
+    }
+  else
     {
-      if (matches_all_terms (model, &iter, casefolded_terms))
+      for (i = 0; i < cc_shell_search_index_get_n_panels (index); i++)
         {
-          gchar *id;
-          gtk_tree_model_get (model, &iter, COL_ID, &id, -1);
-          g_ptr_array_add (results, id);
+          if (matches_all_terms (self, index, i, casefolded_terms))
+            g_array_append_val (panels, i);
         }
-
-      ok = gtk_tree_model_iter_next (model, &iter);
     }
 
-  g_ptr_array_add (results, NULL);
+  cc_shell_search_index_sort (index, (guint *) panels->data, panels->len, casefolded_terms);
+
+  results = g_new (gchar *, panels->len + 1);
+  for (i = 0; i < panels->len; i++)
+    results[i] = g_strdup (cc_shell_search_index_get_id (index, g_array_index (panels, guint, i)));
+  results[panels->len] = NULL;
+
+  g_array_free (panels, TRUE);
   g_strfreev (casefolded_terms);
 
-  return (char**) g_ptr_array_free (results, FALSE);
+  return results;
 }
 
 static gboolean
@@ -138,7 +201,12 @@ handle_get_initial_result_set (CcShellSearchProvider2  *skeleton,
                                char                   **terms,
                                CcSearchProvider        *self)
 {
-  gchar **results = get_results (terms);
+  gchar **results;
+
+  /* A new search session, the terms will be different from now on */
+  g_hash_table_remove_all (self->term_matches);
+
+  results = get_results (self, terms, NULL);
   cc_shell_search_provider2_complete_get_initial_result_set (skeleton,
                                                              invocation,
                                                              (const char* const*) results);
@@ -153,14 +221,7 @@ handle_get_subsearch_result_set (CcShellSearchProvider2  *skeleton,
                                  char                   **terms,
                                  CcSearchProvider        *self)
 {
-  /* We ignore the previous results here since the model re-sorts for
-   * the new terms. This means that we're not really doing a subsearch
-   * but, on the other hand, the results are consistent with the
-   * control center's own search. In any case, the number of elements
-   * in the model is always small enough that we don't need to worry
-   * about this taking too long.
-   */
-  gchar **results = get_results (terms);
+  gchar **results = get_results (self, terms, previous_results);
   cc_shell_search_provider2_complete_get_subsearch_result_set (skeleton,
                                                                invocation,
                                                                (const char* const*) results);
@@ -212,9 +273,7 @@ handle_get_result_metas (CcShellSearchProvider2  *skeleton,
   GtkTreeIter *iter;
   int i;
   GVariantBuilder builder;
-  GAppInfo *app;
-  const char *id;
-  char *name, *description, *escaped_description;
+  char *id, *name, *description, *escaped_description;
   GIcon *icon;
 
   g_variant_builder_init (&builder, G_VARIANT_TYPE ("aa{sv}"));
@@ -226,12 +285,11 @@ handle_get_result_metas (CcShellSearchProvider2  *skeleton,
         continue;
 
       gtk_tree_model_get (model, iter,
-                          COL_APP, &app,
+                          COL_DESKTOP_ID, &id,
                           COL_NAME, &name,
                           COL_GICON, &icon,
                           COL_DESCRIPTION, &description,
                           -1);
-      id = g_app_info_get_id (app);
       escaped_description = g_markup_escape_text (description, -1);
 
       g_variant_builder_open (&builder, G_VARIANT_TYPE ("a{sv}"));
@@ -248,7 +306,7 @@ handle_get_result_metas (CcShellSearchProvider2  *skeleton,
       g_free (name);
       g_free (description);
       g_free (escaped_description);
-      g_object_unref (app);
+      g_free (id);
       g_object_unref (icon);
     }
 
@@ -333,6 +391,7 @@ static void
 cc_search_provider_init (CcSearchProvider *self)
 {
   self->skeleton = cc_shell_search_provider2_skeleton_new ();
+  self->term_matches = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
 
   g_signal_connect (self->skeleton, "handle-get-initial-result-set",
                     G_CALLBACK (handle_get_initial_result_set), self);
@@ -381,6 +440,7 @@ cc_search_provider_dispose (GObject *object)
 
   g_clear_object (&self->skeleton);
   g_clear_pointer (&self->iter_table, g_hash_table_destroy);
+  g_clear_pointer (&self->term_matches, g_hash_table_destroy);
 
   G_OBJECT_CLASS (cc_search_provider_parent_class)->dispose (object);
 }
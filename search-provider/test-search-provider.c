@@ -0,0 +1,232 @@
+/*
+ * Copyright (c) 2017 The GNOME Foundation
+ *
+ * The Control Center is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * The Control Center is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with the Control Center; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/* Drives the search provider the way gnome-shell does, over a private
+ * session bus: one GetInitialResultSet for the first character typed
+ * and one GetSubsearchResultSet per following keystroke. Run it with
+ * "-m perf" to get timings. The provider loads the panels' desktop
+ * files from XDG_DATA_DIRS, so it has to be installed or pointed at a
+ * prefix which has them.
+ */
+
+#include "config.h"
+
+#include <gio/gio.h>
+#include <glib/gstdio.h>
+#include <string.h>
+
+#define BUS_NAME    "org.gnome.ControlCenter.SearchProvider"
+#define OBJECT_PATH "/org/gnome/ControlCenter/SearchProvider"
+#define INTERFACE   "org.gnome.Shell.SearchProvider2"
+
+static const gchar *queries[] = {
+  "wallpaper",
+  "bluetooth",
+  "battery",
+  "screen resolution",
+  "time zone",
+  "keyboard shortcut",
+  "microphone",
+  "mouse touchpad",
+  "brightness",
+  "printer",
+};
+
+static gchar **
+call_search (GDBusConnection  *connection,
+             gchar           **previous_results,
+             gchar           **terms)
+{
+  GVariant *reply;
+  GError *error = NULL;
+  gchar **results;
+
+  if (previous_results)
+    reply = g_dbus_connection_call_sync (connection,
+                                         BUS_NAME,
+                                         OBJECT_PATH,
+                                         INTERFACE,
+                                         "GetSubsearchResultSet",
+                                         g_variant_new ("(^as^as)", previous_results, terms),
+                                         G_VARIANT_TYPE ("(as)"),
+                                         G_DBUS_CALL_FLAGS_NONE,
+                                         -1,
+                                         NULL,
+                                         &error);
+  else
+    reply = g_dbus_connection_call_sync (connection,
+                                         BUS_NAME,
+                                         OBJECT_PATH,
+                                         INTERFACE,
+                                         "GetInitialResultSet",
+                                         g_variant_new ("(^as)", terms),
+                                         G_VARIANT_TYPE ("(as)"),
+                                         G_DBUS_CALL_FLAGS_NONE,
+                                         -1,
+                                         NULL,
+                                         &error);
+
+  g_assert_no_error (error);
+
+  g_variant_get (reply, "(^as)", &results);
+  g_variant_unref (reply);
+
+  return results;
+}
+
+/* Types @query one character at a time. With @subsearch, every keystroke
+ * after the first narrows the previous results, otherwise every keystroke
+ * starts a new search. Returns the number of calls made.
+ */
+static guint
+type_query (GDBusConnection *connection,
+            const gchar     *query,
+            gboolean         subsearch)
+{
+  gchar **results = NULL;
+  guint n_calls = 0;
+  gsize len;
+
+  for (len = 1; len <= strlen (query); len++)
+    {
+      gchar *typed;
+      gchar **terms;
+      gchar **new_results;
+
+      typed = g_strndup (query, len);
+      terms = g_strsplit (typed, " ", -1);
+
+      new_results = call_search (connection, subsearch ? results : NULL, terms);
+      n_calls++;
+
+      g_strfreev (results);
+      results = new_results;
+
+      g_strfreev (terms);
+      g_free (typed);
+    }
+
+  g_strfreev (results);
+
+  return n_calls;
+}
+
+static gchar *
+write_service_dir (void)
+{
+  GError *error = NULL;
+  gchar *dir, *path, *contents;
+
+  dir = g_dir_make_tmp ("cc-search-provider-XXXXXX", &error);
+  g_assert_no_error (error);
+
+  contents = g_strdup_printf ("[D-BUS Service]\n"
+                              "Name=%s\n"
+                              "Exec=%s/gnome-control-center-search-provider\n",
+                              BUS_NAME, BUILDDIR);
+
+  path = g_build_filename (dir, BUS_NAME ".service", NULL);
+  g_file_set_contents (path, contents, -1, &error);
+  g_assert_no_error (error);
+
+  g_free (path);
+  g_free (contents);
+
+  return dir;
+}
+
+static void
+remove_service_dir (const gchar *dir)
+{
+  gchar *path;
+
+  path = g_build_filename (dir, BUS_NAME ".service", NULL);
+  g_unlink (path);
+  g_rmdir (dir);
+  g_free (path);
+}
+
+static void
+test_typing_performance (void)
+{
+  GDBusConnection *connection;
+  GTestDBus *bus;
+  GError *error = NULL;
+  GTimer *timer;
+  gchar *service_dir;
+  gdouble elapsed;
+  guint n_calls;
+  guint round, i;
+  const guint n_rounds = 50;
+
+  if (!g_test_perf ())
+    return;
+
+  service_dir = write_service_dir ();
+
+  bus = g_test_dbus_new (G_TEST_DBUS_NONE);
+  g_test_dbus_add_service_dir (bus, service_dir);
+  g_test_dbus_up (bus);
+
+  connection = g_bus_get_sync (G_BUS_TYPE_SESSION, NULL, &error);
+  g_assert_no_error (error);
+
+  /* Activates the service and warms it up */
+  type_query (connection, queries[0], TRUE);
+
+  timer = g_timer_new ();
+
+  for (n_calls = 0, round = 0; round < n_rounds; round++)
+    for (i = 0; i < G_N_ELEMENTS (queries); i++)
+      n_calls += type_query (connection, queries[i], FALSE);
+
+  elapsed = g_timer_elapsed (timer, NULL);
+  g_test_minimized_result (elapsed * G_USEC_PER_SEC / n_calls,
+                           "GetInitialResultSet per keystroke: %u calls, %.1f µs per call",
+                           n_calls, elapsed * G_USEC_PER_SEC / n_calls);
+
+  g_timer_start (timer);
+
+  for (n_calls = 0, round = 0; round < n_rounds; round++)
+    for (i = 0; i < G_N_ELEMENTS (queries); i++)
+      n_calls += type_query (connection, queries[i], TRUE);
+
+  elapsed = g_timer_elapsed (timer, NULL);
+  g_test_minimized_result (elapsed * G_USEC_PER_SEC / n_calls,
+                           "GetSubsearchResultSet per keystroke: %u calls, %.1f µs per call",
+                           n_calls, elapsed * G_USEC_PER_SEC / n_calls);
+
+  g_timer_destroy (timer);
+  g_object_unref (connection);
+
+  g_test_dbus_down (bus);
+  g_object_unref (bus);
+
+  remove_service_dir (service_dir);
+  g_free (service_dir);
+}
+
+int
+main (int argc, char **argv)
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/search-provider/typing-performance", test_typing_performance);
+
+  return g_test_run ();
+}
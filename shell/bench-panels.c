@@ -0,0 +1,169 @@
+/*
+ * Copyright (c) 2017 The GNOME Foundation
+ *
+ * The Control Center is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * The Control Center is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with the Control Center; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/* Opens the window, then switches to every panel in turn and measures how
+ * long it takes until the panel is drawn. The first switch to a panel is
+ * "cold" (its type and resources are loaded), the second one is "warm".
+ * Run it with "make bench", which uses a private session bus, a headless X
+ * server and in-memory settings.
+ */
+
+#include "config.h"
+
+#include <gtk/gtk.h>
+
+#include "cc-panel-loader.h"
+#include "cc-shell.h"
+#include "cc-shell-profile.h"
+#include "cc-window.h"
+
+typedef struct
+{
+  const gchar *id;
+  gdouble      cold;
+  gdouble      warm;
+} PanelTiming;
+
+static void
+after_paint_cb (GdkFrameClock *frame_clock,
+                GMainLoop     *loop)
+{
+  g_main_loop_quit (loop);
+}
+
+/* Returns the time in ms until the next frame of @window is painted */
+static gdouble
+wait_for_frame (GtkWidget *window,
+                gint64     begin)
+{
+  GdkFrameClock *frame_clock;
+  GMainLoop *loop;
+  gulong handler;
+
+  frame_clock = gtk_widget_get_frame_clock (window);
+  loop = g_main_loop_new (NULL, FALSE);
+
+  handler = g_signal_connect (frame_clock, "after-paint", G_CALLBACK (after_paint_cb), loop);
+  gtk_widget_queue_draw (window);
+  g_main_loop_run (loop);
+  g_signal_handler_disconnect (frame_clock, handler);
+
+  g_main_loop_unref (loop);
+
+  return (g_get_monotonic_time () - begin) / 1000.0;
+}
+
+static gdouble
+switch_to_panel (CcWindow    *window,
+                 const gchar *id)
+{
+  g_autoptr(GError) error = NULL;
+  gint64 begin;
+
+  begin = g_get_monotonic_time ();
+
+  if (!cc_shell_set_active_panel_from_id (CC_SHELL (window), id, NULL, &error))
+    {
+      g_printerr ("Could not open panel '%s': %s\n", id, error ? error->message : "unknown error");
+      return -1.0;
+    }
+
+  return wait_for_frame (GTK_WIDGET (window), begin);
+}
+
+static void
+activate_cb (GtkApplication *application)
+{
+  g_autoptr(GArray) timings = NULL;
+  CcWindow *window;
+  GList *panels, *l;
+  gdouble total_cold = 0.0;
+  gdouble total_warm = 0.0;
+  gdouble first_frame;
+  gint64 begin;
+  guint i;
+
+  begin = g_get_monotonic_time ();
+  window = cc_window_new (application);
+  gtk_widget_show (GTK_WIDGET (window));
+  first_frame = wait_for_frame (GTK_WIDGET (window), begin);
+
+  timings = g_array_new (FALSE, FALSE, sizeof (PanelTiming));
+  panels = cc_panel_loader_get_panels ();
+
+  for (l = panels; l != NULL; l = l->next)
+    {
+      PanelTiming timing = { l->data, 0.0, 0.0 };
+
+      timing.cold = switch_to_panel (window, timing.id);
+      g_array_append_val (timings, timing);
+    }
+
+  for (i = 0; i < timings->len; i++)
+    {
+      PanelTiming *timing = &g_array_index (timings, PanelTiming, i);
+
+      if (timing->cold < 0.0)
+        continue;
+
+      timing->warm = switch_to_panel (window, timing->id);
+    }
+
+  g_print ("%-20s %10s %10s\n", "panel", "cold (ms)", "warm (ms)");
+  g_print ("%-20s %10.2f\n", "window", first_frame);
+
+  for (i = 0; i < timings->len; i++)
+    {
+      PanelTiming *timing = &g_array_index (timings, PanelTiming, i);
+
+      if (timing->cold < 0.0)
+        {
+          g_print ("%-20s %10s %10s\n", timing->id, "-", "-");
+          continue;
+        }
+
+      g_print ("%-20s %10.2f %10.2f\n", timing->id, timing->cold, timing->warm);
+      total_cold += timing->cold;
+      total_warm += timing->warm;
+    }
+
+  g_print ("%-20s %10.2f %10.2f\n", "total", total_cold, total_warm);
+
+  g_list_free (panels);
+  gtk_widget_destroy (GTK_WIDGET (window));
+}
+
+int
+main (int argc, char **argv)
+{
+  GtkApplication *application;
+  int status;
+
+  cc_shell_profile_init ();
+
+  application = gtk_application_new ("org.gnome.ControlCenter.Benchmark",
+                                     G_APPLICATION_NON_UNIQUE);
+  g_signal_connect (application, "activate", G_CALLBACK (activate_cb), NULL);
+
+  status = g_application_run (G_APPLICATION (application), argc, argv);
+
+  g_object_unref (application);
+  cc_shell_profile_shutdown ();
+
+  return status;
+}
@@ -28,6 +28,7 @@
 #include "cc-application.h"
 #include "cc-panel-loader.h"
 #include "cc-shell-log.h"
+#include "cc-shell-profile.h"
 #include "cc-window.h"
 
 #if defined(HAVE_WACOM)
@@ -47,6 +48,7 @@ const GOptionEntry all_options[] = {
   { "overview", 'o', 0, G_OPTION_ARG_NONE, NULL, N_("Show the overview"), NULL },
   { "search", 's', 0, G_OPTION_ARG_STRING, NULL, N_("Search for the string"), "SEARCH" },
   { "list", 'l', 0, G_OPTION_ARG_NONE, NULL, N_("List possible panel names and exit"), NULL },
+  { "profile", 0, 0, G_OPTION_ARG_NONE, NULL, N_("Print the time spent in each startup phase"), NULL },
   { G_OPTION_REMAINING, '\0', 0, G_OPTION_ARG_FILENAME_ARRAY, NULL, N_("Panel to display"), N_("[PANEL] [ARGUMENT…]") },
   { NULL, 0, 0, 0, NULL, NULL, NULL } /* end the list */
 };
@@ -98,6 +100,10 @@ launch_panel_activated (GSimpleAction *action,
 static gint
 cc_application_handle_local_options (GApplication *application, GVariantDict *options)
 {
+  /* Handled here, before the startup phases being measured */
+  if (g_variant_dict_contains (options, "profile"))
+    cc_shell_profile_enable ();
+
   if (g_variant_dict_contains (options, "version"))
     {
       g_print ("%s %s\n", PACKAGE, VERSION);
@@ -215,8 +221,11 @@ cc_application_startup (GApplication *application)
   GMenu *section;
   GSimpleAction *action;
   const gchar *help_accels[] = { "F1", NULL };
+  gint64 begin;
 
+  begin = cc_shell_profile_begin ();
   G_APPLICATION_CLASS (cc_application_parent_class)->startup (application);
+  cc_shell_profile_end (begin, "gtk-startup", NULL);
 
 #if defined(HAVE_WACOM)
   if (gtk_clutter_init (NULL, NULL) != CLUTTER_INIT_SUCCESS)
@@ -260,7 +269,9 @@ cc_application_startup (GApplication *application)
   gtk_application_set_accels_for_action (GTK_APPLICATION (application),
                                          "app.help", help_accels);
 
+  begin = cc_shell_profile_begin ();
   self->priv->window = cc_window_new (GTK_APPLICATION (application));
+  cc_shell_profile_end (begin, "window-construct", NULL);
 }
 
 static GObject *
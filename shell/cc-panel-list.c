@@ -28,6 +28,7 @@ typedef struct
   CcPanelCategory  category;
   gchar           *id;
   gchar           *name;
+  gchar           *casefolded_name;
   gchar           *description;
 } RowData;
 
@@ -51,6 +52,13 @@ struct _CcPanelList
   GtkWidget          *empty_search_placeholder;
 
   gchar              *search_query;
+  gchar              *casefolded_search_query;
+
+  /* Panels matching the current search query, one bit per
+   * panel of the search index.
+   */
+  CcShellSearchIndex *search_index;
+  guint64            *search_matches;
 
   CcPanelListView     previous_view;
   CcPanelListView     view;
@@ -119,6 +127,30 @@ get_view_from_listbox (CcPanelList *self,
   return CC_PANEL_LIST_SEARCH;
 }
 
+static void
+update_search_matches (CcPanelList *self)
+{
+  g_clear_pointer (&self->casefolded_search_query, g_free);
+
+  if (!self->search_query)
+    return;
+
+  self->casefolded_search_query = cc_util_normalize_casefold_and_unaccent (self->search_query);
+  g_strstrip (self->casefolded_search_query);
+
+  if (!self->search_index)
+    return;
+
+  self->search_matches = g_renew (guint64,
+                                  self->search_matches,
+                                  cc_shell_search_index_get_n_words (self->search_index));
+
+  cc_shell_search_index_match_term (self->search_index,
+                                    self->casefolded_search_query,
+                                    CC_SHELL_SEARCH_FIELD_NAME | CC_SHELL_SEARCH_FIELD_DESCRIPTION,
+                                    self->search_matches);
+}
+
 static void
 update_search (CcPanelList *self)
 {
@@ -149,6 +181,7 @@ static void
 row_data_free (RowData *data)
 {
   g_free (data->description);
+  g_free (data->casefolded_name);
   g_free (data->name);
   g_free (data->id);
   g_free (data);
@@ -169,8 +202,11 @@ row_data_new (CcPanelCategory  category,
   data->row = gtk_list_box_row_new ();
   data->id = g_strdup (id);
   data->name = g_strdup (name);
+  data->casefolded_name = cc_util_normalize_casefold_and_unaccent (name);
   data->description = g_strdup (description);
 
+  g_strstrip (data->casefolded_name);
+
   /* Setup the row */
   grid = g_object_new (GTK_TYPE_GRID,
                        "visible", TRUE,
@@ -228,8 +264,7 @@ filter_func (GtkListBoxRow *row,
 {
   CcPanelList *self;
   RowData *data;
-  gchar *search_text, *panel_text, *panel_description;
-  gboolean retval;
+  gint search_index;
 
   self = CC_PANEL_LIST (user_data);
   data = g_object_get_data (G_OBJECT (row), "data");
@@ -237,28 +272,19 @@ filter_func (GtkListBoxRow *row,
   if (!self->search_query)
     return TRUE;
 
-  panel_text = cc_util_normalize_casefold_and_unaccent (data->name);
-  search_text = cc_util_normalize_casefold_and_unaccent (self->search_query);
-  panel_description = cc_util_normalize_casefold_and_unaccent (data->description);
-
-  g_strstrip (panel_text);
-  g_strstrip (search_text);
-  g_strstrip (panel_description);
-
   /*
    * The description label is only visible when the search is
    * happening.
    */
   gtk_widget_set_visible (data->description_label, self->view == CC_PANEL_LIST_SEARCH);
 
-  retval = g_strstr_len (panel_text, -1, search_text) != NULL ||
-           g_strstr_len (panel_description, -1, search_text) != NULL;
+  if (!self->search_index || !self->search_matches)
+    return FALSE;
 
-  g_free (panel_text);
-  g_free (search_text);
-  g_free (panel_description);
+  search_index = cc_shell_search_index_lookup (self->search_index, data->id);
 
-  return retval;
+  return search_index >= 0 &&
+         CC_SHELL_SEARCH_INDEX_TEST_BIT (self->search_matches, search_index);
 }
 
 static const gchar * const panel_order[] = {
@@ -349,52 +375,31 @@ search_sort_function (GtkListBoxRow *a,
 {
   CcPanelList *self;
   RowData *a_data, *b_data;
-  gchar *a_name, *b_name, *search, *a_strstr, *b_strstr;
+  const gchar *search, *a_strstr, *b_strstr;
   gint a_distance, b_distance;
-  gint retval;
 
   self = CC_PANEL_LIST (user_data);
-  search = NULL;
   a_data = g_object_get_data (G_OBJECT (a), "data");
   b_data = g_object_get_data (G_OBJECT (b), "data");
 
   a_distance = b_distance = G_MAXINT;
 
-  a_name = cc_util_normalize_casefold_and_unaccent (a_data->name);
-  b_name = cc_util_normalize_casefold_and_unaccent (b_data->name);
-  g_strstrip (a_name);
-  g_strstrip (b_name);
-
-  if (self->search_query)
-    {
-      search = cc_util_normalize_casefold_and_unaccent (self->search_query);
-      g_strstrip (search);
-    }
+  search = self->casefolded_search_query;
 
   /* Default result for empty search */
-  if (!search || g_utf8_strlen (search, -1) == 0)
-    {
-      retval = g_strcmp0 (a_name, b_name);
-      goto out;
-    }
+  if (!search || *search == '\0')
+    return g_strcmp0 (a_data->casefolded_name, b_data->casefolded_name);
 
-  a_strstr = g_strstr_len (a_name, -1, search);
-  b_strstr = g_strstr_len (b_name, -1, search);
+  a_strstr = g_strstr_len (a_data->casefolded_name, -1, search);
+  b_strstr = g_strstr_len (b_data->casefolded_name, -1, search);
 
   if (a_strstr)
-    a_distance = g_strstr_len (a_name, -1, search) - a_name;
+    a_distance = a_strstr - a_data->casefolded_name;
 
   if (b_strstr)
-    b_distance = g_strstr_len (b_name, -1, search) - b_name;
-
-  retval = a_distance - b_distance;
+    b_distance = b_strstr - b_data->casefolded_name;
 
-out:
-  g_free (a_name);
-  g_free (b_name);
-  g_free (search);
-
-  return retval;
+  return a_distance - b_distance;
 }
 
 static void
@@ -569,6 +574,8 @@ cc_panel_list_finalize (GObject *object)
   CcPanelList *self = (CcPanelList *)object;
 
   g_clear_pointer (&self->search_query, g_free);
+  g_clear_pointer (&self->casefolded_search_query, g_free);
+  g_clear_pointer (&self->search_matches, g_free);
   g_clear_pointer (&self->id_to_data, g_hash_table_destroy);
 
   G_OBJECT_CLASS (cc_panel_list_parent_class)->finalize (object);
@@ -796,6 +803,7 @@ cc_panel_list_set_search_query (CcPanelList *self,
       g_clear_pointer (&self->search_query, g_free);
       self->search_query = g_strdup (search);
 
+      update_search_matches (self);
       update_search (self);
 
       g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_SEARCH_QUERY]);
@@ -893,6 +901,26 @@ cc_panel_list_add_panel (CcPanelList     *self,
   g_hash_table_insert (self->id_to_data, data->id, data);
 }
 
+/**
+ * cc_panel_list_set_search_index:
+ * @self: a #CcPanelList
+ * @search_index: (nullable): the #CcShellSearchIndex of the panels
+ *
+ * Sets the index used to filter the search results. The index must
+ * outlive @self.
+ */
+void
+cc_panel_list_set_search_index (CcPanelList        *self,
+                                CcShellSearchIndex *search_index)
+{
+  g_return_if_fail (CC_IS_PANEL_LIST (self));
+
+  self->search_index = search_index;
+
+  update_search_matches (self);
+  gtk_list_box_invalidate_filter (GTK_LIST_BOX (self->search_listbox));
+}
+
 /**
  * cc_panel_list_set_active_panel:
  * @self: a #CcPanelList
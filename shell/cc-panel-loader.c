@@ -25,6 +25,9 @@
 #include <gio/gdesktopappinfo.h>
 
 #include "cc-panel-loader.h"
+#include "cc-cache-file.h"
+#include "cc-shell-profile.h"
+#include "cc-util.h"
 
 #ifndef CC_PANEL_LOADER_NO_GTYPES
 
@@ -172,11 +175,177 @@ parse_categories (GDesktopAppInfo *app)
   return retval;
 }
 
+/* The metadata of the visible panels is cached, so that starting up does
+ * not require loading and parsing every panel's desktop file and then
+ * normalizing its strings. Each entry holds the panel name, desktop id,
+ * category, display name, description, serialized icon and the casefolded
+ * name, description and keywords.
+ */
+#define PANEL_CACHE_VERSION 1
+#define PANEL_CACHE_ENTRY   "(ssussmvssas)"
+
+#ifdef CC_ENABLE_ALT_CATEGORIES
+#define PANEL_CACHE_NAME "panels-alt.cache"
+#else
+#define PANEL_CACHE_NAME "panels.cache"
+#endif
+
+/* Everything the cached entries depend on, besides the desktop files */
+static gchar *
+get_cache_stamp (void)
+{
+  g_autofree gchar *languages = NULL;
+  g_autofree gchar *data_dirs = NULL;
+  GString *panels;
+  gchar *stamp;
+  guint i;
+
+  languages = g_strjoinv (":", (gchar **) g_get_language_names ());
+  data_dirs = g_strjoinv (":", (gchar **) g_get_system_data_dirs ());
+
+  panels = g_string_new (NULL);
+  for (i = 0; i < G_N_ELEMENTS (all_panels); i++)
+    g_string_append_printf (panels, "%s,", all_panels[i].name);
+
+  stamp = g_strdup_printf ("%d;%s;%s;%s;%s;%s;%s",
+                           PANEL_CACHE_VERSION,
+                           PACKAGE_VERSION,
+                           languages,
+                           g_getenv ("XDG_CURRENT_DESKTOP") ? g_getenv ("XDG_CURRENT_DESKTOP") : "",
+                           g_get_user_data_dir (),
+                           data_dirs,
+                           panels->str);
+
+  g_string_free (panels, TRUE);
+
+  return stamp;
+}
+
+/* Desktop files being added or removed change the mtime of these */
+static void
+add_application_dirs (GPtrArray *watched_paths)
+{
+  const gchar * const *data_dirs;
+  guint i;
+
+  g_ptr_array_add (watched_paths, g_build_filename (g_get_user_data_dir (), "applications", NULL));
+
+  data_dirs = g_get_system_data_dirs ();
+  for (i = 0; data_dirs[i]; i++)
+    g_ptr_array_add (watched_paths, g_build_filename (data_dirs[i], "applications", NULL));
+}
+
+static GVariant *
+panel_entry_new (const gchar     *name,
+                 GDesktopAppInfo *app,
+                 CcPanelCategory  category)
+{
+  g_autofree gchar *casefolded_name = NULL;
+  g_autofree gchar *casefolded_description = NULL;
+  g_autoptr(GVariant) icon = NULL;
+  const gchar * const *keywords;
+  const gchar *description;
+  GVariantBuilder builder;
+  guint i;
+
+  description = g_app_info_get_description (G_APP_INFO (app));
+  casefolded_name = cc_util_normalize_casefold_and_unaccent (g_app_info_get_name (G_APP_INFO (app)));
+  casefolded_description = cc_util_normalize_casefold_and_unaccent (description);
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE_STRING_ARRAY);
+  keywords = g_desktop_app_info_get_keywords (app);
+  for (i = 0; keywords && keywords[i]; i++)
+    {
+      g_autofree gchar *keyword = cc_util_normalize_casefold_and_unaccent (keywords[i]);
+      g_variant_builder_add (&builder, "s", keyword);
+    }
+
+  if (g_app_info_get_icon (G_APP_INFO (app)))
+    icon = g_icon_serialize (g_app_info_get_icon (G_APP_INFO (app)));
+
+  return g_variant_new (PANEL_CACHE_ENTRY,
+                        name,
+                        g_app_info_get_id (G_APP_INFO (app)),
+                        category,
+                        g_app_info_get_name (G_APP_INFO (app)),
+                        description ? description : "",
+                        icon,
+                        casefolded_name,
+                        casefolded_description ? casefolded_description : "",
+                        &builder);
+}
+
+static void
+add_panel_entry (CcShellModel *model,
+                 GVariant     *entry)
+{
+  g_autoptr(GVariant) icon_variant = NULL;
+  g_autoptr(GIcon) icon = NULL;
+  g_autofree const gchar **keywords = NULL;
+  const gchar *name, *desktop_id, *display_name, *description;
+  const gchar *casefolded_name, *casefolded_description;
+  guint32 category;
+
+  g_variant_get (entry, "(&s&su&s&smv&s&s^a&s)",
+                 &name,
+                 &desktop_id,
+                 &category,
+                 &display_name,
+                 &description,
+                 &icon_variant,
+                 &casefolded_name,
+                 &casefolded_description,
+                 &keywords);
+
+  if (icon_variant)
+    icon = g_icon_deserialize (icon_variant);
+
+  cc_shell_model_add_panel (model,
+                            category,
+                            name,
+                            desktop_id,
+                            display_name,
+                            *description ? description : NULL,
+                            icon,
+                            casefolded_name,
+                            *casefolded_description ? casefolded_description : NULL,
+                            keywords);
+}
+
 void
 cc_panel_loader_fill_model (CcShellModel *model)
 {
+  g_autoptr(GVariant) cache = NULL;
+  g_autoptr(GPtrArray) watched_paths = NULL;
+  g_autofree gchar *stamp = NULL;
+  GVariantBuilder builder;
+  GVariantIter iter;
+  GVariant *entry;
+  gint64 begin;
   guint i;
 
+  begin = cc_shell_profile_begin ();
+  stamp = get_cache_stamp ();
+
+  cache = cc_cache_file_load (PANEL_CACHE_NAME, stamp, G_VARIANT_TYPE ("a" PANEL_CACHE_ENTRY));
+  if (cache)
+    {
+      g_variant_iter_init (&iter, cache);
+      while ((entry = g_variant_iter_next_value (&iter)))
+        {
+          add_panel_entry (model, entry);
+          g_variant_unref (entry);
+        }
+
+      cc_shell_profile_end (begin, "model-fill", "cached");
+      return;
+    }
+
+  watched_paths = g_ptr_array_new_with_free_func (g_free);
+  add_application_dirs (watched_paths);
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a" PANEL_CACHE_ENTRY));
+
   for (i = 0; i < G_N_ELEMENTS (all_panels); i++)
     {
       g_autoptr (GDesktopAppInfo) app;
@@ -193,6 +362,8 @@ cc_panel_loader_fill_model (CcShellModel *model)
           continue;
         }
 
+      g_ptr_array_add (watched_paths, g_strdup (g_desktop_app_info_get_filename (app)));
+
       category = parse_categories (app);
       if (G_UNLIKELY (category < 0))
         continue;
@@ -205,8 +376,24 @@ cc_panel_loader_fill_model (CcShellModel *model)
        * that are only visible in the new Shell.
        */
       if (category != CC_CATEGORY_HIDDEN)
-        cc_shell_model_add_item (model, category, G_APP_INFO (app), all_panels[i].name);
+        {
+          entry = g_variant_ref_sink (panel_entry_new (all_panels[i].name, app, category));
+
+          add_panel_entry (model, entry);
+          g_variant_builder_add_value (&builder, entry);
+
+          g_variant_unref (entry);
+        }
     }
+
+  g_ptr_array_add (watched_paths, NULL);
+
+  cc_cache_file_save (PANEL_CACHE_NAME,
+                      stamp,
+                      (const gchar * const *) watched_paths->pdata,
+                      g_variant_builder_end (&builder));
+
+  cc_shell_profile_end (begin, "model-fill", "desktop files");
 }
 
 #ifndef CC_PANEL_LOADER_NO_GTYPES
@@ -232,16 +419,30 @@ cc_panel_loader_load_by_name (CcShell     *shell,
                               GVariant    *parameters)
 {
   GType (*get_type) (void);
+  GType panel_type;
+  CcPanel *panel;
+  gint64 begin;
 
   ensure_panel_types ();
 
   get_type = g_hash_table_lookup (panel_types, name);
   g_return_val_if_fail (get_type != NULL, NULL);
 
-  return g_object_new (get_type (),
-                       "shell", shell,
-                       "parameters", parameters,
-                       NULL);
+  /* Registering the type also runs the class_init, which usually
+   * loads the panel's resources and binds its template.
+   */
+  begin = cc_shell_profile_begin ();
+  panel_type = get_type ();
+  cc_shell_profile_end (begin, "panel-type", name);
+
+  begin = cc_shell_profile_begin ();
+  panel = g_object_new (panel_type,
+                        "shell", shell,
+                        "parameters", parameters,
+                        NULL);
+  cc_shell_profile_end (begin, "panel-construct", name);
+
+  return panel;
 }
 
 #endif /* CC_PANEL_LOADER_NO_GTYPES */
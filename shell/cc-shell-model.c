@@ -33,6 +33,8 @@
 struct _CcShellModelPrivate
 {
   gchar **sort_terms;
+
+  CcShellSearchIndex *search_index;
 };
 
 G_DEFINE_TYPE_WITH_PRIVATE (CcShellModel, cc_shell_model, GTK_TYPE_LIST_STORE)
@@ -238,6 +240,7 @@ cc_shell_model_finalize (GObject *object)
   CcShellModelPrivate *priv = CC_SHELL_MODEL (object)->priv;;
 
   g_strfreev (priv->sort_terms);
+  cc_shell_search_index_free (priv->search_index);
 
   G_OBJECT_CLASS (cc_shell_model_parent_class)->finalize (object);
 }
@@ -254,10 +257,12 @@ cc_shell_model_class_init (CcShellModelClass *klass)
 static void
 cc_shell_model_init (CcShellModel *self)
 {
-  GType types[] = {G_TYPE_STRING, G_TYPE_STRING, G_TYPE_APP_INFO, G_TYPE_STRING,
-                   G_TYPE_UINT, G_TYPE_STRING, G_TYPE_STRING, G_TYPE_ICON, G_TYPE_STRV};
+  GType types[] = {G_TYPE_STRING, G_TYPE_STRING, G_TYPE_STRING, G_TYPE_STRING,
+                   G_TYPE_UINT, G_TYPE_STRING, G_TYPE_STRING, G_TYPE_ICON, G_TYPE_STRV,
+                   G_TYPE_INT};
 
   self->priv = cc_shell_model_get_instance_private (self);
+  self->priv->search_index = cc_shell_search_index_new ();
 
   gtk_list_store_set_column_types (GTK_LIST_STORE (self),
                                    N_COLS, types);
@@ -310,21 +315,70 @@ cc_shell_model_add_item (CcShellModel    *model,
   casefolded_description = cc_util_normalize_casefold_and_unaccent (comment);
   keywords = get_casefolded_keywords (appinfo);
 
+  cc_shell_model_add_panel (model,
+                            category,
+                            id,
+                            g_app_info_get_id (appinfo),
+                            name,
+                            comment,
+                            icon,
+                            casefolded_name,
+                            casefolded_description,
+                            (const char * const *) keywords);
+
+  g_free (casefolded_name);
+  g_free (casefolded_description);
+  g_strfreev (keywords);
+}
+
+/**
+ * cc_shell_model_add_panel:
+ * @model: a #CcShellModel
+ * @category: the category of the panel
+ * @id: the id of the panel
+ * @desktop_id: the id of the panel's desktop file
+ * @name: the name of the panel
+ * @description: (nullable): the description of the panel
+ * @icon: (nullable): the icon of the panel
+ * @casefolded_name: @name, normalized with cc_util_normalize_casefold_and_unaccent()
+ * @casefolded_description: (nullable): @description, normalized likewise
+ * @casefolded_keywords: (nullable): the normalized keywords of the panel
+ *
+ * Adds a panel whose strings were already normalized, e.g. because they
+ * come from a cache, so no desktop file has to be loaded.
+ */
+void
+cc_shell_model_add_panel (CcShellModel       *model,
+                          CcPanelCategory     category,
+                          const char         *id,
+                          const char         *desktop_id,
+                          const char         *name,
+                          const char         *description,
+                          GIcon              *icon,
+                          const char         *casefolded_name,
+                          const char         *casefolded_description,
+                          const char * const *casefolded_keywords)
+{
+  gint search_index;
+
+  search_index = cc_shell_search_index_add_panel (model->priv->search_index,
+                                                  id,
+                                                  casefolded_name,
+                                                  casefolded_description,
+                                                  casefolded_keywords);
+
   gtk_list_store_insert_with_values (GTK_LIST_STORE (model), NULL, 0,
                                      COL_NAME, name,
                                      COL_CASEFOLDED_NAME, casefolded_name,
-                                     COL_APP, appinfo,
+                                     COL_DESKTOP_ID, desktop_id,
                                      COL_ID, id,
                                      COL_CATEGORY, category,
-                                     COL_DESCRIPTION, comment,
+                                     COL_DESCRIPTION, description,
                                      COL_CASEFOLDED_DESCRIPTION, casefolded_description,
                                      COL_GICON, icon,
-                                     COL_KEYWORDS, keywords,
+                                     COL_KEYWORDS, casefolded_keywords,
+                                     COL_SEARCH_INDEX, search_index,
                                      -1);
-
-  g_free (casefolded_name);
-  g_free (casefolded_description);
-  g_strfreev (keywords);
 }
 
 gboolean
@@ -332,34 +386,19 @@ cc_shell_model_iter_matches_search (CcShellModel *model,
                                     GtkTreeIter  *iter,
                                     const char   *term)
 {
-  gchar *name, *description;
-  gboolean result;
-  gchar **keywords;
+  gint search_index;
 
   gtk_tree_model_get (GTK_TREE_MODEL (model), iter,
-                      COL_CASEFOLDED_NAME, &name,
-                      COL_CASEFOLDED_DESCRIPTION, &description,
-                      COL_KEYWORDS, &keywords,
+                      COL_SEARCH_INDEX, &search_index,
                       -1);
 
-  result = (strstr (name, term) != NULL);
-
-  if (!result && description)
-    result = (strstr (description, term) != NULL);
-
-  if (!result && keywords)
-    {
-      gint i;
-
-      for (i = 0; !result && keywords[i]; i++)
-        result = (strstr (keywords[i], term) == keywords[i]);
-    }
-
-  g_free (name);
-  g_free (description);
-  g_strfreev (keywords);
+  if (search_index < 0)
+    return FALSE;
 
-  return result;
+  return cc_shell_search_index_panel_matches (model->priv->search_index,
+                                              search_index,
+                                              term,
+                                              CC_SHELL_SEARCH_FIELD_ALL);
 }
 
 void
@@ -376,3 +415,20 @@ cc_shell_model_set_sort_terms (CcShellModel  *self,
                                            cc_shell_model_sort_func,
                                            self, NULL);
 }
+
+/**
+ * cc_shell_model_get_search_index:
+ * @model: a #CcShellModel
+ *
+ * Returns the search index built from the panels added to @model. The
+ * index of each row is stored in the %COL_SEARCH_INDEX column.
+ *
+ * Returns: (transfer none): the #CcShellSearchIndex of @model
+ */
+CcShellSearchIndex *
+cc_shell_model_get_search_index (CcShellModel *model)
+{
+  g_return_val_if_fail (CC_IS_SHELL_MODEL (model), NULL);
+
+  return model->priv->search_index;
+}
@@ -24,6 +24,8 @@
 
 #include <gtk/gtk.h>
 
+#include "cc-shell-search-index.h"
+
 G_BEGIN_DECLS
 
 #define CC_TYPE_SHELL_MODEL cc_shell_model_get_type()
@@ -74,13 +76,14 @@ enum
 {
   COL_NAME,
   COL_CASEFOLDED_NAME,
-  COL_APP,
+  COL_DESKTOP_ID,
   COL_ID,
   COL_CATEGORY,
   COL_DESCRIPTION,
   COL_CASEFOLDED_DESCRIPTION,
   COL_GICON,
   COL_KEYWORDS,
+  COL_SEARCH_INDEX,
 
   N_COLS
 };
@@ -106,6 +109,17 @@ void cc_shell_model_add_item (CcShellModel   *model,
                               GAppInfo       *appinfo,
                               const char     *id);
 
+void cc_shell_model_add_panel (CcShellModel       *model,
+                               CcPanelCategory     category,
+                               const char         *id,
+                               const char         *desktop_id,
+                               const char         *name,
+                               const char         *description,
+                               GIcon              *icon,
+                               const char         *casefolded_name,
+                               const char         *casefolded_description,
+                               const char * const *casefolded_keywords);
+
 gboolean cc_shell_model_iter_matches_search (CcShellModel *model,
                                              GtkTreeIter  *iter,
                                              const char   *term);
@@ -113,6 +127,8 @@ gboolean cc_shell_model_iter_matches_search (CcShellModel *model,
 void cc_shell_model_set_sort_terms (CcShellModel  *model,
                                     gchar        **terms);
 
+CcShellSearchIndex *cc_shell_model_get_search_index (CcShellModel *model);
+
 G_END_DECLS
 
 #endif /* _CC_SHELL_MODEL_H */
@@ -0,0 +1,236 @@
+/*
+ * Copyright (c) 2017 The GNOME Foundation
+ *
+ * The Control Center is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * The Control Center is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with the Control Center; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <unistd.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "cc-shell-profile.h"
+
+/* Startup phase tracing.
+ *
+ * Enabled with --profile or by setting GNOME_CONTROL_CENTER_PROFILE in the
+ * environment. Every phase is printed to stderr with its start time
+ * relative to main() and its duration, all from the monotonic clock. When
+ * GNOME_CONTROL_CENTER_PROFILE is set to a file name, the phases are also
+ * written there in the Trace Event format once the first frame is drawn,
+ * which can be loaded in chrome://tracing or Perfetto.
+ *
+ * When disabled, every call returns right away.
+ */
+
+typedef struct
+{
+  const gchar *phase;
+  gchar       *detail;
+  gint64       begin;
+  gint64       end;
+} ProfileEvent;
+
+static gboolean enabled;
+static gint64 start_time;
+static gchar *trace_path;
+static GArray *events;
+
+static void
+ensure_initialized (void)
+{
+  if (G_LIKELY (start_time != 0))
+    return;
+
+  start_time = g_get_monotonic_time ();
+}
+
+void
+cc_shell_profile_init (void)
+{
+  const gchar *env;
+
+  ensure_initialized ();
+
+  env = g_getenv ("GNOME_CONTROL_CENTER_PROFILE");
+  if (env == NULL || *env == '\0')
+    return;
+
+  /* Any value enables profiling, file names also get a trace */
+  if (strchr (env, G_DIR_SEPARATOR) != NULL || g_str_has_suffix (env, ".json"))
+    trace_path = g_strdup (env);
+
+  cc_shell_profile_enable ();
+}
+
+void
+cc_shell_profile_enable (void)
+{
+  ensure_initialized ();
+
+  if (enabled)
+    return;
+
+  enabled = TRUE;
+  events = g_array_new (FALSE, FALSE, sizeof (ProfileEvent));
+}
+
+gboolean
+cc_shell_profile_is_enabled (void)
+{
+  return enabled;
+}
+
+/**
+ * cc_shell_profile_begin:
+ *
+ * Returns: the start time of a phase to pass to cc_shell_profile_end()
+ */
+gint64
+cc_shell_profile_begin (void)
+{
+  if (!enabled)
+    return 0;
+
+  return g_get_monotonic_time ();
+}
+
+/**
+ * cc_shell_profile_end:
+ * @begin: the value returned by cc_shell_profile_begin()
+ * @phase: a static string naming the phase
+ * @detail: (nullable): e.g. the name of the panel
+ *
+ * Records a phase which started at @begin and ends now.
+ */
+void
+cc_shell_profile_end (gint64       begin,
+                      const gchar *phase,
+                      const gchar *detail)
+{
+  ProfileEvent event;
+
+  if (!enabled)
+    return;
+
+  event.phase = phase;
+  event.detail = g_strdup (detail);
+  event.begin = begin;
+  event.end = g_get_monotonic_time ();
+
+  g_array_append_val (events, event);
+
+  g_printerr ("gnome-control-center: profile: %9.3f ms %-18s %9.3f ms %s\n",
+              (event.begin - start_time) / 1000.0,
+              phase,
+              (event.end - event.begin) / 1000.0,
+              detail ? detail : "");
+}
+
+/**
+ * cc_shell_profile_mark:
+ * @phase: a static string naming the mark
+ * @detail: (nullable): additional information
+ *
+ * Records an instant, like the first frame being drawn.
+ */
+void
+cc_shell_profile_mark (const gchar *phase,
+                       const gchar *detail)
+{
+  if (!enabled)
+    return;
+
+  cc_shell_profile_end (g_get_monotonic_time (), phase, detail);
+}
+
+static void
+write_trace (void)
+{
+  g_autoptr(GError) error = NULL;
+  GString *trace;
+  guint i;
+
+  trace = g_string_new ("{\"traceEvents\":[\n");
+
+  for (i = 0; i < events->len; i++)
+    {
+      ProfileEvent *event = &g_array_index (events, ProfileEvent, i);
+      g_autofree gchar *detail = NULL;
+
+      detail = g_strescape (event->detail ? event->detail : "", NULL);
+
+      g_string_append_printf (trace,
+                              "%s{\"name\":\"%s\",\"cat\":\"startup\",\"ph\":\"%s\","
+                              "\"ts\":%" G_GINT64_FORMAT ",\"dur\":%" G_GINT64_FORMAT ","
+                              "\"pid\":%d,\"tid\":1,\"args\":{\"detail\":\"%s\"}}",
+                              i > 0 ? ",\n" : "",
+                              event->phase,
+                              event->begin == event->end ? "i" : "X",
+                              event->begin - start_time,
+                              event->end - event->begin,
+                              (int) getpid (),
+                              detail);
+    }
+
+  g_string_append (trace, "\n]}\n");
+
+  if (!g_file_set_contents (trace_path, trace->str, trace->len, &error))
+    g_warning ("Could not write the profile to '%s': %s", trace_path, error->message);
+
+  g_string_free (trace, TRUE);
+}
+
+/**
+ * cc_shell_profile_flush:
+ *
+ * Writes the trace file, if one was requested, and forgets the recorded
+ * phases. Only the first call writes a trace, so that it covers the
+ * startup only.
+ */
+void
+cc_shell_profile_flush (void)
+{
+  guint i;
+
+  if (!enabled || events == NULL)
+    return;
+
+  if (trace_path)
+    write_trace ();
+
+  for (i = 0; i < events->len; i++)
+    g_free (g_array_index (events, ProfileEvent, i).detail);
+  g_array_set_size (events, 0);
+
+  g_clear_pointer (&trace_path, g_free);
+}
+
+/**
+ * cc_shell_profile_shutdown:
+ *
+ * Flushes the profile, and frees the recorded phases.
+ */
+void
+cc_shell_profile_shutdown (void)
+{
+  cc_shell_profile_flush ();
+
+  g_clear_pointer (&events, g_array_unref);
+  enabled = FALSE;
+}
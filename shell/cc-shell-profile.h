@@ -0,0 +1,42 @@
+/*
+ * Copyright (c) 2017 The GNOME Foundation
+ *
+ * The Control Center is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * The Control Center is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with the Control Center; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef __CC_SHELL_PROFILE_H
+#define __CC_SHELL_PROFILE_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+void     cc_shell_profile_init       (void);
+void     cc_shell_profile_enable     (void);
+gboolean cc_shell_profile_is_enabled (void);
+
+gint64   cc_shell_profile_begin      (void);
+void     cc_shell_profile_end        (gint64       begin,
+                                      const gchar *phase,
+                                      const gchar *detail);
+void     cc_shell_profile_mark       (const gchar *phase,
+                                      const gchar *detail);
+
+void     cc_shell_profile_flush      (void);
+void     cc_shell_profile_shutdown   (void);
+
+G_END_DECLS
+
+#endif /* __CC_SHELL_PROFILE_H */
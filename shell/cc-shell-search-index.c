@@ -0,0 +1,556 @@
+/*
+ * Copyright (c) 2017 The GNOME Foundation
+ *
+ * The Control Center is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * The Control Center is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with the Control Center; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <string.h>
+
+#include "cc-shell-search-index.h"
+
+/* The index is a single table of (token, panel) entries sorted by token.
+ * Names and descriptions are matched anywhere, so every suffix of them is
+ * a token; keywords are only matched as prefixes, so they are added once.
+ * All tokens point into strings interned in a GStringChunk, which means
+ * suffixes share storage with their parent string and identical strings
+ * coming from different panels are only stored once.
+ *
+ * A query is then a binary search for the first token >= term followed by
+ * a scan over the tokens which have the term as prefix, setting the bit of
+ * each panel found. No memory is allocated while querying.
+ */
+
+typedef struct
+{
+  const gchar *token;
+  guint16      panel;
+  guint8       field;
+} SearchEntry;
+
+/* What the ranking needs to know about a panel, all interned */
+typedef struct
+{
+  const gchar  *id;
+  const gchar  *name;
+  const gchar **keywords;
+  const gchar **description_words;
+} PanelInfo;
+
+typedef struct
+{
+  guint    panel;
+  guint32  name_matches;          /* bit i set if the name contains term i */
+  gint     keyword_matches;
+  gint     description_matches;   /* -1 if the panel has no description */
+} RankKey;
+
+struct _CcShellSearchIndex
+{
+  GStringChunk *strings;
+  GArray       *entries;
+  GArray       *panels;       /* PanelInfo */
+  GHashTable   *id_to_panel;  /* interned id -> panel + 1 */
+  GArray       *rank_keys;
+  guint64      *scratch;
+  guint         n_words;
+  gboolean      sorted;
+};
+
+#define MAX_PANELS G_MAXUINT16
+
+CcShellSearchIndex *
+cc_shell_search_index_new (void)
+{
+  CcShellSearchIndex *index;
+
+  index = g_new0 (CcShellSearchIndex, 1);
+  index->strings = g_string_chunk_new (4096);
+  index->entries = g_array_new (FALSE, FALSE, sizeof (SearchEntry));
+  index->panels = g_array_new (FALSE, FALSE, sizeof (PanelInfo));
+  index->id_to_panel = g_hash_table_new (g_str_hash, g_str_equal);
+  index->rank_keys = g_array_new (FALSE, FALSE, sizeof (RankKey));
+  index->n_words = 1;
+  index->scratch = g_new0 (guint64, index->n_words);
+  index->sorted = TRUE;
+
+  return index;
+}
+
+void
+cc_shell_search_index_free (CcShellSearchIndex *index)
+{
+  guint i;
+
+  if (index == NULL)
+    return;
+
+  for (i = 0; i < index->panels->len; i++)
+    {
+      PanelInfo *info = &g_array_index (index->panels, PanelInfo, i);
+
+      g_free (info->keywords);
+      g_free (info->description_words);
+    }
+
+  g_string_chunk_free (index->strings);
+  g_array_free (index->entries, TRUE);
+  g_array_free (index->panels, TRUE);
+  g_array_free (index->rank_keys, TRUE);
+  g_hash_table_destroy (index->id_to_panel);
+  g_free (index->scratch);
+  g_free (index);
+}
+
+static void
+add_entry (CcShellSearchIndex *index,
+           const gchar        *token,
+           guint               panel,
+           CcShellSearchField  field)
+{
+  SearchEntry entry;
+
+  entry.token = token;
+  entry.panel = panel;
+  entry.field = field;
+
+  g_array_append_val (index->entries, entry);
+}
+
+static void
+add_suffixes (CcShellSearchIndex *index,
+              const gchar        *str,
+              guint               panel,
+              CcShellSearchField  field)
+{
+  const gchar *p;
+
+  if (str == NULL || *str == '\0')
+    return;
+
+  str = g_string_chunk_insert_const (index->strings, str);
+
+  for (p = str; *p != '\0'; p = g_utf8_next_char (p))
+    add_entry (index, p, panel, field);
+}
+
+static const gchar **
+intern_strv (CcShellSearchIndex  *index,
+             const gchar * const *strv)
+{
+  const gchar **interned;
+  guint i, n;
+
+  n = strv ? g_strv_length ((gchar **) strv) : 0;
+  interned = g_new (const gchar *, n + 1);
+
+  for (i = 0; i < n; i++)
+    interned[i] = g_string_chunk_insert_const (index->strings, strv[i]);
+  interned[n] = NULL;
+
+  return interned;
+}
+
+gint
+cc_shell_search_index_add_panel (CcShellSearchIndex  *index,
+                                 const gchar         *id,
+                                 const gchar         *casefolded_name,
+                                 const gchar         *casefolded_description,
+                                 const gchar * const *casefolded_keywords)
+{
+  const gchar *interned_id;
+  PanelInfo info;
+  guint panel;
+  guint i;
+
+  g_return_val_if_fail (index != NULL, -1);
+  g_return_val_if_fail (id != NULL, -1);
+  g_return_val_if_fail (index->panels->len < MAX_PANELS, -1);
+
+  interned_id = g_string_chunk_insert_const (index->strings, id);
+  if (g_hash_table_contains (index->id_to_panel, interned_id))
+    {
+      g_warning ("Panel '%s' is already in the search index", id);
+      return -1;
+    }
+
+  info.id = interned_id;
+  info.name = casefolded_name ? g_string_chunk_insert_const (index->strings, casefolded_name) : "";
+  info.keywords = intern_strv (index, casefolded_keywords);
+  info.description_words = NULL;
+
+  if (casefolded_description)
+    {
+      gchar **words;
+
+      words = g_strsplit (casefolded_description, " ", -1);
+      info.description_words = intern_strv (index, (const gchar * const *) words);
+      g_strfreev (words);
+    }
+
+  panel = index->panels->len;
+  g_array_append_val (index->panels, info);
+  g_hash_table_insert (index->id_to_panel,
+                       (gpointer) interned_id,
+                       GUINT_TO_POINTER (panel + 1));
+
+  if (index->panels->len > index->n_words * 64)
+    {
+      index->n_words++;
+      index->scratch = g_renew (guint64, index->scratch, index->n_words);
+    }
+
+  add_suffixes (index, casefolded_name, panel, CC_SHELL_SEARCH_FIELD_NAME);
+  add_suffixes (index, casefolded_description, panel, CC_SHELL_SEARCH_FIELD_DESCRIPTION);
+
+  for (i = 0; casefolded_keywords && casefolded_keywords[i]; i++)
+    {
+      const gchar *keyword;
+
+      if (*casefolded_keywords[i] == '\0')
+        continue;
+
+      keyword = g_string_chunk_insert_const (index->strings, casefolded_keywords[i]);
+      add_entry (index, keyword, panel, CC_SHELL_SEARCH_FIELD_KEYWORDS);
+    }
+
+  index->sorted = FALSE;
+
+  return panel;
+}
+
+guint
+cc_shell_search_index_get_n_panels (CcShellSearchIndex *index)
+{
+  g_return_val_if_fail (index != NULL, 0);
+
+  return index->panels->len;
+}
+
+guint
+cc_shell_search_index_get_n_words (CcShellSearchIndex *index)
+{
+  g_return_val_if_fail (index != NULL, 1);
+
+  return index->n_words;
+}
+
+gint
+cc_shell_search_index_lookup (CcShellSearchIndex *index,
+                              const gchar        *id)
+{
+  gpointer value;
+
+  g_return_val_if_fail (index != NULL, -1);
+
+  if (id == NULL)
+    return -1;
+
+  value = g_hash_table_lookup (index->id_to_panel, id);
+
+  return value ? (gint) GPOINTER_TO_UINT (value) - 1 : -1;
+}
+
+const gchar *
+cc_shell_search_index_get_id (CcShellSearchIndex *index,
+                              guint               panel)
+{
+  g_return_val_if_fail (index != NULL, NULL);
+  g_return_val_if_fail (panel < index->panels->len, NULL);
+
+  return g_array_index (index->panels, PanelInfo, panel).id;
+}
+
+static gint
+compare_entries (gconstpointer a,
+                 gconstpointer b)
+{
+  const SearchEntry *entry_a = a;
+  const SearchEntry *entry_b = b;
+  gint rval;
+
+  rval = strcmp (entry_a->token, entry_b->token);
+  if (rval)
+    return rval;
+
+  return (gint) entry_a->panel - (gint) entry_b->panel;
+}
+
+static void
+ensure_sorted (CcShellSearchIndex *index)
+{
+  if (index->sorted)
+    return;
+
+  g_array_sort (index->entries, compare_entries);
+  index->sorted = TRUE;
+}
+
+/* Returns the position of the first entry whose token is >= @term */
+static guint
+lower_bound (CcShellSearchIndex *index,
+             const gchar        *term)
+{
+  guint lo, hi;
+
+  lo = 0;
+  hi = index->entries->len;
+
+  while (lo < hi)
+    {
+      guint mid = lo + (hi - lo) / 2;
+      const SearchEntry *entry = &g_array_index (index->entries, SearchEntry, mid);
+
+      if (strcmp (entry->token, term) < 0)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+
+  return lo;
+}
+
+gboolean
+cc_shell_search_index_match_term (CcShellSearchIndex *index,
+                                  const gchar        *term,
+                                  CcShellSearchField  fields,
+                                  guint64            *bits)
+{
+  gboolean found;
+  gsize term_len;
+  guint i;
+
+  g_return_val_if_fail (index != NULL, FALSE);
+  g_return_val_if_fail (term != NULL, FALSE);
+  g_return_val_if_fail (bits != NULL, FALSE);
+
+  ensure_sorted (index);
+
+  memset (bits, 0, index->n_words * sizeof (guint64));
+
+  found = FALSE;
+  term_len = strlen (term);
+
+  for (i = lower_bound (index, term); i < index->entries->len; i++)
+    {
+      const SearchEntry *entry = &g_array_index (index->entries, SearchEntry, i);
+
+      if (strncmp (entry->token, term, term_len) != 0)
+        break;
+
+      if ((entry->field & fields) == 0)
+        continue;
+
+      bits[entry->panel / 64] |= G_GUINT64_CONSTANT (1) << (entry->panel % 64);
+      found = TRUE;
+    }
+
+  return found;
+}
+
+/**
+ * cc_shell_search_index_match_terms:
+ * @index: a #CcShellSearchIndex
+ * @terms: a %NULL-terminated array of casefolded terms
+ * @fields: the fields to look the terms up in
+ * @bits: return location for the panels matching every term
+ *
+ * Computes the set of panels matching all of @terms. An empty @terms
+ * array matches every panel.
+ *
+ * Returns: %TRUE if at least one panel matched.
+ */
+gboolean
+cc_shell_search_index_match_terms (CcShellSearchIndex  *index,
+                                   gchar              **terms,
+                                   CcShellSearchField   fields,
+                                   guint64             *bits)
+{
+  gboolean found;
+  guint i, w;
+
+  g_return_val_if_fail (index != NULL, FALSE);
+  g_return_val_if_fail (bits != NULL, FALSE);
+
+  if (terms == NULL || terms[0] == NULL)
+    {
+      guint n_panels = index->panels->len;
+
+      memset (bits, 0, index->n_words * sizeof (guint64));
+      for (i = 0; i < n_panels; i++)
+        bits[i / 64] |= G_GUINT64_CONSTANT (1) << (i % 64);
+
+      return n_panels > 0;
+    }
+
+  found = cc_shell_search_index_match_term (index, terms[0], fields, bits);
+
+  for (i = 1; found && terms[i]; i++)
+    {
+      cc_shell_search_index_match_term (index, terms[i], fields, index->scratch);
+
+      found = FALSE;
+      for (w = 0; w < index->n_words; w++)
+        {
+          bits[w] &= index->scratch[w];
+          found = found || bits[w] != 0;
+        }
+    }
+
+  return found;
+}
+
+gboolean
+cc_shell_search_index_panel_matches (CcShellSearchIndex *index,
+                                     guint               panel,
+                                     const gchar        *term,
+                                     CcShellSearchField  fields)
+{
+  gsize term_len;
+  guint i;
+
+  g_return_val_if_fail (index != NULL, FALSE);
+  g_return_val_if_fail (term != NULL, FALSE);
+
+  ensure_sorted (index);
+
+  term_len = strlen (term);
+
+  for (i = lower_bound (index, term); i < index->entries->len; i++)
+    {
+      const SearchEntry *entry = &g_array_index (index->entries, SearchEntry, i);
+
+      if (strncmp (entry->token, term, term_len) != 0)
+        break;
+
+      if (entry->panel == panel && (entry->field & fields) != 0)
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
+static gint
+count_matches (const gchar **words,
+               gchar       **terms)
+{
+  gint i, j, c;
+
+  if (!words)
+    return 0;
+
+  c = 0;
+
+  for (i = 0; terms[i]; ++i)
+    for (j = 0; words[j]; ++j)
+      if (strstr (words[j], terms[i]))
+        c += 1;
+
+  return c;
+}
+
+static gint
+compare_rank_keys (gconstpointer a,
+                   gconstpointer b,
+                   gpointer      user_data)
+{
+  CcShellSearchIndex *index = user_data;
+  const RankKey *key_a = a;
+  const RankKey *key_b = b;
+  guint32 name_diff;
+
+  /* The first term found in only one of the names wins */
+  name_diff = key_a->name_matches ^ key_b->name_matches;
+  if (name_diff)
+    {
+      guint32 first = name_diff & -name_diff;
+
+      return (key_a->name_matches & first) ? -1 : 1;
+    }
+
+  if (key_a->keyword_matches != key_b->keyword_matches)
+    return key_a->keyword_matches > key_b->keyword_matches ? -1 : 1;
+
+  if (key_a->description_matches != key_b->description_matches)
+    return key_a->description_matches > key_b->description_matches ? -1 : 1;
+
+  return g_strcmp0 (g_array_index (index->panels, PanelInfo, key_a->panel).name,
+                    g_array_index (index->panels, PanelInfo, key_b->panel).name);
+}
+
+/**
+ * cc_shell_search_index_sort:
+ * @index: a #CcShellSearchIndex
+ * @panels: (array length=n_panels): panels of @index to sort
+ * @n_panels: the number of panels
+ * @terms: (nullable): a %NULL-terminated array of casefolded terms
+ *
+ * Sorts @panels in place by relevance for @terms: panels whose name
+ * contains the terms come first, then the ones with the most matching
+ * keywords and description words, and finally they are sorted by name.
+ * This is the order #CcShellModel uses for its sort terms, computed
+ * without touching the model.
+ */
+void
+cc_shell_search_index_sort (CcShellSearchIndex  *index,
+                            guint               *panels,
+                            guint                n_panels,
+                            gchar              **terms)
+{
+  gboolean has_terms;
+  guint i, t;
+
+  g_return_if_fail (index != NULL);
+
+  if (n_panels < 2)
+    return;
+
+  has_terms = terms != NULL && terms[0] != NULL;
+
+  g_array_set_size (index->rank_keys, n_panels);
+
+  for (i = 0; i < n_panels; i++)
+    {
+      RankKey *key = &g_array_index (index->rank_keys, RankKey, i);
+      const PanelInfo *info;
+
+      g_return_if_fail (panels[i] < index->panels->len);
+
+      info = &g_array_index (index->panels, PanelInfo, panels[i]);
+
+      key->panel = panels[i];
+      key->name_matches = 0;
+      key->keyword_matches = 0;
+      key->description_matches = 0;
+
+      if (!has_terms)
+        continue;
+
+      for (t = 0; t < 32 && terms[t]; t++)
+        if (strstr (info->name, terms[t]))
+          key->name_matches |= 1u << t;
+
+      key->keyword_matches = count_matches (info->keywords, terms);
+      key->description_matches = info->description_words ? count_matches (info->description_words, terms) : -1;
+    }
+
+  g_qsort_with_data (index->rank_keys->data,
+                     n_panels,
+                     sizeof (RankKey),
+                     compare_rank_keys,
+                     index);
+
+  for (i = 0; i < n_panels; i++)
+    panels[i] = g_array_index (index->rank_keys, RankKey, i).panel;
+}
@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2017 The GNOME Foundation
+ *
+ * The Control Center is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * The Control Center is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with the Control Center; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _CC_SHELL_SEARCH_INDEX_H
+#define _CC_SHELL_SEARCH_INDEX_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _CcShellSearchIndex CcShellSearchIndex;
+
+typedef enum {
+  CC_SHELL_SEARCH_FIELD_NAME        = 1 << 0,
+  CC_SHELL_SEARCH_FIELD_DESCRIPTION = 1 << 1,
+  CC_SHELL_SEARCH_FIELD_KEYWORDS    = 1 << 2,
+
+  CC_SHELL_SEARCH_FIELD_ALL         = 0x7
+} CcShellSearchField;
+
+/* Match results are bitsets with one bit per panel, sized with
+ * cc_shell_search_index_get_n_words().
+ */
+#define CC_SHELL_SEARCH_INDEX_TEST_BIT(bits, panel) \
+  (((bits)[(panel) / 64] & (G_GUINT64_CONSTANT (1) << ((panel) % 64))) != 0)
+
+CcShellSearchIndex *cc_shell_search_index_new          (void);
+
+void                cc_shell_search_index_free         (CcShellSearchIndex  *index);
+
+gint                cc_shell_search_index_add_panel    (CcShellSearchIndex  *index,
+                                                        const gchar         *id,
+                                                        const gchar         *casefolded_name,
+                                                        const gchar         *casefolded_description,
+                                                        const gchar * const *casefolded_keywords);
+
+guint               cc_shell_search_index_get_n_panels (CcShellSearchIndex  *index);
+
+guint               cc_shell_search_index_get_n_words  (CcShellSearchIndex  *index);
+
+gint                cc_shell_search_index_lookup       (CcShellSearchIndex  *index,
+                                                        const gchar         *id);
+
+const gchar *       cc_shell_search_index_get_id       (CcShellSearchIndex  *index,
+                                                        guint                panel);
+
+gboolean            cc_shell_search_index_match_term   (CcShellSearchIndex  *index,
+                                                        const gchar         *term,
+                                                        CcShellSearchField   fields,
+                                                        guint64             *bits);
+
+gboolean            cc_shell_search_index_match_terms  (CcShellSearchIndex  *index,
+                                                        gchar              **terms,
+                                                        CcShellSearchField   fields,
+                                                        guint64             *bits);
+
+gboolean            cc_shell_search_index_panel_matches (CcShellSearchIndex *index,
+                                                         guint               panel,
+                                                         const gchar        *term,
+                                                         CcShellSearchField  fields);
+
+void                cc_shell_search_index_sort          (CcShellSearchIndex  *index,
+                                                         guint               *panels,
+                                                         guint                n_panels,
+                                                         gchar              **terms);
+
+G_END_DECLS
+
+#endif /* _CC_SHELL_SEARCH_INDEX_H */
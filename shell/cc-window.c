@@ -37,6 +37,7 @@
 #include "cc-shell.h"
 #include "cc-shell-category-view.h"
 #include "cc-shell-model.h"
+#include "cc-shell-profile.h"
 #include "cc-panel-list.h"
 #include "cc-panel-loader.h"
 #include "cc-util.h"
@@ -299,6 +300,9 @@ setup_model (CcWindow *shell)
 
   cc_panel_loader_fill_model (CC_SHELL_MODEL (shell->store));
 
+  cc_panel_list_set_search_index (CC_PANEL_LIST (shell->panel_list),
+                                  cc_shell_model_get_search_index (CC_SHELL_MODEL (shell->store)));
+
   /* Create a row for each panel */
   valid = gtk_tree_model_get_iter_first (model, &iter);
 
@@ -579,6 +583,10 @@ cc_window_dispose (GObject *object)
       self->custom_widgets = NULL;
     }
 
+  /* The panel list points to the model's search index */
+  if (self->store)
+    cc_panel_list_set_search_index (CC_PANEL_LIST (self->panel_list), NULL);
+
   g_clear_object (&self->store);
   g_clear_object (&self->active_panel);
 
@@ -801,10 +809,42 @@ create_window (CcWindow *self)
   split_decorations (settings, NULL, self);
 }
 
+static void
+first_frame_cb (GdkFrameClock *frame_clock,
+                CcWindow      *self)
+{
+  g_signal_handlers_disconnect_by_func (frame_clock, first_frame_cb, self);
+
+  cc_shell_profile_mark ("first-frame", self->current_panel_id);
+  cc_shell_profile_flush ();
+}
+
+static void
+window_map_profile_cb (GtkWidget *widget,
+                       CcWindow  *self)
+{
+  GdkFrameClock *frame_clock;
+
+  g_signal_handlers_disconnect_by_func (widget, window_map_profile_cb, self);
+
+  cc_shell_profile_mark ("window-map", NULL);
+
+  frame_clock = gtk_widget_get_frame_clock (widget);
+  if (frame_clock)
+    g_signal_connect (frame_clock, "after-paint", G_CALLBACK (first_frame_cb), self);
+}
+
 static void
 cc_window_init (CcWindow *self)
 {
+  gint64 begin;
+
+  begin = cc_shell_profile_begin ();
   gtk_widget_init_template (GTK_WIDGET (self));
+  cc_shell_profile_end (begin, "ui-inflate", "window.ui");
+
+  if (cc_shell_profile_is_enabled ())
+    g_signal_connect_after (self, "map", G_CALLBACK (window_map_profile_cb), self);
 
   create_window (self);
 
@@ -34,6 +34,7 @@
 #endif /* HAVE_CHEESE */
 
 #include "cc-application.h"
+#include "cc-shell-profile.h"
 
 int
 main (int argc, char **argv)
@@ -41,6 +42,8 @@ main (int argc, char **argv)
   GtkApplication *application;
   int status;
 
+  cc_shell_profile_init ();
+
   bindtextdomain (GETTEXT_PACKAGE, GNOMELOCALEDIR);
   bind_textdomain_codeset (GETTEXT_PACKAGE, "UTF-8");
   textdomain (GETTEXT_PACKAGE);
@@ -0,0 +1,334 @@
+/*
+ * Copyright (c) 2017 The GNOME Foundation
+ *
+ * The Control Center is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * The Control Center is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with the Control Center; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "config.h"
+
+#include <glib.h>
+#include <string.h>
+
+#include "cc-shell-search-index.h"
+
+typedef struct
+{
+  const gchar *id;
+  const gchar *name;
+  const gchar *description;
+  const gchar *keywords[6];
+} TestPanel;
+
+static const TestPanel test_panels[] = {
+  { "background", "background", "change your background image to a wallpaper or photo",
+    { "wallpaper", "screen", "desktop", NULL } },
+  { "bluetooth", "bluetooth", "turn bluetooth on and off and connect your devices",
+    { "share", "sharing", "bluetooth", "obex", "wireless", NULL } },
+  { "datetime", "date & time", "change the date and time, including time zone",
+    { "clock", "timezone", "location", NULL } },
+  { "display", "displays", "choose how to use connected monitors and projectors",
+    { "panel", "projector", "xrandr", "screen", "resolution", NULL } },
+  { "keyboard", "keyboard", "view and change keyboard shortcuts and set your typing preferences",
+    { "shortcut", "repeat", "blink", NULL } },
+  { "mouse", "mouse & touchpad", "change your mouse or touchpad sensitivity and select right or left-handed",
+    { "trackpad", "pointer", "click", "tap", "double", NULL } },
+  { "power", "power", "view your battery status and change power saving settings",
+    { "battery", "sleep", "suspend", "hibernate", "brightness", NULL } },
+  { "sound", "sound", "change sound levels, inputs, outputs, and alert sounds",
+    { "card", "microphone", "volume", "fade", "balance", NULL } },
+};
+
+static CcShellSearchIndex *
+create_index (void)
+{
+  CcShellSearchIndex *index;
+  guint i;
+
+  index = cc_shell_search_index_new ();
+
+  for (i = 0; i < G_N_ELEMENTS (test_panels); i++)
+    cc_shell_search_index_add_panel (index,
+                                     test_panels[i].id,
+                                     test_panels[i].name,
+                                     test_panels[i].description,
+                                     test_panels[i].keywords);
+
+  return index;
+}
+
+static gboolean
+panel_in_bits (CcShellSearchIndex *index,
+               const guint64      *bits,
+               const gchar        *id)
+{
+  gint panel;
+
+  panel = cc_shell_search_index_lookup (index, id);
+  g_assert_cmpint (panel, >=, 0);
+
+  return CC_SHELL_SEARCH_INDEX_TEST_BIT (bits, panel);
+}
+
+static guint
+count_bits (CcShellSearchIndex *index,
+            const guint64      *bits)
+{
+  guint i, n;
+
+  n = 0;
+  for (i = 0; i < cc_shell_search_index_get_n_panels (index); i++)
+    n += CC_SHELL_SEARCH_INDEX_TEST_BIT (bits, i) ? 1 : 0;
+
+  return n;
+}
+
+static void
+test_lookup (void)
+{
+  CcShellSearchIndex *index;
+
+  index = create_index ();
+
+  g_assert_cmpuint (cc_shell_search_index_get_n_panels (index), ==, G_N_ELEMENTS (test_panels));
+  g_assert_cmpint (cc_shell_search_index_lookup (index, "background"), ==, 0);
+  g_assert_cmpint (cc_shell_search_index_lookup (index, "sound"), ==, 7);
+  g_assert_cmpint (cc_shell_search_index_lookup (index, "unknown"), ==, -1);
+  g_assert_cmpstr (cc_shell_search_index_get_id (index, 3), ==, "display");
+
+  cc_shell_search_index_free (index);
+}
+
+static void
+test_match_term (void)
+{
+  CcShellSearchIndex *index;
+  guint64 bits[1];
+
+  index = create_index ();
+  g_assert_cmpuint (cc_shell_search_index_get_n_words (index), ==, 1);
+
+  /* Substring of a name */
+  g_assert_true (cc_shell_search_index_match_term (index, "ound", CC_SHELL_SEARCH_FIELD_ALL, bits));
+  g_assert_true (panel_in_bits (index, bits, "sound"));
+  g_assert_true (panel_in_bits (index, bits, "background"));
+  g_assert_cmpuint (count_bits (index, bits), ==, 2);
+
+  /* Keywords only match as prefixes */
+  g_assert_true (cc_shell_search_index_match_term (index, "hibern", CC_SHELL_SEARCH_FIELD_ALL, bits));
+  g_assert_true (panel_in_bits (index, bits, "power"));
+  g_assert_false (cc_shell_search_index_match_term (index, "ibernate", CC_SHELL_SEARCH_FIELD_ALL, bits));
+  g_assert_cmpuint (count_bits (index, bits), ==, 0);
+
+  /* Field masks */
+  g_assert_true (cc_shell_search_index_match_term (index, "wallpaper", CC_SHELL_SEARCH_FIELD_ALL, bits));
+  g_assert_true (panel_in_bits (index, bits, "background"));
+  g_assert_true (cc_shell_search_index_match_term (index, "wallpaper", CC_SHELL_SEARCH_FIELD_KEYWORDS, bits));
+  g_assert_false (cc_shell_search_index_match_term (index, "wallpaper", CC_SHELL_SEARCH_FIELD_NAME, bits));
+  g_assert_true (cc_shell_search_index_match_term (index, "time zone", CC_SHELL_SEARCH_FIELD_DESCRIPTION, bits));
+  g_assert_true (panel_in_bits (index, bits, "datetime"));
+
+  /* Every panel matches the empty term */
+  g_assert_true (cc_shell_search_index_match_term (index, "", CC_SHELL_SEARCH_FIELD_NAME, bits));
+  g_assert_cmpuint (count_bits (index, bits), ==, G_N_ELEMENTS (test_panels));
+
+  g_assert_true (cc_shell_search_index_panel_matches (index, 6, "batt", CC_SHELL_SEARCH_FIELD_ALL));
+  g_assert_false (cc_shell_search_index_panel_matches (index, 7, "batt", CC_SHELL_SEARCH_FIELD_ALL));
+
+  cc_shell_search_index_free (index);
+}
+
+static void
+test_match_terms (void)
+{
+  CcShellSearchIndex *index;
+  const gchar *terms_screen[] = { "screen", NULL };
+  const gchar *terms_both[] = { "screen", "res", NULL };
+  const gchar *terms_none[] = { "screen", "volume", NULL };
+  const gchar *terms_empty[] = { NULL };
+  guint64 bits[1];
+
+  index = create_index ();
+
+  g_assert_true (cc_shell_search_index_match_terms (index, (gchar **) terms_screen, CC_SHELL_SEARCH_FIELD_ALL, bits));
+  g_assert_cmpuint (count_bits (index, bits), ==, 2);
+
+  g_assert_true (cc_shell_search_index_match_terms (index, (gchar **) terms_both, CC_SHELL_SEARCH_FIELD_ALL, bits));
+  g_assert_true (panel_in_bits (index, bits, "display"));
+  g_assert_cmpuint (count_bits (index, bits), ==, 1);
+
+  g_assert_false (cc_shell_search_index_match_terms (index, (gchar **) terms_none, CC_SHELL_SEARCH_FIELD_ALL, bits));
+  g_assert_cmpuint (count_bits (index, bits), ==, 0);
+
+  g_assert_true (cc_shell_search_index_match_terms (index, (gchar **) terms_empty, CC_SHELL_SEARCH_FIELD_ALL, bits));
+  g_assert_cmpuint (count_bits (index, bits), ==, G_N_ELEMENTS (test_panels));
+
+  cc_shell_search_index_free (index);
+}
+
+static void
+test_sort (void)
+{
+  CcShellSearchIndex *index;
+  const gchar *terms_change[] = { "change", NULL };
+  const gchar *terms_screen[] = { "screen", NULL };
+  guint panels[G_N_ELEMENTS (test_panels)];
+  guint i;
+
+  index = create_index ();
+
+  /* Without terms, panels are sorted by name */
+  for (i = 0; i < G_N_ELEMENTS (panels); i++)
+    panels[i] = G_N_ELEMENTS (panels) - 1 - i;
+  cc_shell_search_index_sort (index, panels, G_N_ELEMENTS (panels), NULL);
+  g_assert_cmpstr (cc_shell_search_index_get_id (index, panels[0]), ==, "background");
+  g_assert_cmpstr (cc_shell_search_index_get_id (index, panels[2]), ==, "datetime");
+  g_assert_cmpstr (cc_shell_search_index_get_id (index, panels[7]), ==, "sound");
+
+  /* Keyword matches tie, so the name decides */
+  panels[0] = cc_shell_search_index_lookup (index, "display");
+  panels[1] = cc_shell_search_index_lookup (index, "background");
+  cc_shell_search_index_sort (index, panels, 2, (gchar **) terms_screen);
+  g_assert_cmpstr (cc_shell_search_index_get_id (index, panels[0]), ==, "background");
+  g_assert_cmpstr (cc_shell_search_index_get_id (index, panels[1]), ==, "display");
+
+  /* Panels with matching description words go first */
+  panels[0] = cc_shell_search_index_lookup (index, "bluetooth");
+  panels[1] = cc_shell_search_index_lookup (index, "sound");
+  panels[2] = cc_shell_search_index_lookup (index, "datetime");
+  cc_shell_search_index_sort (index, panels, 3, (gchar **) terms_change);
+  g_assert_cmpstr (cc_shell_search_index_get_id (index, panels[0]), ==, "datetime");
+  g_assert_cmpstr (cc_shell_search_index_get_id (index, panels[1]), ==, "sound");
+  g_assert_cmpstr (cc_shell_search_index_get_id (index, panels[2]), ==, "bluetooth");
+
+  cc_shell_search_index_free (index);
+}
+
+static CcShellSearchIndex *
+create_large_index (guint n_copies)
+{
+  CcShellSearchIndex *index;
+  guint i, j;
+
+  index = cc_shell_search_index_new ();
+
+  for (i = 0; i < n_copies; i++)
+    {
+      for (j = 0; j < G_N_ELEMENTS (test_panels); j++)
+        {
+          gchar *id;
+
+          id = g_strdup_printf ("%s-%u", test_panels[j].id, i);
+          cc_shell_search_index_add_panel (index,
+                                           id,
+                                           test_panels[j].name,
+                                           test_panels[j].description,
+                                           test_panels[j].keywords);
+          g_free (id);
+        }
+    }
+
+  return index;
+}
+
+static void
+test_many_panels (void)
+{
+  CcShellSearchIndex *index;
+  guint64 *bits;
+  guint n_panels;
+
+  index = create_large_index (20);
+  n_panels = cc_shell_search_index_get_n_panels (index);
+
+  g_assert_cmpuint (n_panels, ==, 20 * G_N_ELEMENTS (test_panels));
+  g_assert_cmpuint (cc_shell_search_index_get_n_words (index), ==, (n_panels + 63) / 64);
+
+  bits = g_new (guint64, cc_shell_search_index_get_n_words (index));
+
+  g_assert_true (cc_shell_search_index_match_term (index, "bluetooth", CC_SHELL_SEARCH_FIELD_ALL, bits));
+  g_assert_cmpuint (count_bits (index, bits), ==, 20);
+  g_assert_true (panel_in_bits (index, bits, "bluetooth-19"));
+
+  g_free (bits);
+  cc_shell_search_index_free (index);
+}
+
+/* Replays the queries a user types letter by letter, like the search
+ * entry and the search provider see them.
+ */
+static void
+test_typing_performance (void)
+{
+  const gchar *queries[] = {
+    "wallpaper", "bluetooth", "battery", "screen resolution", "time zone",
+    "keyboard shortcut", "microphone", "touchpad", "brightness", "xyz",
+  };
+  CcShellSearchIndex *index;
+  GTimer *timer;
+  guint64 *bits;
+  guint n_queries;
+  guint round, i;
+  gsize len;
+
+  if (!g_test_perf ())
+    return;
+
+  index = create_large_index (8);
+  bits = g_new (guint64, cc_shell_search_index_get_n_words (index));
+  timer = g_timer_new ();
+  n_queries = 0;
+
+  for (round = 0; round < 1000; round++)
+    {
+      for (i = 0; i < G_N_ELEMENTS (queries); i++)
+        {
+          gchar term[64];
+
+          for (len = 1; len <= strlen (queries[i]); len++)
+            {
+              g_strlcpy (term, queries[i], len + 1);
+              cc_shell_search_index_match_term (index, term, CC_SHELL_SEARCH_FIELD_ALL, bits);
+              n_queries++;
+            }
+        }
+    }
+
+  g_timer_stop (timer);
+
+  g_test_minimized_result (g_timer_elapsed (timer, NULL) * G_USEC_PER_SEC / n_queries,
+                           "%u panels, %u typed queries: %.3f µs per query",
+                           cc_shell_search_index_get_n_panels (index),
+                           n_queries,
+                           g_timer_elapsed (timer, NULL) * G_USEC_PER_SEC / n_queries);
+
+  g_timer_destroy (timer);
+  g_free (bits);
+  cc_shell_search_index_free (index);
+}
+
+int
+main (int argc, char **argv)
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/shell/search-index/lookup", test_lookup);
+  g_test_add_func ("/shell/search-index/match-term", test_match_term);
+  g_test_add_func ("/shell/search-index/match-terms", test_match_terms);
+  g_test_add_func ("/shell/search-index/sort", test_sort);
+  g_test_add_func ("/shell/search-index/many-panels", test_many_panels);
+  g_test_add_func ("/shell/search-index/typing-performance", test_typing_performance);
+
+  return g_test_run ();
+}